@@ -0,0 +1,160 @@
+#include "AllocationCounter.h"
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc
+#endif
+
+#define ALLOCATION_HEADER_SIZE 16
+
+namespace
+{
+	std::atomic<unsigned long long> allocationCount(0);
+	std::atomic<unsigned long long> allocatedBytes(0);
+
+	// In front of every allocation.  Offset is how far the memory handed out is from what malloc returned.
+	struct AllocationHeader
+	{
+		unsigned long long Size;
+		unsigned int Tag;
+		unsigned int Offset;
+	};
+	static_assert(sizeof(AllocationHeader) == ALLOCATION_HEADER_SIZE, "Keeps malloc's alignment");
+
+	void* Track(void* block, size_t size, size_t offset)
+	{
+		if (!block)
+			return nullptr;
+
+		MemoryTag tag = GetMemoryTag();
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		TrackHeapAllocation(tag, size);
+
+		char* pointer = (char*)block + offset;
+		AllocationHeader* header = (AllocationHeader*)(pointer - ALLOCATION_HEADER_SIZE);
+		header->Size = size;
+		header->Tag = tag;
+		header->Offset = (unsigned int)offset;
+		return pointer;
+	}
+
+	// Returns what malloc returned
+	void* Untrack(void* pointer)
+	{
+		AllocationHeader* header = (AllocationHeader*)((char*)pointer - ALLOCATION_HEADER_SIZE);
+		TrackHeapFree((MemoryTag)header->Tag, header->Size);
+		return (char*)pointer - header->Offset;
+	}
+
+	void* CountedAllocate(size_t size)
+	{
+		return Track(malloc(size + ALLOCATION_HEADER_SIZE), size, ALLOCATION_HEADER_SIZE);
+	}
+
+	// The header goes in a whole alignment's worth of space in front, so the memory after it stays aligned
+	void* CountedAllocateAligned(size_t size, size_t alignment)
+	{
+		size_t offset = alignment > ALLOCATION_HEADER_SIZE ? alignment : ALLOCATION_HEADER_SIZE;
+#ifdef _WIN32
+		return Track(_aligned_malloc(size + offset, alignment), size, offset);
+#else
+		// aligned_alloc wants a multiple of the alignment
+		return Track(aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment), size, offset);
+#endif
+	}
+
+	void CountedFree(void* pointer)
+	{
+		if (pointer)
+			free(Untrack(pointer));
+	}
+
+	void CountedFreeAligned(void* pointer)
+	{
+		if (!pointer)
+			return;
+#ifdef _WIN32
+		_aligned_free(Untrack(pointer));
+#else
+		free(Untrack(pointer));
+#endif
+	}
+}
+
+unsigned long long GetHeapAllocationCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+unsigned long long GetHeapAllocatedBytes()
+{
+	return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Replacements for every form of the global new and delete
+// --------------------------------------------------------
+void* operator new(size_t size)
+{
+	void* pointer = CountedAllocate(size);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* pointer = CountedAllocateAligned(size, (size_t)alignment);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, (size_t)alignment);
+}
+
+void operator delete(void* pointer) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+
+void operator delete(void* pointer, std::align_val_t) noexcept { CountedFreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { CountedFreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { CountedFreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { CountedFreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CountedFreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { CountedFreeAligned(pointer); }
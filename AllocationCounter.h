@@ -0,0 +1,13 @@
+#pragma once
+
+// Counts every allocation made through the global operator new (and so every std container, string,
+// shared_ptr, std::function... using the default allocator)
+// - AllocationCounter.cpp replaces operator new and delete for the whole program, so it only needs to be linked in
+// - Counts only go up: take the difference between two points to see what happened in between
+// - Doesn't see malloc, or memory D3D and the driver allocate for themselves
+// - Each allocation also goes to the MemoryTracker under the tag of the scope it was made in.  The tag and size
+//   are kept in 16 bytes just in front of the memory, so frees are counted against the right tag.
+
+// Allocations (and the bytes asked for) since the program started
+unsigned long long GetHeapAllocationCount();
+unsigned long long GetHeapAllocatedBytes();
@@ -0,0 +1,253 @@
+#include "AssetManager.h"
+#include "ContentHash.h"
+#include "Helpers.h"
+
+
+namespace
+{
+	size_t GetBufferSize(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer)
+	{
+		if (!buffer)
+			return 0;
+		D3D11_BUFFER_DESC desc = {};
+		buffer->GetDesc(&desc);
+		return desc.ByteWidth;
+	}
+}
+
+
+AssetManager::AssetManager(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: device(device),
+	context(context)
+{
+	textureLoader = std::make_shared<TextureLoader>(device);
+}
+
+AssetManager::~AssetManager()
+{
+}
+
+std::shared_ptr<Mesh> AssetManager::GetMesh(const std::wstring& filePath)
+{
+	return GetOrLoad(meshes, ASSET_TYPE_MESH, filePath, [this](const std::wstring& path, size_t& bytes) {
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(path.c_str(), device);
+		bytes = GetBufferSize(mesh->GetVertexBuffer()) + GetBufferSize(mesh->GetIndexBuffer());
+		return mesh;
+	});
+}
+
+std::shared_ptr<SimpleVertexShader> AssetManager::GetVertexShader(const std::wstring& filePath)
+{
+	return GetOrLoad(vertexShaders, ASSET_TYPE_VERTEX_SHADER, filePath, [this](const std::wstring& path, size_t&) {
+		return std::make_shared<SimpleVertexShader>(device, context, path.c_str());
+	});
+}
+
+std::shared_ptr<SimplePixelShader> AssetManager::GetPixelShader(const std::wstring& filePath)
+{
+	return GetOrLoad(pixelShaders, ASSET_TYPE_PIXEL_SHADER, filePath, [this](const std::wstring& path, size_t&) {
+		return std::make_shared<SimplePixelShader>(device, context, path.c_str());
+	});
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::GetTexture(const std::wstring& textureFolder, const std::string& textureName, PlaceholderType placeholder, TextureLoader::LoadedCallback onLoaded)
+{
+	std::filesystem::path folder = textureFolder;
+	return GetTexture(CanonicalPath(textureFolder + NarrowToWide(textureName) + L".png"),
+		[folder, textureName]() { return PrepareCompressedTexture(folder, textureName); },
+		placeholder, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::GetPackedORM(const std::wstring& textureFolder, const std::string& materialName, TextureLoader::LoadedCallback onLoaded)
+{
+	// Not a real file, but no real file could ever have this name either
+	std::filesystem::path folder = textureFolder;
+	return GetTexture(CanonicalPath(textureFolder + NarrowToWide(materialName)) + L"|orm",
+		[folder, materialName]() { return PreparePackedORM(folder, materialName); },
+		PLACEHOLDER_ORM, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::GetCubemap(const std::vector<std::wstring>& facePaths, TextureLoader::LoadedCallback onLoaded)
+{
+	std::wstring key;
+	std::vector<std::filesystem::path> faces;
+	for (const std::wstring& path : facePaths)
+	{
+		key += CanonicalPath(path) + L"|";
+		faces.push_back(path);
+	}
+	return GetTexture(key, [faces]() { return PrepareCubemap(faces); }, PLACEHOLDER_CUBE, onLoaded);
+}
+
+void AssetManager::ProcessCompletedLoads()
+{
+	textureLoader->ProcessCompletedLoads();
+}
+
+void AssetManager::ReleaseUnused()
+{
+	ReleaseUnused(meshes);
+	ReleaseUnused(vertexShaders);
+	ReleaseUnused(pixelShaders);
+}
+
+AssetStats AssetManager::GetStats(AssetType type)
+{
+	switch (type)
+	{
+	case ASSET_TYPE_MESH:			return CountResident(meshes, type);
+	case ASSET_TYPE_VERTEX_SHADER:	return CountResident(vertexShaders, type);
+	case ASSET_TYPE_PIXEL_SHADER:	return CountResident(pixelShaders, type);
+	default: break;
+	}
+
+	AssetStats result = stats[ASSET_TYPE_TEXTURE];
+	result.Resident = (unsigned int)residentTextures.size();
+	for (auto& resident : residentTextures)
+		result.BytesResident += resident.second.bytes;
+	for (auto& entry : textures)
+		result.References += entry.second.requests;
+	return result;
+}
+
+std::shared_ptr<TextureLoader> AssetManager::GetTextureLoader()
+{
+	return textureLoader;
+}
+
+// --------------------------------------------------------
+// Looks an asset up by path, then by content.  Only a path
+// we've never seen costs a file read (to hash it), and only
+// contents we've never seen cost an actual load.
+// --------------------------------------------------------
+template<typename T, typename LoadFunction>
+std::shared_ptr<T> AssetManager::GetOrLoad(AssetTable<T>& table, AssetType type, const std::wstring& filePath, LoadFunction load)
+{
+	std::wstring path = CanonicalPath(filePath);
+	auto knownPath = table.hashByPath.find(path);
+	if (knownPath != table.hashByPath.end())
+	{
+		auto resident = table.byHash.find(knownPath->second);
+		if (resident != table.byHash.end())
+		{
+			stats[type].Hits++;
+			return resident->second.asset;
+		}
+	}
+
+	stats[type].Misses++;
+	unsigned long long hash = 0;
+	size_t fileSize = 0;
+	if (!HashFile(path, hash, &fileSize))
+		hash = HashBytes(path.data(), path.size() * sizeof(wchar_t)); // Missing file, so at least don't collide with others
+	table.hashByPath[path] = hash;
+
+	auto resident = table.byHash.find(hash);
+	if (resident != table.byHash.end())
+	{
+		stats[type].Deduplicated++;
+		return resident->second.asset;
+	}
+
+	// Loaders can report a better size (e.g. GPU buffer sizes), otherwise the file size is used
+	size_t bytes = fileSize;
+	std::shared_ptr<T> asset = load(path, bytes);
+	table.byHash[hash] = { asset, bytes };
+	return asset;
+}
+
+template<typename T>
+void AssetManager::ReleaseUnused(AssetTable<T>& table)
+{
+	for (auto it = table.byHash.begin(); it != table.byHash.end();)
+	{
+		if (it->second.asset.use_count() == 1)
+			it = table.byHash.erase(it);
+		else
+			it++;
+	}
+}
+
+template<typename T>
+AssetStats AssetManager::CountResident(AssetTable<T>& table, AssetType type)
+{
+	AssetStats result = stats[type];
+	result.Resident = (unsigned int)table.byHash.size();
+	for (auto& resident : table.byHash)
+	{
+		result.BytesResident += resident.second.bytes;
+		result.References += (unsigned int)resident.second.asset.use_count() - 1; // Minus our own
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// Textures can only be matched by path up front, since their
+// contents aren't known until a worker has prepared them.
+// Content matching happens in OnTexturePrepared instead.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::GetTexture(const std::wstring& key, std::function<PreparedTexture()> prepare, PlaceholderType placeholder, TextureLoader::LoadedCallback onLoaded)
+{
+	auto existing = textures.find(key);
+	if (existing != textures.end())
+	{
+		stats[ASSET_TYPE_TEXTURE].Hits++;
+		existing->second.requests++;
+		if (!existing->second.loaded && onLoaded)
+			existing->second.waiting.push_back(onLoaded);
+		return existing->second.srv;
+	}
+
+	stats[ASSET_TYPE_TEXTURE].Misses++;
+	TextureEntry& entry = textures[key];
+	entry.loaded = false;
+	entry.requests = 1;
+	entry.prepare = prepare;
+	entry.placeholder = placeholder;
+	entry.rebuilt = false;
+	if (onLoaded)
+		entry.waiting.push_back(onLoaded);
+	entry.srv = textureLoader->Load(prepare, placeholder, [this, key](PreparedTexture& texture) { OnTexturePrepared(key, texture); });
+	return entry.srv;
+}
+
+void AssetManager::OnTexturePrepared(const std::wstring& key, PreparedTexture& texture)
+{
+	TextureEntry& entry = textures[key];
+	entry.loaded = true;
+	std::vector<TextureLoader::LoadedCallback> waiting = std::move(entry.waiting);
+	entry.waiting.clear();
+	if (!texture.IsValid())
+		return; // Keeps its placeholder
+
+	auto resident = residentTextures.find(texture.ContentHash);
+	if (resident != residentTextures.end())
+	{
+		stats[ASSET_TYPE_TEXTURE].Deduplicated++;
+		entry.srv = resident->second.srv;
+	}
+	else
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = CreatePreparedTexture(device, texture);
+		if (!srv && !texture.CachedFile.empty() && !entry.rebuilt)
+		{
+			// A cached DDS the device won't take is deleted, so preparing it again rebuilds it from the source
+			std::error_code error;
+			std::filesystem::remove(texture.CachedFile, error);
+			entry.loaded = false;
+			entry.rebuilt = true;
+			entry.waiting = std::move(waiting);
+			textureLoader->Load(entry.prepare, entry.placeholder, [this, key](PreparedTexture& texture) { OnTexturePrepared(key, texture); });
+			return;
+		}
+		if (!srv)
+			return;
+		residentTextures[texture.ContentHash] = { srv, texture.GetByteSize() };
+		entry.srv = srv;
+	}
+
+	// Copy the view out first, since callbacks may request more textures
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = entry.srv;
+	for (TextureLoader::LoadedCallback& callback : waiting)
+		callback(srv);
+}
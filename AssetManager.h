@@ -0,0 +1,120 @@
+#pragma once
+
+// Hands out shared meshes, shaders and textures so nothing is loaded twice
+// - Assets are found by canonical path first, then by a hash of their contents,
+//   so the same file reached through different paths (or copied under a new name) is shared
+// - Keeps per-type counts of hits, misses and resident memory for the stats panel
+
+#include "DXCore.h"
+#include "Mesh.h"
+#include "SimpleShader.h"
+#include "TextureLoader.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl/client.h>
+
+enum AssetType
+{
+	ASSET_TYPE_MESH,
+	ASSET_TYPE_VERTEX_SHADER,
+	ASSET_TYPE_PIXEL_SHADER,
+	ASSET_TYPE_TEXTURE,
+	ASSET_TYPE_COUNT
+};
+
+struct AssetStats
+{
+	unsigned int Hits = 0;			// Requests for something already loaded (or loading)
+	unsigned int Misses = 0;		// Requests for a path we hadn't seen
+	unsigned int Deduplicated = 0;	// Misses whose contents matched something already resident
+	unsigned int Resident = 0;		// Unique assets currently held
+	unsigned int References = 0;	// Handles held outside the manager (for textures: requests served)
+	size_t BytesResident = 0;
+};
+
+class AssetManager
+{
+public:
+	AssetManager(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~AssetManager();
+
+	// Paths are full paths, usually straight from FixPath()
+	std::shared_ptr<Mesh> GetMesh(const std::wstring& filePath);
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(const std::wstring& filePath);
+	std::shared_ptr<SimplePixelShader> GetPixelShader(const std::wstring& filePath);
+
+	// Textures load in the background (see TextureLoader).  These return the real texture if it's
+	// already loaded; otherwise a placeholder, with onLoaded called once the real one is ready.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTexture(const std::wstring& textureFolder, const std::string& textureName, PlaceholderType placeholder, TextureLoader::LoadedCallback onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetPackedORM(const std::wstring& textureFolder, const std::string& materialName, TextureLoader::LoadedCallback onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetCubemap(const std::vector<std::wstring>& facePaths, TextureLoader::LoadedCallback onLoaded);
+
+	// Finishes any background texture loads that are ready.  Call once per frame.
+	void ProcessCompletedLoads();
+
+	// Drops meshes and shaders that nothing outside the manager is using anymore
+	void ReleaseUnused();
+
+	AssetStats GetStats(AssetType type);
+	std::shared_ptr<TextureLoader> GetTextureLoader();
+
+private:
+	// A loaded asset, shared by every path whose contents hash the same
+	template<typename T>
+	struct ResidentAsset
+	{
+		std::shared_ptr<T> asset;
+		size_t bytes;
+	};
+
+	template<typename T>
+	struct AssetTable
+	{
+		std::unordered_map<std::wstring, unsigned long long> hashByPath;
+		std::unordered_map<unsigned long long, ResidentAsset<T>> byHash;
+	};
+
+	struct TextureEntry
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv; // The placeholder until loaded
+		bool loaded;
+		unsigned int requests;
+		std::vector<TextureLoader::LoadedCallback> waiting;
+		std::function<PreparedTexture()> prepare;
+		PlaceholderType placeholder;
+		bool rebuilt;	// Already threw away a cached file the device wouldn't take, so don't again
+	};
+
+	struct ResidentTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		size_t bytes;
+	};
+
+	template<typename T, typename LoadFunction>
+	std::shared_ptr<T> GetOrLoad(AssetTable<T>& table, AssetType type, const std::wstring& filePath, LoadFunction load);
+
+	template<typename T>
+	void ReleaseUnused(AssetTable<T>& table);
+
+	template<typename T>
+	AssetStats CountResident(AssetTable<T>& table, AssetType type);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTexture(const std::wstring& key, std::function<PreparedTexture()> prepare, PlaceholderType placeholder, TextureLoader::LoadedCallback onLoaded);
+	void OnTexturePrepared(const std::wstring& key, PreparedTexture& texture);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<TextureLoader> textureLoader;
+
+	AssetTable<Mesh> meshes;
+	AssetTable<SimpleVertexShader> vertexShaders;
+	AssetTable<SimplePixelShader> pixelShaders;
+	std::unordered_map<std::wstring, TextureEntry> textures;
+	std::unordered_map<unsigned long long, ResidentTexture> residentTextures;
+
+	AssetStats stats[ASSET_TYPE_COUNT];
+};
@@ -0,0 +1,701 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BC_USE_SSE2
+#endif
+
+namespace
+{
+	// A 4x4 block of pixels stored channel-major (structure of arrays),
+	// so four pixels of one channel can be loaded into a register at once
+	struct Block
+	{
+		alignas(16) float channels[4][16];
+	};
+
+	void LoadBlock(const ImageData& image, unsigned int blockX, unsigned int blockY, Block& block)
+	{
+		for (unsigned int y = 0; y < 4; y++)
+		{
+			// Clamp to the edge for images that aren't a multiple of 4 in size
+			unsigned int py = std::min(blockY * 4 + y, image.Height - 1);
+			for (unsigned int x = 0; x < 4; x++)
+			{
+				unsigned int px = std::min(blockX * 4 + x, image.Width - 1);
+				const unsigned char* pixel = &image.Pixels[((size_t)py * image.Width + px) * 4];
+				for (int ch = 0; ch < 4; ch++)
+					block.channels[ch][y * 4 + x] = pixel[ch];
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Picks the closest palette entry for each of the 16 pixels,
+	// comparing channels [firstChannel, firstChannel + channelCount).
+	// This is where nearly all encode time goes, so it's vectorized
+	// four pixels at a time when SSE2 is available.
+	// Returns the total squared error of the block.
+	// --------------------------------------------------------
+	float FindClosestIndices(const Block& block, int firstChannel, int channelCount, const float palette[][4], int paletteSize, unsigned char indices[16])
+	{
+		float totalError = 0;
+#ifdef BC_USE_SSE2
+		for (int group = 0; group < 16; group += 4)
+		{
+			__m128 bestError = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; p++)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int ch = 0; ch < channelCount; ch++)
+				{
+					__m128 diff = _mm_sub_ps(_mm_load_ps(&block.channels[firstChannel + ch][group]), _mm_set1_ps(palette[p][ch]));
+					error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+				}
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) int groupIndices[4];
+			alignas(16) float groupErrors[4];
+			_mm_store_si128((__m128i*)groupIndices, bestIndex);
+			_mm_store_ps(groupErrors, bestError);
+			for (int i = 0; i < 4; i++)
+			{
+				indices[group + i] = (unsigned char)groupIndices[i];
+				totalError += groupErrors[i];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float bestError = FLT_MAX;
+			for (int p = 0; p < paletteSize; p++)
+			{
+				float error = 0;
+				for (int ch = 0; ch < channelCount; ch++)
+				{
+					float diff = block.channels[firstChannel + ch][i] - palette[p][ch];
+					error += diff * diff;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = (unsigned char)p;
+				}
+			}
+			totalError += bestError;
+		}
+#endif
+		return totalError;
+	}
+
+	// --------------------------------------------------------
+	// Initial endpoints: the extent of the block's colors along
+	// their principal axis (power iteration on the covariance)
+	// --------------------------------------------------------
+	void FindEndpoints(const Block& block, int channelCount, float endpoint0[4], float endpoint1[4])
+	{
+		float mean[4] = {};
+		for (int ch = 0; ch < channelCount; ch++)
+		{
+			for (int i = 0; i < 16; i++)
+				mean[ch] += block.channels[ch][i];
+			mean[ch] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channelCount; a++)
+			{
+				for (int b = 0; b < channelCount; b++)
+					covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+			}
+		}
+
+		float axis[4] = { 1, 1, 1, 1 };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float largest = 0;
+			for (int a = 0; a < channelCount; a++)
+			{
+				for (int b = 0; b < channelCount; b++)
+					next[a] += covariance[a][b] * axis[b];
+				largest = std::max(largest, fabsf(next[a]));
+			}
+			if (largest <= FLT_EPSILON)
+				break; // Flat block, any axis works
+			for (int a = 0; a < channelCount; a++)
+				axis[a] = next[a] / largest;
+		}
+
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		float lengthSq = 0;
+		for (int ch = 0; ch < channelCount; ch++)
+			lengthSq += axis[ch] * axis[ch];
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0;
+			for (int ch = 0; ch < channelCount; ch++)
+				t += (block.channels[ch][i] - mean[ch]) * axis[ch];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (int ch = 0; ch < 4; ch++)
+		{
+			endpoint0[ch] = ch < channelCount ? std::clamp(mean[ch] + axis[ch] * minT / lengthSq, 0.0f, 255.0f) : 255.0f;
+			endpoint1[ch] = ch < channelCount ? std::clamp(mean[ch] + axis[ch] * maxT / lengthSq, 0.0f, 255.0f) : 255.0f;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Least squares refit of the endpoints once we know which
+	// interpolation weight (0-1) each pixel has chosen
+	// --------------------------------------------------------
+	void RefineEndpoints(const Block& block, int channelCount, const unsigned char indices[16], const float* weights, float endpoint0[4], float endpoint1[4])
+	{
+		float a = 0, b = 0, c = 0;
+		float x0[4] = {};
+		float x1[4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float w = weights[indices[i]];
+			a += (1 - w) * (1 - w);
+			b += (1 - w) * w;
+			c += w * w;
+			for (int ch = 0; ch < channelCount; ch++)
+			{
+				x0[ch] += (1 - w) * block.channels[ch][i];
+				x1[ch] += w * block.channels[ch][i];
+			}
+		}
+
+		float determinant = a * c - b * b;
+		if (fabsf(determinant) < FLT_EPSILON)
+			return;
+		for (int ch = 0; ch < channelCount; ch++)
+		{
+			endpoint0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+			endpoint1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+		}
+	}
+
+	// ================ BC1 ================
+	unsigned short QuantizeRGB565(const float color[4])
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	void BuildBC1Palette(unsigned short color0, unsigned short color1, float palette[4][4])
+	{
+		int r0 = (color0 >> 11) & 31, g0 = (color0 >> 5) & 63, b0 = color0 & 31;
+		int r1 = (color1 >> 11) & 31, g1 = (color1 >> 5) & 63, b1 = color1 & 31;
+		float c0[3] = { (float)((r0 << 3) | (r0 >> 2)), (float)((g0 << 2) | (g0 >> 4)), (float)((b0 << 3) | (b0 >> 2)) };
+		float c1[3] = { (float)((r1 << 3) | (r1 >> 2)), (float)((g1 << 2) | (g1 >> 4)), (float)((b1 << 3) | (b1 >> 2)) };
+		for (int ch = 0; ch < 3; ch++)
+		{
+			palette[0][ch] = c0[ch];
+			palette[1][ch] = c1[ch];
+			if (color0 > color1)
+			{
+				palette[2][ch] = (2 * c0[ch] + c1[ch]) / 3.0f;
+				palette[3][ch] = (c0[ch] + 2 * c1[ch]) / 3.0f;
+			}
+			else
+			{
+				palette[2][ch] = (c0[ch] + c1[ch]) / 2.0f;
+				palette[3][ch] = 0; // Transparent black
+			}
+		}
+		for (int i = 0; i < 4; i++)
+			palette[i][3] = (color0 <= color1 && i == 3) ? 0.0f : 255.0f;
+	}
+
+	float EncodeBC1WithEndpoints(const Block& block, const float endpoint0[4], const float endpoint1[4], unsigned char out[8], unsigned char indices[16])
+	{
+		unsigned short color0 = QuantizeRGB565(endpoint0);
+		unsigned short color1 = QuantizeRGB565(endpoint1);
+
+		// Four color mode requires color0 > color1
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		float palette[4][4];
+		BuildBC1Palette(color0, color1, palette);
+		float error;
+		if (color0 == color1)
+		{
+			memset(indices, 0, 16);
+			error = FindClosestIndices(block, 0, 3, palette, 1, indices);
+		}
+		else
+		{
+			error = FindClosestIndices(block, 0, 3, palette, 4, indices);
+		}
+
+		unsigned int packedIndices = 0;
+		for (int i = 0; i < 16; i++)
+			packedIndices |= (unsigned int)indices[i] << (i * 2);
+		memcpy(out, &color0, 2);
+		memcpy(out + 2, &color1, 2);
+		memcpy(out + 4, &packedIndices, 4);
+		return error;
+	}
+
+	void EncodeBC1(const Block& block, unsigned char out[8])
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		FindEndpoints(block, 3, endpoint0, endpoint1);
+
+		unsigned char indices[16];
+		float error = EncodeBC1WithEndpoints(block, endpoint0, endpoint1, out, indices);
+
+		// One refinement pass using the weights the palette actually has
+		unsigned short color0, color1;
+		memcpy(&color0, out, 2);
+		memcpy(&color1, out + 2, 2);
+		if (color0 == color1)
+			return;
+		float palette[4][4];
+		BuildBC1Palette(color0, color1, palette);
+		memcpy(endpoint0, palette[0], sizeof(endpoint0));
+		memcpy(endpoint1, palette[1], sizeof(endpoint1));
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		RefineEndpoints(block, 3, indices, weights, endpoint0, endpoint1);
+
+		unsigned char refined[8];
+		unsigned char refinedIndices[16];
+		if (EncodeBC1WithEndpoints(block, endpoint0, endpoint1, refined, refinedIndices) < error)
+			memcpy(out, refined, 8);
+	}
+
+	// ================ BC4 ================
+	void BuildBC4Palette(int red0, int red1, float palette[8][4])
+	{
+		palette[0][0] = (float)red0;
+		palette[1][0] = (float)red1;
+		if (red0 > red1)
+		{
+			for (int i = 2; i < 8; i++)
+				palette[i][0] = ((8 - i) * red0 + (i - 1) * red1) / 7.0f;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				palette[i][0] = ((6 - i) * red0 + (i - 1) * red1) / 5.0f;
+			palette[6][0] = 0.0f;
+			palette[7][0] = 255.0f;
+		}
+	}
+
+	void EncodeBC4(const Block& block, int channel, unsigned char out[8])
+	{
+		float low = 255.0f;
+		float high = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			low = std::min(low, block.channels[channel][i]);
+			high = std::max(high, block.channels[channel][i]);
+		}
+
+		int red0 = (int)(high + 0.5f);
+		int red1 = (int)(low + 0.5f);
+		unsigned char indices[16] = {};
+		if (red0 != red1)
+		{
+			float palette[8][4];
+			BuildBC4Palette(red0, red1, palette);
+			FindClosestIndices(block, channel, 1, palette, 8, indices);
+		}
+
+		out[0] = (unsigned char)red0;
+		out[1] = (unsigned char)red1;
+		unsigned long long packedIndices = 0;
+		for (int i = 0; i < 16; i++)
+			packedIndices |= (unsigned long long)indices[i] << (i * 3);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(packedIndices >> (i * 8));
+	}
+
+	// ================ BC7 (mode 6) ================
+	// Mode 6 is a single subset with 7 bit RGBA endpoints, one p-bit per
+	// endpoint and 4 bit indices: the best general purpose mode for
+	// smoothly varying textures, and the only one this encoder emits.
+	const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter
+	{
+		unsigned char* data;
+		int position;
+
+		void Write(unsigned int value, int bitCount)
+		{
+			for (int i = 0; i < bitCount; i++, position++)
+				data[position >> 3] |= (unsigned char)(((value >> i) & 1) << (position & 7));
+		}
+	};
+
+	struct BitReader128
+	{
+		const unsigned char* data;
+		int position;
+
+		unsigned int Read(int bitCount)
+		{
+			unsigned int value = 0;
+			for (int i = 0; i < bitCount; i++, position++)
+				value |= (unsigned int)((data[position >> 3] >> (position & 7)) & 1) << i;
+			return value;
+		}
+	};
+
+	// Quantizes an endpoint to 7 bits per channel plus a shared p-bit, picking whichever p-bit fits best
+	void QuantizeMode6Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+	{
+		float bestError = FLT_MAX;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0;
+			for (int ch = 0; ch < 4; ch++)
+			{
+				candidate[ch] = std::clamp((int)((endpoint[ch] - p) / 2.0f + 0.5f), 0, 127);
+				float diff = (float)(candidate[ch] * 2 + p) - endpoint[ch];
+				error += diff * diff;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	float EncodeBC7WithEndpoints(const Block& block, const float endpoint0[4], const float endpoint1[4], unsigned char out[16], unsigned char indices[16])
+	{
+		int q0[4], q1[4];
+		int p0, p1;
+		QuantizeMode6Endpoint(endpoint0, q0, p0);
+		QuantizeMode6Endpoint(endpoint1, q1, p1);
+
+		float palette[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int ch = 0; ch < 4; ch++)
+			{
+				int e0 = q0[ch] * 2 + p0;
+				int e1 = q1[ch] * 2 + p1;
+				palette[i][ch] = (float)(((64 - bc7Weights4[i]) * e0 + bc7Weights4[i] * e1 + 32) >> 6);
+			}
+		}
+		float error = FindClosestIndices(block, 0, 4, palette, 16, indices);
+
+		// The first pixel's index has an implicit zero high bit, so swap endpoints if needed
+		if (indices[0] & 8)
+		{
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (int i = 0; i < 16; i++)
+				indices[i] = (unsigned char)(15 - indices[i]);
+		}
+
+		memset(out, 0, 16);
+		BitWriter bits = { out, 0 };
+		bits.Write(1 << 6, 7); // Mode 6
+		for (int ch = 0; ch < 4; ch++)
+		{
+			bits.Write(q0[ch], 7);
+			bits.Write(q1[ch], 7);
+		}
+		bits.Write(p0, 1);
+		bits.Write(p1, 1);
+		bits.Write(indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			bits.Write(indices[i], 4);
+		return error;
+	}
+
+	void EncodeBC7(const Block& block, unsigned char out[16])
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		FindEndpoints(block, 4, endpoint0, endpoint1);
+
+		unsigned char indices[16];
+		float error = EncodeBC7WithEndpoints(block, endpoint0, endpoint1, out, indices);
+		if (error == 0)
+			return;
+
+		// Refit against the chosen weights (indices may have been flipped, so refit from the encoded block)
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+			weights[i] = bc7Weights4[i] / 64.0f;
+		BitReader128 bits = { out, 7 };
+		for (int ch = 0; ch < 4; ch++)
+		{
+			endpoint0[ch] = (float)(bits.Read(7) * 2);
+			endpoint1[ch] = (float)(bits.Read(7) * 2);
+		}
+		RefineEndpoints(block, 4, indices, weights, endpoint0, endpoint1);
+
+		unsigned char refined[16];
+		unsigned char refinedIndices[16];
+		if (EncodeBC7WithEndpoints(block, endpoint0, endpoint1, refined, refinedIndices) < error)
+			memcpy(out, refined, 16);
+	}
+
+	// ================ Decoding ================
+	void DecodeBC1(const unsigned char* in, unsigned char pixels[16][4])
+	{
+		unsigned short color0, color1;
+		unsigned int packedIndices;
+		memcpy(&color0, in, 2);
+		memcpy(&color1, in + 2, 2);
+		memcpy(&packedIndices, in + 4, 4);
+
+		float palette[4][4];
+		BuildBC1Palette(color0, color1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (packedIndices >> (i * 2)) & 3;
+			for (int ch = 0; ch < 4; ch++)
+				pixels[i][ch] = (unsigned char)(palette[index][ch] + 0.5f);
+		}
+	}
+
+	void DecodeBC4(const unsigned char* in, unsigned char pixels[16][4], int channel)
+	{
+		float palette[8][4];
+		BuildBC4Palette(in[0], in[1], palette);
+		unsigned long long packedIndices = 0;
+		for (int i = 0; i < 6; i++)
+			packedIndices |= (unsigned long long)in[2 + i] << (i * 8);
+		for (int i = 0; i < 16; i++)
+			pixels[i][channel] = (unsigned char)(palette[(packedIndices >> (i * 3)) & 7][0] + 0.5f);
+	}
+
+	void DecodeBC7(const unsigned char* in, unsigned char pixels[16][4])
+	{
+		if ((in[0] & 0x7F) != 0x40)
+		{
+			// Not mode 6, which we never write: flag it loudly
+			for (int i = 0; i < 16; i++)
+			{
+				pixels[i][0] = 255; pixels[i][1] = 0; pixels[i][2] = 255; pixels[i][3] = 255;
+			}
+			return;
+		}
+
+		BitReader128 bits = { in, 7 };
+		int e0[4], e1[4];
+		for (int ch = 0; ch < 4; ch++)
+		{
+			e0[ch] = bits.Read(7) << 1;
+			e1[ch] = bits.Read(7) << 1;
+		}
+		int p0 = bits.Read(1);
+		int p1 = bits.Read(1);
+		for (int ch = 0; ch < 4; ch++)
+		{
+			e0[ch] |= p0;
+			e1[ch] |= p1;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int weight = bc7Weights4[bits.Read(i == 0 ? 3 : 4)];
+			for (int ch = 0; ch < 4; ch++)
+				pixels[i][ch] = (unsigned char)(((64 - weight) * e0[ch] + weight * e1[ch] + 32) >> 6);
+		}
+	}
+}
+
+
+unsigned int GetBlockSize(BCFormat format)
+{
+	return (format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4) ? 8 : 16;
+}
+
+
+unsigned int GetDXGIFormat(BCFormat format)
+{
+	switch (format)
+	{
+	case BC_FORMAT_BC1: return 71;	// DXGI_FORMAT_BC1_UNORM
+	case BC_FORMAT_BC4: return 80;	// DXGI_FORMAT_BC4_UNORM
+	case BC_FORMAT_BC5: return 83;	// DXGI_FORMAT_BC5_UNORM
+	default:			return 98;	// DXGI_FORMAT_BC7_UNORM
+	}
+}
+
+
+// --------------------------------------------------------
+// Encodes every 4x4 block of the image.  Rows of blocks are
+// handed out to worker threads through a shared counter so
+// that uneven rows don't leave threads idle.
+// --------------------------------------------------------
+CompressedImage CompressImage(const ImageData& image, BCFormat format, unsigned int threadCount)
+{
+	CompressedImage result;
+	result.Format = format;
+	result.Width = image.Width;
+	result.Height = image.Height;
+	if (!image.IsValid())
+		return result;
+
+	unsigned int blocksWide = (image.Width + 3) / 4;
+	unsigned int blocksHigh = (image.Height + 3) / 4;
+	unsigned int blockSize = GetBlockSize(format);
+	result.Data.resize((size_t)blocksWide * blocksHigh * blockSize);
+
+	std::atomic<unsigned int> nextRow(0);
+	auto worker = [&]() {
+		Block block;
+		for (unsigned int row = nextRow++; row < blocksHigh; row = nextRow++)
+		{
+			for (unsigned int column = 0; column < blocksWide; column++)
+			{
+				LoadBlock(image, column, row, block);
+				unsigned char* out = &result.Data[((size_t)row * blocksWide + column) * blockSize];
+				switch (format)
+				{
+				case BC_FORMAT_BC1: EncodeBC1(block, out); break;
+				case BC_FORMAT_BC4: EncodeBC4(block, 0, out); break;
+				case BC_FORMAT_BC5: EncodeBC4(block, 0, out); EncodeBC4(block, 1, out + 8); break;
+				case BC_FORMAT_BC7: EncodeBC7(block, out); break;
+				}
+			}
+		}
+	};
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, blocksHigh);
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker(); // This thread helps too
+	for (std::thread& thread : threads)
+		thread.join();
+	return result;
+}
+
+
+CompressedImage CompressMipChain(const std::vector<ImageData>& mips, BCFormat format, unsigned int threadCount)
+{
+	CompressedImage result;
+	result.Format = format;
+	if (mips.empty())
+		return result;
+
+	result.Width = mips[0].Width;
+	result.Height = mips[0].Height;
+	result.MipLevels = (unsigned int)mips.size();
+	for (const ImageData& mip : mips)
+	{
+		CompressedImage level = CompressImage(mip, format, threadCount);
+		result.Data.insert(result.Data.end(), level.Data.begin(), level.Data.end());
+	}
+	return result;
+}
+
+
+ImageData DecompressImage(const CompressedImage& image)
+{
+	ImageData result;
+	result.Width = image.Width;
+	result.Height = image.Height;
+	result.Pixels.resize((size_t)image.Width * image.Height * 4);
+
+	unsigned int blocksWide = (image.Width + 3) / 4;
+	unsigned int blocksHigh = (image.Height + 3) / 4;
+	unsigned int blockSize = GetBlockSize(image.Format);
+	if (image.Data.size() < (size_t)blocksWide * blocksHigh * blockSize)
+		return result;
+
+	for (unsigned int row = 0; row < blocksHigh; row++)
+	{
+		for (unsigned int column = 0; column < blocksWide; column++)
+		{
+			const unsigned char* in = &image.Data[((size_t)row * blocksWide + column) * blockSize];
+			unsigned char pixels[16][4] = {};
+			switch (image.Format)
+			{
+			case BC_FORMAT_BC1:
+				DecodeBC1(in, pixels);
+				break;
+			case BC_FORMAT_BC4:
+				DecodeBC4(in, pixels, 0);
+				for (int i = 0; i < 16; i++)
+				{
+					pixels[i][1] = pixels[i][2] = pixels[i][0];
+					pixels[i][3] = 255;
+				}
+				break;
+			case BC_FORMAT_BC5:
+				DecodeBC4(in, pixels, 0);
+				DecodeBC4(in + 8, pixels, 1);
+				for (int i = 0; i < 16; i++)
+					pixels[i][3] = 255;
+				break;
+			case BC_FORMAT_BC7:
+				DecodeBC7(in, pixels);
+				break;
+			}
+
+			for (unsigned int y = 0; y < 4 && row * 4 + y < image.Height; y++)
+			{
+				for (unsigned int x = 0; x < 4 && column * 4 + x < image.Width; x++)
+					memcpy(&result.Pixels[(((size_t)row * 4 + y) * image.Width + column * 4 + x) * 4], pixels[y * 4 + x], 4);
+			}
+		}
+	}
+	return result;
+}
+
+
+float CalculatePSNR(const ImageData& reference, const ImageData& test, int channelCount)
+{
+	if (reference.Width != test.Width || reference.Height != test.Height || !reference.IsValid() || !test.IsValid())
+		return 0.0f;
+
+	double squaredError = 0;
+	size_t pixelCount = (size_t)reference.Width * reference.Height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int ch = 0; ch < channelCount; ch++)
+		{
+			double diff = (double)reference.Pixels[i * 4 + ch] - test.Pixels[i * 4 + ch];
+			squaredError += diff * diff;
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)pixelCount * channelCount);
+	if (meanSquaredError == 0)
+		return INFINITY;
+	return (float)(10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
+
+
+bool SaveCompressedDDS(const std::filesystem::path& path, const CompressedImage& image)
+{
+	return SaveDDS(path, GetDXGIFormat(image.Format), image.Width, image.Height, image.MipLevels, image.Data);
+}
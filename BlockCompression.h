@@ -0,0 +1,47 @@
+#pragma once
+
+// CPU block compression (BC1/BC4/BC5/BC7) for texture assets
+// - Encodes 4x4 blocks in parallel across threads, with an SSE2 inner loop where available
+// - Also decodes, so quality (PSNR) can be checked offline against the source image
+
+#include "ImageData.h"
+
+#include <filesystem>
+#include <vector>
+
+enum BCFormat
+{
+	BC_FORMAT_BC1,	// RGB, 4bpp - cheap albedo
+	BC_FORMAT_BC4,	// Single channel (red), 4bpp - roughness/metalness/etc.
+	BC_FORMAT_BC5,	// Two channels (red/green), 8bpp - tangent space normal maps
+	BC_FORMAT_BC7	// RGBA, 8bpp - high quality albedo and packed maps
+};
+
+struct CompressedImage
+{
+	BCFormat Format = BC_FORMAT_BC7;
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	unsigned int MipLevels = 1;
+	std::vector<unsigned char> Data; // Every mip's blocks, largest mip first
+};
+
+// Size of one encoded 4x4 block, in bytes
+unsigned int GetBlockSize(BCFormat format);
+
+// Matching DXGI_FORMAT value (UNORM; the shaders do their own gamma correction)
+unsigned int GetDXGIFormat(BCFormat format);
+
+// Encodes a single image.  Zero threads means "one per hardware thread".
+CompressedImage CompressImage(const ImageData& image, BCFormat format, unsigned int threadCount = 0);
+
+// Encodes every level of a mip chain (largest first, as from GenerateMipChain) into one image
+CompressedImage CompressMipChain(const std::vector<ImageData>& mips, BCFormat format, unsigned int threadCount = 0);
+
+// Decodes the top mip back to RGBA8.  Only BC7 mode 6 (the mode our encoder emits) is supported for BC7.
+ImageData DecompressImage(const CompressedImage& image);
+
+// Peak signal-to-noise ratio over the first channelCount channels (higher is better, identical = infinity)
+float CalculatePSNR(const ImageData& reference, const ImageData& test, int channelCount);
+
+bool SaveCompressedDDS(const std::filesystem::path& path, const CompressedImage& image);
@@ -0,0 +1,30 @@
+#include "Blur.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+
+// --------------------------------------------------------
+// Every texel in the box weighs the same.  Texels k and k+1
+// are read together at k + 0.5, where bilinear filtering
+// gives exactly half of each.  An odd one out at the end is
+// read on its own.
+// --------------------------------------------------------
+BlurTaps CalculateBlurTaps(int radius)
+{
+	radius = std::clamp(radius, 0, MAX_BLUR_RADIUS);
+	float texelWeight = 1.0f / (2 * radius + 1);
+
+	BlurTaps taps = {};
+	taps.Taps[0] = XMFLOAT4(0, texelWeight, 0, 0);
+	taps.Count = 1;
+	for (int texel = 1; texel <= radius; texel += 2)
+	{
+		if (texel + 1 <= radius)
+			taps.Taps[taps.Count++] = XMFLOAT4(texel + 0.5f, texelWeight * 2, 0, 0);
+		else
+			taps.Taps[taps.Count++] = XMFLOAT4((float)texel, texelWeight, 0, 0);
+	}
+	return taps;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Taps for the separable box blur (PixelShader_Blur.hlsl)
+// - A (2r+1) x (2r+1) box is the same as a (2r+1) wide blur across, then another down
+// - Neighboring texels have the same weight, so each pair is read with one bilinear sample between them
+// - Only DirectXMath (no D3D), so the taps can be checked away from the renderer
+
+#include <DirectXMath.h>
+
+#define MAX_BLUR_TAPS 8		// Must match PixelShader_Blur.hlsl
+#define MAX_BLUR_RADIUS 14	// The most texels each side that fit in that many taps
+
+// One side of the blur, mirrored by the shader.  Tap 0 is the center.
+struct BlurTaps
+{
+	DirectX::XMFLOAT4 Taps[MAX_BLUR_TAPS];	// x = offset in texels, y = weight (zw unused, for HLSL array packing)
+	int Count;
+};
+
+// Radius is in texels, and clamped to MAX_BLUR_RADIUS.  Zero gives a single tap that just copies.
+BlurTaps CalculateBlurTaps(int radius);
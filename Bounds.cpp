@@ -0,0 +1,189 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+
+AABB EmptyAABB()
+{
+	AABB box;
+	box.Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	box.Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	return box;
+}
+
+bool IsEmpty(const AABB& box)
+{
+	return box.Min.x > box.Max.x || box.Min.y > box.Max.y || box.Min.z > box.Max.z;
+}
+
+void GrowAABB(AABB& box, XMFLOAT3 point)
+{
+	XMStoreFloat3(&box.Min, XMVectorMin(XMLoadFloat3(&box.Min), XMLoadFloat3(&point)));
+	XMStoreFloat3(&box.Max, XMVectorMax(XMLoadFloat3(&box.Max), XMLoadFloat3(&point)));
+}
+
+AABB TransformAABB(const AABB& box, const XMFLOAT4X4& matrix)
+{
+	XMMATRIX transform = XMLoadFloat4x4(&matrix);
+	AABB result = EmptyAABB();
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? box.Max.x : box.Min.x,
+			(i & 2) ? box.Max.y : box.Min.y,
+			(i & 4) ? box.Max.z : box.Min.z,
+			1);
+		XMFLOAT3 transformed;
+		XMStoreFloat3(&transformed, XMVector3TransformCoord(corner, transform));
+		GrowAABB(result, transformed);
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// Works in clip space, before the divide by W, so it's the
+// same test for perspective and orthographic projections:
+// a corner is inside when -w <= x,y <= w and 0 <= z <= w
+// --------------------------------------------------------
+bool IsAABBVisible(const AABB& box, const XMFLOAT4X4& viewProjection)
+{
+	XMMATRIX transform = XMLoadFloat4x4(&viewProjection);
+	int outside[6] = {};
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			(i & 1) ? box.Max.x : box.Min.x,
+			(i & 2) ? box.Max.y : box.Min.y,
+			(i & 4) ? box.Max.z : box.Min.z,
+			1);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, transform));
+		outside[0] += clip.x < -clip.w;
+		outside[1] += clip.x > clip.w;
+		outside[2] += clip.y < -clip.w;
+		outside[3] += clip.y > clip.w;
+		outside[4] += clip.z < 0;
+		outside[5] += clip.z > clip.w;
+	}
+
+	for (int plane = 0; plane < 6; plane++)
+	{
+		if (outside[plane] == 8)
+			return false;
+	}
+	return true;
+}
+
+
+Cone GetSpotLightCone(const Light& light)
+{
+	Cone cone;
+	cone.Apex = light.Position;
+	XMStoreFloat3(&cone.Direction, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+	cone.Range = light.Range;
+	cone.CosAngle = GetSpotLightCosAngle(light.SpotFalloff);
+	cone.SinAngle = sqrtf(1.0f - cone.CosAngle * cone.CosAngle);
+	return cone;
+}
+
+// --------------------------------------------------------
+// The shader's spot term is pow(cos(angle), falloff), so it
+// reaches the cutoff at cos(angle) = cutoff ^ (1 / falloff).
+// Kept just above zero so the cone stays under 90 degrees.
+// --------------------------------------------------------
+float GetSpotLightCosAngle(float spotFalloff)
+{
+	return std::max(powf(SPOT_LIGHT_CUTOFF, 1.0f / std::max(spotFalloff, 0.001f)), 0.001f);
+}
+
+// --------------------------------------------------------
+// Along each axis the cone reaches furthest at a point on
+// its rim, unless that axis is inside the cone, in which
+// case the far end bulges out a full Range along it
+// --------------------------------------------------------
+AABB GetConeBounds(const Cone& cone)
+{
+	const float* apex = &cone.Apex.x;
+	const float* direction = &cone.Direction.x;
+	AABB box;
+	float* boxMin = &box.Min.x;
+	float* boxMax = &box.Max.x;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float along = direction[axis] * cone.CosAngle;
+		float across = sqrtf(std::max(1.0f - direction[axis] * direction[axis], 0.0f)) * cone.SinAngle;
+		float reachMax = direction[axis] >= cone.CosAngle ? 1.0f : along + across;
+		float reachMin = -direction[axis] >= cone.CosAngle ? -1.0f : along - across;
+		boxMin[axis] = apex[axis] + std::min(reachMin, 0.0f) * cone.Range;
+		boxMax[axis] = apex[axis] + std::max(reachMax, 0.0f) * cone.Range;
+	}
+	return box;
+}
+
+// --------------------------------------------------------
+// Wide cones fit best around their rim, narrow ones around
+// the apex and rim together
+// --------------------------------------------------------
+void GetConeBoundingSphere(const Cone& cone, XMFLOAT3& center, float& radius)
+{
+	float distance;
+	if (cone.CosAngle < 0.70710678f)
+	{
+		distance = cone.Range * cone.CosAngle;
+		radius = cone.Range * cone.SinAngle;
+	}
+	else
+	{
+		distance = cone.Range / (2.0f * cone.CosAngle);
+		radius = distance;
+	}
+	XMStoreFloat3(&center, XMVectorMultiplyAdd(XMLoadFloat3(&cone.Direction), XMVectorReplicate(distance), XMLoadFloat3(&cone.Apex)));
+}
+
+// --------------------------------------------------------
+// The sphere misses if it's entirely past the cone's side
+// (its distance from the nearest side, found in the plane
+// through the axis and the center), entirely behind the
+// apex, or entirely past the far end
+// --------------------------------------------------------
+bool ConeIntersectsSphere(const Cone& cone, XMFLOAT3 center, float radius)
+{
+	XMVECTOR toCenter = XMVectorSubtract(XMLoadFloat3(&center), XMLoadFloat3(&cone.Apex));
+	float lengthSquared = XMVectorGetX(XMVector3Dot(toCenter, toCenter));
+	float along = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&cone.Direction)));
+	float across = sqrtf(std::max(lengthSquared - along * along, 0.0f));
+
+	float sideDistance = cone.CosAngle * across - cone.SinAngle * along;
+	if (sideDistance > radius)
+		return false;
+	if (along < -radius)
+		return false;
+	if (lengthSquared > (cone.Range + radius) * (cone.Range + radius))
+		return false;
+	return true;
+}
+
+// --------------------------------------------------------
+// Two cheap tests that each miss some empty space: the box
+// against the cone's own box, and the sphere around the box
+// against the cone
+// --------------------------------------------------------
+bool ConeIntersectsAABB(const Cone& cone, const AABB& box)
+{
+	AABB coneBox = GetConeBounds(cone);
+	if (coneBox.Min.x > box.Max.x || coneBox.Max.x < box.Min.x ||
+		coneBox.Min.y > box.Max.y || coneBox.Max.y < box.Min.y ||
+		coneBox.Min.z > box.Max.z || coneBox.Max.z < box.Min.z)
+		return false;
+
+	XMVECTOR boxMin = XMLoadFloat3(&box.Min);
+	XMVECTOR boxMax = XMLoadFloat3(&box.Max);
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f));
+	float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boxMax, boxMin))) * 0.5f;
+	return ConeIntersectsSphere(cone, center, radius);
+}
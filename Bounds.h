@@ -0,0 +1,49 @@
+#pragma once
+
+// Axis aligned bounding boxes and spot light cones, for deciding what's worth drawing
+// - Only DirectXMath (no D3D), so culling can be checked away from the renderer
+
+#include <DirectXMath.h>
+
+#include "Lights.h"
+
+struct AABB
+{
+	DirectX::XMFLOAT3 Min;
+	DirectX::XMFLOAT3 Max;
+};
+
+// A box that contains nothing; growing it by any point makes it just that point
+AABB EmptyAABB();
+bool IsEmpty(const AABB& box);
+void GrowAABB(AABB& box, DirectX::XMFLOAT3 point);
+
+// Smallest box around all 8 transformed corners of another box
+AABB TransformAABB(const AABB& box, const DirectX::XMFLOAT4X4& matrix);
+
+// Conservative: false only if the whole box is outside one of the planes of a
+// view-projection's clip volume (so boxes near frustum corners may still pass)
+bool IsAABBVisible(const AABB& box, const DirectX::XMFLOAT4X4& viewProjection);
+
+// A spot light's cone: everything within Range of the apex and within the angle of the axis
+// (so its far end is a piece of a sphere, the same as the light's falloff)
+struct Cone
+{
+	DirectX::XMFLOAT3 Apex;
+	DirectX::XMFLOAT3 Direction;	// Normalized
+	float Range;
+	float CosAngle;	// Of the half angle, which is less than 90 degrees
+	float SinAngle;
+};
+
+// The cone a spot light reaches, where its falloff fades out (see SPOT_LIGHT_CUTOFF)
+Cone GetSpotLightCone(const Light& light);
+float GetSpotLightCosAngle(float spotFalloff);
+
+// The smallest box and sphere around a cone
+AABB GetConeBounds(const Cone& cone);
+void GetConeBoundingSphere(const Cone& cone, DirectX::XMFLOAT3& center, float& radius);
+
+// Conservative like IsAABBVisible: false only if the shapes are definitely apart
+bool ConeIntersectsSphere(const Cone& cone, DirectX::XMFLOAT3 center, float radius);
+bool ConeIntersectsAABB(const Cone& cone, const AABB& box);
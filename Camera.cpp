@@ -1,5 +1,6 @@
 #include "Camera.h"
 #include "Input.h"
+#include "Profiler.h"
 
 using namespace DirectX;
 
@@ -33,7 +34,7 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix()
 	return projectionMatrix;
 }
 
-std::shared_ptr<Transform> Camera::GetTransform()
+const std::shared_ptr<Transform>& Camera::GetTransform()
 {
 	return transform;
 }
@@ -43,8 +44,19 @@ bool Camera::IsLeftHanded()
 	return leftHanded;
 }
 
+float Camera::GetNearClip()
+{
+	return nearClipDist;
+}
+
+float Camera::GetFarClip()
+{
+	return farClipDist;
+}
+
 void Camera::Update(float dt)
 {
+	PROFILE_SCOPE("Camera::Update");
 	Input& input = Input::GetInstance();
 	int sprintSpeed = 1;
 	int handedness = leftHanded ? 1 : -1;
@@ -13,8 +13,10 @@ public:
 	// Getters
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
-	std::shared_ptr<Transform> GetTransform();
+	const std::shared_ptr<Transform>& GetTransform();
 	bool IsLeftHanded();
+	float GetNearClip();
+	float GetFarClip();
 
 	// Update functions
 	void Update(float dt);
@@ -0,0 +1,169 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+CommandBuffer::CommandBuffer(size_t initialSize)
+	: memory(std::max(initialSize, (size_t)COMMAND_ALIGNMENT)), used(0), commandCount(0), growCount(0)
+{
+}
+
+void CommandBuffer::Reset()
+{
+	used = 0;
+	commandCount = 0;
+}
+
+// --------------------------------------------------------
+// Packets are plain data that only ever point outside the
+// buffer, so growing can just copy the bytes over
+// --------------------------------------------------------
+void CommandBuffer::Reserve(size_t size)
+{
+	if (size <= memory.size())
+		return;
+
+	size_t capacity = memory.size();
+	while (capacity < size)
+		capacity *= 2;
+	memory.resize(capacity);
+	growCount++;
+}
+
+template<typename T>
+T* CommandBuffer::Add(CommandType type, unsigned int extraBytes)
+{
+	unsigned int size = (unsigned int)((sizeof(T) + extraBytes + COMMAND_ALIGNMENT - 1) & ~(size_t)(COMMAND_ALIGNMENT - 1));
+	Reserve(used + size);
+
+	// The only padding in a packet is at its end, so clearing the last few bytes keeps the
+	// bytes of identical commands identical (for CommandRecorder's hash)
+	memset(memory.data() + used + size - COMMAND_ALIGNMENT, 0, COMMAND_ALIGNMENT);
+
+	T* command = (T*)(memory.data() + used);
+	command->Header.Type = type;
+	command->Header.Stage = 0;
+	command->Header.Slot = 0;
+	command->Header.Size = size;
+	used += size;
+	commandCount++;
+	return command;
+}
+
+void CommandBuffer::SetShader(ShaderStage stage, void* shader, void* inputLayout)
+{
+	SetShaderCommand* command = Add<SetShaderCommand>(COMMAND_SET_SHADER);
+	command->Header.Stage = stage;
+	command->Shader = shader;
+	command->InputLayout = inputLayout;
+}
+
+void CommandBuffer::SetConstantBuffer(ShaderStage stage, unsigned int slot, void* buffer)
+{
+	SetResourceCommand* command = Add<SetResourceCommand>(COMMAND_SET_CONSTANT_BUFFER);
+	command->Header.Stage = stage;
+	command->Header.Slot = (unsigned short)slot;
+	command->Resource = buffer;
+}
+
+void CommandBuffer::UpdateConstants(void* buffer, const void* data, unsigned int size)
+{
+	UpdateConstantsCommand* command = Add<UpdateConstantsCommand>(COMMAND_UPDATE_CONSTANTS, size);
+	command->Buffer = buffer;
+	command->DataSize = size;
+	memcpy(command + 1, data, size);
+}
+
+void CommandBuffer::SetShaderResource(ShaderStage stage, unsigned int slot, void* view)
+{
+	SetResourceCommand* command = Add<SetResourceCommand>(COMMAND_SET_SHADER_RESOURCE);
+	command->Header.Stage = stage;
+	command->Header.Slot = (unsigned short)slot;
+	command->Resource = view;
+}
+
+void CommandBuffer::SetSampler(ShaderStage stage, unsigned int slot, void* sampler)
+{
+	SetResourceCommand* command = Add<SetResourceCommand>(COMMAND_SET_SAMPLER);
+	command->Header.Stage = stage;
+	command->Header.Slot = (unsigned short)slot;
+	command->Resource = sampler;
+}
+
+void CommandBuffer::SetVertexBuffer(void* buffer, unsigned int stride, unsigned int offset)
+{
+	SetVertexBufferCommand* command = Add<SetVertexBufferCommand>(COMMAND_SET_VERTEX_BUFFER);
+	command->Buffer = buffer;
+	command->Stride = stride;
+	command->Offset = offset;
+}
+
+void CommandBuffer::SetIndexBuffer(void* buffer)
+{
+	SetResourceCommand* command = Add<SetResourceCommand>(COMMAND_SET_INDEX_BUFFER);
+	command->Resource = buffer;
+}
+
+void CommandBuffer::SetRasterizerState(void* state)
+{
+	SetStateCommand* command = Add<SetStateCommand>(COMMAND_SET_RASTERIZER_STATE);
+	command->State = state;
+	command->StencilRef = 0;
+}
+
+void CommandBuffer::SetDepthStencilState(void* state, unsigned int stencilRef)
+{
+	SetStateCommand* command = Add<SetStateCommand>(COMMAND_SET_DEPTH_STENCIL_STATE);
+	command->State = state;
+	command->StencilRef = stencilRef;
+}
+
+void CommandBuffer::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	DrawCommand* command = Add<DrawCommand>(COMMAND_DRAW_INDEXED);
+	command->Count = indexCount;
+	command->Start = startIndex;
+	command->BaseVertex = baseVertex;
+}
+
+void CommandBuffer::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	DrawCommand* command = Add<DrawCommand>(COMMAND_DRAW);
+	command->Count = vertexCount;
+	command->Start = startVertex;
+	command->BaseVertex = 0;
+}
+
+void CommandBuffer::Append(const CommandBuffer& other)
+{
+	Reserve(used + other.used);
+	memcpy(memory.data() + used, other.memory.data(), other.used);
+	used += other.used;
+	commandCount += other.commandCount;
+}
+
+const unsigned char* CommandBuffer::GetData() const
+{
+	return memory.data();
+}
+
+size_t CommandBuffer::GetSize() const
+{
+	return used;
+}
+
+unsigned int CommandBuffer::GetCommandCount() const
+{
+	return commandCount;
+}
+
+size_t CommandBuffer::GetCapacity() const
+{
+	return memory.size();
+}
+
+unsigned int CommandBuffer::GetGrowCount() const
+{
+	return growCount;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// A list of rendering commands written down as small packets of plain data, to be run later by a CommandExecutor
+// - Packets sit back to back in one linear block of memory, each starting with a CommandHeader saying what it is
+//   and how big it is, so running a buffer is one walk from start to end
+// - Resources (shaders, buffers, views, states) are opaque pointers: the D3D objects themselves for
+//   CommandExecutorD3D11, or anything else for an executor that never touches a GPU
+// - Constant buffer contents are copied into the packet that updates them, so the source can change right after
+// - Reset() keeps the memory, so once a buffer has grown to fit a frame, recording it again doesn't allocate
+// - No D3D: this and CommandRecorder build and run anywhere
+
+#include <cstddef>
+#include <vector>
+
+#define COMMAND_BUFFER_DEFAULT_SIZE (64 * 1024)	// Bytes a buffer starts with (it doubles whenever it runs out)
+#define COMMAND_ALIGNMENT 8						// Every packet starts on a multiple of this, so its pointers are aligned
+
+enum CommandType : unsigned char
+{
+	COMMAND_SET_SHADER,					// Stage, Shader, InputLayout (vertex shaders only)
+	COMMAND_SET_CONSTANT_BUFFER,		// Stage, Slot, Buffer
+	COMMAND_UPDATE_CONSTANTS,			// Buffer, then its new contents
+	COMMAND_SET_SHADER_RESOURCE,		// Stage, Slot, View
+	COMMAND_SET_SAMPLER,				// Stage, Slot, Sampler
+	COMMAND_SET_VERTEX_BUFFER,			// Buffer, Stride, Offset (slot 0)
+	COMMAND_SET_INDEX_BUFFER,			// Buffer (32 bit indices)
+	COMMAND_SET_RASTERIZER_STATE,		// State
+	COMMAND_SET_DEPTH_STENCIL_STATE,	// State, StencilRef
+	COMMAND_DRAW_INDEXED,				// IndexCount, StartIndex, BaseVertex
+	COMMAND_DRAW,						// VertexCount, StartVertex
+
+	COMMAND_TYPE_COUNT
+};
+
+enum ShaderStage : unsigned char
+{
+	SHADER_STAGE_VERTEX,
+	SHADER_STAGE_HULL,
+	SHADER_STAGE_DOMAIN,
+	SHADER_STAGE_GEOMETRY,
+	SHADER_STAGE_PIXEL,
+
+	SHADER_STAGE_COUNT
+};
+
+// The start of every packet
+struct CommandHeader
+{
+	CommandType Type;
+	unsigned char Stage;	// For the commands that have one
+	unsigned short Slot;	// Likewise
+	unsigned int Size;		// Of the whole packet, header and any data after it included, in bytes
+};
+
+struct SetShaderCommand
+{
+	CommandHeader Header;
+	void* Shader;
+	void* InputLayout;
+};
+
+// Set constant buffers, shader resources and samplers all look the same
+struct SetResourceCommand
+{
+	CommandHeader Header;
+	void* Resource;
+};
+
+// Followed by DataSize bytes of data
+struct UpdateConstantsCommand
+{
+	CommandHeader Header;
+	void* Buffer;
+	unsigned int DataSize;
+};
+
+struct SetVertexBufferCommand
+{
+	CommandHeader Header;
+	void* Buffer;
+	unsigned int Stride;
+	unsigned int Offset;
+};
+
+struct SetStateCommand
+{
+	CommandHeader Header;
+	void* State;
+	unsigned int StencilRef;
+};
+
+struct DrawCommand
+{
+	CommandHeader Header;
+	unsigned int Count;		// Indices for DrawIndexed, vertices for Draw
+	unsigned int Start;
+	int BaseVertex;
+};
+
+class CommandBuffer
+{
+public:
+	CommandBuffer(size_t initialSize = COMMAND_BUFFER_DEFAULT_SIZE);
+
+	// Empties the buffer, keeping its memory
+	void Reset();
+
+	// Writing commands
+	void SetShader(ShaderStage stage, void* shader, void* inputLayout = nullptr);
+	void SetConstantBuffer(ShaderStage stage, unsigned int slot, void* buffer);
+	void UpdateConstants(void* buffer, const void* data, unsigned int size);
+	void SetShaderResource(ShaderStage stage, unsigned int slot, void* view);
+	void SetSampler(ShaderStage stage, unsigned int slot, void* sampler);
+	void SetVertexBuffer(void* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(void* buffer);
+	void SetRasterizerState(void* state);
+	void SetDepthStencilState(void* state, unsigned int stencilRef);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void Draw(unsigned int vertexCount, unsigned int startVertex);
+
+	// Copies every packet in another buffer onto the end of this one
+	void Append(const CommandBuffer& other);
+
+	// Reading them back: each packet's header is at GetData() + offset, and the next one is Size bytes on
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+	unsigned int GetCommandCount() const;
+
+	// How much memory the buffer has, and how many times it's had to grow into more
+	size_t GetCapacity() const;
+	unsigned int GetGrowCount() const;
+
+private:
+	// Room for a packet of type T plus extraBytes after it, with its header filled in
+	template<typename T> T* Add(CommandType type, unsigned int extraBytes = 0);
+	void Reserve(size_t size);
+
+	std::vector<unsigned char> memory;
+	size_t used;
+	unsigned int commandCount;
+	unsigned int growCount;
+};
+
+// Runs the commands in a buffer, in order
+class CommandExecutor
+{
+public:
+	virtual ~CommandExecutor() {}
+	virtual void Execute(const CommandBuffer& commands) = 0;
+};
+
+// Calls visit(header) on every packet in a buffer, in order
+template<typename Visit>
+void ForEachCommand(const CommandBuffer& commands, Visit visit)
+{
+	const unsigned char* data = commands.GetData();
+	for (size_t offset = 0; offset < commands.GetSize(); offset += ((const CommandHeader*)(data + offset))->Size)
+		visit(*(const CommandHeader*)(data + offset));
+}
@@ -0,0 +1,140 @@
+#include "CommandBufferD3D11.h"
+#include "Profiler.h"
+
+
+CommandBufferD3D11::CommandBufferD3D11(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: context(context)
+{
+}
+
+void CommandBufferD3D11::Execute(const CommandBuffer& commands)
+{
+	PROFILE_SCOPE("Execute command buffer");
+	ForEachCommand(commands, [this](const CommandHeader& header) { Run(header); });
+}
+
+// --------------------------------------------------------
+// One packet, as the context call(s) it stands for
+// --------------------------------------------------------
+void CommandBufferD3D11::Run(const CommandHeader& header)
+{
+	ID3D11DeviceContext* c = context.Get();
+	switch (header.Type)
+	{
+	case COMMAND_SET_SHADER:
+	{
+		const SetShaderCommand& command = (const SetShaderCommand&)header;
+		switch (header.Stage)
+		{
+		case SHADER_STAGE_VERTEX:
+			c->IASetInputLayout((ID3D11InputLayout*)command.InputLayout);
+			c->VSSetShader((ID3D11VertexShader*)command.Shader, 0, 0);
+			break;
+		case SHADER_STAGE_HULL: c->HSSetShader((ID3D11HullShader*)command.Shader, 0, 0); break;
+		case SHADER_STAGE_DOMAIN: c->DSSetShader((ID3D11DomainShader*)command.Shader, 0, 0); break;
+		case SHADER_STAGE_GEOMETRY: c->GSSetShader((ID3D11GeometryShader*)command.Shader, 0, 0); break;
+		case SHADER_STAGE_PIXEL: c->PSSetShader((ID3D11PixelShader*)command.Shader, 0, 0); break;
+		}
+		break;
+	}
+
+	case COMMAND_SET_CONSTANT_BUFFER:
+	{
+		ID3D11Buffer* buffer = (ID3D11Buffer*)((const SetResourceCommand&)header).Resource;
+		switch (header.Stage)
+		{
+		case SHADER_STAGE_VERTEX: c->VSSetConstantBuffers(header.Slot, 1, &buffer); break;
+		case SHADER_STAGE_HULL: c->HSSetConstantBuffers(header.Slot, 1, &buffer); break;
+		case SHADER_STAGE_DOMAIN: c->DSSetConstantBuffers(header.Slot, 1, &buffer); break;
+		case SHADER_STAGE_GEOMETRY: c->GSSetConstantBuffers(header.Slot, 1, &buffer); break;
+		case SHADER_STAGE_PIXEL: c->PSSetConstantBuffers(header.Slot, 1, &buffer); break;
+		}
+		break;
+	}
+
+	case COMMAND_UPDATE_CONSTANTS:
+	{
+		const UpdateConstantsCommand& command = (const UpdateConstantsCommand&)header;
+		c->UpdateSubresource((ID3D11Buffer*)command.Buffer, 0, 0, &command + 1, 0, 0);
+		break;
+	}
+
+	case COMMAND_SET_SHADER_RESOURCE:
+	{
+		ID3D11ShaderResourceView* view = (ID3D11ShaderResourceView*)((const SetResourceCommand&)header).Resource;
+		switch (header.Stage)
+		{
+		case SHADER_STAGE_VERTEX: c->VSSetShaderResources(header.Slot, 1, &view); break;
+		case SHADER_STAGE_HULL: c->HSSetShaderResources(header.Slot, 1, &view); break;
+		case SHADER_STAGE_DOMAIN: c->DSSetShaderResources(header.Slot, 1, &view); break;
+		case SHADER_STAGE_GEOMETRY: c->GSSetShaderResources(header.Slot, 1, &view); break;
+		case SHADER_STAGE_PIXEL: c->PSSetShaderResources(header.Slot, 1, &view); break;
+		}
+		break;
+	}
+
+	case COMMAND_SET_SAMPLER:
+	{
+		ID3D11SamplerState* sampler = (ID3D11SamplerState*)((const SetResourceCommand&)header).Resource;
+		switch (header.Stage)
+		{
+		case SHADER_STAGE_VERTEX: c->VSSetSamplers(header.Slot, 1, &sampler); break;
+		case SHADER_STAGE_HULL: c->HSSetSamplers(header.Slot, 1, &sampler); break;
+		case SHADER_STAGE_DOMAIN: c->DSSetSamplers(header.Slot, 1, &sampler); break;
+		case SHADER_STAGE_GEOMETRY: c->GSSetSamplers(header.Slot, 1, &sampler); break;
+		case SHADER_STAGE_PIXEL: c->PSSetSamplers(header.Slot, 1, &sampler); break;
+		}
+		break;
+	}
+
+	case COMMAND_SET_VERTEX_BUFFER:
+	{
+		const SetVertexBufferCommand& command = (const SetVertexBufferCommand&)header;
+		ID3D11Buffer* buffer = (ID3D11Buffer*)command.Buffer;
+		c->IASetVertexBuffers(0, 1, &buffer, &command.Stride, &command.Offset);
+		break;
+	}
+
+	case COMMAND_SET_INDEX_BUFFER:
+		c->IASetIndexBuffer((ID3D11Buffer*)((const SetResourceCommand&)header).Resource, DXGI_FORMAT_R32_UINT, 0);
+		break;
+
+	case COMMAND_SET_RASTERIZER_STATE:
+		c->RSSetState((ID3D11RasterizerState*)((const SetStateCommand&)header).State);
+		break;
+
+	case COMMAND_SET_DEPTH_STENCIL_STATE:
+	{
+		const SetStateCommand& command = (const SetStateCommand&)header;
+		c->OMSetDepthStencilState((ID3D11DepthStencilState*)command.State, command.StencilRef);
+		break;
+	}
+
+	case COMMAND_DRAW_INDEXED:
+	{
+		const DrawCommand& command = (const DrawCommand&)header;
+		c->DrawIndexed(command.Count, command.Start, command.BaseVertex);
+		break;
+	}
+
+	case COMMAND_DRAW:
+	{
+		const DrawCommand& command = (const DrawCommand&)header;
+		c->Draw(command.Count, command.Start);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+void CommandBufferD3D11::SetContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	this->context = context;
+}
+
+Microsoft::WRL::ComPtr<ID3D11DeviceContext> CommandBufferD3D11::GetContext()
+{
+	return context;
+}
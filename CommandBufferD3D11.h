@@ -0,0 +1,29 @@
+#pragma once
+
+// Runs CommandBuffers on a D3D11 context
+// - Every resource pointer in the buffer has to be the D3D11 object itself (a shader for its stage, an
+//   ID3D11Buffer, an ID3D11ShaderResourceView, etc.), which is what SimpleShader, Mesh and Sky record
+// - Nothing is held onto between commands, so the buffer's resources have to outlive executing it
+// - Only sets what the buffer says to: render targets, viewports and topology are up to whoever executes it
+
+#include "CommandBuffer.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+class CommandBufferD3D11 : public CommandExecutor
+{
+public:
+	CommandBufferD3D11(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void Execute(const CommandBuffer& commands) override;
+
+	// Which context the commands run on (an immediate or deferred one)
+	void SetContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> GetContext();
+
+private:
+	void Run(const CommandHeader& header);
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+};
@@ -0,0 +1,180 @@
+#include "CommandRecorder.h"
+
+#include <cstring>
+
+
+CommandRecorder::CommandRecorder()
+	: keepRecording(false)
+{
+	ResetState();
+	ResetStats();
+}
+
+void CommandRecorder::ResetState()
+{
+	memset(stages, 0, sizeof(stages));
+	vertexBuffer = nullptr;
+	vertexStride = 0;
+	vertexOffset = 0;
+	indexBuffer = nullptr;
+	rasterizerState = nullptr;
+	depthStencilState = nullptr;
+	stencilRef = 0;
+}
+
+void CommandRecorder::ResetStats()
+{
+	stats = CommandStats();
+	hash = 14695981039346656037ull;
+	recording.Reset();
+}
+
+// --------------------------------------------------------
+// Hashes and (maybe) keeps the whole buffer at once, then
+// runs each packet against the modelled state
+// --------------------------------------------------------
+void CommandRecorder::Execute(const CommandBuffer& commands)
+{
+	// A word at a time (packets are all a multiple of COMMAND_ALIGNMENT long)
+	const unsigned char* data = commands.GetData();
+	for (size_t i = 0; i < commands.GetSize(); i += sizeof(unsigned long long))
+	{
+		unsigned long long word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	if (keepRecording)
+		recording.Append(commands);
+
+	ForEachCommand(commands, [&](const CommandHeader& header) {
+		bool redundant = Run(header);
+		stats.Commands++;
+		stats.ByType[header.Type]++;
+		if (redundant)
+		{
+			stats.Redundant++;
+			stats.RedundantByType[header.Type]++;
+		}
+	});
+}
+
+bool CommandRecorder::Bind(void*& bound, void* value)
+{
+	bool same = bound == value;
+	bound = value;
+	return same;
+}
+
+// --------------------------------------------------------
+// Applies one command, returning whether it changed nothing
+// --------------------------------------------------------
+bool CommandRecorder::Run(const CommandHeader& header)
+{
+	StageState& stage = stages[header.Stage < SHADER_STAGE_COUNT ? header.Stage : 0];
+	unsigned int slot = header.Slot < COMMAND_RECORDER_MAX_SLOTS ? header.Slot : COMMAND_RECORDER_MAX_SLOTS - 1;
+
+	switch (header.Type)
+	{
+	case COMMAND_SET_SHADER:
+	{
+		const SetShaderCommand& command = (const SetShaderCommand&)header;
+		bool sameShader = Bind(stage.Shader, command.Shader);
+		bool sameLayout = header.Stage != SHADER_STAGE_VERTEX || Bind(stage.InputLayout, command.InputLayout);
+		return sameShader && sameLayout;
+	}
+
+	case COMMAND_SET_CONSTANT_BUFFER:
+		return Bind(stage.ConstantBuffers[slot], ((const SetResourceCommand&)header).Resource);
+
+	case COMMAND_SET_SHADER_RESOURCE:
+		return Bind(stage.ShaderResources[slot], ((const SetResourceCommand&)header).Resource);
+
+	case COMMAND_SET_SAMPLER:
+		return Bind(stage.Samplers[slot], ((const SetResourceCommand&)header).Resource);
+
+	case COMMAND_UPDATE_CONSTANTS:
+	{
+		const UpdateConstantsCommand& command = (const UpdateConstantsCommand&)header;
+		const unsigned char* data = (const unsigned char*)(&command + 1);
+		stats.ConstantBytes += command.DataSize;
+
+		std::vector<unsigned char>& contents = constants[command.Buffer];
+		bool same = contents.size() == command.DataSize && memcmp(contents.data(), data, command.DataSize) == 0;
+		if (!same)
+			contents.assign(data, data + command.DataSize);
+		return same;
+	}
+
+	case COMMAND_SET_VERTEX_BUFFER:
+	{
+		const SetVertexBufferCommand& command = (const SetVertexBufferCommand&)header;
+		bool same = vertexBuffer == command.Buffer && vertexStride == command.Stride && vertexOffset == command.Offset;
+		vertexBuffer = command.Buffer;
+		vertexStride = command.Stride;
+		vertexOffset = command.Offset;
+		return same;
+	}
+
+	case COMMAND_SET_INDEX_BUFFER:
+		return Bind(indexBuffer, ((const SetResourceCommand&)header).Resource);
+
+	case COMMAND_SET_RASTERIZER_STATE:
+		return Bind(rasterizerState, ((const SetStateCommand&)header).State);
+
+	case COMMAND_SET_DEPTH_STENCIL_STATE:
+	{
+		const SetStateCommand& command = (const SetStateCommand&)header;
+		bool same = depthStencilState == command.State && stencilRef == command.StencilRef;
+		depthStencilState = command.State;
+		stencilRef = command.StencilRef;
+		return same;
+	}
+
+	case COMMAND_DRAW_INDEXED:
+	case COMMAND_DRAW:
+		stats.Draws++;
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+const CommandStats& CommandRecorder::GetStats()
+{
+	return stats;
+}
+
+unsigned long long CommandRecorder::GetHash()
+{
+	return hash;
+}
+
+void CommandRecorder::SetKeepRecording(bool keep)
+{
+	keepRecording = keep;
+}
+
+const CommandBuffer& CommandRecorder::GetRecording()
+{
+	return recording;
+}
+
+const char* CommandRecorder::GetCommandName(CommandType type)
+{
+	switch (type)
+	{
+	case COMMAND_SET_SHADER: return "Set shader";
+	case COMMAND_SET_CONSTANT_BUFFER: return "Set constant buffer";
+	case COMMAND_UPDATE_CONSTANTS: return "Update constants";
+	case COMMAND_SET_SHADER_RESOURCE: return "Set shader resource";
+	case COMMAND_SET_SAMPLER: return "Set sampler";
+	case COMMAND_SET_VERTEX_BUFFER: return "Set vertex buffer";
+	case COMMAND_SET_INDEX_BUFFER: return "Set index buffer";
+	case COMMAND_SET_RASTERIZER_STATE: return "Set rasterizer state";
+	case COMMAND_SET_DEPTH_STENCIL_STATE: return "Set depth stencil state";
+	case COMMAND_DRAW_INDEXED: return "Draw indexed";
+	case COMMAND_DRAW: return "Draw";
+	default: return "Unknown";
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// A CommandExecutor that runs nothing: it plays the commands against a model of a D3D11 context's bound state instead
+// - Counts every command by type, and the ones that were redundant: setting what's already bound, or updating
+//   a constant buffer with exactly what it already holds
+// - Hashes every packet it sees, so two runs that should have submitted the same thing can be compared
+// - Can keep a copy of everything it's executed, to replay later into any other executor
+// - No D3D, so submission can be timed and checked on a machine without a GPU
+
+#include "CommandBuffer.h"
+
+#include <unordered_map>
+#include <vector>
+
+#define COMMAND_RECORDER_MAX_SLOTS 128		// Shader resource slots per stage, the most D3D11 has of anything
+
+struct CommandStats
+{
+	unsigned long long Commands = 0;
+	unsigned long long Redundant = 0;
+	unsigned long long Draws = 0;
+	unsigned long long ConstantBytes = 0;
+	unsigned long long ByType[COMMAND_TYPE_COUNT] = {};
+	unsigned long long RedundantByType[COMMAND_TYPE_COUNT] = {};
+};
+
+class CommandRecorder : public CommandExecutor
+{
+public:
+	CommandRecorder();
+
+	void Execute(const CommandBuffer& commands) override;
+
+	// Forgets everything bound (like starting on a new deferred context), but keeps counting
+	void ResetState();
+	// Starts the counts, the hash and the kept copy over too
+	void ResetStats();
+
+	const CommandStats& GetStats();
+	// FNV-1a (on 64 bit words) over every packet executed since ResetStats()
+	unsigned long long GetHash();
+
+	// Whether to keep a copy of what's executed (off to start with)
+	void SetKeepRecording(bool keep);
+	const CommandBuffer& GetRecording();
+
+	// Names for printing stats
+	static const char* GetCommandName(CommandType type);
+
+private:
+	struct StageState
+	{
+		void* Shader;
+		void* InputLayout;
+		void* ConstantBuffers[COMMAND_RECORDER_MAX_SLOTS];
+		void* ShaderResources[COMMAND_RECORDER_MAX_SLOTS];
+		void* Samplers[COMMAND_RECORDER_MAX_SLOTS];
+	};
+
+	// Stores value in bound, returning whether it was already there
+	static bool Bind(void*& bound, void* value);
+	bool Run(const CommandHeader& header);
+
+	StageState stages[SHADER_STAGE_COUNT];
+	void* vertexBuffer;
+	unsigned int vertexStride;
+	unsigned int vertexOffset;
+	void* indexBuffer;
+	void* rasterizerState;
+	void* depthStencilState;
+	unsigned int stencilRef;
+
+	// What each constant buffer was last updated with (buffers keep their contents from one context to the next)
+	std::unordered_map<void*, std::vector<unsigned char>> constants;
+
+	CommandStats stats;
+	unsigned long long hash;
+	bool keepRecording;
+	CommandBuffer recording;
+};
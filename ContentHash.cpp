@@ -0,0 +1,43 @@
+#include "ContentHash.h"
+
+#include <fstream>
+
+
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull; // FNV prime
+	}
+	return hash;
+}
+
+
+// --------------------------------------------------------
+// Reads in fixed size chunks so large files never need to
+// be in memory all at once
+// --------------------------------------------------------
+bool HashFile(const std::filesystem::path& path, unsigned long long& hash, size_t* fileSize)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	hash = CONTENT_HASH_SEED;
+	size_t total = 0;
+	char buffer[64 * 1024];
+	while (file)
+	{
+		file.read(buffer, sizeof(buffer));
+		size_t count = (size_t)file.gcount();
+		hash = HashBytes(buffer, count, hash);
+		total += count;
+	}
+
+	if (fileSize)
+		*fileSize = total;
+	return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// 64 bit FNV-1a hashing of asset contents
+// - Lets identical assets be recognized no matter what path they were loaded from
+// - Not cryptographic, just fast and well distributed
+
+#include <filesystem>
+
+#define CONTENT_HASH_SEED 14695981039346656037ull
+
+// Hashes a block of memory.  Pass a previous result as the seed to continue hashing more data.
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed = CONTENT_HASH_SEED);
+
+// Hashes a whole file.  Returns false if it can't be read.
+bool HashFile(const std::filesystem::path& path, unsigned long long& hash, size_t* fileSize = nullptr);
@@ -1,5 +1,7 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "MemoryTrackerD3D11.h"
+#include "Profiler.h"
 
 
 #include "ImGui/imgui_impl_win32.h"
@@ -8,6 +10,11 @@
 #include <WindowsX.h>
 #include <sstream>
 
+// Windows 10, version 1803 on, though older SDKs don't have it
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 // Define the static instance variable so our OS-level 
 // message handling function below can talk to our object
 DXCore* DXCore::DXCoreInstance = 0;
@@ -57,6 +64,13 @@ DXCore::DXCore(
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
+	maxFrameLatency(DEFAULT_MAX_FRAME_LATENCY),
+	swapChainWaitTime(0),
+	swapChainFlags(0),
+	frameLatencyWaitable(0),
+	sleepTimer(0),
+	frameReady(false),
+	inputSampleTime(0),
 	hWnd(0)
 {
 	// Save a static reference to this object.
@@ -69,6 +83,14 @@ DXCore::DXCore(
 	__int64 perfFreq = 0;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
 	perfCounterSeconds = 1.0 / (double)perfFreq;
+
+	// Something to sleep on while the frame limiter holds a frame back
+	//  - A high resolution timer wakes up within a fraction of a millisecond
+	//  - Without one (before Windows 10, version 1803) sleeps end on the system's
+	//    timer tick, and the frame limiter spins for longer to make up for it
+	sleepTimer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!sleepTimer)
+		sleepTimer = CreateWaitableTimerExW(0, 0, 0, TIMER_ALL_ACCESS);
 }
 
 // --------------------------------------------------------
@@ -81,6 +103,12 @@ DXCore::~DXCore()
 	// - If we weren't using smart pointers, we'd need to call
 	//   Release() on each Direct3D object created in DXCore
 
+	// Handles aren't though
+	if (frameLatencyWaitable)
+		CloseHandle(frameLatencyWaitable);
+	if (sleepTimer)
+		CloseHandle(sleepTimer);
+
 	// Delete input manager singleton
 	delete& Input::GetInstance();
 }
@@ -200,6 +228,12 @@ HRESULT DXCore::InitDirect3D()
 		deviceSupportsTearing = SUCCEEDED(featureCheck) && tearingSupported;
 	}
 
+	// The swap chain gives us something to wait on until it has room for
+	// another frame, so frames don't queue up behind Present() (see WaitForNextFrame())
+	swapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	if (deviceSupportsTearing)
+		swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+
 	// Create a description of how our swap
 	// chain should work
 	DXGI_SWAP_CHAIN_DESC swapDesc = {};
@@ -212,7 +246,7 @@ HRESULT DXCore::InitDirect3D()
 	swapDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
 	swapDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 	swapDesc.BufferUsage		= DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapDesc.Flags				= deviceSupportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+	swapDesc.Flags				= swapChainFlags;
 	swapDesc.OutputWindow		= hWnd;
 	swapDesc.SampleDesc.Count	= 1;
 	swapDesc.SampleDesc.Quality = 0;
@@ -238,6 +272,17 @@ HRESULT DXCore::InitDirect3D()
 		context.GetAddressOf());	// Pointer to our Device Context pointer
 	if (FAILED(hr)) return hr;
 
+	// How many frames can queue up for display, and the handle to wait on for
+	// room for another (which starts out signaled that many times)
+	{
+		Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+		if (SUCCEEDED(swapChain.As(&swapChain2)))
+		{
+			swapChain2->SetMaximumFrameLatency(maxFrameLatency);
+			frameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+		}
+	}
+
 	// Create the Render Target View for the back buffer render target
 	{
 		// The above function created the back buffer texture for us
@@ -264,9 +309,9 @@ HRESULT DXCore::InitDirect3D()
 		depthStencilDesc.Height					= windowHeight;
 		depthStencilDesc.MipLevels				= 1;
 		depthStencilDesc.ArraySize				= 1;
-		depthStencilDesc.Format					= DXGI_FORMAT_D24_UNORM_S8_UINT;
+		depthStencilDesc.Format					= DXGI_FORMAT_R24G8_TYPELESS; // Typeless, so it can also be read as a texture
 		depthStencilDesc.Usage					= D3D11_USAGE_DEFAULT;
-		depthStencilDesc.BindFlags				= D3D11_BIND_DEPTH_STENCIL;
+		depthStencilDesc.BindFlags				= D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 		depthStencilDesc.CPUAccessFlags			= 0;
 		depthStencilDesc.MiscFlags				= 0;
 		depthStencilDesc.SampleDesc.Count		= 1;
@@ -275,12 +320,23 @@ HRESULT DXCore::InitDirect3D()
 		// Create the depth buffer texture resource
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> depthBufferTexture;
 		device->CreateTexture2D(&depthStencilDesc, 0, depthBufferTexture.GetAddressOf());
+		TrackGpuResource(depthBufferTexture.Get(), MEMORY_RENDER_TARGETS);
 
 		// As long as the depth buffer texture was created successfully, 
 		// create the associated Depth Stencil View so we can use it for rendering
 		if (depthBufferTexture != 0)
 		{
-			device->CreateDepthStencilView(depthBufferTexture.Get(), 0,	depthBufferDSV.GetAddressOf());
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+			dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+			dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+			device->CreateDepthStencilView(depthBufferTexture.Get(), &dsvDesc, depthBufferDSV.GetAddressOf());
+
+			// And a view of just the depth, for post processing
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MipLevels = 1;
+			device->CreateShaderResourceView(depthBufferTexture.Get(), &srvDesc, depthBufferSRV.GetAddressOf());
 		}
 	}
 
@@ -323,6 +379,7 @@ void DXCore::OnResize()
 		// the back buffer before the resize operation
 		backBufferRTV.Reset();
 		depthBufferDSV.Reset();
+		depthBufferSRV.Reset();
 
 		// Resize the underlying swap chain buffers,
 		// which essentially destroys and recreates them
@@ -331,7 +388,7 @@ void DXCore::OnResize()
 			windowWidth,
 			windowHeight,
 			DXGI_FORMAT_R8G8B8A8_UNORM,
-			deviceSupportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+			swapChainFlags); // Has to match creation, or the resize fails
 	}
 
 	// A new back buffer requires a new Render Target View
@@ -355,9 +412,9 @@ void DXCore::OnResize()
 		depthStencilDesc.Height = windowHeight;
 		depthStencilDesc.MipLevels = 1;
 		depthStencilDesc.ArraySize = 1;
-		depthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS; // Typeless, so it can also be read as a texture
 		depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
-		depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+		depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 		depthStencilDesc.CPUAccessFlags = 0;
 		depthStencilDesc.MiscFlags = 0;
 		depthStencilDesc.SampleDesc.Count = 1;
@@ -366,12 +423,23 @@ void DXCore::OnResize()
 		// Create the depth buffer texture resource
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> depthBufferTexture;
 		device->CreateTexture2D(&depthStencilDesc, 0, depthBufferTexture.GetAddressOf());
+		TrackGpuResource(depthBufferTexture.Get(), MEMORY_RENDER_TARGETS);
 
 		// As long as the depth buffer texture was created successfully, 
 		// create the associated Depth Stencil View so we can use it for rendering
 		if (depthBufferTexture != 0)
 		{
-			device->CreateDepthStencilView(depthBufferTexture.Get(), 0,	depthBufferDSV.GetAddressOf());
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+			dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+			dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+			device->CreateDepthStencilView(depthBufferTexture.Get(), &dsvDesc, depthBufferDSV.GetAddressOf());
+
+			// And a view of just the depth, for post processing
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MipLevels = 1;
+			device->CreateShaderResourceView(depthBufferTexture.Get(), &srvDesc, depthBufferSRV.GetAddressOf());
 		}
 	}
 
@@ -394,6 +462,21 @@ void DXCore::OnResize()
  	swapChain->GetFullscreenState(&isFullscreen, 0);
 }
 
+// --------------------------------------------------------
+// Changes how many frames can be queued up for display
+// before WaitForNextFrame() holds the next one back
+//  - 1 has the least latency, but the CPU can't start the
+//    next frame until the GPU has (nearly) finished this one
+// --------------------------------------------------------
+void DXCore::SetMaxFrameLatency(unsigned int frames)
+{
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+	if (FAILED(swapChain.As(&swapChain2)) || FAILED(swapChain2->SetMaximumFrameLatency(frames)))
+		return;
+
+	maxFrameLatency = frames;
+}
+
 
 // --------------------------------------------------------
 // This is the main game loop, handling the following:
@@ -425,20 +508,41 @@ HRESULT DXCore::Run()
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
+		else if (!frameReady)
+		{
+			// Wait until it's time for the next frame, then go back round for any
+			// messages that came in meanwhile, so the frame gets the latest input
+			WaitForNextFrame();
+			frameReady = true;
+		}
 		else
 		{
+			frameReady = false;
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
 			// Update the input manager
+			inputSampleTime = GetClockSeconds();
 			Input::GetInstance().Update();
 
-			// The game loop
+			// The game loop: as many simulation steps as it takes to catch up with
+			// real time, then one update and draw of wherever that leaves things
+			timestep.Advance(deltaTime);
+			while (timestep.Step())
+				FixedUpdate(timestep.GetStepTime(), timestep.GetSimulationTime());
 			Update(deltaTime, totalTime);
 			Draw(deltaTime, totalTime);
 
+			// Draw() presents, so this is how long the input waited to be sent on its way
+			//  - Not counting the frames already queued up for display (see maxFrameLatency)
+			inputLatency.Add(GetClockSeconds() - inputSampleTime);
+
+			// Everything timed this frame goes into the profiler's history
+			Profiler::GetInstance().EndFrame();
+
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
 		}
@@ -483,6 +587,66 @@ void DXCore::UpdateTimer()
 	previousTime = currentTime;
 }
 
+double DXCore::GetClockSeconds()
+{
+	__int64 now = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	return now * perfCounterSeconds;
+}
+
+// --------------------------------------------------------
+// Sleeps on the waitable timer, which can wake up late
+// (the frame limiter measures by how much)
+// --------------------------------------------------------
+void DXCore::SleepFor(double seconds)
+{
+	// Negative for a time relative to now, in 100 nanosecond units
+	LARGE_INTEGER dueTime = {};
+	dueTime.QuadPart = -(LONGLONG)(seconds * 10000000.0);
+	if (sleepTimer && SetWaitableTimer(sleepTimer, &dueTime, 0, 0, 0, FALSE))
+		WaitForSingleObject(sleepTimer, INFINITE);
+	else
+		Sleep((DWORD)(seconds * 1000.0));
+}
+
+// --------------------------------------------------------
+// Holds the next frame back until:
+//  - The swap chain has room for it, so it doesn't sit in
+//    a queue of frames waiting to be displayed, with input
+//    that's older by each frame ahead of it
+//  - It's due, if the frame limiter has a target frame rate
+//    (most useful with vsync off, which would otherwise
+//    render as many frames as it can, mostly never seen).
+//    It sleeps most of the way and spins the rest.
+// --------------------------------------------------------
+void DXCore::WaitForNextFrame()
+{
+	if (frameLatencyWaitable)
+	{
+		PROFILE_SCOPE("Wait for swap chain");
+		double start = GetClockSeconds();
+		WaitForSingleObjectEx(frameLatencyWaitable, 1000, TRUE);
+		swapChainWaitTime = (float)((GetClockSeconds() - start) * 1000.0);
+	}
+
+	double sleepTime = frameLimiter.GetSleepTime(GetClockSeconds());
+	if (sleepTime > 0)
+	{
+		PROFILE_SCOPE("Frame limiter sleep");
+		double start = GetClockSeconds();
+		SleepFor(sleepTime);
+		frameLimiter.Slept(sleepTime, GetClockSeconds() - start);
+	}
+
+	if (frameLimiter.GetWaitTime(GetClockSeconds()) > 0)
+	{
+		PROFILE_SCOPE("Frame limiter spin");
+		while (frameLimiter.GetWaitTime(GetClockSeconds()) > 0)
+			YieldProcessor();
+	}
+	frameLimiter.StartFrame(GetClockSeconds());
+}
+
 
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
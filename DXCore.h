@@ -1,5 +1,8 @@
 #pragma once
 
+#include "FixedTimestep.h"
+#include "FramePacing.h"
+
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
@@ -10,6 +13,8 @@
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
 
+#define DEFAULT_MAX_FRAME_LATENCY 2	// Frames the swap chain lets queue up for display (1 for the least latency)
+
 class DXCore
 {
 public:
@@ -43,6 +48,9 @@ public:
 
 	// Pure virtual methods for setup and game functionality
 	virtual void Init() = 0;
+	// Simulation, run in steps of a fixed length: none, one or several times a frame (see FixedTimestep.h)
+	virtual void FixedUpdate(float stepTime, float simulationTime) = 0;
+	// Once a frame, after any steps.  timestep.GetInterpolation() is how far to draw between the last two steps.
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
@@ -66,6 +74,16 @@ protected:
 	bool deviceSupportsTearing;
 	BOOL isFullscreen; // Due to alt+enter key combination (must be BOOL typedef)
 
+	// When FixedUpdate() runs
+	FixedTimestep timestep;
+
+	// Frame pacing (see WaitForNextFrame())
+	unsigned int maxFrameLatency;
+	FrameLimiter frameLimiter;		// Holds frames back to a target frame rate, if it has one
+	LatencyHistory inputLatency;	// From sampling input to presenting the frame it went into
+	float swapChainWaitTime;		// Milliseconds the last frame waited for the swap chain
+	void SetMaxFrameLatency(unsigned int frames);
+
 	// DirectX related objects and variables
 	D3D_FEATURE_LEVEL		dxFeatureLevel;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>		swapChain;
@@ -74,6 +92,7 @@ protected:
 
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> depthBufferSRV; // Only readable while depthBufferDSV isn't bound
 
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
@@ -91,7 +110,17 @@ private:
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 
+	// Frame pacing
+	unsigned int swapChainFlags;	// Must be the same when the swap chain's resized
+	HANDLE frameLatencyWaitable;	// Signaled when the swap chain has room for another frame
+	HANDLE sleepTimer;				// High resolution where Windows has them
+	bool frameReady;				// Waited for, but messages still to handle before it starts
+	double inputSampleTime;
+
 	void UpdateTimer();			// Updates the timer for this frame
+	double GetClockSeconds();	// Since an arbitrary point, from the performance counter
+	void SleepFor(double seconds);
+	void WaitForNextFrame();	// Until the swap chain and frame limiter are both ready for another frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
 };
 
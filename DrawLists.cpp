@@ -0,0 +1,85 @@
+#include "DrawLists.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+
+void SplitDraws(unsigned int drawCount, unsigned int maxLists, unsigned int minDrawsPerList, std::vector<DrawListRange>& ranges)
+{
+	ranges.clear();
+	if (drawCount == 0)
+		return;
+
+	unsigned int listCount = std::max(1u, std::min(maxLists, drawCount / std::max(1u, minDrawsPerList)));
+	for (unsigned int list = 0; list < listCount; list++)
+	{
+		// 64 bit, so many draws times many lists can't overflow
+		unsigned int first = (unsigned int)((unsigned long long)drawCount * list / listCount);
+		unsigned int end = (unsigned int)((unsigned long long)drawCount * (list + 1) / listCount);
+		ranges.push_back({ first, end });
+	}
+}
+
+
+DrawLists::DrawLists(DrawListBackend* backend, std::shared_ptr<JobSystem> jobs)
+	: backend(backend), jobs(jobs), maxLists(DRAW_LISTS_MAX), minDrawsPerList(DRAW_LISTS_MIN_DRAWS)
+{
+}
+
+// --------------------------------------------------------
+// Each list is one job, so a thread records a whole run of
+// draws into one list from start to finish.  Executing has
+// to wait for all of them, and happens back on this thread
+// (the only one allowed to use the immediate context).
+// --------------------------------------------------------
+void DrawLists::Record(unsigned int drawCount, const RecordFunction& record)
+{
+	unsigned int listLimit = std::min(maxLists, jobs ? jobs->GetThreadCount() : 1);
+	SplitDraws(drawCount, listLimit, minDrawsPerList, ranges);
+	if (ranges.size() <= 1)
+	{
+		ranges.clear();
+		if (drawCount > 0)
+			record(DRAW_LIST_IMMEDIATE, 0, drawCount);
+		return;
+	}
+
+	jobs->ParallelFor((unsigned int)ranges.size(), 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int list = begin; list < end; list++)
+		{
+			PROFILE_SCOPE("Record draw list");
+			backend->BeginList(list);
+			record(list, ranges[list].First, ranges[list].End);
+			backend->FinishList(list);
+		}
+	});
+
+	PROFILE_SCOPE("Execute draw lists");
+	for (unsigned int list = 0; list < ranges.size(); list++)
+		backend->ExecuteList(list);
+}
+
+void DrawLists::SetMaxLists(unsigned int maxLists)
+{
+	this->maxLists = std::min(std::max(maxLists, 1u), (unsigned int)DRAW_LISTS_MAX);
+}
+
+unsigned int DrawLists::GetMaxLists()
+{
+	return maxLists;
+}
+
+void DrawLists::SetMinDrawsPerList(unsigned int minDraws)
+{
+	minDrawsPerList = std::max(minDraws, 1u);
+}
+
+unsigned int DrawLists::GetMinDrawsPerList()
+{
+	return minDrawsPerList;
+}
+
+const std::vector<DrawListRange>& DrawLists::GetRanges()
+{
+	return ranges;
+}
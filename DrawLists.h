@@ -0,0 +1,72 @@
+#pragma once
+
+// Records a pass's draws on several threads at once, then plays them back in order
+// - The draws are split into runs of neighbouring draws, one command list each, recorded in parallel by the JobSystem
+// - The lists are executed one after another in list order, so the draws land in the same order as if
+//   they'd been recorded on one thread
+// - Too few draws to be worth splitting are recorded straight onto the immediate context instead
+// - No D3D: the lists themselves are made and executed by a DrawListBackend
+
+#include "JobSystem.h"
+
+#include <climits>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#define DRAW_LISTS_MAX 16					// Lists the backend needs to be able to record at once
+#define DRAW_LISTS_MIN_DRAWS 64				// Default for the fewest draws worth giving their own list
+#define DRAW_LIST_IMMEDIATE UINT_MAX		// The "list" that's recorded straight onto the immediate context
+
+// Makes, records and executes the lists.  Lists are numbered 0 to DRAW_LISTS_MAX - 1.
+class DrawListBackend
+{
+public:
+	virtual ~DrawListBackend() {}
+
+	// Around a list's recording, on the thread that records it
+	virtual void BeginList(unsigned int list) = 0;
+	virtual void FinishList(unsigned int list) = 0;
+
+	// On the thread that called DrawLists::Record(), once every list is finished, in list order
+	virtual void ExecuteList(unsigned int list) = 0;
+};
+
+// The draws one list records: First up to (but not including) End
+struct DrawListRange
+{
+	unsigned int First;
+	unsigned int End;
+};
+
+// Splits drawCount draws into as many runs as possible (up to maxLists) of at least minDrawsPerList each,
+// as evenly as it can.  Always at least one run, unless there are no draws at all.
+void SplitDraws(unsigned int drawCount, unsigned int maxLists, unsigned int minDrawsPerList, std::vector<DrawListRange>& ranges);
+
+class DrawLists
+{
+public:
+	// Records draws first to end - 1 into a list (or the immediate context, for DRAW_LIST_IMMEDIATE)
+	typedef std::function<void(unsigned int list, unsigned int first, unsigned int end)> RecordFunction;
+
+	DrawLists(DrawListBackend* backend, std::shared_ptr<JobSystem> jobs);
+
+	// Records drawCount draws and executes them, returning once they're all on the immediate context
+	void Record(unsigned int drawCount, const RecordFunction& record);
+
+	// At most one list per thread in the job system, and never more than DRAW_LISTS_MAX.  One list turns it off.
+	void SetMaxLists(unsigned int maxLists);
+	unsigned int GetMaxLists();
+	void SetMinDrawsPerList(unsigned int minDraws);
+	unsigned int GetMinDrawsPerList();
+
+	// What the last Record() did.  No ranges means it recorded on the immediate context.
+	const std::vector<DrawListRange>& GetRanges();
+
+private:
+	DrawListBackend* backend;
+	std::shared_ptr<JobSystem> jobs;
+	unsigned int maxLists;
+	unsigned int minDrawsPerList;
+	std::vector<DrawListRange> ranges;
+};
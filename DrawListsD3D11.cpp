@@ -0,0 +1,49 @@
+#include "DrawListsD3D11.h"
+#include "SimpleShader.h"
+
+static_assert(DRAW_LISTS_MAX <= SIMPLE_SHADER_RECORDING_SLOTS, "Each list records in its own SimpleShader slot");
+
+
+DrawListsD3D11::DrawListsD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: context(context), driverCommandLists(false)
+{
+	for (unsigned int list = 0; list < DRAW_LISTS_MAX; list++)
+		device->CreateDeferredContext(0, deferredContexts[list].GetAddressOf());
+
+	D3D11_FEATURE_DATA_THREADING threading = {};
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading))))
+		driverCommandLists = threading.DriverCommandLists != FALSE;
+}
+
+void DrawListsD3D11::BeginList(unsigned int list)
+{
+	// Slot 0 is the shaders' own local data, so lists start at 1
+	ISimpleShader::BeginRecording(deferredContexts[list].Get(), list + 1);
+}
+
+void DrawListsD3D11::FinishList(unsigned int list)
+{
+	ISimpleShader::EndRecording();
+
+	// Not keeping the deferred context's state means the next list recorded on it starts from nothing again
+	deferredContexts[list]->FinishCommandList(FALSE, commandLists[list].ReleaseAndGetAddressOf());
+}
+
+void DrawListsD3D11::ExecuteList(unsigned int list)
+{
+	if (!commandLists[list])
+		return;
+
+	context->ExecuteCommandList(commandLists[list].Get(), TRUE);
+	commandLists[list].Reset();
+}
+
+Microsoft::WRL::ComPtr<ID3D11DeviceContext> DrawListsD3D11::GetContext(unsigned int list)
+{
+	return list == DRAW_LIST_IMMEDIATE ? context : deferredContexts[list];
+}
+
+bool DrawListsD3D11::HasDriverCommandLists()
+{
+	return driverCommandLists;
+}
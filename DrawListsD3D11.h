@@ -0,0 +1,34 @@
+#pragma once
+
+// The DrawLists' D3D11 side
+// - One deferred context per list, made up front, each finished into a command list that the immediate context executes
+// - While a list records, every SimpleShader on that thread draws into its deferred context (see ISimpleShader::BeginRecording)
+// - A deferred context starts with nothing bound, so whatever records into it has to bind its own targets and state
+// - Executing keeps the immediate context's state as it was, so the passes after don't notice
+
+#include "DrawLists.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+class DrawListsD3D11 : public DrawListBackend
+{
+public:
+	DrawListsD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void BeginList(unsigned int list) override;
+	void FinishList(unsigned int list) override;
+	void ExecuteList(unsigned int list) override;
+
+	// Where a list records (the immediate context for DRAW_LIST_IMMEDIATE)
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> GetContext(unsigned int list);
+
+	// False if the runtime emulates command lists because the driver can't make them itself
+	bool HasDriverCommandLists();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deferredContexts[DRAW_LISTS_MAX];
+	Microsoft::WRL::ComPtr<ID3D11CommandList> commandLists[DRAW_LISTS_MAX];
+	bool driverCommandLists;
+};
@@ -2,7 +2,8 @@
 
 Entity::Entity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) 
     : mesh(mesh), 
-    material(material)
+    material(material),
+    isStatic(false)
 {
     transform = std::make_shared<Transform>(Transform()); // The entity starts at (0, 0, 0) by default
 }
@@ -11,21 +12,26 @@ Entity::~Entity()
 {
 }
 
-std::shared_ptr<Mesh> Entity::GetMesh()
+const std::shared_ptr<Mesh>& Entity::GetMesh()
 {
     return mesh;
 }
 
-std::shared_ptr<Transform> Entity::GetTransform()
+const std::shared_ptr<Transform>& Entity::GetTransform()
 {
     return transform;
 }
 
-std::shared_ptr<Material> Entity::GetMaterial()
+const std::shared_ptr<Material>& Entity::GetMaterial()
 {
     return material;
 }
 
+bool Entity::IsStatic()
+{
+    return isStatic;
+}
+
 void Entity::SetMesh(std::shared_ptr<Mesh> newMesh)
 {
     mesh = newMesh;
@@ -35,3 +41,8 @@ void Entity::SetMaterial(std::shared_ptr<Material> newMaterial)
 {
     material = newMaterial;
 }
+
+void Entity::SetStatic(bool newIsStatic)
+{
+    isStatic = newIsStatic;
+}
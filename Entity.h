@@ -15,17 +15,20 @@ public:
 	~Entity();
 
 	// Getters
-	std::shared_ptr<Mesh> GetMesh();
-	std::shared_ptr<Transform> GetTransform();
-	std::shared_ptr<Material> GetMaterial();
+	const std::shared_ptr<Mesh>& GetMesh();
+	const std::shared_ptr<Transform>& GetTransform();
+	const std::shared_ptr<Material>& GetMaterial();
+	bool IsStatic(); // Static entities are expected to rarely move, so their shadows are cached
 
 	// Setters
 	void SetMesh(std::shared_ptr<Mesh> newMesh);
 	void SetMaterial(std::shared_ptr<Material> newMaterial);
+	void SetStatic(bool newIsStatic);
 
 private:
 	std::shared_ptr <Transform> transform;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	bool isStatic;
 };
 
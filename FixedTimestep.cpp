@@ -0,0 +1,90 @@
+#include "FixedTimestep.h"
+
+
+FixedTimestep::FixedTimestep(float tickRate, unsigned int maxSteps)
+	: stepTime(1.0 / tickRate), maxSteps(maxSteps), accumulator(0), simulationTime(0), stepCount(0), stepsThisFrame(0), droppedTime(0)
+{
+}
+
+// --------------------------------------------------------
+// Anything more than this frame's steps can use is dropped
+// now, so what's left over afterwards is always less than
+// a step (and the interpolation stays between 0 and 1)
+// --------------------------------------------------------
+void FixedTimestep::Advance(double elapsedSeconds)
+{
+	if (elapsedSeconds > 0)
+		accumulator += elapsedSeconds;
+	stepsThisFrame = 0;
+
+	double limit = maxSteps * stepTime;
+	if (accumulator > limit)
+	{
+		droppedTime += accumulator - limit;
+		accumulator = limit;
+	}
+}
+
+bool FixedTimestep::Step()
+{
+	if (stepsThisFrame >= maxSteps || accumulator < stepTime)
+		return false;
+
+	accumulator -= stepTime;
+	simulationTime += stepTime;
+	stepCount++;
+	stepsThisFrame++;
+	return true;
+}
+
+void FixedTimestep::SetTickRate(float ticksPerSecond)
+{
+	stepTime = 1.0 / ticksPerSecond;
+}
+
+void FixedTimestep::SetMaxSteps(unsigned int newMaxSteps)
+{
+	maxSteps = newMaxSteps;
+}
+
+float FixedTimestep::GetTickRate()
+{
+	return (float)(1.0 / stepTime);
+}
+
+unsigned int FixedTimestep::GetMaxSteps()
+{
+	return maxSteps;
+}
+
+float FixedTimestep::GetStepTime()
+{
+	return (float)stepTime;
+}
+
+float FixedTimestep::GetSimulationTime()
+{
+	return (float)simulationTime;
+}
+
+unsigned long long FixedTimestep::GetStepCount()
+{
+	return stepCount;
+}
+
+unsigned int FixedTimestep::GetStepsThisFrame()
+{
+	return stepsThisFrame;
+}
+
+double FixedTimestep::GetDroppedTime()
+{
+	return droppedTime;
+}
+
+float FixedTimestep::GetInterpolation()
+{
+	// Only over a step if the tick rate went up since Advance()
+	double interpolation = accumulator / stepTime;
+	return (float)(interpolation < 1.0 ? interpolation : 1.0);
+}
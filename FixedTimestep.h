@@ -0,0 +1,50 @@
+#pragma once
+
+// Turns the real time between frames into a whole number of fixed length simulation steps
+// - Real time builds up from frame to frame, and a step is taken for each full step's worth, so the simulation
+//   keeps pace with real time on average and gives the same results whatever the frame rate
+// - At most maxSteps are taken in one frame.  Time beyond that (a hitch, a breakpoint, loading) is dropped, so the
+//   simulation falls behind rather than spending ever longer catching up.
+// - What's left over, as a fraction of a step, is how far between the last two steps' states to draw
+// - No Windows: the caller measures the time, so it can be driven by a fake clock
+
+#define FIXED_TIMESTEP_DEFAULT_RATE 60.0f		// Steps per second
+#define FIXED_TIMESTEP_DEFAULT_MAX_STEPS 5		// Per frame
+
+class FixedTimestep
+{
+public:
+	FixedTimestep(float tickRate = FIXED_TIMESTEP_DEFAULT_RATE, unsigned int maxSteps = FIXED_TIMESTEP_DEFAULT_MAX_STEPS);
+
+	// Once a frame, with the real time since the last one.  Then call Step() until it returns false:
+	//     timestep.Advance(deltaTime);
+	//     while (timestep.Step())
+	//         FixedUpdate(timestep.GetStepTime(), timestep.GetSimulationTime());
+	void Advance(double elapsedSeconds);
+	// Takes a step if there's a step's worth of time left this frame
+	bool Step();
+
+	// Time already built up carries over into steps of the new length
+	void SetTickRate(float ticksPerSecond);
+	void SetMaxSteps(unsigned int newMaxSteps);
+	float GetTickRate();
+	unsigned int GetMaxSteps();
+
+	float GetStepTime();			// Seconds a step covers
+	float GetSimulationTime();		// Seconds simulated, up to the end of the last step
+	unsigned long long GetStepCount();
+	unsigned int GetStepsThisFrame();
+	double GetDroppedTime();		// Real time the simulation has fallen behind by, over the whole run
+
+	// How far this frame is from the state before the last step (0) to the state after it (1)
+	float GetInterpolation();
+
+private:
+	double stepTime;
+	unsigned int maxSteps;
+	double accumulator;		// Real time not simulated yet
+	double simulationTime;
+	unsigned long long stepCount;
+	unsigned int stepsThisFrame;
+	double droppedTime;
+};
@@ -0,0 +1,139 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+FrameArena::FrameArena(size_t blockSize)
+	: current(0), peak(0), overflowCount(0)
+{
+	for (Block& block : blocks)
+	{
+		block.Size = std::max(blockSize, (size_t)1);
+		block.Memory = new char[block.Size];
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for (Block& block : blocks)
+	{
+		FreeChunks(block);
+		delete[] block.Memory;
+	}
+}
+
+// --------------------------------------------------------
+// Moves on to the oldest block.  If that one ran out the
+// last time it was used, it's swapped for one big enough
+// for everything it was asked for, so it won't run out again
+// (unless frames keep getting bigger)
+// --------------------------------------------------------
+void FrameArena::NextFrame()
+{
+	Block& finished = blocks[current];
+	peak = std::max(peak, finished.Used.load() + finished.Overflow);
+
+	current = (current + 1) % FRAME_ARENA_FRAMES;
+	Block& block = blocks[current];
+
+	if (block.Overflow > 0)
+	{
+		// Grown by at least half again, so a frame that creeps up a little each time doesn't reallocate each time
+		size_t needed = block.Used.load() + block.Overflow;
+		size_t size = std::max(needed, block.Size + block.Size / 2);
+		delete[] block.Memory;
+		block.Memory = new char[size];
+		block.Size = size;
+	}
+
+	FreeChunks(block);
+	block.Used = 0;
+}
+
+// --------------------------------------------------------
+// Bumps the offset into this frame's block with a compare and
+// swap, so threads can allocate at once without a lock.  Only
+// once the block's full does anything take the mutex.
+// --------------------------------------------------------
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	Block& block = blocks[current];
+	uintptr_t base = (uintptr_t)block.Memory;
+
+	size_t used = block.Used.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		size_t offset = ((base + used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+		if (offset + size > block.Size)
+			return AllocateFromChunk(block, size, alignment);
+
+		if (block.Used.compare_exchange_weak(used, offset + size, std::memory_order_relaxed))
+			return block.Memory + offset;
+	}
+}
+
+void* FrameArena::AllocateFromChunk(Block& block, size_t size, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	block.Overflow += size + alignment;
+
+	if (!block.Chunks.empty())
+	{
+		uintptr_t base = (uintptr_t)block.Chunks.back();
+		size_t offset = ((base + block.ChunkUsed + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+		if (offset + size <= block.ChunkSize)
+		{
+			block.ChunkUsed = offset + size;
+			return block.Chunks.back() + offset;
+		}
+	}
+
+	block.ChunkSize = std::max(size + alignment, (size_t)FRAME_ARENA_CHUNK_SIZE);
+	block.Chunks.push_back(new char[block.ChunkSize]);
+	overflowCount++;
+
+	uintptr_t base = (uintptr_t)block.Chunks.back();
+	size_t offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+	block.ChunkUsed = offset + size;
+	return block.Chunks.back() + offset;
+}
+
+void FrameArena::FreeChunks(Block& block)
+{
+	for (char* chunk : block.Chunks)
+		delete[] chunk;
+	block.Chunks.clear();
+	block.ChunkSize = 0;
+	block.ChunkUsed = 0;
+	block.Overflow = 0;
+}
+
+const char* FrameArena::CopyString(const char* text)
+{
+	size_t length = strlen(text) + 1;
+	char* copy = (char*)Allocate(length, 1);
+	memcpy(copy, text, length);
+	return copy;
+}
+
+size_t FrameArena::GetUsed()
+{
+	return blocks[current].Used.load() + blocks[current].Overflow;
+}
+
+size_t FrameArena::GetCapacity()
+{
+	return blocks[current].Size;
+}
+
+size_t FrameArena::GetPeak()
+{
+	return std::max(peak, GetUsed());
+}
+
+unsigned int FrameArena::GetOverflowCount()
+{
+	return overflowCount;
+}
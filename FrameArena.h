@@ -0,0 +1,117 @@
+#pragma once
+
+// Memory for things that only live for a frame, handed out by bumping a pointer
+// - One block per frame in flight, used in turn: NextFrame() moves on to the next block and forgets everything
+//   in it at once, so whatever was allocated last frame is still there all through this one
+// - Nothing is freed on its own.  Containers using it (FrameVector, say) leave their old storage behind in the
+//   block when they grow, until the block comes round again.  Destructors aren't run either.
+// - A block that runs out carries on in chunks from the heap, and is grown to fit the whole frame the next time
+//   it comes round, so once frames stop getting bigger the arena never touches the heap
+// - Allocating is safe from several threads at once; NextFrame() has to be called while nothing is
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define FRAME_ARENA_FRAMES 2					// Blocks, so memory lives this many frames
+#define FRAME_ARENA_DEFAULT_SIZE (256 * 1024)	// Bytes each block starts with
+#define FRAME_ARENA_CHUNK_SIZE (64 * 1024)		// Smallest heap chunk a full block carries on in
+
+class FrameArena
+{
+public:
+	FrameArena(size_t blockSize = FRAME_ARENA_DEFAULT_SIZE);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Starts a frame: the oldest block is emptied (and grown, if it ran out last time) and used from here on
+	void NextFrame();
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	// Constructs an object that's simply dropped with the rest of the frame
+	template<typename T, typename... Args>
+	T* New(Args&&... args)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "The arena never runs destructors");
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// A copy of a string that lasts as long as the frame
+	const char* CopyString(const char* text);
+
+	// This frame's block
+	size_t GetUsed();
+	size_t GetCapacity();
+	// The most any frame has needed, and how many heap chunks frames have had to carry on in
+	size_t GetPeak();
+	unsigned int GetOverflowCount();
+
+private:
+	struct Block
+	{
+		char* Memory = nullptr;
+		size_t Size = 0;
+		std::atomic<size_t> Used{ 0 };
+
+		// Once Memory runs out (under chunkMutex)
+		std::vector<char*> Chunks;
+		size_t ChunkSize = 0;
+		size_t ChunkUsed = 0;
+		size_t Overflow = 0;	// Bytes asked for after Memory ran out
+	};
+
+	void* AllocateFromChunk(Block& block, size_t size, size_t alignment);
+	void FreeChunks(Block& block);
+
+	Block blocks[FRAME_ARENA_FRAMES];
+	unsigned int current;
+	std::mutex chunkMutex;
+	size_t peak;
+	unsigned int overflowCount;
+};
+
+// Lets standard containers use a FrameArena.  With no arena it uses the heap like std::allocator,
+// so the same container type works both ways.
+template<typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameAllocator(FrameArena* arena = nullptr) noexcept : arena(arena) {}
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>& other) noexcept : arena(other.GetArena()) {}
+
+	T* allocate(size_t count)
+	{
+		if (arena)
+			return (T*)arena->Allocate(count * sizeof(T), alignof(T));
+		return (T*)::operator new(count * sizeof(T));
+	}
+
+	void deallocate(T* pointer, size_t) noexcept
+	{
+		if (!arena)
+			::operator delete(pointer);
+	}
+
+	FrameArena* GetArena() const { return arena; }
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>& other) const { return arena == other.GetArena(); }
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>& other) const { return arena != other.GetArena(); }
+
+private:
+	FrameArena* arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
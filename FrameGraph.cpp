@@ -0,0 +1,322 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+
+
+FrameGraph::FrameGraph(FrameGraphBackend* backend, unsigned int framesToKeep, FrameArena* arena)
+	: backend(backend), arena(arena), pool(framesToKeep), bindCount(0), unbindCount(0), targetsKnown(false), boundDepthTarget(-1)
+{
+	if (!arena)
+	{
+		ownArena = std::make_unique<FrameArena>(16 * 1024);
+		this->arena = ownArena.get();
+	}
+	ForgetFrame();
+}
+
+FrameGraph::~FrameGraph()
+{
+	for (Pass& pass : passes)
+		pass.Destroy(pass.Function);
+}
+
+void FrameGraph::Reset()
+{
+	ForgetFrame();
+	if (ownArena)
+		ownArena->NextFrame();
+
+	// Presenting unbinds the back buffer, so the first pass always binds its own targets
+	targetsKnown = false;
+}
+
+// --------------------------------------------------------
+// The old lists (and what's in them) are just left in the
+// arena, but the pass functions might own something, so
+// they're destroyed properly
+// --------------------------------------------------------
+void FrameGraph::ForgetFrame()
+{
+	for (Pass& pass : passes)
+		pass.Destroy(pass.Function);
+	resources = FrameVector<Resource>(FrameAllocator<Resource>(arena));
+	passes = FrameVector<Pass>(FrameAllocator<Pass>(arena));
+}
+
+unsigned int FrameGraph::Import(const char* name, unsigned int width, unsigned int height, bool output)
+{
+	unsigned int import = 0;
+	while (import < importNames.size() && importNames[import] != name)
+		import++;
+	if (import == importNames.size())
+	{
+		importNames.push_back(name);
+		importStates.push_back(BIND_NONE);
+	}
+
+	resources.push_back({ arena->CopyString(name), { width, height, 0, 0 }, true, output, import, -1 });
+	return (unsigned int)resources.size() - 1;
+}
+
+unsigned int FrameGraph::Create(const char* name, const RenderTargetDesc& desc)
+{
+	resources.push_back({ arena->CopyString(name), desc, false, false, 0, -1 });
+	return (unsigned int)resources.size() - 1;
+}
+
+unsigned int FrameGraph::AddPass(const char* name, void* function, void (*run)(void*), void (*destroy)(void*), bool sideEffects)
+{
+	FrameAllocator<unsigned int> allocator(arena);
+	passes.push_back({ arena->CopyString(name), function, run, destroy, sideEffects, FrameVector<Use>(allocator),
+		false, false, FrameVector<unsigned int>(allocator), -1, FrameVector<unsigned int>(allocator) });
+	return (unsigned int)passes.size() - 1;
+}
+
+void FrameGraph::Read(unsigned int pass, unsigned int resource)
+{
+	passes[pass].Uses.push_back({ resource, false, false, FRAME_GRAPH_UNBOUND });
+}
+
+void FrameGraph::Write(unsigned int pass, unsigned int resource, FrameGraphTarget target, bool overwrite)
+{
+	passes[pass].Uses.push_back({ resource, true, overwrite, target });
+}
+
+FrameGraph::BindState& FrameGraph::StateOf(unsigned int resource)
+{
+	if (resources[resource].Imported)
+		return importStates[resources[resource].Import];
+	return slotStates[pool.GetSlot(resources[resource].PoolTarget)];
+}
+
+// --------------------------------------------------------
+// Three walks over the passes: backwards to find the ones
+// worth running, forwards to give their transient targets
+// textures, then forwards again following what's bound to
+// work out what each pass has to change before it runs.
+// --------------------------------------------------------
+void FrameGraph::Compile()
+{
+	// A pass is kept if it has side effects or writes something needed after it.  What it reads is then
+	// needed too, while what it overwrites isn't needed from any pass before it.
+	FrameVector<bool> needed(resources.size(), false, FrameAllocator<bool>(arena));
+	for (unsigned int r = 0; r < resources.size(); r++)
+		needed[r] = resources[r].Output;
+	for (int p = (int)passes.size() - 1; p >= 0; p--)
+	{
+		Pass& pass = passes[p];
+		bool keep = pass.SideEffects;
+		for (const Use& use : pass.Uses)
+			keep |= use.Write && needed[use.Resource];
+		pass.Culled = !keep;
+		if (!keep)
+			continue;
+
+		for (const Use& use : pass.Uses)
+		{
+			if (use.Write && use.Overwrite)
+				needed[use.Resource] = false;
+		}
+		for (const Use& use : pass.Uses)
+		{
+			if (!use.Write)
+				needed[use.Resource] = true;
+		}
+	}
+
+	// Transient targets live from the first kept pass that uses them to the last
+	pool.BeginFrame();
+	unsigned int step = 0;
+	for (const Pass& pass : passes)
+	{
+		if (pass.Culled)
+			continue;
+		for (const Use& use : pass.Uses)
+		{
+			Resource& resource = resources[use.Resource];
+			if (resource.Imported)
+				continue;
+			if (resource.PoolTarget < 0)
+				resource.PoolTarget = (int)pool.Request(resource.Desc, step);
+			else
+				pool.Use(resource.PoolTarget, step);
+		}
+		step++;
+	}
+
+	pool.Allocate();
+	slotStates.resize(pool.GetSlotCount(), BIND_NONE);
+	for (unsigned int slot : pool.GetReleasedSlots())
+	{
+		backend->ReleaseTexture(slot);
+		slotStates[slot] = BIND_NONE;
+	}
+	for (unsigned int slot : pool.GetCreatedSlots())
+	{
+		backend->CreateTexture(slot, pool.GetSlotDesc(slot));
+		slotStates[slot] = BIND_NONE;
+	}
+	for (unsigned int r = 0; r < resources.size(); r++)
+	{
+		if (!resources[r].Imported && resources[r].PoolTarget >= 0)
+			backend->PlaceTransient(r, pool.GetSlot(resources[r].PoolTarget));
+	}
+
+	// Follow the bindings through the frame
+	bindCount = 0;
+	unbindCount = 0;
+	for (Pass& pass : passes)
+	{
+		pass.Bind = false;
+		pass.RenderTargets.clear();
+		pass.DepthTarget = -1;
+		pass.Unbinds.clear();
+		if (pass.Culled)
+			continue;
+
+		bool bindsOwnTargets = false;
+		bool readsTarget = false;
+		for (const Use& use : pass.Uses)
+		{
+			if (!use.Write)
+			{
+				readsTarget |= StateOf(use.Resource) == BIND_TARGET;
+				continue;
+			}
+
+			if (use.Target == FRAME_GRAPH_RENDER_TARGET)
+				pass.RenderTargets.push_back(use.Resource);
+			else if (use.Target == FRAME_GRAPH_DEPTH_TARGET)
+				pass.DepthTarget = (int)use.Resource;
+			else
+				bindsOwnTargets = true;
+
+			// Can't draw into something that's still bound as an input
+			BindState& state = StateOf(use.Resource);
+			if (state == BIND_SHADER_RESOURCE)
+			{
+				pass.Unbinds.push_back(use.Resource);
+				state = BIND_NONE;
+			}
+		}
+
+		// Targets only change when they have to: the pass wants different ones, or it reads something
+		// that's still bound as one (then with no targets of its own, they're simply unbound)
+		bool hasTargets = !pass.RenderTargets.empty() || pass.DepthTarget >= 0;
+		if (hasTargets)
+		{
+			bool sameTargets = targetsKnown && pass.DepthTarget == boundDepthTarget &&
+				std::equal(pass.RenderTargets.begin(), pass.RenderTargets.end(), boundRenderTargets.begin(), boundRenderTargets.end());
+			pass.Bind = !sameTargets || readsTarget;
+		}
+		else
+			pass.Bind = !bindsOwnTargets && readsTarget;
+
+		if (pass.Bind)
+		{
+			for (BindState& state : importStates)
+				state = state == BIND_TARGET ? BIND_NONE : state;
+			for (BindState& state : slotStates)
+				state = state == BIND_TARGET ? BIND_NONE : state;
+			for (unsigned int target : pass.RenderTargets)
+				StateOf(target) = BIND_TARGET;
+			if (pass.DepthTarget >= 0)
+				StateOf(pass.DepthTarget) = BIND_TARGET;
+			boundRenderTargets.assign(pass.RenderTargets.begin(), pass.RenderTargets.end());
+			boundDepthTarget = pass.DepthTarget;
+			targetsKnown = true;
+		}
+
+		if (bindsOwnTargets)
+		{
+			for (const Use& use : pass.Uses)
+			{
+				if (use.Write && use.Target == FRAME_GRAPH_UNBOUND)
+					StateOf(use.Resource) = BIND_TARGET;
+			}
+			targetsKnown = false;
+		}
+
+		for (const Use& use : pass.Uses)
+		{
+			if (!use.Write)
+				StateOf(use.Resource) = BIND_SHADER_RESOURCE;
+		}
+
+		bindCount += pass.Bind;
+		unbindCount += (unsigned int)pass.Unbinds.size();
+	}
+}
+
+void FrameGraph::Execute()
+{
+	for (Pass& pass : passes)
+	{
+		if (pass.Culled)
+			continue;
+
+		if (beforePass)
+			beforePass(pass.Name);
+		if (!pass.Unbinds.empty())
+			backend->UnbindShaderResources(pass.Unbinds.data(), (unsigned int)pass.Unbinds.size());
+		if (pass.Bind)
+		{
+			// The viewport covers the first target
+			RenderTargetDesc size = {};
+			if (!pass.RenderTargets.empty())
+				size = resources[pass.RenderTargets[0]].Desc;
+			else if (pass.DepthTarget >= 0)
+				size = resources[pass.DepthTarget].Desc;
+			backend->BindTargets(pass.RenderTargets.data(), (unsigned int)pass.RenderTargets.size(), pass.DepthTarget, size.Width, size.Height);
+		}
+		pass.Run(pass.Function);
+		if (afterPass)
+			afterPass(pass.Name);
+	}
+}
+
+void FrameGraph::SetPassHooks(PassHook before, PassHook after)
+{
+	beforePass = before;
+	afterPass = after;
+}
+
+void FrameGraph::Clear()
+{
+	for (unsigned int slot = 0; slot < pool.GetSlotCount(); slot++)
+		backend->ReleaseTexture(slot);
+	pool.Clear();
+	slotStates.clear();
+	ForgetFrame();
+	targetsKnown = false;
+}
+
+unsigned int FrameGraph::GetPassCount()
+{
+	return (unsigned int)passes.size();
+}
+
+const char* FrameGraph::GetPassName(unsigned int pass)
+{
+	return passes[pass].Name;
+}
+
+bool FrameGraph::IsCulled(unsigned int pass)
+{
+	return passes[pass].Culled;
+}
+
+unsigned int FrameGraph::GetBindCount()
+{
+	return bindCount;
+}
+
+unsigned int FrameGraph::GetUnbindCount()
+{
+	return unbindCount;
+}
+
+RenderTargetPool& FrameGraph::GetPool()
+{
+	return pool;
+}
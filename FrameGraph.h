@@ -0,0 +1,172 @@
+#pragma once
+
+// Runs a frame's passes from what each of them reads and draws into
+// - Passes are added in the order they should run, along with the resources they read (in shaders) and write
+// - Compile() drops passes nothing needs, gives the remaining passes' transient targets textures from a
+//   RenderTargetPool, and works out what has to be bound and unbound before each pass
+// - Execute() then binds each pass's targets (only when they change), unbinds only the inputs that are
+//   about to be drawn into, and runs it
+// - No D3D: everything that touches the device goes through a FrameGraphBackend
+// - Each frame's passes, resources and names live in a FrameArena, so building the graph again every frame
+//   doesn't touch the heap
+
+#include "FrameArena.h"
+#include "RenderTargetPool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// How a pass writes a resource
+enum FrameGraphTarget
+{
+	FRAME_GRAPH_RENDER_TARGET,	// Bound by the graph, in the order they're written, with a viewport the size of the first
+	FRAME_GRAPH_DEPTH_TARGET,	// Bound by the graph as the depth buffer
+	FRAME_GRAPH_UNBOUND			// The pass binds it itself (a slice or a tile at a time, say)
+};
+
+// Does what the graph decides on
+class FrameGraphBackend
+{
+public:
+	virtual ~FrameGraphBackend() {}
+
+	// A pool slot needs a texture, or should let go of it (unbinding it first, if it's still an input)
+	virtual void CreateTexture(unsigned int slot, const RenderTargetDesc& desc) = 0;
+	virtual void ReleaseTexture(unsigned int slot) = 0;
+
+	// Which slot's texture a transient resource gets this frame
+	virtual void PlaceTransient(unsigned int resource, unsigned int slot) = 0;
+
+	// Replaces every bound target.  Nothing at all (no targets, depth of -1) just unbinds them.
+	virtual void BindTargets(const unsigned int* renderTargets, unsigned int count, int depthTarget, unsigned int width, unsigned int height) = 0;
+
+	// These are about to be drawn into, so they can't stay bound as shader inputs
+	virtual void UnbindShaderResources(const unsigned int* resources, unsigned int count) = 0;
+};
+
+class FrameGraph
+{
+public:
+	typedef std::function<void(const char* name)> PassHook;
+
+	// With no arena, the graph keeps one of its own and starts a new frame of it in Reset().  A shared one has to
+	// keep everything from one Reset() to the next (it needs to be started once a frame and double buffered).
+	FrameGraph(FrameGraphBackend* backend, unsigned int framesToKeep = 3, FrameArena* arena = nullptr);
+	~FrameGraph();
+
+	// Forgets last frame's passes and resources.  What's still bound is remembered.
+	void Reset();
+
+	// Imported resources live outside the graph (the back buffer, shadow maps), and are found again
+	// by name each frame.  Outputs are what the frame is for, so passes writing them are never dropped.
+	unsigned int Import(const char* name, unsigned int width, unsigned int height, bool output = false);
+	// Transient ones only live for the passes that use them, sharing textures with others where they can
+	unsigned int Create(const char* name, const RenderTargetDesc& desc);
+
+	// Side effects (drawing the UI, say) also keep a pass from being dropped.  The function (any lambda)
+	// is copied into the arena rather than a std::function, and destroyed when the frame's forgotten.
+	template<typename Function>
+	unsigned int AddPass(const char* name, Function&& execute, bool sideEffects = false)
+	{
+		typedef typename std::decay<Function>::type Callable;
+		void* callable = new (arena->Allocate(sizeof(Callable), alignof(Callable))) Callable(std::forward<Function>(execute));
+		return AddPass(name, callable,
+			[](void* function) { (*(Callable*)function)(); },
+			[](void* function) { ((Callable*)function)->~Callable(); },
+			sideEffects);
+	}
+	void Read(unsigned int pass, unsigned int resource);
+	// Overwriting means nothing from before the pass survives it (it clears, or draws every pixel)
+	void Write(unsigned int pass, unsigned int resource, FrameGraphTarget target, bool overwrite = false);
+
+	void Compile();
+	void Execute();
+
+	// Called around every pass that runs (to time them, say).  The first comes before the pass's
+	// targets change, so that's counted as part of the pass too.
+	void SetPassHooks(PassHook before, PassHook after);
+
+	// Lets every transient texture go (after a resize, nothing will match anyway)
+	void Clear();
+
+	unsigned int GetPassCount();
+	const char* GetPassName(unsigned int pass);
+	bool IsCulled(unsigned int pass);
+	unsigned int GetBindCount();	// Target changes this frame
+	unsigned int GetUnbindCount();	// Shader inputs unbound this frame
+	RenderTargetPool& GetPool();
+
+private:
+	enum BindState
+	{
+		BIND_NONE,
+		BIND_SHADER_RESOURCE,
+		BIND_TARGET
+	};
+
+	struct Resource
+	{
+		const char* Name;
+		RenderTargetDesc Desc;	// Only the size, for imported ones
+		bool Imported;
+		bool Output;
+		unsigned int Import;	// Into importNames, for imported ones
+		int PoolTarget;			// For transient ones, -1 until a kept pass uses it
+	};
+
+	struct Use
+	{
+		unsigned int Resource;
+		bool Write;
+		bool Overwrite;
+		FrameGraphTarget Target;	// Writes only
+	};
+
+	struct Pass
+	{
+		const char* Name;
+		void* Function;					// The copy in the arena
+		void (*Run)(void* function);
+		void (*Destroy)(void* function);
+		bool SideEffects;
+		FrameVector<Use> Uses;
+
+		// From Compile()
+		bool Culled;
+		bool Bind;	// Targets change before this pass
+		FrameVector<unsigned int> RenderTargets;
+		int DepthTarget;
+		FrameVector<unsigned int> Unbinds;
+	};
+
+	unsigned int AddPass(const char* name, void* function, void (*run)(void*), void (*destroy)(void*), bool sideEffects);
+	// Destroys the pass functions and starts empty lists in the arena
+	void ForgetFrame();
+	BindState& StateOf(unsigned int resource);
+
+	FrameGraphBackend* backend;
+	std::unique_ptr<FrameArena> ownArena;
+	FrameArena* arena;
+	PassHook beforePass;
+	PassHook afterPass;
+	RenderTargetPool pool;
+	FrameVector<Resource> resources;
+	FrameVector<Pass> passes;
+	unsigned int bindCount;
+	unsigned int unbindCount;
+
+	// What's bound, kept from frame to frame for every import (by name) and every pool slot.
+	// BIND_TARGET means "might still be bound as a target".
+	std::vector<std::string> importNames;
+	std::vector<BindState> importStates;
+	std::vector<BindState> slotStates;
+
+	// The targets the graph last bound, unless a pass has bound its own since (or it's a new frame)
+	bool targetsKnown;
+	std::vector<unsigned int> boundRenderTargets;
+	int boundDepthTarget;
+};
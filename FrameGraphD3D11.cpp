@@ -0,0 +1,141 @@
+#include "FrameGraphD3D11.h"
+#include "MemoryTrackerD3D11.h"
+
+
+FrameGraphD3D11::FrameGraphD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: device(device), context(context)
+{
+}
+
+FrameGraphD3D11::Views& FrameGraphD3D11::ViewsOf(unsigned int resource)
+{
+	if (resource >= resourceViews.size())
+		resourceViews.resize(resource + 1);
+	return resourceViews[resource];
+}
+
+void FrameGraphD3D11::SetImported(unsigned int resource, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv,
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	ViewsOf(resource) = { rtv, dsv, srv };
+}
+
+ID3D11RenderTargetView* FrameGraphD3D11::GetRTV(unsigned int resource)
+{
+	return ViewsOf(resource).RTV.Get();
+}
+
+ID3D11DepthStencilView* FrameGraphD3D11::GetDSV(unsigned int resource)
+{
+	return ViewsOf(resource).DSV.Get();
+}
+
+ID3D11ShaderResourceView* FrameGraphD3D11::GetSRV(unsigned int resource)
+{
+	return ViewsOf(resource).SRV.Get();
+}
+
+void FrameGraphD3D11::CreateTexture(unsigned int slot, const RenderTargetDesc& desc)
+{
+	MEMORY_SCOPE(MEMORY_RENDER_TARGETS);
+	if (slot >= slotViews.size())
+		slotViews.resize(slot + 1);
+
+	bool mips = (desc.Flags & RENDER_TARGET_MIPS) != 0;
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.Width;
+	textureDesc.Height = desc.Height;
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.Format = (DXGI_FORMAT)desc.Format;
+	textureDesc.MipLevels = mips ? 0 : 1; // 0 is a full chain
+	textureDesc.MiscFlags = mips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf());
+	TrackGpuResource(texture.Get(), MEMORY_RENDER_TARGETS);
+
+	// Default views: the RTV draws into the top mip, the SRV sees all of them
+	device->CreateRenderTargetView(texture.Get(), 0, slotViews[slot].RTV.ReleaseAndGetAddressOf());
+	device->CreateShaderResourceView(texture.Get(), 0, slotViews[slot].SRV.ReleaseAndGetAddressOf());
+}
+
+void FrameGraphD3D11::ReleaseTexture(unsigned int slot)
+{
+	if (slot >= slotViews.size())
+		return;
+
+	// Still bound, the context would keep the texture alive
+	ID3D11ShaderResourceView* srv = slotViews[slot].SRV.Get();
+	if (srv)
+		Unbind(&srv, 1);
+	slotViews[slot] = {};
+}
+
+void FrameGraphD3D11::PlaceTransient(unsigned int resource, unsigned int slot)
+{
+	ViewsOf(resource) = slotViews[slot];
+}
+
+void FrameGraphD3D11::BindTargets(const unsigned int* renderTargets, unsigned int count, int depthTarget, unsigned int width, unsigned int height)
+{
+	ID3D11RenderTargetView* rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+	for (unsigned int i = 0; i < count; i++)
+		rtvs[i] = GetRTV(renderTargets[i]);
+	context->OMSetRenderTargets(count, rtvs, depthTarget >= 0 ? GetDSV(depthTarget) : 0);
+
+	if (width > 0 && height > 0)
+	{
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = (float)width;
+		viewport.Height = (float)height;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+	}
+}
+
+void FrameGraphD3D11::UnbindShaderResources(const unsigned int* resources, unsigned int count)
+{
+	ID3D11ShaderResourceView* views[FRAME_GRAPH_SHADER_RESOURCE_SLOTS] = {};
+	unsigned int viewCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (GetSRV(resources[i]) && viewCount < FRAME_GRAPH_SHADER_RESOURCE_SLOTS)
+			views[viewCount++] = GetSRV(resources[i]);
+	}
+	Unbind(views, viewCount);
+}
+
+// --------------------------------------------------------
+// Reads back what's bound and only nulls the slots holding
+// one of these views, in a single call.
+// --------------------------------------------------------
+void FrameGraphD3D11::Unbind(ID3D11ShaderResourceView* const* views, unsigned int count)
+{
+	ID3D11ShaderResourceView* bound[FRAME_GRAPH_SHADER_RESOURCE_SLOTS] = {};
+	context->PSGetShaderResources(0, FRAME_GRAPH_SHADER_RESOURCE_SLOTS, bound);
+
+	unsigned int first = FRAME_GRAPH_SHADER_RESOURCE_SLOTS;
+	unsigned int last = 0;
+	for (unsigned int slot = 0; slot < FRAME_GRAPH_SHADER_RESOURCE_SLOTS; slot++)
+	{
+		if (!bound[slot])
+			continue;
+
+		bool match = false;
+		for (unsigned int v = 0; v < count; v++)
+			match |= bound[slot] == views[v];
+		bound[slot]->Release(); // PSGetShaderResources adds a reference
+		bound[slot] = match ? 0 : bound[slot];
+		if (match)
+		{
+			first = first < slot ? first : slot;
+			last = slot;
+		}
+	}
+
+	// The views in between are set again as they were (the context holds its own references)
+	if (first <= last)
+		context->PSSetShaderResources(first, last - first + 1, bound + first);
+}
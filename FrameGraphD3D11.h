@@ -0,0 +1,52 @@
+#pragma once
+
+// The FrameGraph's D3D11 side
+// - Creates a texture (and its views) for each of the pool's slots, and hands them to the transient resources placed there
+// - Imported resources are given their views each frame by whoever imports them
+// - Shader inputs are unbound by finding their views among the pixel shader's bound resources,
+//   so only those slots change
+
+#include "FrameGraph.h"
+
+#include <d3d11.h>
+#include <vector>
+#include <wrl/client.h>
+
+// How many pixel shader resource slots are searched when unbinding (every shader here uses fewer)
+#define FRAME_GRAPH_SHADER_RESOURCE_SLOTS 16
+
+class FrameGraphD3D11 : public FrameGraphBackend
+{
+public:
+	FrameGraphD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// After FrameGraph::Import, each frame.  Any of the views can be null.
+	void SetImported(unsigned int resource, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv,
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+
+	ID3D11RenderTargetView* GetRTV(unsigned int resource);
+	ID3D11DepthStencilView* GetDSV(unsigned int resource);
+	ID3D11ShaderResourceView* GetSRV(unsigned int resource);
+
+	void CreateTexture(unsigned int slot, const RenderTargetDesc& desc) override;
+	void ReleaseTexture(unsigned int slot) override;
+	void PlaceTransient(unsigned int resource, unsigned int slot) override;
+	void BindTargets(const unsigned int* renderTargets, unsigned int count, int depthTarget, unsigned int width, unsigned int height) override;
+	void UnbindShaderResources(const unsigned int* resources, unsigned int count) override;
+
+private:
+	struct Views
+	{
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RTV;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DSV;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	};
+
+	Views& ViewsOf(unsigned int resource);
+	void Unbind(ID3D11ShaderResourceView* const* views, unsigned int count);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::vector<Views> slotViews;
+	std::vector<Views> resourceViews; // This frame's, by resource
+};
@@ -0,0 +1,156 @@
+#include "FramePacing.h"
+
+
+FrameLimiter::FrameLimiter(float targetFps)
+	: period(0), nextFrame(0), started(false), waited(false), lateness(0), lateFrames(0), oversleepIndex(0), spinMargin(FRAME_LIMITER_DEFAULT_SPIN_MARGIN)
+{
+	// As if recent sleeps had woken up late enough to need the default margin
+	for (unsigned int i = 0; i < FRAME_LIMITER_SLEEP_HISTORY; i++)
+		oversleeps[i] = FRAME_LIMITER_DEFAULT_SPIN_MARGIN - FRAME_LIMITER_SPIN_SLACK;
+
+	SetTargetFps(targetFps);
+}
+
+double FrameLimiter::GetSleepTime(double now)
+{
+	double sleepTime = GetWaitTime(now) - spinMargin;
+	return sleepTime > 0 ? sleepTime : 0;
+}
+
+// --------------------------------------------------------
+// The margin covers the latest wake up of the last few
+// sleeps, so one late one widens it straight away and it
+// only narrows again once that's out of the history
+// --------------------------------------------------------
+void FrameLimiter::Slept(double requested, double actual)
+{
+	double oversleep = actual - requested;
+	oversleeps[oversleepIndex] = oversleep > 0 ? oversleep : 0;
+	oversleepIndex = (oversleepIndex + 1) % FRAME_LIMITER_SLEEP_HISTORY;
+
+	double latest = 0;
+	for (unsigned int i = 0; i < FRAME_LIMITER_SLEEP_HISTORY; i++)
+		latest = oversleeps[i] > latest ? oversleeps[i] : latest;
+
+	spinMargin = latest + FRAME_LIMITER_SPIN_SLACK;
+	if (spinMargin > FRAME_LIMITER_MAX_SPIN_MARGIN)
+		spinMargin = FRAME_LIMITER_MAX_SPIN_MARGIN;
+}
+
+double FrameLimiter::GetWaitTime(double now)
+{
+	if (period <= 0 || !started || now >= nextFrame)
+		return 0;
+
+	waited = true;
+	return nextFrame - now;
+}
+
+// --------------------------------------------------------
+// The next frame is due a period after this one was due.
+// If this one is a whole period or more late anyway (the
+// last frame ran long, or the limit was just turned on)
+// the schedule starts again from now, rather than letting
+// frames through early until it's caught up.
+// --------------------------------------------------------
+void FrameLimiter::StartFrame(double now)
+{
+	lateness = started ? now - nextFrame : 0;
+	if (lateness < 0)
+		lateness = 0;
+	if (waited && lateness > FRAME_LIMITER_SPIN_SLACK)
+		lateFrames++;
+	waited = false;
+
+	if (period <= 0)
+	{
+		started = false;
+		return;
+	}
+
+	if (!started || now - nextFrame >= period)
+		nextFrame = now + period;
+	else
+		nextFrame += period;
+	started = true;
+}
+
+void FrameLimiter::SetTargetFps(float fps)
+{
+	double newPeriod = fps > 0 ? 1.0 / fps : 0;
+	if (started)
+		nextFrame += newPeriod - period;
+	period = newPeriod;
+}
+
+float FrameLimiter::GetTargetFps()
+{
+	return period > 0 ? (float)(1.0 / period) : 0.0f;
+}
+
+double FrameLimiter::GetSpinMargin()
+{
+	return spinMargin;
+}
+
+double FrameLimiter::GetLateness()
+{
+	return lateness;
+}
+
+unsigned long long FrameLimiter::GetLateFrames()
+{
+	return lateFrames;
+}
+
+
+LatencyHistory::LatencyHistory()
+	: samples(), count(0)
+{
+}
+
+void LatencyHistory::Add(double seconds)
+{
+	samples[count % FRAME_LATENCY_HISTORY] = (float)(seconds * 1000.0);
+	count++;
+}
+
+float LatencyHistory::GetLatest()
+{
+	return count > 0 ? samples[(count - 1) % FRAME_LATENCY_HISTORY] : 0.0f;
+}
+
+float LatencyHistory::GetAverage()
+{
+	int sampleCount = GetSampleCount();
+	if (sampleCount == 0)
+		return 0.0f;
+
+	float total = 0;
+	for (int i = 0; i < sampleCount; i++)
+		total += samples[i];
+	return total / sampleCount;
+}
+
+float LatencyHistory::GetWorst()
+{
+	float worst = 0;
+	for (int i = 0; i < GetSampleCount(); i++)
+		worst = samples[i] > worst ? samples[i] : worst;
+	return worst;
+}
+
+const float* LatencyHistory::GetSamples()
+{
+	return samples;
+}
+
+int LatencyHistory::GetSampleCount()
+{
+	return count < FRAME_LATENCY_HISTORY ? (int)count : FRAME_LATENCY_HISTORY;
+}
+
+int LatencyHistory::GetOffset()
+{
+	return count < FRAME_LATENCY_HISTORY ? 0 : (int)(count % FRAME_LATENCY_HISTORY);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// Frame pacing: the timing logic for holding frames back to a target frame rate, and a history of how long
+// input waits to be seen
+// - FrameLimiter works out when each frame is due and how much of the wait is safe to sleep.  The OS can wake
+//   a sleep up late, so it sleeps until a margin before the frame is due and spins the rest; the margin follows
+//   how late recent sleeps woke up, so a coarse timer gets a wide one and a precise timer hardly spins at all.
+// - Frames are due a whole period apart (not a period after the last one started), so the rate doesn't drift
+//   with however late each one was let go.  A frame that runs long isn't caught up on with short ones after it.
+// - No Windows: the caller reads the clock, sleeps and spins, so it can be driven by a fake clock
+
+#define FRAME_LIMITER_SLEEP_HISTORY 64			// Sleeps the spin margin covers the latest of
+#define FRAME_LIMITER_DEFAULT_SPIN_MARGIN 0.002	// Seconds, until there's some history
+#define FRAME_LIMITER_SPIN_SLACK 0.0002			// Seconds added to the latest wake up in the history
+#define FRAME_LIMITER_MAX_SPIN_MARGIN 0.02		// Seconds, for when sleeps are very coarse (a 15.6 ms tick)
+#define FRAME_LATENCY_HISTORY 240				// Frames of latency kept
+
+class FrameLimiter
+{
+public:
+	FrameLimiter(float targetFps = 0.0f);
+
+	// Once a frame, before starting it, with times in seconds from any steady clock:
+	//     double sleepTime = limiter.GetSleepTime(Now());
+	//     if (sleepTime > 0) { double start = Now(); Sleep(sleepTime); limiter.Slept(sleepTime, Now() - start); }
+	//     while (limiter.GetWaitTime(Now()) > 0) Spin();
+	//     limiter.StartFrame(Now());
+	double GetSleepTime(double now);			// What's safe to sleep of the wait (0 if it's too close to call)
+	void Slept(double requested, double actual);
+	double GetWaitTime(double now);				// Until the next frame is due (0 once it is, or with no limit)
+	void StartFrame(double now);
+
+	// Zero (or less) for no limit.  The next frame is due a period of the new rate after the last.
+	void SetTargetFps(float fps);
+	float GetTargetFps();
+
+	double GetSpinMargin();			// Seconds before a frame is due that sleeping stops
+	double GetLateness();			// Seconds the last frame started after it was due
+	unsigned long long GetLateFrames();	// Frames held back that were let go more than the spin slack late
+
+private:
+	double period;			// Zero for no limit
+	double nextFrame;		// When the next frame is due
+	bool started;			// Whether nextFrame means anything yet
+	bool waited;			// Whether this frame had to wait at all
+	double lateness;
+	unsigned long long lateFrames;
+
+	double oversleeps[FRAME_LIMITER_SLEEP_HISTORY];	// How late recent sleeps woke up
+	unsigned int oversleepIndex;
+	double spinMargin;
+};
+
+// The time from sampling input to handing the frame it went into to Present(), over the last few frames
+class LatencyHistory
+{
+public:
+	LatencyHistory();
+
+	void Add(double seconds);
+
+	// Milliseconds
+	float GetLatest();
+	float GetAverage();
+	float GetWorst();
+
+	// Oldest first from GetOffset(), for ImGui::PlotLines()
+	const float* GetSamples();
+	int GetSampleCount();
+	int GetOffset();
+
+private:
+	float samples[FRAME_LATENCY_HISTORY];
+	unsigned int count;		// Samples added in all
+};
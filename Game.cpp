@@ -3,8 +3,9 @@
 #include "Input.h"
 #include "Helpers.h"
 #include "Material.h"
-
-#include <WICTextureLoader.h>
+#include "Profiler.h"
+#include "AllocationCounter.h"
+#include "MemoryTrackerD3D11.h"
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -14,11 +15,53 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
 
 // For the DirectX Math library
 using namespace DirectX;
 using namespace std;
 
+namespace
+{
+	// ImGui allocates through these, so everything it keeps is counted as its own
+	void* ImGuiAllocate(size_t size, void*)
+	{
+		MEMORY_SCOPE(MEMORY_IMGUI);
+		return ::operator new(size);
+	}
+
+	void ImGuiFree(void* pointer, void*)
+	{
+		::operator delete(pointer);
+	}
+
+	// A bar filling up towards the budget (red once it's over), or just the size if there isn't one
+	void MemoryBar(unsigned long long bytes, unsigned long long budget)
+	{
+		const float megabyte = 1024.0f * 1024.0f;
+		if (budget == 0) {
+			ImGui::Text("%.1f MB", bytes / megabyte);
+			return;
+		}
+
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.1f / %.0f MB", bytes / megabyte, budget / megabyte);
+		bool over = bytes > budget;
+		if (over)
+			ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.9f, 0.2f, 0.2f, 1.0f));
+		ImGui::ProgressBar(std::min((float)bytes / budget, 1.0f), ImVec2(-FLT_MIN, 0), overlay);
+		if (over)
+			ImGui::PopStyleColor();
+	}
+}
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -34,7 +77,10 @@ Game::Game(HINSTANCE hInstance)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	jobs(std::make_shared<JobSystem>()),
+	frameArena(std::make_shared<FrameArena>()),
+	lightClusters(jobs)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -43,11 +89,40 @@ Game::Game(HINSTANCE hInstance)
 #endif
 	cameraIndex = 0;
 	ambientColor = XMFLOAT4(0.05f, 0.15f, 0.2f, 1.0f);
-	shadowMapResolution = 512;
+	shadowMapResolution = 1024;
 	lightDisplacement = 25;
-	lightViewMatrix = XMFLOAT4X4();
-	lightProjectionMatrix = XMFLOAT4X4();
+	shadowCascadeCount = 0;
+	shadowCastersCulled = 0;
+	staticShadowUpdates = 0;
+	for (unsigned int c = 0; c < MAX_SHADOW_CASCADES; c++)
+		staticShadowsStale[c] = true;
+	shadowAtlasResolution = 2048;
+	scatteredLightCount = 0;
+	lightClusteringTime = 0;
+	uploadedLightVersion = UINT_MAX;
+	clusteredLightVersion = UINT_MAX;
+	clusteredView = {};
+	clusteredProjection = {};
+	clusterBuffersStale = true;
+	sceneTarget = 0;
+	sunAndOccludersTarget = 0;
+	analyzeDrawCommands = false;
+	frameStartHeapAllocations = 0;
+	heapAllocationsLastFrame = 0;
 	blurRadius = 0;
+	blurDownsample = 1;
+	scatteringSettings.Exposure = 0.7f;
+	scatteringSettings.Weight = 0.5f;
+	scatteringSettings.Decay = 0.8f;
+	scatteringSettings.TexelsPerSample = 8.0f;
+	scatteringSettings.MaxSamples = 32;
+	scatteringDownsample = 2;
+	scatteringDepthSharpness = 20.0f;
+	interpolateEntities = true;
+	frameLimiterTarget = 120.0f;
+	profilerFrameAge = 0;
+	profilerExportStatus = "";
+	memoryReportStatus = "";
 }
 
 // --------------------------------------------------------
@@ -69,6 +144,17 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
+	// Rough budgets for the memory panel (going over is only shown, nothing's stopped).  Zero is no budget.
+	const unsigned long long megabyte = 1024 * 1024;
+	SetMemoryBudget(MEMORY_MESH, { 32 * megabyte, 64 * megabyte });
+	SetMemoryBudget(MEMORY_MATERIAL, { 1 * megabyte, 0 });
+	SetMemoryBudget(MEMORY_SIMPLE_SHADER, { 4 * megabyte, 1 * megabyte });
+	SetMemoryBudget(MEMORY_SKY, { 1 * megabyte, 32 * megabyte });
+	SetMemoryBudget(MEMORY_TEXTURES, { 64 * megabyte, 256 * megabyte });
+	SetMemoryBudget(MEMORY_RENDER_TARGETS, { 1 * megabyte, 256 * megabyte });
+	SetMemoryBudget(MEMORY_IMGUI, { 8 * megabyte, 0 });
+
+	assets = std::make_shared<AssetManager>(device, context);
 	LoadShaders();
 	CreateGeometry();
 	
@@ -89,16 +175,14 @@ void Game::Init()
 	cameras.push_back(std::make_shared<Camera>(Camera((float)this->windowWidth / this->windowHeight, XMFLOAT3(0, 0, -10), XMFLOAT4(0, 0, 0, 1), XM_PIDIV4, 5, 0.001f, 0.01f, 50, false, XMFLOAT3(0.4f, 0.6f, 0))));
 
 	// Create lights
-	allLights = vector<shared_ptr<Light>>();
-	activeLights = unordered_map<int, shared_ptr<Light>>();
 	{
 		Light directionalLight = {};
 		directionalLight.Type = LIGHT_TYPE_DIRECTIONAL;
 		directionalLight.Direction = XMFLOAT3(-0.70534561585f, -0.70534561585f, 0.070534561585f);
 		directionalLight.Color = XMFLOAT3(1.0f, 0.3f, 0.3f);
 		directionalLight.Intensity = 1.0f;
-		allLights.push_back(make_shared<Light>(directionalLight));
-		activeLights.insert({ 0, allLights[0]});
+		sunLight = lights.Add(directionalLight);
+		sceneLights.push_back(sunLight);
 	}
 	{
 		Light directionalLight = {};
@@ -106,7 +190,7 @@ void Game::Init()
 		directionalLight.Direction = XMFLOAT3(0, 0, -1);
 		directionalLight.Color = XMFLOAT3(0.2f, 0.2f, 5.0f);
 		directionalLight.Intensity = 0.5f;
-		allLights.push_back(make_shared<Light>(directionalLight));
+		sceneLights.push_back(lights.Add(directionalLight, false));
 	}
 	{
 		Light directionalLight = {};
@@ -114,8 +198,7 @@ void Game::Init()
 		directionalLight.Direction = XMFLOAT3(1, -1, -0.1f);
 		directionalLight.Color = XMFLOAT3(0.5f, 0.15f, 0.15f);
 		directionalLight.Intensity = 1.0f;
-		allLights.push_back(make_shared<Light>(directionalLight));
-		activeLights.insert({ 2, allLights[2] });
+		sceneLights.push_back(lights.Add(directionalLight));
 	}
 	// Point lights
 	{
@@ -125,7 +208,7 @@ void Game::Init()
 		pointLight.Range = 4.0f;
 		pointLight.Color = XMFLOAT3(0.5f, 0.5f, 0.0f);
 		pointLight.Intensity = 1.0f;
-		allLights.push_back(make_shared<Light>(pointLight));
+		sceneLights.push_back(lights.Add(pointLight, false));
 	}
 	{
 		Light pointLight = {};
@@ -134,13 +217,21 @@ void Game::Init()
 		pointLight.Range = 10.0f;
 		pointLight.Color = XMFLOAT3(1.0f, 0.0f, 1.0f);
 		pointLight.Intensity = 0.5f;
-		allLights.push_back(make_shared<Light>(pointLight));
+		sceneLights.push_back(lights.Add(pointLight, false));
 	}
-
-	lightsToRender = vector<Light>();
-	for (auto& light : activeLights) {
-		lightsToRender.push_back(*light.second);
+	// Spot lights
+	{
+		Light spotLight = {};
+		spotLight.Type = LIGHT_TYPE_SPOT;
+		spotLight.Position = XMFLOAT3(0, 5, 0);
+		spotLight.Direction = XMFLOAT3(0, -1, 0.2f);
+		spotLight.Range = 12.0f;
+		spotLight.SpotFalloff = 20.0f;
+		spotLight.Color = XMFLOAT3(1.0f, 1.0f, 0.8f);
+		spotLight.Intensity = 2.0f;
+		sceneLights.push_back(lights.Add(spotLight, false));
 	}
+	lights.Update();
 
 	ShadowInit();
 
@@ -155,11 +246,24 @@ void Game::Init()
 		ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		device->CreateSamplerState(&ppSampDesc, postProcessSampler.GetAddressOf());
 
-		RenderTargetInit();
+		// Render targets are made by the frame graph, as its passes need them
+		frameGraphBackend = std::make_shared<FrameGraphD3D11>(device, context);
+		frameGraph = std::make_shared<FrameGraph>(frameGraphBackend.get(), 3, frameArena.get());
+
+		// Every pass the graph runs is timed on the GPU
+		gpuProfilerBackend = std::make_shared<GpuProfilerD3D11>(device, context);
+		gpuProfiler = std::make_shared<GpuProfiler>(gpuProfilerBackend.get());
+		frameGraph->SetPassHooks(
+			[this](const char* name) { gpuProfiler->BeginPass(name); },
+			[this](const char*) { gpuProfiler->EndPass(); });
+
+		drawListBackend = std::make_shared<DrawListsD3D11>(device, context);
+		drawLists = std::make_shared<DrawLists>(drawListBackend.get(), jobs);
 	}
 
 	// Initialize ImGui itself & platform/renderer backends
 	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions(ImGuiAllocate, ImGuiFree);
 	ImGui::CreateContext();
 	ImGui_ImplWin32_Init(hWnd);
 	ImGui_ImplDX11_Init(device.Get(), context.Get());
@@ -172,11 +276,15 @@ void Game::Init()
 
 // Helper method to hold shadow initializing
 void Game::ShadowInit() {
-	// Create the actual texture that will be the shadow map
+	cascadeSettings.Resolution = shadowMapResolution;
+	cascadeSettings.CasterDistance = lightDisplacement;
+
+	// Create the actual texture that will be the shadow map (one slice per cascade,
+	// always the max so the cascade count can change without recreating it)
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
 	shadowDesc.Width = shadowMapResolution; // Ideally a power of 2 (like 1024)
 	shadowDesc.Height = shadowMapResolution; // Ideally a power of 2 (like 1024)
-	shadowDesc.ArraySize = 1;
+	shadowDesc.ArraySize = MAX_SHADOW_CASCADES;
 	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowDesc.CPUAccessFlags = 0;
 	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -185,25 +293,52 @@ void Game::ShadowInit() {
 	shadowDesc.SampleDesc.Count = 1;
 	shadowDesc.SampleDesc.Quality = 0;
 	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
 	device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
+	TrackGpuResource(shadowTexture.Get(), MEMORY_RENDER_TARGETS);
+
+	// Same again for the static casters' cache, which is only ever drawn to and copied from
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	device->CreateTexture2D(&shadowDesc, 0, staticShadowTexture.GetAddressOf());
+	TrackGpuResource(staticShadowTexture.Get(), MEMORY_RENDER_TARGETS);
+	staticShadowCache.Invalidate();
+
+	// Create depth/stencil views and a debug SRV for each cascade's slice
+	for (unsigned int i = 0; i < MAX_SHADOW_CASCADES; i++) {
+		D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
+		shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		shadowDSDesc.Texture2DArray.MipSlice = 0;
+		shadowDSDesc.Texture2DArray.FirstArraySlice = i;
+		shadowDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(
+			shadowTexture.Get(),
+			&shadowDSDesc,
+			shadowDSVs[i].GetAddressOf());
+		device->CreateDepthStencilView(
+			staticShadowTexture.Get(),
+			&shadowDSDesc,
+			staticShadowDSVs[i].GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC sliceDesc = {};
+		sliceDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		sliceDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		sliceDesc.Texture2DArray.MipLevels = 1;
+		sliceDesc.Texture2DArray.FirstArraySlice = i;
+		sliceDesc.Texture2DArray.ArraySize = 1;
+		device->CreateShaderResourceView(
+			shadowTexture.Get(),
+			&sliceDesc,
+			shadowCascadeSRVs[i].GetAddressOf());
+	}
 
-	// Create the depth/stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSDesc,
-		shadowDSV.GetAddressOf());
-
-	// Create the SRV for the shadow map
+	// Create the SRV for the whole shadow map array
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = MAX_SHADOW_CASCADES;
 	device->CreateShaderResourceView(
 		shadowTexture.Get(),
 		&srvDesc,
@@ -218,6 +353,11 @@ void Game::ShadowInit() {
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
 	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
 
+	// Cascades only fit their near plane to static casters (see ShadowCulling.h), so
+	// dynamic ones in front of it are flattened onto it rather than clipped away
+	shadowRastDesc.DepthClipEnable = false;
+	device->CreateRasterizerState(&shadowRastDesc, &shadowCascadeRasterizer);
+
 	// Create the Percentage-Close Filtering sampler to use in shadow mapping
 	D3D11_SAMPLER_DESC shadowSampDesc = {};
 	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
@@ -228,90 +368,302 @@ void Game::ShadowInit() {
 	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
 	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
 
-	// Initialize light matrices
-	XMFLOAT3 lightDirection = allLights[0]->Direction;
-	XMStoreFloat4x4(&lightViewMatrix, XMMatrixLookToLH(
-		XMLoadFloat3(&lightDirection) * -lightDisplacement,
-		XMLoadFloat3(&lightDirection),
-		XMVectorSet(0, 1, 0, 0)));
-
-	float lightProjectionSize = 15.0f; // Tweak for your scene!
-	XMStoreFloat4x4(&lightProjectionMatrix, XMMatrixOrthographicLH(
-		lightProjectionSize,
-		lightProjectionSize,
-		1.0f,
-		100.0f
-	));
+	// Create the shadow atlas, with the same format as the cascades
+	shadowAtlas = ShadowAtlas(shadowAtlasResolution, 128);
+	D3D11_TEXTURE2D_DESC atlasDesc = shadowDesc;
+	atlasDesc.Width = shadowAtlasResolution;
+	atlasDesc.Height = shadowAtlasResolution;
+	atlasDesc.ArraySize = 1;
+	atlasDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> atlasTexture;
+	device->CreateTexture2D(&atlasDesc, 0, atlasTexture.GetAddressOf());
+	TrackGpuResource(atlasTexture.Get(), MEMORY_RENDER_TARGETS);
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC atlasDSDesc = {};
+	atlasDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	atlasDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	atlasDSDesc.Texture2D.MipSlice = 0;
+	device->CreateDepthStencilView(atlasTexture.Get(), &atlasDSDesc, shadowAtlasDSV.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC atlasSRVDesc = {};
+	atlasSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	atlasSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	atlasSRVDesc.Texture2D.MipLevels = 1;
+	atlasSRVDesc.Texture2D.MostDetailedMip = 0;
+	device->CreateShaderResourceView(atlasTexture.Get(), &atlasSRVDesc, shadowAtlasSRV.GetAddressOf());
+
+	// The atlas tiles' matrices go to the pixel shader in a structured buffer, rewritten every frame
+	D3D11_BUFFER_DESC entryDesc = {};
+	entryDesc.ByteWidth = sizeof(ShadowAtlasEntry) * MAX_SHADOW_ATLAS_ENTRIES;
+	entryDesc.Usage = D3D11_USAGE_DYNAMIC;
+	entryDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	entryDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	entryDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	entryDesc.StructureByteStride = sizeof(ShadowAtlasEntry);
+	device->CreateBuffer(&entryDesc, 0, shadowAtlasEntryBuffer.GetAddressOf());
+	TrackGpuResource(shadowAtlasEntryBuffer.Get(), MEMORY_OTHER);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC entrySRVDesc = {};
+	entrySRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+	entrySRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	entrySRVDesc.Buffer.FirstElement = 0;
+	entrySRVDesc.Buffer.NumElements = MAX_SHADOW_ATLAS_ENTRIES;
+	device->CreateShaderResourceView(shadowAtlasEntryBuffer.Get(), &entrySRVDesc, shadowAtlasEntrySRV.GetAddressOf());
+
+	// Light matrices follow the camera, so they're worked out every frame
+	UpdateShadowCascades();
 }
 
-void Game::RenderTargetInit() {
-	// Describe the texture used as our second render target
-	D3D11_TEXTURE2D_DESC rtTextureDesc = {};
-	rtTextureDesc.Width = windowWidth;
-	rtTextureDesc.Height = windowHeight;
-	rtTextureDesc.ArraySize = 1;
-	rtTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	rtTextureDesc.CPUAccessFlags = 0;
-	rtTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	rtTextureDesc.MipLevels = 1;
-	rtTextureDesc.MiscFlags = 0;
-	rtTextureDesc.SampleDesc.Count = 1;
-	rtTextureDesc.SampleDesc.Quality = 0;
-	rtTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> rtTexture;
-	device->CreateTexture2D(&rtTextureDesc, 0, rtTexture.GetAddressOf());
-
-	// Create our new Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = rtTextureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	device->CreateRenderTargetView(
-		rtTexture.Get(),
-		&rtvDesc,
-		renderRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	device->CreateShaderResourceView(
-		rtTexture.Get(),
-		0,
-		renderSRV.ReleaseAndGetAddressOf());
-
-	// Describe our MRT render target
-	D3D11_TEXTURE2D_DESC sunAndOccludersTextureDesc = {};
-	sunAndOccludersTextureDesc.Width = windowWidth;
-	sunAndOccludersTextureDesc.Height = windowHeight;
-	sunAndOccludersTextureDesc.ArraySize = 1;
-	sunAndOccludersTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	sunAndOccludersTextureDesc.CPUAccessFlags = 0;
-	sunAndOccludersTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	sunAndOccludersTextureDesc.MipLevels = 1;
-	sunAndOccludersTextureDesc.MiscFlags = 0;
-	sunAndOccludersTextureDesc.SampleDesc.Count = 1;
-	sunAndOccludersTextureDesc.SampleDesc.Quality = 0;
-	sunAndOccludersTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	device->CreateTexture2D(&sunAndOccludersTextureDesc, 0, sunAndOccludersTexture.GetAddressOf());
-
-	// Create our MRT Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC sunAndOccludersRTVDesc = {};
-	sunAndOccludersRTVDesc.Format = sunAndOccludersTextureDesc.Format;
-	sunAndOccludersRTVDesc.Texture2D.MipSlice = 0;
-	sunAndOccludersRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	device->CreateRenderTargetView(
-		sunAndOccludersTexture.Get(),
-		&sunAndOccludersRTVDesc,
-		sunAndOccludersRTV.ReleaseAndGetAddressOf());
-	// Create the MRT Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	device->CreateShaderResourceView(
-		sunAndOccludersTexture.Get(),
-		0,
-		sunAndOccludersSRV.ReleaseAndGetAddressOf());
+// --------------------------------------------------------
+// Fits each shadow cascade to its slice of the current
+// camera's view (see ShadowCascades.h), culls the entities
+// that can't cast into it (see ShadowCulling.h), and checks
+// whether its cached static shadows are still good
+// (see StaticShadowCache.h)
+// --------------------------------------------------------
+void Game::UpdateShadowCascades()
+{
+	PROFILE_SCOPE("Shadow cascade setup");
+	std::shared_ptr<Camera> camera = cameras[cameraIndex];
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	shadowCascadeCount = CalculateShadowCascades(
+		cascadeSettings,
+		view,
+		projection,
+		camera->GetNearClip(),
+		camera->GetFarClip(),
+		lights.Get(sunLight).Direction,
+		shadowCascades);
+
+	// Everything the camera can see receives shadows.  Asking for the world matrix brings each
+	// entity's matrices up to date here, on the job system, rather than one at a time in Draw().
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+	entityBounds.resize(entities.size());
+	FrameVector<unsigned char> visible(entities.size(), 0, FrameAllocator<unsigned char>(frameArena.get()));
+	jobs->ParallelFor((unsigned int)entities.size(), 0, [&](unsigned int begin, unsigned int end) {
+		PROFILE_SCOPE("Entity bounds");
+		for (unsigned int i = begin; i < end; i++) {
+			entityBounds[i] = TransformAABB(entities[i]->GetMesh()->GetBounds(), entities[i]->GetTransform()->GetWorldMatrix());
+			visible[i] = IsAABBVisible(entityBounds[i], viewProjection);
+		}
+	});
+	visibleEntities.clear();
+	staticEntities.clear();
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		if (visible[i])
+			visibleEntities.push_back(i);
+		if (entities[i]->IsStatic())
+			staticEntities.push_back(i);
+	}
+
+	// Each cascade only writes its own caster list
+	unsigned int culled[MAX_SHADOW_CASCADES] = {};
+	jobs->ParallelFor(shadowCascadeCount, 1, [&](unsigned int begin, unsigned int end) {
+		PROFILE_SCOPE("Shadow caster culling");
+		for (unsigned int c = begin; c < end; c++)
+			culled[c] = CullShadowCasters(shadowCascades[c], entityBounds, staticEntities, visibleEntities, shadowCasters[c]);
+	});
+
+	shadowCastersCulled = 0;
+	staticShadowUpdates = 0;
+	for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+		shadowCastersCulled += culled[c];
+
+		FrameVector<StaticShadowCaster> staticCasters(FrameAllocator<StaticShadowCaster>(frameArena.get()));
+		staticCasters.reserve(shadowCasters[c].size());
+		for (unsigned int i : shadowCasters[c]) {
+			if (entities[i]->IsStatic())
+				staticCasters.push_back({ i, entities[i]->GetTransform()->GetVersion() });
+		}
+		staticShadowsStale[c] = staticShadowCache.NeedsUpdate(c, shadowCascades[c].ViewProjection, staticCasters.data(), staticCasters.size());
+		staticShadowUpdates += staticShadowsStale[c];
+	}
+}
+
+// --------------------------------------------------------
+// Bins this frame's lights into the camera's clusters
+// --------------------------------------------------------
+void Game::UpdateLightClusters()
+{
+	PROFILE_SCOPE("Light clustering");
+	std::shared_ptr<Camera> camera = cameras[cameraIndex];
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+
+	// Nothing to redo if neither the lights nor the camera changed
+	lightClusteringTime = 0;
+	if (lights.GetVersion() == clusteredLightVersion &&
+		memcmp(&view, &clusteredView, sizeof(XMFLOAT4X4)) == 0 &&
+		memcmp(&projection, &clusteredProjection, sizeof(XMFLOAT4X4)) == 0)
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	lightClusters.Build(lights.GetActiveLights(), view, projection, camera->GetNearClip(), camera->GetFarClip());
+	lightClusteringTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	clusteredLightVersion = lights.GetVersion();
+	clusteredView = view;
+	clusteredProjection = projection;
+	clusterBuffersStale = true;
+}
+
+// --------------------------------------------------------
+// Copies an array into a dynamic structured buffer, first
+// replacing the buffer (and its view) if it's too small
+// --------------------------------------------------------
+void Game::UploadStructuredBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+	const void* data, unsigned int stride, unsigned int count)
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	if (buffer)
+		buffer->GetDesc(&bufferDesc);
+
+	if (!buffer || bufferDesc.ByteWidth < stride * count) {
+		// Grow in powers of two, so a slowly rising count doesn't make a new buffer every frame
+		unsigned int capacity = 64;
+		while (capacity < count)
+			capacity *= 2;
+
+		bufferDesc = {};
+		bufferDesc.ByteWidth = stride * capacity;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = stride;
+		buffer.Reset();
+		device->CreateBuffer(&bufferDesc, 0, buffer.GetAddressOf());
+		TrackGpuResource(buffer.Get(), MEMORY_OTHER);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		srv.Reset();
+		device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+	}
+
+	if (count == 0)
+		return;
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, data, (size_t)stride * count);
+	context->Unmap(buffer.Get(), 0);
+}
+
+// --------------------------------------------------------
+// Decides which lights get shadows this frame: the main
+// directional light always uses the cascades, and point
+// lights on screen get six atlas tiles each, sized by how
+// much of the screen they could light.  Lights that don't
+// fit in the atlas go unshadowed.
+// --------------------------------------------------------
+void Game::UpdateShadowAtlas()
+{
+	PROFILE_SCOPE("Shadow atlas setup");
+	std::shared_ptr<Camera> camera = cameras[cameraIndex];
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	struct ShadowRequest
+	{
+		unsigned int lightIndex;
+		unsigned int tileSize;
+		unsigned int tileCount; // 6 for point lights (one per cube face), 1 for spot lights
+	};
+	FrameVector<ShadowRequest> requests(FrameAllocator<ShadowRequest>(frameArena.get()));
+
+	// Worked out in full before any are handed to the lights, so unchanged ones aren't marked as changed
+	const std::vector<Light>& activeLights = lights.GetActiveLights();
+	FrameVector<int> shadowIndices(activeLights.size(), -1, FrameAllocator<int>(frameArena.get()));
+	requests.reserve(activeLights.size());
+
+	for (unsigned int index = 0; index < activeLights.size(); index++) {
+		const Light& light = activeLights[index];
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL) {
+			if (lights.GetActiveHandle(index) == sunLight)
+				shadowIndices[index] = 0; // The light the cascades follow
+			continue;
+		}
+		if (light.Type != LIGHT_TYPE_POINT && light.Type != LIGHT_TYPE_SPOT)
+			continue;
+
+		// Spot lights only need to be seen by their cone, and are sized by the sphere around it
+		AABB lightBounds;
+		XMFLOAT3 center = light.Position;
+		float radius = light.Range;
+		if (light.Type == LIGHT_TYPE_SPOT) {
+			Cone cone = GetSpotLightCone(light);
+			lightBounds = GetConeBounds(cone);
+			GetConeBoundingSphere(cone, center, radius);
+		}
+		else {
+			lightBounds.Min = XMFLOAT3(light.Position.x - light.Range, light.Position.y - light.Range, light.Position.z - light.Range);
+			lightBounds.Max = XMFLOAT3(light.Position.x + light.Range, light.Position.y + light.Range, light.Position.z + light.Range);
+		}
+		if (!IsAABBVisible(lightBounds, viewProjection))
+			continue;
+
+		// Roughly how much of the screen's height the light's range covers
+		float depth = fabsf(XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&center), XMLoadFloat4x4(&view))));
+		float screenFraction = depth > radius ? radius * projection._22 / depth : 1.0f;
+		requests.push_back({ index, ChooseShadowTileSize(screenFraction, shadowAtlas.GetMinTileSize(), shadowAtlas.GetAtlasSize() / 4),
+			light.Type == LIGHT_TYPE_SPOT ? 1u : 6u });
+	}
 
+	// Biggest first packs the quadtree with no wasted space.  Ties stay in light order, as a stable sort
+	// would leave them, without the buffer std::stable_sort allocates.
+	std::sort(requests.begin(), requests.end(), [](const ShadowRequest& a, const ShadowRequest& b) {
+		return a.tileSize != b.tileSize ? a.tileSize > b.tileSize : a.lightIndex < b.lightIndex;
+	});
+
+	shadowAtlas.Clear();
+	shadowAtlasViews.clear();
+	for (ShadowRequest& request : requests) {
+		if (shadowAtlasViews.size() + request.tileCount > MAX_SHADOW_ATLAS_ENTRIES)
+			continue; // A spot light might still fit
+
+		// Shrink the tiles until all of them fit
+		ShadowAtlasRegion regions[6];
+		bool placed = false;
+		for (unsigned int size = request.tileSize; size >= shadowAtlas.GetMinTileSize() && !placed; size /= 2) {
+			unsigned int allocated = 0;
+			while (allocated < request.tileCount && shadowAtlas.Allocate(size, regions[allocated]))
+				allocated++;
+			placed = allocated == request.tileCount;
+			if (!placed) {
+				while (allocated > 0)
+					shadowAtlas.Free(regions[--allocated]);
+			}
+		}
+		if (!placed)
+			continue;
+
+		const Light& light = activeLights[request.lightIndex];
+		shadowIndices[request.lightIndex] = (int)shadowAtlasViews.size();
+		if (light.Type == LIGHT_TYPE_SPOT) {
+			Cone cone = GetSpotLightCone(light);
+			XMFLOAT4X4 spotView;
+			XMFLOAT4X4 spotProjection;
+			CalculateSpotLightShadowView(cone, spotView, spotProjection);
+			shadowAtlasViews.push_back({ spotView, spotProjection, regions[0], cone });
+			continue;
+		}
+
+		XMFLOAT4X4 faceViews[6];
+		XMFLOAT4X4 faceProjection;
+		CalculatePointLightShadowViews(light.Position, light.Range, faceViews, faceProjection);
+		for (int face = 0; face < 6; face++)
+			shadowAtlasViews.push_back({ faceViews[face], faceProjection, regions[face], {} });
+	}
+
+	for (unsigned int index = 0; index < shadowIndices.size(); index++)
+		lights.SetShadowIndex(lights.GetActiveHandle(index), shadowIndices[index]);
 }
 
 // --------------------------------------------------------
@@ -321,15 +673,17 @@ void Game::RenderTargetInit() {
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader.cso").c_str());
-	pixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader.cso").c_str());
-	specialPixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SpecialPixelShader.cso").c_str());
-	vertexShader_NormalMap = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader_NormalMap.cso").c_str());
-	pixelShader_NormalMap = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader_NormalMap.cso").c_str());
-	vertexShader_ShadowMap = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader_ShadowMap.cso").c_str());
-	vertexShader_Fullscreen = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader_Fullscreen.cso").c_str());
-	pixelShader_Blur = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader_Blur.cso").c_str());
-	pixelShader_VolumetricLighting = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader_VolumetricLighting.cso").c_str());
+	vertexShader = assets->GetVertexShader(FixPath(L"VertexShader.cso"));
+	pixelShader = assets->GetPixelShader(FixPath(L"PixelShader.cso"));
+	specialPixelShader = assets->GetPixelShader(FixPath(L"SpecialPixelShader.cso"));
+	vertexShader_NormalMap = assets->GetVertexShader(FixPath(L"VertexShader_NormalMap.cso"));
+	pixelShader_NormalMap = assets->GetPixelShader(FixPath(L"PixelShader_NormalMap.cso"));
+	pixelShader_NormalMapORM = assets->GetPixelShader(FixPath(L"PixelShader_NormalMapORM.cso"));
+	vertexShader_ShadowMap = assets->GetVertexShader(FixPath(L"VertexShader_ShadowMap.cso"));
+	vertexShader_Fullscreen = assets->GetVertexShader(FixPath(L"VertexShader_Fullscreen.cso"));
+	pixelShader_Blur = assets->GetPixelShader(FixPath(L"PixelShader_Blur.cso"));
+	pixelShader_VolumetricLighting = assets->GetPixelShader(FixPath(L"PixelShader_VolumetricLighting.cso"));
+	pixelShader_VolumetricComposite = assets->GetPixelShader(FixPath(L"PixelShader_VolumetricComposite.cso"));
 
 
 
@@ -354,47 +708,6 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeMetalnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeRoughnessSRV;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\bronze_albedo.png").c_str(), nullptr, bronzeAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\bronze_metal.png").c_str(), nullptr, bronzeMetalnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\bronze_normals.png").c_str(), nullptr, bronzeNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\bronze_roughness.png").c_str(), nullptr, bronzeRoughnessSRV.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedMetalnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedRoughnessSRV;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\scratched_albedo.png").c_str(), nullptr, scratchedAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\scratched_metal.png").c_str(), nullptr, scratchedMetalnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\scratched_normals.png").c_str(), nullptr, scratchedNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\scratched_roughness.png").c_str(), nullptr, scratchedRoughnessSRV.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> plateAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> plateMetalnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> plateNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> plateRoughnessSRV;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\floor_albedo.png").c_str(), nullptr, plateAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\floor_metal.png").c_str(), nullptr, plateMetalnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\floor_normals.png").c_str(), nullptr, plateNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\floor_roughness.png").c_str(), nullptr, plateRoughnessSRV.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughnessSRV;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\wood_albedo.png").c_str(), nullptr, woodAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\wood_metal.png").c_str(), nullptr, woodMetalnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\wood_normals.png").c_str(), nullptr, woodNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"..\\..\\Assets\\Textures\\wood_roughness.png").c_str(), nullptr, woodRoughnessSRV.GetAddressOf());
-
-
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 
 	{
@@ -409,47 +722,16 @@ void Game::CreateGeometry()
 		device->CreateSamplerState(&samplerDesc, sampler.GetAddressOf());
 	}
 
-	// Create some temporary variables to represent colors
-	XMFLOAT4 red	= XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
-	XMFLOAT4 green	= XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f);
-	XMFLOAT4 blue	= XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
-	XMFLOAT4 gold	= XMFLOAT4(1.0f, 0.84f, 0.0f, 1.0f);
-	XMFLOAT4 white	= XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-
 	// Creating materials
-	std::shared_ptr<Material> bronze = std::make_shared<Material>(white, vertexShader_NormalMap, pixelShader_NormalMap, 0.1f);
-	std::shared_ptr<Material> scratched = std::make_shared<Material>(white, vertexShader_NormalMap, pixelShader_NormalMap, 0.6f);
-	std::shared_ptr<Material> plate = std::make_shared<Material>(white, vertexShader_NormalMap, pixelShader_NormalMap, 0.1f);
-	std::shared_ptr<Material> wood = std::make_shared<Material>(white, vertexShader_NormalMap, pixelShader_NormalMap, 0.6f);
-
-	bronze->AddTextureSRV("AlbedoTexture", bronzeAlbedoSRV);
-	bronze->AddTextureSRV("RoughnessMap", bronzeRoughnessSRV);
-	bronze->AddTextureSRV("NormalMap", bronzeNormalSRV);
-	bronze->AddTextureSRV("MetalnessMap", bronzeMetalnessSRV);
-	bronze->AddSampler("BasicSampler", sampler);
-
-	scratched->AddTextureSRV("AlbedoTexture", scratchedAlbedoSRV);
-	scratched->AddTextureSRV("RoughnessMap", scratchedRoughnessSRV);
-	scratched->AddTextureSRV("NormalMap", scratchedNormalSRV);
-	scratched->AddTextureSRV("MetalnessMap", scratchedMetalnessSRV);
-	scratched->AddSampler("BasicSampler", sampler);
-
-	plate->AddTextureSRV("AlbedoTexture", plateAlbedoSRV);
-	plate->AddTextureSRV("RoughnessMap", plateRoughnessSRV);
-	plate->AddTextureSRV("NormalMap", plateNormalSRV);
-	plate->AddTextureSRV("MetalnessMap", plateMetalnessSRV);
-	plate->AddSampler("BasicSampler", sampler);
-
-	wood->AddTextureSRV("AlbedoTexture", woodAlbedoSRV);
-	wood->AddTextureSRV("RoughnessMap", woodRoughnessSRV);
-	wood->AddTextureSRV("NormalMap", woodNormalSRV);
-	wood->AddTextureSRV("MetalnessMap", woodMetalnessSRV);
-	wood->AddSampler("BasicSampler", sampler);
+	std::shared_ptr<Material> bronze = CreatePBRMaterial("bronze", 0.1f, sampler);
+	std::shared_ptr<Material> scratched = CreatePBRMaterial("scratched", 0.6f, sampler);
+	std::shared_ptr<Material> plate = CreatePBRMaterial("floor", 0.1f, sampler);
+	std::shared_ptr<Material> wood = CreatePBRMaterial("wood", 0.6f, sampler);
 
 	// Creating pointers to each mesh object
-	shared_ptr<Mesh> cubeMesh = make_shared<Mesh>(FixPath(L"..\\..\\Assets\\Meshes\\cube.obj").c_str(), device);
-	shared_ptr<Mesh> sphereMesh = make_shared<Mesh>(FixPath(L"..\\..\\Assets\\Meshes\\sphere.obj").c_str(), device);
-	shared_ptr<Mesh> torusMesh = make_shared<Mesh>(FixPath(L"..\\..\\Assets\\Meshes\\torus.obj").c_str(), device);
+	shared_ptr<Mesh> cubeMesh = assets->GetMesh(FixPath(L"..\\..\\Assets\\Meshes\\cube.obj"));
+	shared_ptr<Mesh> sphereMesh = assets->GetMesh(FixPath(L"..\\..\\Assets\\Meshes\\sphere.obj"));
+	shared_ptr<Mesh> torusMesh = assets->GetMesh(FixPath(L"..\\..\\Assets\\Meshes\\torus.obj"));
 
 	// Creating entity objects
 	entities = std::vector<std::shared_ptr<Entity>>();
@@ -486,9 +768,42 @@ void Game::CreateGeometry()
 	// Floor transformation
 	entities[0]->GetTransform()->MoveBy(0.0f, -10.0f, 0.0f);
 	entities[0]->GetTransform()->ScaleBy(40.0f, 1.0f, 40.0f);
+	entities[0]->SetStatic(true); // The only entity that doesn't move every frame
+
+	// The simulation starts wherever they've been put
+	for (std::shared_ptr<Entity>& entity : entities)
+		currentPositions.push_back(*entity->GetTransform()->GetPosition());
+	previousPositions = currentPositions;
 
 	// Create sky
-	skybox = make_shared<Sky>(cubeMesh, sampler, device, context, FixPath(L"..\\..\\Assets\\Textures\\Sky_Pink").c_str(), FixPath(L"VertexShader_Sky.cso").c_str(), FixPath(L"PixelShader_Sky.cso").c_str());
+	skybox = make_shared<Sky>(cubeMesh, sampler, device, context, FixPath(L"..\\..\\Assets\\Textures\\Sky_Pink").c_str(), FixPath(L"VertexShader_Sky.cso").c_str(), FixPath(L"PixelShader_Sky.cso").c_str(), assets);
+}
+
+
+// --------------------------------------------------------
+// Creates a normal mapped PBR material from textures named
+// "<name>_albedo.png", "<name>_normals.png", "<name>_roughness.png"
+// and "<name>_metal.png".  Roughness and metalness are packed
+// into a single ORM texture, so the pixel shader only needs
+// three texture fetches.  Everything is block compressed (BC7
+// color, BC5 normals) on its way into the cache, and loaded
+// in the background by the asset manager.
+// --------------------------------------------------------
+std::shared_ptr<Material> Game::CreatePBRMaterial(const std::string& textureName, float roughness, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+{
+	XMFLOAT4 white = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	std::wstring textureFolder = FixPath(L"..\\..\\Assets\\Textures\\");
+	std::shared_ptr<Material> material = std::make_shared<Material>(white, vertexShader_NormalMap, pixelShader_NormalMapORM, roughness);
+
+	// Each texture starts as a placeholder and is swapped for the real thing once it's loaded
+	auto replaceTexture = [material](const std::string& srvName) {
+		return [material, srvName](Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) { material->AddTextureSRV(srvName, srv); };
+	};
+	material->AddTextureSRV("AlbedoTexture", assets->GetTexture(textureFolder, textureName + "_albedo", PLACEHOLDER_WHITE, replaceTexture("AlbedoTexture")));
+	material->AddTextureSRV("NormalMap", assets->GetTexture(textureFolder, textureName + "_normals", PLACEHOLDER_FLAT_NORMAL, replaceTexture("NormalMap")));
+	material->AddTextureSRV("ORMMap", assets->GetPackedORM(textureFolder, textureName, replaceTexture("ORMMap")));
+	material->AddSampler("BasicSampler", sampler);
+	return material;
 }
 
 
@@ -505,11 +820,9 @@ void Game::OnResize()
 		cameras[i]->UpdateProjectionMatrix((float)this->windowWidth / this->windowHeight);
 	}
 	
-	renderRTV.Reset();
-	renderSRV.Reset();
-	sunAndOccludersRTV.Reset();
-	sunAndOccludersSRV.Reset();
-	RenderTargetInit();
+	// Every transient target was the old size, so none of them will be asked for again
+	if (frameGraph)
+		frameGraph->Clear();
 }
 
 // --------------------------------------------------------
@@ -517,14 +830,36 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	PROFILE_SCOPE("Update");
+
+	// A new frame of temporary memory (last frame's is still there until the next one)
+	unsigned long long heapAllocations = GetHeapAllocationCount();
+	heapAllocationsLastFrame = heapAllocations - frameStartHeapAllocations;
+	frameStartHeapAllocations = heapAllocations;
+	frameArena->NextFrame();
+
+	// Swap in any textures that finished loading in the background
+	assets->ProcessCompletedLoads();
+
 	UpdateImGui(deltaTime, totalTime);
-	for (unsigned int i = 1; i < entities.size(); i++) {
-		std::shared_ptr<Entity> entity = entities[i];
-		//entity->GetTransform()->RotateBy(0.0f, deltaTime/4, 0.0f);
-		entity->GetTransform()->SetPosition(entity->GetTransform()->GetPosition()->x, sin(totalTime), entity->GetTransform()->GetPosition()->z);
-	}
+
+	// Moving entities are drawn part way from where they were before the last step to where they are now
+	float interpolation = interpolateEntities ? timestep.GetInterpolation() : 1.0f;
+	jobs->ParallelFor((unsigned int)entities.size(), 0, [&](unsigned int begin, unsigned int end) {
+		PROFILE_SCOPE("Place entities");
+		for (unsigned int i = std::max(begin, 1u); i < end; i++) {
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&previousPositions[i]), XMLoadFloat3(&currentPositions[i]), interpolation));
+			entities[i]->GetTransform()->SetPosition(position);
+		}
+	});
 
 	cameras[cameraIndex]->Update(deltaTime);
+	lights.Update(); // Anything the GUI changed
+	UpdateShadowCascades();
+	UpdateShadowAtlas();
+	lights.Update(); // Any lights whose shadows moved
+	UpdateLightClusters();
 
 	// Redoing sky shader code in C++
 	XMFLOAT4X4 untranslatedView;
@@ -537,7 +872,8 @@ void Game::Update(float deltaTime, float totalTime)
 
 	XMFLOAT4X4 viewProject;
 	XMFLOAT4X4 sunPositionAsMatrix;
-	XMFLOAT4 sunDirection = XMFLOAT4(-lightsToRender[0].Direction.x, -lightsToRender[0].Direction.y, -lightsToRender[0].Direction.z, 1.0);
+	const Light& sun = lights.Get(sunLight);
+	XMFLOAT4 sunDirection = XMFLOAT4(-sun.Direction.x, -sun.Direction.y, -sun.Direction.z, 1.0);
 	XMStoreFloat4x4(&viewProject, XMMatrixMultiply(XMLoadFloat4x4(&projectionMatrix), XMLoadFloat4x4(&untranslatedView)));
 	XMStoreFloat4x4(&sunPositionAsMatrix, XMMatrixMultiply(XMLoadFloat4x4(&viewProject), XMMatrixTranslationFromVector(XMLoadFloat4(&sunDirection))));
 	sunPosition = XMFLOAT4(sunPositionAsMatrix._14, sunPositionAsMatrix._24, sunPositionAsMatrix._34, 1);
@@ -548,173 +884,447 @@ void Game::Update(float deltaTime, float totalTime)
 		Quit();
 }
 
+// --------------------------------------------------------
+// One step of the simulation, always stepTime long however
+// fast frames are coming, so the results don't depend on
+// the frame rate.  Update() places what's drawn from here.
+// --------------------------------------------------------
+void Game::FixedUpdate(float stepTime, float simulationTime)
+{
+	PROFILE_SCOPE("Fixed update");
+
+	// Every entity but the first moves on its own, so they're split over the job system
+	jobs->ParallelFor((unsigned int)entities.size(), 0, [&](unsigned int begin, unsigned int end) {
+		PROFILE_SCOPE("Move entities");
+		for (unsigned int i = std::max(begin, 1u); i < end; i++) {
+			previousPositions[i] = currentPositions[i];
+			currentPositions[i].y = sin(simulationTime);
+		}
+	});
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
+// - The frame is a list of passes, each saying what it reads
+//   and draws into.  The frame graph binds their targets,
+//   unbinds inputs just before they're drawn into, drops
+//   passes nothing needs and gives the transient targets
+//   textures (see FrameGraph.h).
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
-	// ==================== PRE-RENDERING ====================
-	// - These things should happen ONCE PER FRAME
-	// - At the beginning of Game::Draw() before drawing *anything*
-	{
-		// Clear the back buffer (erases what's on the screen)
-		const float bgColor[4] = { 0.4f, 0.6f, 0.75f, 1.0f }; // Cornflower Blue
-		context->ClearRenderTargetView(backBufferRTV.Get(), bgColor);
-		context->ClearRenderTargetView(renderRTV.Get(), bgColor);
-		context->ClearRenderTargetView(sunAndOccludersRTV.Get(), bgColor); // clear additional render targets as well
+	PROFILE_SCOPE("Draw");
+	frameGraph->Reset();
+
+	// Everything that lives outside the frame
+	unsigned int backBuffer = frameGraph->Import("Back buffer", windowWidth, windowHeight, true);
+	unsigned int depthBuffer = frameGraph->Import("Depth buffer", windowWidth, windowHeight);
+	unsigned int shadowMap = frameGraph->Import("Shadow cascades", shadowMapResolution, shadowMapResolution);
+	unsigned int shadowAtlasMap = frameGraph->Import("Shadow atlas", shadowAtlasResolution, shadowAtlasResolution);
+	frameGraphBackend->SetImported(backBuffer, backBufferRTV, 0, 0);
+	frameGraphBackend->SetImported(depthBuffer, 0, depthBufferDSV, depthBufferSRV);
+	frameGraphBackend->SetImported(shadowMap, 0, 0, shadowSRV);
+	frameGraphBackend->SetImported(shadowAtlasMap, 0, 0, shadowAtlasSRV);
+
+	// The main pass draws the scene and, as a second target, the sun and whatever blocks it
+	sceneTarget = frameGraph->Create("Scene", { windowWidth, windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM, 0 });
+	sunAndOccludersTarget = frameGraph->Create("Sun and occluders", { windowWidth, windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM, RENDER_TARGET_MIPS });
 
-		// Clear the depth buffer (resets per-pixel occlusion information)
+	// ==================== RENDERING ====================
+	// Shadow map creation (each cascade and atlas tile is bound by the pass itself)
+	unsigned int pass = frameGraph->AddPass("Shadow cascades", [&]() { DrawShadowCascades(); });
+	frameGraph->Write(pass, shadowMap, FRAME_GRAPH_UNBOUND, true);
+	pass = frameGraph->AddPass("Shadow atlas", [&]() { DrawShadowAtlas(); });
+	frameGraph->Write(pass, shadowAtlasMap, FRAME_GRAPH_UNBOUND, true);
+
+	pass = frameGraph->AddPass("Main", [&]() {
+		// Clear the render targets and depth buffer (resets per-pixel occlusion information)
+		const float bgColor[4] = { 0.4f, 0.6f, 0.75f, 1.0f }; // Cornflower Blue
+		context->ClearRenderTargetView(frameGraphBackend->GetRTV(sceneTarget), bgColor);
+		context->ClearRenderTargetView(frameGraphBackend->GetRTV(sunAndOccludersTarget), bgColor); // clear additional render targets as well
 		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		DrawScene();
+	});
+	frameGraph->Read(pass, shadowMap);
+	frameGraph->Read(pass, shadowAtlasMap);
+	frameGraph->Write(pass, sceneTarget, FRAME_GRAPH_RENDER_TARGET, true);
+	frameGraph->Write(pass, sunAndOccludersTarget, FRAME_GRAPH_RENDER_TARGET, true);
+	frameGraph->Write(pass, depthBuffer, FRAME_GRAPH_DEPTH_TARGET, true);
+
+	// Skybox rendering, behind what's already there
+	pass = frameGraph->AddPass("Sky", [&]() {
+		std::shared_ptr<SimplePixelShader> ps = skybox->GetPixelShader();
+		ps->SetFloat4("colorTint", XMFLOAT4(1, 1, 1, 1));
+		ps->SetFloat3("cameraPos", *cameras[cameraIndex]->GetTransform()->GetPosition());
+		ps->SetData("sun", (void*)&lights.Get(sunLight), sizeof(Light));
+
+		skybox->Draw(cameras[cameraIndex]);
+	});
+	frameGraph->Write(pass, sceneTarget, FRAME_GRAPH_RENDER_TARGET);
+	frameGraph->Write(pass, sunAndOccludersTarget, FRAME_GRAPH_RENDER_TARGET);
+	frameGraph->Write(pass, depthBuffer, FRAME_GRAPH_DEPTH_TARGET);
+
+	// ==================== POST-RENDERING ====================
+	// Blurred (or not) scene, then volumetric lighting on top of it into the back buffer
+	unsigned int screen = blurRadius > 0 ? AddBlurPasses(sceneTarget) : sceneTarget;
+	AddLightScatteringPasses(screen, depthBuffer, backBuffer);
+
+	// Render UI on top
+	pass = frameGraph->AddPass("ImGui", [&]() {
+		PROFILE_SCOPE("ImGui");
+		ImGui::Render();
+		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	}, true);
+	frameGraph->Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET);
+
+	frameGraph->Compile();
+	gpuProfiler->BeginFrame();
+	frameGraph->Execute();
+	gpuProfiler->EndFrame();
 
-		// Clear shadow map depth buffer
-		context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-	}
-	
-	// ==================== RENDERING ====================
-	// Shadow map creation
 	{
-		// Set shadow map DSV (w/ no back buffer) as current depth buffer
-		ID3D11RenderTargetView* nullRTV = {};
-		context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
-		
-		// Unbind pixel shader
-		context->PSSetShader(0, 0, 0);
-		
-		// Set viewport description to match shadow map texture
-		D3D11_VIEWPORT viewport = {};
-		viewport.Width = (float)shadowMapResolution;
-		viewport.Height = (float)shadowMapResolution;
-		viewport.MaxDepth = 1.0f;
-		context->RSSetViewports(1, &viewport);
-
-		// Set shadow vertex shader as current shader
-		vertexShader_ShadowMap->SetShader();
-		vertexShader_ShadowMap->SetMatrix4x4("view", lightViewMatrix);
-		vertexShader_ShadowMap->SetMatrix4x4("projection", lightProjectionMatrix);
-
-		// Set shadow rasterizer
-		context->RSSetState(shadowRasterizer.Get());
-		
-		// Drawing all entities
-		for (unsigned int i = 0; i < entities.size(); i++) {
-			std::shared_ptr<Entity> entity = entities[i];
+		PROFILE_SCOPE("Present");
+
+		// Present the back buffer to the user
+		//  - Puts the results of what we've drawn onto the window
+		//  - Without this, the user never sees anything
+		bool vsyncNecessary = vsync || !deviceSupportsTearing || isFullscreen;
+		swapChain->Present(
+			vsyncNecessary ? 1 : 0,
+			vsyncNecessary ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+	}
+}
+
+// --------------------------------------------------------
+// Each cascade starts from a copy of its static shadows,
+// which are only re-rendered when something about them
+// changed, then has the dynamic casters drawn on top
+// --------------------------------------------------------
+void Game::DrawShadowCascades()
+{
+	PROFILE_SCOPE("Shadow pass");
+
+	// Unbind pixel shader
+	context->PSSetShader(0, 0, 0);
+
+	// Set viewport description to match shadow map texture
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)shadowMapResolution;
+	viewport.Height = (float)shadowMapResolution;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+
+	// Set shadow vertex shader as current shader
+	vertexShader_ShadowMap->SetShader();
+
+	// Set shadow rasterizer
+	context->RSSetState(shadowCascadeRasterizer.Get());
+
+	// Draws this cascade's static or dynamic casters (only those that can cast into it)
+	auto drawCasters = [&](unsigned int c, bool isStatic) {
+		for (unsigned int i : shadowCasters[c]) {
+			Entity* entity = entities[i].get();
+			if (entity->IsStatic() != isStatic)
+				continue;
 			vertexShader_ShadowMap->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
 			vertexShader_ShadowMap->CopyAllBufferData();
 
 			entity->GetMesh()->Draw(context);
 		}
+	};
+
+	ID3D11RenderTargetView* nullRTV = {};
+	for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+		vertexShader_ShadowMap->SetMatrix4x4("view", shadowCascades[c].View);
+		vertexShader_ShadowMap->SetMatrix4x4("projection", shadowCascades[c].Projection);
+
+		// Re-render the static shadows only if something about them changed
+		if (staticShadowsStale[c]) {
+			context->ClearDepthStencilView(staticShadowDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			context->OMSetRenderTargets(1, &nullRTV, staticShadowDSVs[c].Get());
+			drawCasters(c, true);
+			context->OMSetRenderTargets(0, 0, 0); // Can't copy out of a bound depth buffer
+		}
 
-		// Changing pipeline back to pre-shadow map state
-		ID3D11RenderTargetView* mainRenderTargets[2] = {};
-		mainRenderTargets[0] = renderRTV.Get();
-		mainRenderTargets[1] = sunAndOccludersRTV.Get();
+		// Start from the static shadows, then add the dynamic ones on top
+		unsigned int slice = D3D11CalcSubresource(0, c, 1);
+		context->CopySubresourceRegion(shadowTexture.Get(), slice, 0, 0, 0, staticShadowTexture.Get(), slice, 0);
 
-		viewport.Width = (float)this->windowWidth;
-		viewport.Height = (float)this->windowHeight;
-		context->RSSetViewports(1, &viewport);
-		context->RSSetState(0);
-		context->OMSetRenderTargets(
-			2,
-			mainRenderTargets,
-			depthBufferDSV.Get());
+		// Set this cascade's DSV (w/ no back buffer) as current depth buffer
+		context->OMSetRenderTargets(1, &nullRTV, shadowDSVs[c].Get());
+		drawCasters(c, false);
+		context->OMSetRenderTargets(0, 0, 0);
 	}
 
-	for (unsigned int i = 0; i < entities.size(); i++) {
-		// Defining temporary variables for cleaner code (hopefully no performance cost here?)
-		std::shared_ptr<Entity> entity = entities[i];
-		std::shared_ptr<Material> material = entity->GetMaterial();
-		std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-		std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
-
-		// Setting what used to be constant buffer data, now handled by simpleShader
-		vs->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
-		vs->SetMatrix4x4("worldInvTranspose", entity->GetTransform()->GetWorldInverseTransposeMatrix());
-		vs->SetMatrix4x4("view", cameras[cameraIndex]->GetViewMatrix());
-		vs->SetMatrix4x4("projection", cameras[cameraIndex]->GetProjectionMatrix());
-		vs->SetMatrix4x4("lightView", lightViewMatrix);
-		vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-		vs->CopyAllBufferData();
-
-		ps->SetFloat4("colorTint", material->GetTint());
-		ps->SetFloat3("cameraPos", *cameras[cameraIndex]->GetTransform()->GetPosition());
-		ps->SetFloat("roughnessConstant", material->GetRoughness());
-		ps->SetInt("numLights", (int)lightsToRender.size());
-		ps->SetData("lights", &lightsToRender[0], sizeof(Light) * (int)lightsToRender.size());
-		ps->SetShaderResourceView("ShadowMap", shadowSRV);
-		ps->SetSamplerState("ShadowSampler", shadowSampler);
-
-		// If the shader is using vector field functions
-		if (ps->HasVariable("functionVars")) {
-			ps->SetFloat4("functionVars", XMFLOAT4(specialShaderVars[0], specialShaderVars[1], specialShaderVars[2], specialShaderVars[3]));
-			ps->SetInt("xFunction", specialShaderFuncs[0] * 4 + specialShaderFuncs[1]);
-			ps->SetInt("yFunction", specialShaderFuncs[2] * 4 + specialShaderFuncs[3]);
+	context->RSSetState(0);
+}
+
+// --------------------------------------------------------
+// Shadow atlas tiles, each with its own viewport into the
+// atlas.  Also fills the buffer of entries the pixel shader
+// finds each light's tiles in.
+// --------------------------------------------------------
+void Game::DrawShadowAtlas()
+{
+	PROFILE_SCOPE("Shadow atlas pass");
+	if (shadowAtlasViews.empty())
+		return;
+
+	context->PSSetShader(0, 0, 0);
+	vertexShader_ShadowMap->SetShader();
+	context->RSSetState(shadowRasterizer.Get());
+
+	ID3D11RenderTargetView* nullRTV = {};
+	context->ClearDepthStencilView(shadowAtlasDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	context->OMSetRenderTargets(1, &nullRTV, shadowAtlasDSV.Get());
+
+	D3D11_MAPPED_SUBRESOURCE mappedEntries = {};
+	context->Map(shadowAtlasEntryBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedEntries);
+	ShadowAtlasEntry* atlasEntries = (ShadowAtlasEntry*)mappedEntries.pData;
+
+	for (unsigned int t = 0; t < shadowAtlasViews.size(); t++) {
+		ShadowAtlasView& tile = shadowAtlasViews[t];
+		ShadowAtlasEntry entry = shadowAtlas.CreateEntry(tile);
+		atlasEntries[t] = entry; // Mapped memory is write-only, so keep a copy to cull with
+
+		D3D11_VIEWPORT tileViewport = {};
+		tileViewport.TopLeftX = (float)tile.Region.X;
+		tileViewport.TopLeftY = (float)tile.Region.Y;
+		tileViewport.Width = (float)tile.Region.Size;
+		tileViewport.Height = (float)tile.Region.Size;
+		tileViewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &tileViewport);
+
+		vertexShader_ShadowMap->SetMatrix4x4("view", tile.View);
+		vertexShader_ShadowMap->SetMatrix4x4("projection", tile.Projection);
+		for (unsigned int i = 0; i < entities.size(); i++) {
+			if (!IsAABBVisible(entityBounds[i], entry.ViewProjection))
+				continue;
+			if (tile.CullingCone.Range > 0 && !ConeIntersectsAABB(tile.CullingCone, entityBounds[i]))
+				continue;
+			vertexShader_ShadowMap->SetMatrix4x4("world", entities[i]->GetTransform()->GetWorldMatrix());
+			vertexShader_ShadowMap->CopyAllBufferData();
+			entities[i]->GetMesh()->Draw(context);
 		}
+	}
 
-		material->BindMaterial();
-		ps->CopyAllBufferData();
+	context->Unmap(shadowAtlasEntryBuffer.Get(), 0);
+	context->OMSetRenderTargets(0, 0, 0);
+	context->RSSetState(0);
+}
 
-		// Setting the current material's shaders
-		vs->SetShader();
-		ps->SetShader();
+// --------------------------------------------------------
+// Every entity, lit by the clustered lights and shadowed
+// by the cascades and the atlas
+// --------------------------------------------------------
+void Game::DrawScene()
+{
+	PROFILE_SCOPE("Main pass");
+
+	// Everything the pixel shader needs to pick and sample a cascade
+	XMFLOAT4X4 shadowViewProjections[MAX_SHADOW_CASCADES] = {};
+	float cascadeEnds[MAX_SHADOW_CASCADES] = {}; // View space depth where each cascade stops
+	for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+		shadowViewProjections[c] = shadowCascades[c].ViewProjection;
+		cascadeEnds[c] = shadowCascades[c].SplitFar;
+	}
 
-		entity->GetMesh()->Draw(context);
+	// The lights and their clusters are shared by every entity, and only uploaded when they've changed
+	if (lights.GetVersion() != uploadedLightVersion) {
+		const std::vector<Light>& activeLights = lights.GetActiveLights();
+		UploadStructuredBuffer(lightBuffer, lightSRV, activeLights.data(), sizeof(Light), (unsigned int)activeLights.size());
+		uploadedLightVersion = lights.GetVersion();
+	}
+	if (clusterBuffersStale) {
+		UploadStructuredBuffer(lightClusterBuffer, lightClusterSRV, lightClusters.GetClusters().data(), sizeof(LightCluster), LIGHT_CLUSTER_COUNT);
+		UploadStructuredBuffer(lightIndexBuffer, lightIndexSRV, lightClusters.GetLightIndices().data(), sizeof(unsigned int), (unsigned int)lightClusters.GetLightIndices().size());
+		clusterBuffersStale = false;
 	}
-	// Skybox rendering
-	{
-		std::shared_ptr<SimplePixelShader> ps = skybox->GetPixelShader();
-		ps->SetFloat4("colorTint", XMFLOAT4(1, 1, 1, 1));
-		ps->SetFloat3("cameraPos", *cameras[cameraIndex]->GetTransform()->GetPosition());
-		ps->SetInt("numLights", (int)lightsToRender.size());
-		ps->SetData("lights", &lightsToRender[0], sizeof(Light)* (int)lightsToRender.size());
 
-		skybox->Draw(cameras[cameraIndex]);
+	// Only what the camera can see, split into runs of draws that are recorded on separate threads
+	// (see DrawLists.h).  Every draw sets all of its own shader values, so they don't depend on each other.
+	drawLists->Record((unsigned int)visibleEntities.size(), [&](unsigned int list, unsigned int first, unsigned int end) {
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> drawContext = drawListBackend->GetContext(list);
+
+		// A deferred context starts with nothing bound, so it needs the targets the graph bound on the immediate one
+		if (list != DRAW_LIST_IMMEDIATE) {
+			ID3D11RenderTargetView* targets[2] = { frameGraphBackend->GetRTV(sceneTarget), frameGraphBackend->GetRTV(sunAndOccludersTarget) };
+			drawContext->OMSetRenderTargets(2, targets, depthBufferDSV.Get());
+			D3D11_VIEWPORT viewport = { 0, 0, (float)windowWidth, (float)windowHeight, 0, 1 };
+			drawContext->RSSetViewports(1, &viewport);
+			drawContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		}
+
+		// Every shader on this thread writes into the list's command buffer, which is run all at once after
+		CommandBuffer& commands = drawCommands[list == DRAW_LIST_IMMEDIATE ? 0 : list];
+		commands.Reset();
+		ISimpleShader::RecordCommands(&commands);
+
+		for (unsigned int d = first; d < end; d++) {
+			// Raw pointers, since copying shared_ptrs here would mean four atomic increments and decrements per draw
+			Entity* entity = entities[visibleEntities[d]].get();
+			Material* material = entity->GetMaterial().get();
+			SimpleVertexShader* vs = material->GetVertexShader().get();
+			SimplePixelShader* ps = material->GetPixelShader().get();
+
+			// Setting what used to be constant buffer data, now handled by simpleShader
+			vs->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+			vs->SetMatrix4x4("worldInvTranspose", entity->GetTransform()->GetWorldInverseTransposeMatrix());
+			vs->SetMatrix4x4("view", cameras[cameraIndex]->GetViewMatrix());
+			vs->SetMatrix4x4("projection", cameras[cameraIndex]->GetProjectionMatrix());
+			vs->CopyAllBufferData();
+
+			ps->SetFloat4("colorTint", material->GetTint());
+			ps->SetFloat3("cameraPos", *cameras[cameraIndex]->GetTransform()->GetPosition());
+			ps->SetFloat("roughnessConstant", material->GetRoughness());
+			ps->SetInt("globalLightCount", (int)lightClusters.GetGlobalLightCount());
+			ps->SetFloat2("clusterTileSize", XMFLOAT2((float)windowWidth / LIGHT_CLUSTERS_X, (float)windowHeight / LIGHT_CLUSTERS_Y));
+			ps->SetFloat("clusterDepthScale", lightClusters.GetDepthScale());
+			ps->SetFloat("clusterDepthBias", lightClusters.GetDepthBias());
+			ps->SetShaderResourceView("Lights", lightSRV);
+			ps->SetShaderResourceView("LightClusters", lightClusterSRV);
+			ps->SetShaderResourceView("LightIndices", lightIndexSRV);
+			ps->SetData("shadowViewProjections", shadowViewProjections, sizeof(shadowViewProjections));
+			ps->SetData("cascadeEnds", cascadeEnds, sizeof(cascadeEnds));
+			ps->SetInt("cascadeCount", (int)shadowCascadeCount);
+			ps->SetShaderResourceView("ShadowMap", shadowSRV);
+			ps->SetShaderResourceView("ShadowAtlasEntries", shadowAtlasEntrySRV);
+			ps->SetShaderResourceView("ShadowAtlas", shadowAtlasSRV);
+			ps->SetSamplerState("ShadowSampler", shadowSampler);
+
+			// If the shader is using vector field functions
+			if (ps->HasVariable("functionVars")) {
+				ps->SetFloat4("functionVars", XMFLOAT4(specialShaderVars[0], specialShaderVars[1], specialShaderVars[2], specialShaderVars[3]));
+				ps->SetInt("xFunction", specialShaderFuncs[0] * 4 + specialShaderFuncs[1]);
+				ps->SetInt("yFunction", specialShaderFuncs[2] * 4 + specialShaderFuncs[3]);
+			}
+
+			material->BindMaterial();
+			ps->CopyAllBufferData();
+
+			// Setting the current material's shaders
+			vs->SetShader();
+			ps->SetShader();
+
+			entity->GetMesh()->Draw(commands);
+		}
+
+		ISimpleShader::RecordCommands(nullptr);
+		CommandBufferD3D11(drawContext).Execute(commands);
+	});
+
+	// Each deferred list starts from nothing bound, so each is analyzed that way (the immediate one just continues)
+	if (analyzeDrawCommands) {
+		drawCommandAnalysis.ResetStats();
+		unsigned int listCount = std::max(1u, (unsigned int)drawLists->GetRanges().size());
+		for (unsigned int list = 0; list < listCount; list++) {
+			if (!drawLists->GetRanges().empty())
+				drawCommandAnalysis.ResetState();
+			drawCommandAnalysis.Execute(drawCommands[list]);
+		}
 	}
-	// ==================== POST-RENDERING ====================
-	// - These should happen exactly ONCE PER FRAME
-	// - At the very end of the frame (after drawing *everything*)
-	{
-		// Doing our post-processing effect
-		context->OMSetRenderTargets(
-			1,
-			backBufferRTV.GetAddressOf(),
-			0);
+}
+
+// --------------------------------------------------------
+// Separable box blur: shrunk first if it's running at a
+// lower resolution (each halving is one bilinear read that
+// averages 2x2 texels), then across, then down.  Returns
+// the result, which the composite stretches back over the
+// screen with the same bilinear sampler.
+// --------------------------------------------------------
+unsigned int Game::AddBlurPasses(unsigned int source)
+{
+	// Each pass reads what the one before it drew, into a target the graph binds (with a viewport to match)
+	auto addBlurPass = [&](const char* name, unsigned int downsample, XMFLOAT2 axis, const BlurTaps& taps) {
+		RenderTargetDesc desc = { std::max(windowWidth / downsample, 1u), std::max(windowHeight / downsample, 1u), DXGI_FORMAT_R8G8B8A8_UNORM, 0 };
+		unsigned int input = source;
+		unsigned int output = frameGraph->Create(name, desc);
+		XMFLOAT2 direction(axis.x / desc.Width, axis.y / desc.Height);
+		unsigned int pass = frameGraph->AddPass(name, [this, input, direction, taps]() {
+			vertexShader_Fullscreen->SetShader();
+			pixelShader_Blur->SetShader();
+			pixelShader_Blur->SetSamplerState("ClampSampler", postProcessSampler.Get());
+			pixelShader_Blur->SetShaderResourceView("Screen", frameGraphBackend->GetSRV(input));
+			pixelShader_Blur->SetFloat2("direction", direction);
+			pixelShader_Blur->SetInt("tapCount", taps.Count);
+			pixelShader_Blur->SetData("taps", taps.Taps, sizeof(taps.Taps));
+			pixelShader_Blur->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+		frameGraph->Read(pass, input);
+		frameGraph->Write(pass, output, FRAME_GRAPH_RENDER_TARGET, true);
+		source = output;
+	};
+
+	// The radius shrinks with the image, so it covers the same part of the screen
+	BlurTaps copy = CalculateBlurTaps(0);
+	BlurTaps taps = CalculateBlurTaps((blurRadius + blurDownsample / 2) / blurDownsample);
+	for (int downsample = 2; downsample <= blurDownsample; downsample *= 2)
+		addBlurPass(downsample == 2 ? "Blur half" : "Blur quarter", downsample, XMFLOAT2(0, 0), copy);
+	addBlurPass("Blur across", blurDownsample, XMFLOAT2(1, 0), taps);
+	addBlurPass("Blur down", blurDownsample, XMFLOAT2(0, 1), taps);
+	return source;
+}
+
+// --------------------------------------------------------
+// Light scattering at a reduced resolution, then added to
+// the screen at full resolution by a depth aware upsample.
+// The scattering pass reads the sun/occluder mip nearest
+// its own size, so it never touches the full size target.
+// --------------------------------------------------------
+void Game::AddLightScatteringPasses(unsigned int screen, unsigned int depth, unsigned int backBuffer)
+{
+	unsigned int width = std::max(windowWidth / scatteringDownsample, 1u);
+	unsigned int height = std::max(windowHeight / scatteringDownsample, 1u);
+
+	// Half precision: the light fades smoothly, and the view depth needs more than 8 bits
+	unsigned int scattering = frameGraph->Create("Light scattering", { width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, 0 });
+
+	unsigned int pass = frameGraph->AddPass("Light scattering", [this, depth, width, height]() {
+		std::shared_ptr<Camera> camera = cameras[cameraIndex];
+		context->GenerateMips(frameGraphBackend->GetSRV(sunAndOccludersTarget));
 
 		vertexShader_Fullscreen->SetShader();
 		pixelShader_VolumetricLighting->SetShader();
-		pixelShader_VolumetricLighting->SetShaderResourceView("Screen", renderSRV.Get());
-		pixelShader_VolumetricLighting->SetShaderResourceView("SunAndOcclusion",sunAndOccludersSRV.Get());
+		pixelShader_VolumetricLighting->SetShaderResourceView("SunAndOcclusion", frameGraphBackend->GetSRV(sunAndOccludersTarget));
+		pixelShader_VolumetricLighting->SetShaderResourceView("Depth", frameGraphBackend->GetSRV(depth));
 		pixelShader_VolumetricLighting->SetSamplerState("ClampSampler", postProcessSampler.Get());
-		pixelShader_VolumetricLighting->SetInt("numSamples", 20);
-		pixelShader_VolumetricLighting->SetFloat("exposure", 0.7f);
-		pixelShader_VolumetricLighting->SetFloat("weight", 0.5f);
-		pixelShader_VolumetricLighting->SetFloat("decay", 0.8f);
+		pixelShader_VolumetricLighting->SetFloat("exposure", scatteringSettings.Exposure);
+		pixelShader_VolumetricLighting->SetFloat("weight", scatteringSettings.Weight);
+		pixelShader_VolumetricLighting->SetFloat("decay", scatteringSettings.Decay);
+		pixelShader_VolumetricLighting->SetFloat("texelsPerSample", scatteringSettings.TexelsPerSample);
+		pixelShader_VolumetricLighting->SetInt("maxSamples", scatteringSettings.MaxSamples);
 		pixelShader_VolumetricLighting->SetFloat4("sunPosition", sunPosition);
+		pixelShader_VolumetricLighting->SetFloat2("targetSize", XMFLOAT2((float)width, (float)height));
+		pixelShader_VolumetricLighting->SetFloat("occlusionMip", log2f((float)scatteringDownsample));
+		pixelShader_VolumetricLighting->SetFloat("nearClip", camera->GetNearClip());
+		pixelShader_VolumetricLighting->SetFloat("farClip", camera->GetFarClip());
 		pixelShader_VolumetricLighting->CopyAllBufferData();
-
 		context->Draw(3, 0); // Just drawing 3 vertices, the vertex shader does the rest
+	});
+	frameGraph->Read(pass, sunAndOccludersTarget);
+	frameGraph->Read(pass, depth);
+	frameGraph->Write(pass, scattering, FRAME_GRAPH_RENDER_TARGET, true);
 
-	}
-	{
-		// Present the back buffer to the user
-		//  - Puts the results of what we've drawn onto the window
-		//  - Without this, the user never sees anything
-		bool vsyncNecessary = vsync || !deviceSupportsTearing || isFullscreen;
-		
-		// Render UI
-		ImGui::Render();
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-
-		swapChain->Present(
-			vsyncNecessary ? 1 : 0,
-			vsyncNecessary ? 0 : DXGI_PRESENT_ALLOW_TEARING);
-
-		// Must re-bind buffers after presenting, as they become unbound
-		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
-
-		// Unbind all SRVs to avoid errors when shadow map is used as a depth buffer at the beginning of the next frame
-		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		context->PSSetShaderResources(0, 128, nullSRVs);
-	}
+	pass = frameGraph->AddPass("Light scattering composite", [this, screen, scattering, depth, width, height]() {
+		std::shared_ptr<Camera> camera = cameras[cameraIndex];
+		vertexShader_Fullscreen->SetShader();
+		pixelShader_VolumetricComposite->SetShader();
+		pixelShader_VolumetricComposite->SetShaderResourceView("Screen", frameGraphBackend->GetSRV(screen));
+		pixelShader_VolumetricComposite->SetShaderResourceView("Scattering", frameGraphBackend->GetSRV(scattering));
+		pixelShader_VolumetricComposite->SetShaderResourceView("Depth", frameGraphBackend->GetSRV(depth));
+		pixelShader_VolumetricComposite->SetSamplerState("ClampSampler", postProcessSampler.Get());
+		pixelShader_VolumetricComposite->SetFloat2("scatteringSize", XMFLOAT2((float)width, (float)height));
+		pixelShader_VolumetricComposite->SetFloat("nearClip", camera->GetNearClip());
+		pixelShader_VolumetricComposite->SetFloat("farClip", camera->GetFarClip());
+		pixelShader_VolumetricComposite->SetFloat("depthSharpness", scatteringDepthSharpness);
+		pixelShader_VolumetricComposite->CopyAllBufferData();
+		context->Draw(3, 0);
+	});
+	frameGraph->Read(pass, screen);
+	frameGraph->Read(pass, scattering);
+	frameGraph->Read(pass, depth);
+	frameGraph->Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET, true); // Every pixel, so the back buffer needn't be cleared
 }
 
 void Game::UpdateImGui(float deltaTime, float totalTime)
@@ -741,6 +1351,8 @@ void Game::UpdateImGui(float deltaTime, float totalTime)
 	ImGui::Text("The current framerate is %f", ImGui::GetIO().Framerate);
 	ImGui::Text("The game window is %i pixels wide and %i pixels high", windowWidth, windowHeight);
 	ImGui::ColorEdit4("Ambient light color", &ambientColor.x);
+	if (assets->GetTextureLoader()->GetPendingLoadCount() > 0)
+		ImGui::Text("Textures still loading: %u", assets->GetTextureLoader()->GetPendingLoadCount());
 
 	// Camera GUI
 	if (ImGui::CollapsingHeader("Cameras")) {
@@ -783,14 +1395,21 @@ void Game::UpdateImGui(float deltaTime, float totalTime)
 				XMFLOAT4 rot = *entities[i]->GetTransform()->GetRotation(); // All I could think to do is just display quaternion data, though I know that's not super intuitive
 				XMFLOAT3 sc = *entities[i]->GetTransform()->GetScale();
 
-				ImGui::DragFloat3("Position", &pos.x, 0.01f);
-				ImGui::DragFloat4("Rotation", &rot.x, 0.01f);
-				ImGui::DragFloat3("Scale", &sc.x, 0.01f);
+				// Only set what actually changed, so static entities' cached shadows aren't thrown away
+				if (ImGui::DragFloat3("Position", &pos.x, 0.01f)) {
+					// Moved straight there, rather than drawn sliding over
+					entities[i]->GetTransform()->SetPosition(pos);
+					previousPositions[i] = pos;
+					currentPositions[i] = pos;
+				}
+				if (ImGui::DragFloat4("Rotation", &rot.x, 0.01f))
+					entities[i]->GetTransform()->SetRotation(rot);
+				if (ImGui::DragFloat3("Scale", &sc.x, 0.01f))
+					entities[i]->GetTransform()->SetScale(sc);
+				bool isStatic = entities[i]->IsStatic();
+				if (ImGui::Checkbox("Static", &isStatic))
+					entities[i]->SetStatic(isStatic);
 				ImGui::Text("Tris: %i", entities[i]->GetMesh()->GetIndexCount() / 3);
-
-				entities[i]->GetTransform()->SetPosition(pos);
-				entities[i]->GetTransform()->SetRotation(rot);
-				entities[i]->GetTransform()->SetScale(sc);
 				
 				ImGui::TreePop();
 			}
@@ -818,42 +1437,346 @@ void Game::UpdateImGui(float deltaTime, float totalTime)
 	// Lighting GUI
 	const char* lightTypes[] = { "Directional", "Point", "Spot" };
 	if (ImGui::CollapsingHeader("Lights")) {
-		for (unsigned int i = 0; i < allLights.size(); i++) {
-			if (ImGui::TreeNode((void*)(intptr_t)i, "Light %c (%s)", (char)(i + 65), lightTypes[allLights[i]->Type])) {
-				const bool wasActive = activeLights.count(i);
+		for (unsigned int i = 0; i < sceneLights.size(); i++) {
+			Light light = lights.Get(sceneLights[i]);
+			if (ImGui::TreeNode((void*)(intptr_t)i, "Light %c (%s)", (char)(i + 65), lightTypes[light.Type])) {
+				const bool wasActive = lights.IsActive(sceneLights[i]);
 				bool nowActive = wasActive;
 				if (i > 0) {
 					ImGui::Checkbox("Active", &nowActive);
 				}
-				if (nowActive && !wasActive) {
-					activeLights.insert({ i, allLights[i] });
-				}
-				else if (!nowActive && wasActive && activeLights.size() > 1) {
-					activeLights.erase(i);
+				if (nowActive != wasActive && (nowActive || lights.GetActiveLights().size() > 1)) {
+					lights.SetActive(sceneLights[i], nowActive);
 				}
 
-				XMFLOAT3 lightColor = allLights[i]->Color;
-				ImGui::ColorEdit3("Color", &lightColor.x);
-				allLights[i]->Color = lightColor;
+				bool changed = ImGui::ColorEdit3("Color", &light.Color.x);
+				if (light.Type == LIGHT_TYPE_SPOT) {
+					changed |= ImGui::SliderFloat3("Direction", &light.Direction.x, -1.0f, 1.0f);
+					changed |= ImGui::SliderFloat("Falloff", &light.SpotFalloff, 1.0f, 128.0f);
+					ImGui::Text("Cone half angle: %.1f degrees", XMConvertToDegrees(acosf(GetSpotLightCosAngle(light.SpotFalloff))));
+				}
+				if (changed) {
+					lights.Set(sceneLights[i], light);
+				}
 
 
 				ImGui::TreePop();
 			}
 		}
-	}
-	lightsToRender = vector<Light>();
-	for (auto& light : activeLights) {
-		lightsToRender.push_back(*light.second);
+
+		// Unshadowed point lights scattered over the scene.  The same seed every time, so the slider only adds or removes lights.
+		if (ImGui::SliderInt("Scattered point lights", &scatteredLightCount, 0, 4096)) {
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> across(-15.0f, 15.0f);
+			std::uniform_real_distribution<float> height(-1.0f, 3.0f);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (LightHandle handle : scatteredLights) {
+				lights.Remove(handle);
+			}
+			scatteredLights.clear();
+			for (int i = 0; i < scatteredLightCount; i++) {
+				Light pointLight = {};
+				pointLight.Type = LIGHT_TYPE_POINT;
+				pointLight.Position = XMFLOAT3(across(random), height(random), across(random) + 10.0f);
+				pointLight.Range = 1.0f + 2.0f * unit(random);
+				pointLight.Color = XMFLOAT3(unit(random), unit(random), unit(random));
+				pointLight.Intensity = 1.0f;
+				pointLight.ShadowIndex = -1;
+				scatteredLights.push_back(lights.Add(pointLight));
+			}
+		}
+		ImGui::Text("Light clustering: %.3f ms on %u threads", lightClusteringTime, lightClusters.GetThreadCount());
+		ImGui::Text("%u light indices, busiest cluster has %u lights",
+			(unsigned int)lightClusters.GetLightIndices().size(), lightClusters.GetMaxClusterLights());
+		ImGui::Text("%u lights (%u active), version %u, %u full rebuilds",
+			lights.GetCount(), (unsigned int)lights.GetActiveLights().size(), lights.GetVersion(), lights.GetRebuildCount());
 	}
 	// Post Processing GUI
 	if (ImGui::CollapsingHeader("Post Processing")) {
 		ImGui::SliderInt("Blurriness", &blurRadius, 0, 12);
+		const char* blurResolutions[] = { "Full", "Half", "Quarter" };
+		int blurResolution = blurDownsample == 4 ? 2 : blurDownsample - 1;
+		if (ImGui::Combo("Blur resolution", &blurResolution, blurResolutions, 3))
+			blurDownsample = 1 << blurResolution;
+		BlurTaps taps = CalculateBlurTaps((blurRadius + blurDownsample / 2) / blurDownsample);
+		ImGui::Text("%d texture reads per pixel (a full size box would be %d)", 2 * (2 * taps.Count - 1), (2 * blurRadius + 1) * (2 * blurRadius + 1));
+
+		const char* scatteringResolutions[] = { "Full", "Half", "Quarter" };
+		int scatteringResolution = scatteringDownsample == 4 ? 2 : scatteringDownsample - 1;
+		if (ImGui::Combo("Light scattering resolution", &scatteringResolution, scatteringResolutions, 3))
+			scatteringDownsample = 1 << scatteringResolution;
+		ImGui::SliderFloat("Scattering exposure", &scatteringSettings.Exposure, 0.0f, 2.0f);
+		ImGui::SliderFloat("Scattering decay", &scatteringSettings.Decay, 0.5f, 1.0f);
+		ImGui::SliderFloat("Texels per scattering sample", &scatteringSettings.TexelsPerSample, 1.0f, 32.0f);
+		ImGui::SliderInt("Max scattering samples", &scatteringSettings.MaxSamples, 1, MAX_SCATTERING_SAMPLES);
+		ImGui::SliderFloat("Upsample depth sharpness", &scatteringDepthSharpness, 0.0f, 100.0f);
+	}
+	// Frame graph GUI (last frame's)
+	if (ImGui::CollapsingHeader("Frame Graph")) {
+		for (unsigned int p = 0; p < frameGraph->GetPassCount(); p++)
+			ImGui::BulletText("%s%s", frameGraph->GetPassName(p), frameGraph->IsCulled(p) ? " (culled)" : "");
+		ImGui::Text("%u target changes, %u inputs unbound", frameGraph->GetBindCount(), frameGraph->GetUnbindCount());
+		ImGui::Text("%u render targets, sharing %u textures", frameGraph->GetPool().GetTargetCount(), frameGraph->GetPool().GetTextureCount());
+	}
+	// CPU profiler GUI
+	if (ImGui::CollapsingHeader("Profiler")) {
+		UpdateProfilerImGui();
+		ImGui::Text("Job system: %u threads, %llu jobs run, %llu stolen", jobs->GetThreadCount(), jobs->GetJobsRun(), jobs->GetJobsStolen());
+		ImGui::Text("Heap allocations last frame: %llu", heapAllocationsLastFrame);
+		ImGui::Text("Frame arena: %zu of %zu KB (peak %zu KB), %u overflows", frameArena->GetUsed() / 1024,
+			frameArena->GetCapacity() / 1024, frameArena->GetPeak() / 1024, frameArena->GetOverflowCount());
+
+		// Main pass recording
+		int maxDrawLists = (int)drawLists->GetMaxLists();
+		if (ImGui::SliderInt("Max draw lists", &maxDrawLists, 1, DRAW_LISTS_MAX))
+			drawLists->SetMaxLists((unsigned int)maxDrawLists);
+		int minDrawsPerList = (int)drawLists->GetMinDrawsPerList();
+		if (ImGui::SliderInt("Min draws per list", &minDrawsPerList, 1, 1024))
+			drawLists->SetMinDrawsPerList((unsigned int)minDrawsPerList);
+		if (drawLists->GetRanges().empty())
+			ImGui::Text("Main pass: %u draws on the immediate context", (unsigned int)visibleEntities.size());
+		else
+			ImGui::Text("Main pass: %u draws in %u deferred lists%s", (unsigned int)visibleEntities.size(), (unsigned int)drawLists->GetRanges().size(),
+				drawListBackend->HasDriverCommandLists() ? "" : " (emulated by the runtime)");
+		ImGui::Checkbox("Analyze main pass commands", &analyzeDrawCommands);
+		if (analyzeDrawCommands) {
+			const CommandStats& stats = drawCommandAnalysis.GetStats();
+			ImGui::Text("%llu commands, %llu redundant (%.1f%%), %llu KB of constants",
+				stats.Commands, stats.Redundant, stats.Commands ? 100.0 * stats.Redundant / stats.Commands : 0.0, stats.ConstantBytes / 1024);
+			for (unsigned int type = 0; type < COMMAND_TYPE_COUNT; type++) {
+				if (stats.ByType[type] > 0)
+					ImGui::Text("    %s: %llu (%llu redundant)", CommandRecorder::GetCommandName((CommandType)type), stats.ByType[type], stats.RedundantByType[type]);
+			}
+		}
+
+		// GPU times, from a few frames ago
+		ImGui::Separator();
+		ImGui::Text("GPU frame: %.3f ms (average %.3f ms)", gpuProfiler->GetFrameTime(), gpuProfiler->GetAverageFrameTime());
+		if (ImGui::BeginTable("GPU passes", 3)) {
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("ms");
+			ImGui::TableSetupColumn("Average ms");
+			ImGui::TableHeadersRow();
+			for (const GpuPassTime& time : gpuProfiler->GetPassTimes()) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%*s%s", (int)time.Depth * 2, "", time.Name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", time.Milliseconds);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", time.Average);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::Text("%u frames read back, %u dropped, %u passes untimed",
+			gpuProfiler->GetFramesRead(), gpuProfiler->GetFramesDropped(), gpuProfiler->GetPassesSkipped());
+	}
+	// Shadow cascade GUI
+	if (ImGui::CollapsingHeader("Shadows")) {
+		int cascadeCount = (int)cascadeSettings.CascadeCount;
+		ImGui::SliderInt("Cascades", &cascadeCount, 1, MAX_SHADOW_CASCADES);
+		cascadeSettings.CascadeCount = (unsigned int)cascadeCount;
+		ImGui::SliderFloat("Log/uniform split blend", &cascadeSettings.SplitLambda, 0.0f, 1.0f);
+		ImGui::SliderFloat("Max shadow distance", &cascadeSettings.MaxShadowDistance, 5.0f, 200.0f);
+		for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+			ImGui::Text("Cascade %u: %.2f to %.2f (radius %.2f), %u casters", c, shadowCascades[c].SplitNear, shadowCascades[c].SplitFar, shadowCascades[c].Radius, (unsigned int)shadowCasters[c].size());
+		}
+		ImGui::Text("Casters culled this frame: %u", shadowCastersCulled);
+		ImGui::Text("Static shadows re-rendered this frame: %u of %u cascades", staticShadowUpdates, shadowCascadeCount);
+		ImGui::Text("Shadow atlas: %u tiles, %.0f%% used, fragmentation %.2f",
+			(unsigned int)shadowAtlasViews.size(),
+			100.0f * shadowAtlas.GetUsedArea() / ((float)shadowAtlasResolution * shadowAtlasResolution),
+			shadowAtlas.GetFragmentation());
 	}
 	// Shadow Map GUI
 	if (ImGui::CollapsingHeader("Other Render Targes")) {
-		ImGui::Image(shadowSRV.Get(), ImVec2((float)shadowMapResolution, (float)shadowMapResolution));
-		ImGui::Image(sunAndOccludersSRV.Get(), ImVec2((float)windowWidth, (float)windowHeight));
+		for (unsigned int c = 0; c < shadowCascadeCount; c++) {
+			ImGui::Image(shadowCascadeSRVs[c].Get(), ImVec2(256, 256));
+			if (c + 1 < shadowCascadeCount)
+				ImGui::SameLine();
+		}
+		ImGui::Image(shadowAtlasSRV.Get(), ImVec2(512, 512));
+		// Last frame's, until the next frame's passes are added (none after a resize)
+		if (frameGraph->GetPassCount() > 0)
+			ImGui::Image(frameGraphBackend->GetSRV(sunAndOccludersTarget), ImVec2((float)windowWidth, (float)windowHeight));
+	}
+	// Frame pacing GUI
+	if (ImGui::CollapsingHeader("Frame Pacing")) {
+		ImGui::Checkbox("VSync", &vsync);
+		if (!vsync && (!deviceSupportsTearing || isFullscreen))
+			ImGui::Text("(Still synced: no tearing on this device, or in fullscreen)");
+		int frameLatency = (int)maxFrameLatency;
+		if (ImGui::SliderInt("Max frame latency", &frameLatency, 1, 3))
+			SetMaxFrameLatency((unsigned int)frameLatency);
+		bool limitFrameRate = frameLimiter.GetTargetFps() > 0;
+		if (ImGui::Checkbox("Limit frame rate", &limitFrameRate))
+			frameLimiter.SetTargetFps(limitFrameRate ? frameLimiterTarget : 0.0f);
+		if (limitFrameRate && ImGui::SliderFloat("Target FPS", &frameLimiterTarget, 30.0f, 500.0f, "%.0f"))
+			frameLimiter.SetTargetFps(frameLimiterTarget);
+		if (limitFrameRate)
+			ImGui::Text("Spin margin: %.2f ms, last frame %.3f ms late (%llu late in all)", frameLimiter.GetSpinMargin() * 1000.0, frameLimiter.GetLateness() * 1000.0, frameLimiter.GetLateFrames());
+		ImGui::Text("Waited %.2f ms for the swap chain", swapChainWaitTime);
+		ImGui::Text("Input to present: %.2f ms (average %.2f, worst %.2f)", inputLatency.GetLatest(), inputLatency.GetAverage(), inputLatency.GetWorst());
+		ImGui::PlotLines("Input to present (ms)", inputLatency.GetSamples(), inputLatency.GetSampleCount(), inputLatency.GetOffset(), 0, 0.0f, FLT_MAX, ImVec2(0, 60));
+	}
+	// Fixed timestep GUI
+	if (ImGui::CollapsingHeader("Simulation")) {
+		float tickRate = timestep.GetTickRate();
+		if (ImGui::SliderFloat("Tick rate (Hz)", &tickRate, 5.0f, 240.0f, "%.0f"))
+			timestep.SetTickRate(tickRate);
+		int maxSteps = (int)timestep.GetMaxSteps();
+		if (ImGui::SliderInt("Max steps per frame", &maxSteps, 1, 20))
+			timestep.SetMaxSteps((unsigned int)maxSteps);
+		ImGui::Checkbox("Interpolate entities", &interpolateEntities);
+		ImGui::Text("%u steps this frame, %llu in all (%.2f s simulated)", timestep.GetStepsThisFrame(), timestep.GetStepCount(), timestep.GetSimulationTime());
+		ImGui::Text("Interpolation: %.2f", timestep.GetInterpolation());
+		ImGui::Text("Fallen behind by %.2f s", timestep.GetDroppedTime());
+	}
+	// Memory GUI
+	if (ImGui::CollapsingHeader("Memory")) {
+		UpdateMemoryImGui();
+	}
+	// Asset GUI
+	const char* assetTypes[] = { "Meshes", "Vertex shaders", "Pixel shaders", "Textures" };
+	if (ImGui::CollapsingHeader("Assets")) {
+		for (int i = 0; i < ASSET_TYPE_COUNT; i++) {
+			AssetStats stats = assets->GetStats((AssetType)i);
+			if (ImGui::TreeNode(assetTypes[i], "%s: %u resident, %.2f MB", assetTypes[i], stats.Resident, stats.BytesResident / (1024.0f * 1024.0f))) {
+				ImGui::Text("Hits: %u", stats.Hits);
+				ImGui::Text("Misses: %u (%u matched existing contents)", stats.Misses, stats.Deduplicated);
+				ImGui::Text("References: %u", stats.References);
+				ImGui::TreePop();
+			}
+		}
 	}
 
 	ImGui::End();
 }
+
+// --------------------------------------------------------
+// Each memory tag's live and peak use, on the heap and the
+// GPU, against its budget
+// --------------------------------------------------------
+void Game::UpdateMemoryImGui()
+{
+	if (ImGui::Button("Write memory report"))
+		memoryReportStatus = WriteMemoryReport("memory_report.txt") ? "Wrote memory_report.txt" : "Couldn't write memory_report.txt";
+	ImGui::SameLine();
+	ImGui::Text("%s", memoryReportStatus);
+
+	const float megabyte = 1024.0f * 1024.0f;
+	MemoryUsage total = GetTotalMemoryUsage();
+	ImGui::Text("Heap: %.1f MB in %llu allocations (peak %.1f MB)", total.HeapBytes / megabyte, total.HeapAllocations, total.HeapPeak / megabyte);
+	ImGui::Text("GPU (estimated): %.1f MB in %llu resources (peak %.1f MB)", total.GpuBytes / megabyte, total.GpuResources, total.GpuPeak / megabyte);
+
+	if (!ImGui::BeginTable("Memory tags", 5))
+		return;
+	ImGui::TableSetupColumn("Tag");
+	ImGui::TableSetupColumn("Heap");
+	ImGui::TableSetupColumn("Heap peak MB");
+	ImGui::TableSetupColumn("GPU");
+	ImGui::TableSetupColumn("GPU peak MB");
+	ImGui::TableHeadersRow();
+	for (unsigned int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+		MemoryUsage usage = GetMemoryUsage((MemoryTag)tag);
+		MemoryBudget budget = GetMemoryBudget((MemoryTag)tag);
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		if (IsOverMemoryBudget((MemoryTag)tag))
+			ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s (over budget)", GetMemoryTagName((MemoryTag)tag));
+		else
+			ImGui::Text("%s", GetMemoryTagName((MemoryTag)tag));
+		ImGui::TableNextColumn();
+		MemoryBar(usage.HeapBytes, budget.HeapBytes);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.1f", usage.HeapPeak / megabyte);
+		ImGui::TableNextColumn();
+		MemoryBar(usage.GpuBytes, budget.GpuBytes);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.1f", usage.GpuPeak / megabyte);
+	}
+	ImGui::EndTable();
+}
+
+// --------------------------------------------------------
+// Recent frame times, and one frame's zones as a flame
+// graph: a lane per thread, a row per nesting depth, with
+// time running left to right across the frame
+// --------------------------------------------------------
+void Game::UpdateProfilerImGui()
+{
+	Profiler& profiler = Profiler::GetInstance();
+	bool paused = profiler.IsPaused();
+	if (ImGui::Checkbox("Pause", &paused))
+		profiler.SetPaused(paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome trace"))
+		profilerExportStatus = profiler.ExportChromeTrace("profile.json") ? "Wrote profile.json" : "Couldn't write profile.json";
+	ImGui::SameLine();
+	ImGui::Text("%s", profilerExportStatus);
+
+	unsigned int frameCount = profiler.GetFrameCount();
+	if (frameCount == 0)
+		return;
+
+	// Oldest on the left
+	float frameTimes[PROFILER_HISTORY_FRAMES];
+	for (unsigned int i = 0; i < frameCount; i++) {
+		const ProfilerFrame& frame = profiler.GetFrame(frameCount - 1 - i);
+		frameTimes[i] = (float)profiler.ToMilliseconds(frame.End - frame.Start);
+	}
+	ImGui::PlotHistogram("Frame times (ms)", frameTimes, (int)frameCount, 0, 0, 0.0f, FLT_MAX, ImVec2(0, 60));
+	profilerFrameAge = std::min(profilerFrameAge, (int)frameCount - 1);
+	ImGui::SliderInt("Frames ago", &profilerFrameAge, 0, (int)frameCount - 1);
+
+	const ProfilerFrame& frame = profiler.GetFrame(profilerFrameAge);
+	double frameTime = std::max(profiler.ToMilliseconds(frame.End - frame.Start), 0.001);
+	ImGui::Text("%.3f ms, %u zones on %u threads", frameTime, (unsigned int)frame.Events.size(), frame.ThreadCount);
+	if (frame.Dropped > 0)
+		ImGui::Text("%u zones dropped (a thread's ring filled up)", frame.Dropped);
+
+	// Each thread's lane has a label, then as many rows as its deepest zone
+	unsigned int rows[PROFILER_MAX_THREADS] = {};
+	for (const ProfilerEvent& event : frame.Events)
+		rows[event.Thread] = std::max(rows[event.Thread], event.Depth + 1);
+	float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	float laneTops[PROFILER_MAX_THREADS] = {};
+	float height = 0;
+	for (unsigned int t = 0; t < frame.ThreadCount; t++) {
+		laneTops[t] = height;
+		height += rows[t] > 0 ? (rows[t] + 1) * rowHeight : 0;
+	}
+
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+	ImGui::InvisibleButton("Flame graph", ImVec2(width, std::max(height, rowHeight)));
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	for (unsigned int t = 0; t < frame.ThreadCount; t++) {
+		if (rows[t] == 0)
+			continue;
+		char label[32] = "Main thread";
+		if (t > 0)
+			snprintf(label, sizeof(label), "Thread %u", t);
+		drawList->AddText(ImVec2(origin.x, origin.y + laneTops[t]), ImGui::GetColorU32(ImGuiCol_Text), label);
+	}
+
+	for (const ProfilerEvent& event : frame.Events) {
+		// Zones still open when the frame started are cut off at its start
+		double start = event.Start > frame.Start ? profiler.ToMilliseconds(event.Start - frame.Start) : 0.0;
+		double end = event.End > frame.Start ? profiler.ToMilliseconds(event.End - frame.Start) : 0.0;
+		ImVec2 min(origin.x + (float)(start / frameTime) * width, origin.y + laneTops[event.Thread] + (event.Depth + 1) * rowHeight);
+		ImVec2 max(std::max(origin.x + (float)(end / frameTime) * width, min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+		// The same color for a name every frame
+		unsigned int hash = 2166136261u;
+		for (const char* c = event.Name; *c; c++)
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		drawList->AddRectFilled(min, max, ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.6f));
+		if (max.x - min.x > 8.0f) {
+			ImVec4 clip(min.x, min.y, max.x, max.y);
+			drawList->AddText(ImGui::GetFont(), ImGui::GetFontSize(), ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, event.Name, 0, 0.0f, &clip);
+		}
+		if (ImGui::IsMouseHoveringRect(min, max))
+			ImGui::SetTooltip("%s: %.3f ms", event.Name, profiler.ToMilliseconds(event.End - event.Start));
+	}
+}
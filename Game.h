@@ -6,6 +6,24 @@
 #include "Camera.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "AssetManager.h"
+#include "ShadowCascades.h"
+#include "ShadowCulling.h"
+#include "StaticShadowCache.h"
+#include "ShadowAtlas.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "LightManager.h"
+#include "Blur.h"
+#include "LightScattering.h"
+#include "FrameGraph.h"
+#include "FrameGraphD3D11.h"
+#include "GpuProfiler.h"
+#include "GpuProfilerD3D11.h"
+#include "DrawListsD3D11.h"
+#include "CommandBufferD3D11.h"
+#include "CommandRecorder.h"
+#include "FrameArena.h"
 
 #include <memory>
 #include <DirectXMath.h>
@@ -24,12 +42,15 @@ public:
 	// will be called automatically
 	void Init();
 	void OnResize();
+	void FixedUpdate(float stepTime, float simulationTime);
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 	/// <summary>
 	/// Function called in Update() that handles ImGui
 	/// </summary>
 	void UpdateImGui(float deltaTime, float totalTime);
+	void UpdateProfilerImGui();
+	void UpdateMemoryImGui();
 
 private:
 
@@ -37,7 +58,17 @@ private:
 	void LoadShaders(); 
 	void CreateGeometry();
 	void ShadowInit();
-	void RenderTargetInit();
+	void DrawShadowCascades();
+	void DrawShadowAtlas();
+	void DrawScene();
+	unsigned int AddBlurPasses(unsigned int source);
+	void AddLightScatteringPasses(unsigned int screen, unsigned int depth, unsigned int backBuffer);
+	void UpdateShadowCascades();
+	void UpdateShadowAtlas();
+	void UpdateLightClusters();
+	void UploadStructuredBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+		const void* data, unsigned int stride, unsigned int count);
+	std::shared_ptr<Material> CreatePBRMaterial(const std::string& textureName, float roughness, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
 	// Buffers to hold actual geometry data
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
@@ -49,16 +80,38 @@ private:
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader_NormalMap;
 	std::shared_ptr<SimplePixelShader> pixelShader_NormalMap;
+	std::shared_ptr<SimplePixelShader> pixelShader_NormalMapORM; // Packed occlusion/roughness/metalness variant
 	std::shared_ptr<SimpleVertexShader> vertexShader_ShadowMap;
 	std::shared_ptr<SimpleVertexShader> vertexShader_Fullscreen;
 	std::shared_ptr<SimplePixelShader> pixelShader_Blur;
 	std::shared_ptr<SimplePixelShader> pixelShader_VolumetricLighting;
+	std::shared_ptr<SimplePixelShader> pixelShader_VolumetricComposite;
 
 	std::vector<int> specialShaderFuncs;
 	std::vector<float> specialShaderVars;
 
+	// Every mesh, shader and texture comes through here so nothing is loaded twice
+	// - Textures load on background threads; materials use placeholders until then
+	std::shared_ptr<AssetManager> assets;
+
+	// Worker threads for the frame's CPU work: moving entities, their bounds and culling, light clustering (see JobSystem.h)
+	// - Declared before anything that's given it on construction
+	std::shared_ptr<JobSystem> jobs;
+
+	// Memory for lists that only last a frame (the frame graph's, culling's, shadow setup's), emptied a frame
+	// at a time at the start of Update() (see FrameArena.h).  Declared before anything that keeps some of it.
+	std::shared_ptr<FrameArena> frameArena;
+	unsigned long long frameStartHeapAllocations; // GetHeapAllocationCount() as Update() began (see AllocationCounter.h)
+	unsigned long long heapAllocationsLastFrame;
+
 	// A list of objects to draw on-screen
 	std::vector<std::shared_ptr<Entity>> entities;
+	// Each entity's position before and after the last simulation step.  Its transform is
+	// put between the two every frame, so movement is smooth whatever the tick rate.
+	std::vector<DirectX::XMFLOAT3> previousPositions;
+	std::vector<DirectX::XMFLOAT3> currentPositions;
+	bool interpolateEntities;
+	float frameLimiterTarget; // Frames per second, kept while the limiter's off
 	std::shared_ptr<Sky> skybox;
 	DirectX::XMFLOAT4 ambientColor;
 	
@@ -66,31 +119,103 @@ private:
 	std::vector<std::shared_ptr<Camera>> cameras;
 	int cameraIndex;
 
-	// A list of lights
-	std::unordered_map<int, std::shared_ptr<Light>> activeLights;
-	std::vector<Light> lightsToRender;
-	std::vector<std::shared_ptr<Light>> allLights;
+	// Every light in the scene
+	LightManager lights;
+	std::vector<LightHandle> sceneLights; // The ones listed in the GUI
+	LightHandle sunLight; // The directional light the shadow cascades follow
+	std::vector<LightHandle> scatteredLights; // Extra unshadowed point lights, for seeing how the lighting scales
+	int scatteredLightCount;
+
+	// Clustered lighting
+	// - Each frame the lights are binned into a grid of view space clusters (see LightClusters.h)
+	// - The pixel shader reads the lights, each cluster's offset/count and the index list from structured buffers
+	LightClusters lightClusters;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightClusterBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightClusterSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightIndexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightIndexSRV;
+	float lightClusteringTime; // Milliseconds, this frame
+	unsigned int uploadedLightVersion; // LightManager::GetVersion() of what's in lightBuffer
+	unsigned int clusteredLightVersion; // ...and of the lights the clusters were last built from
+	DirectX::XMFLOAT4X4 clusteredView; // The camera they were built for
+	DirectX::XMFLOAT4X4 clusteredProjection;
+	bool clusterBuffersStale; // Rebuilt since they were last uploaded
 
 	// Shadow mapping variables
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
+	// - The main directional light gets one cascade per slice of the camera's view, each its own array slice
+	// - Static entities' shadows are kept in a second array, copied in each frame before dynamic ones are drawn
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staticShadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSVs[MAX_SHADOW_CASCADES];
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticShadowDSVs[MAX_SHADOW_CASCADES];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV; // Whole array, for the pixel shader
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowCascadeSRVs[MAX_SHADOW_CASCADES]; // One slice each, for ImGui
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowCascadeRasterizer; // Same, without depth clipping
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	int shadowMapResolution;
-	float lightDisplacement; // These refer to our main directional light
-	DirectX::XMFLOAT4X4 lightViewMatrix;
-	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+	float lightDisplacement; // How far towards our main directional light shadow casters are still caught
+	ShadowCascadeSettings cascadeSettings;
+	ShadowCascade shadowCascades[MAX_SHADOW_CASCADES];
+	unsigned int shadowCascadeCount;
+	std::vector<unsigned int> shadowCasters[MAX_SHADOW_CASCADES]; // Entity indices worth drawing into each cascade
+	unsigned int shadowCastersCulled; // Summed over every cascade, this frame
+	StaticShadowCache staticShadowCache;
+	bool staticShadowsStale[MAX_SHADOW_CASCADES]; // Which cascades need their static shadows re-rendered this frame
+	unsigned int staticShadowUpdates; // How many did, this frame
+	std::vector<AABB> entityBounds; // World space, updated each frame for culling
+	std::vector<unsigned int> staticEntities; // The ones whose shadows are cached, from UpdateShadowCascades()
+
+	// Shadow atlas variables
+	// - Every other shadowed light (currently point lights, one tile per cube face) shares this texture
+	// - Tiles are handed out again every frame, biggest first, sized by how much of the screen each light covers
+	ShadowAtlas shadowAtlas;
+	std::vector<ShadowAtlasView> shadowAtlasViews;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowAtlasDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowAtlasSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> shadowAtlasEntryBuffer; // Structured buffer of ShadowAtlasEntry
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowAtlasEntrySRV;
+	int shadowAtlasResolution;
+
+	// The frame's passes, added again each frame in Draw()
+	// - Every render target they draw into comes from the graph, which gives targets that
+	//   aren't needed at the same time the same texture (see FrameGraph.h and RenderTargetPool.h)
+	std::shared_ptr<FrameGraphD3D11> frameGraphBackend;
+	std::shared_ptr<FrameGraph> frameGraph;
+
+	// GPU time of each of the frame graph's passes, read back a few frames late (see GpuProfiler.h)
+	std::shared_ptr<GpuProfilerD3D11> gpuProfilerBackend;
+	std::shared_ptr<GpuProfiler> gpuProfiler;
+
+	// The main pass's draws, split over the job system's threads, each recording into a deferred context (see DrawLists.h)
+	std::shared_ptr<DrawListsD3D11> drawListBackend;
+	std::shared_ptr<DrawLists> drawLists;
+	std::vector<unsigned int> visibleEntities; // The ones the camera can see, from UpdateShadowCascades()
+
+	// Each list's draws are written down as commands first, then run on its context (see CommandBuffer.h)
+	CommandBuffer drawCommands[DRAW_LISTS_MAX];
+	// Plays them back without a GPU for the profiler panel's submission stats, when turned on
+	CommandRecorder drawCommandAnalysis;
+	bool analyzeDrawCommands;
 
 	// Post-processing variables
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> postProcessSampler;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderRTV; // as opposed to the post-render RTV (our normal back buffer)
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> renderSRV;
-	int blurRadius;
+	unsigned int sceneTarget; // This frame's frame graph resource, as opposed to the back buffer
+	int blurRadius; // In full resolution pixels
+	int blurDownsample; // 1, 2 or 4: blurs at full, half or quarter resolution
 
 	// Volumetric Light Variables
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> sunAndOccludersTexture;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> sunAndOccludersRTV; // as opposed to the post-render RTV (our normal back buffer)
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sunAndOccludersSRV;
+	unsigned int sunAndOccludersTarget; // Has mips, so smaller targets can read a matching size
 	DirectX::XMFLOAT4 sunPosition;
+	ScatteringSettings scatteringSettings;
+	int scatteringDownsample; // 1, 2 or 4: scatters at full, half or quarter resolution
+	float scatteringDepthSharpness; // How strongly the upsample avoids texels at other depths
+
+	// Profiler GUI variables (the zones themselves are in Profiler)
+	int profilerFrameAge; // Which frame the flame graph shows, 0 being the newest
+	const char* profilerExportStatus;
+	const char* memoryReportStatus;
 };
 
@@ -0,0 +1,200 @@
+#include "GpuProfiler.h"
+
+#include <climits>
+
+// A frame's first two timestamps are its start and end
+#define GPU_PROFILER_FRAME_START 0
+#define GPU_PROFILER_FRAME_END 1
+
+
+GpuProfiler::GpuProfiler(GpuProfilerBackend* backend)
+	: backend(backend), frames(), frameNumber(0), inFrame(false), frameHistory(),
+	frameTime(0), averageFrameTime(0), framesRead(0), framesDropped(0), passesSkipped(0)
+{
+}
+
+void GpuProfiler::BeginFrame()
+{
+	// Its last results never came, and now its queries are needed
+	Frame& frame = frames[frameNumber % GPU_PROFILER_FRAMES];
+	if (frame.Pending)
+	{
+		frame.Pending = false;
+		framesDropped++;
+	}
+
+	frame.Number = frameNumber;
+	frame.TimestampCount = 2;
+	frame.PassCount = 0;
+	openPasses.clear();
+	inFrame = true;
+
+	unsigned int slot = frameNumber % GPU_PROFILER_FRAMES;
+	backend->BeginFrame(slot);
+	backend->Timestamp(slot, GPU_PROFILER_FRAME_START);
+}
+
+void GpuProfiler::BeginPass(const char* name)
+{
+	Frame& frame = frames[frameNumber % GPU_PROFILER_FRAMES];
+	if (!inFrame || frame.TimestampCount + 2 > GPU_PROFILER_MAX_TIMESTAMPS)
+	{
+		openPasses.push_back(UINT_MAX);
+		passesSkipped += inFrame;
+		return;
+	}
+
+	if (frame.PassCount == frame.Passes.size())
+		frame.Passes.emplace_back();
+	openPasses.push_back(frame.PassCount);
+	Pass& pass = frame.Passes[frame.PassCount++];
+	pass.Name = name;
+	pass.Depth = (unsigned int)openPasses.size() - 1;
+	pass.Begin = frame.TimestampCount;
+	pass.End = frame.TimestampCount + 1;
+	frame.TimestampCount += 2;
+	backend->Timestamp(frameNumber % GPU_PROFILER_FRAMES, pass.Begin);
+}
+
+void GpuProfiler::EndPass()
+{
+	if (openPasses.empty())
+		return;
+
+	unsigned int pass = openPasses.back();
+	openPasses.pop_back();
+	if (pass != UINT_MAX)
+		backend->Timestamp(frameNumber % GPU_PROFILER_FRAMES, frames[frameNumber % GPU_PROFILER_FRAMES].Passes[pass].End);
+}
+
+// --------------------------------------------------------
+// Closes this frame's queries, then reads back every frame
+// that's old enough, oldest first.  The GPU finishes them
+// in order, so the first one that isn't in yet means none
+// of the rest are either.
+// --------------------------------------------------------
+void GpuProfiler::EndFrame()
+{
+	if (!inFrame)
+		return;
+
+	// Passes left open end with the frame
+	while (!openPasses.empty())
+		EndPass();
+
+	unsigned int slot = frameNumber % GPU_PROFILER_FRAMES;
+	backend->Timestamp(slot, GPU_PROFILER_FRAME_END);
+	backend->EndFrame(slot);
+	frames[slot].Pending = true;
+	inFrame = false;
+
+	for (int age = GPU_PROFILER_FRAMES - 1; age >= GPU_PROFILER_LATENCY; age--)
+	{
+		if ((unsigned long long)age > frameNumber)
+			continue;
+		unsigned int oldSlot = (frameNumber - age) % GPU_PROFILER_FRAMES;
+		if (frames[oldSlot].Pending && frames[oldSlot].Number == frameNumber - age && !ReadBack(oldSlot))
+			break;
+	}
+	frameNumber++;
+}
+
+bool GpuProfiler::ReadBack(unsigned int slot)
+{
+	Frame& frame = frames[slot];
+	unsigned long long ticksPerSecond = 0;
+	bool disjoint = false;
+	if (!backend->GetFrequency(slot, ticksPerSecond, disjoint))
+		return false;
+
+	// The GPU's clock changed speed partway through, so none of its timestamps can be trusted
+	if (disjoint || ticksPerSecond == 0)
+	{
+		frame.Pending = false;
+		framesDropped++;
+		return true;
+	}
+
+	unsigned long long timestamps[GPU_PROFILER_MAX_TIMESTAMPS];
+	for (unsigned int t = 0; t < frame.TimestampCount; t++)
+	{
+		if (!backend->GetTimestamp(slot, t, timestamps[t]))
+			return false;
+	}
+
+	auto milliseconds = [&](unsigned int begin, unsigned int end) {
+		return timestamps[end] > timestamps[begin] ? (float)((timestamps[end] - timestamps[begin]) * 1000.0 / ticksPerSecond) : 0.0f;
+	};
+
+	passTimes.resize(frame.PassCount);
+	for (unsigned int p = 0; p < frame.PassCount; p++)
+	{
+		const Pass& pass = frame.Passes[p];
+		GpuPassTime& time = passTimes[p];
+		time.Name = pass.Name;
+		time.Depth = pass.Depth;
+		time.Milliseconds = milliseconds(pass.Begin, pass.End);
+		time.Average = AddTime(HistoryOf(pass.Name), time.Milliseconds);
+	}
+	frameTime = milliseconds(GPU_PROFILER_FRAME_START, GPU_PROFILER_FRAME_END);
+	averageFrameTime = AddTime(frameHistory, frameTime);
+
+	frame.Pending = false;
+	framesRead++;
+	return true;
+}
+
+GpuProfiler::History& GpuProfiler::HistoryOf(const std::string& name)
+{
+	for (History& history : histories)
+	{
+		if (history.Name == name)
+			return history;
+	}
+
+	histories.push_back({});
+	histories.back().Name = name;
+	return histories.back();
+}
+
+float GpuProfiler::AddTime(History& history, float milliseconds)
+{
+	if (history.Count == GPU_PROFILER_AVERAGE_FRAMES)
+		history.Sum -= history.Times[history.Next];
+	else
+		history.Count++;
+	history.Times[history.Next] = milliseconds;
+	history.Next = (history.Next + 1) % GPU_PROFILER_AVERAGE_FRAMES;
+	history.Sum += milliseconds;
+	return history.Sum / history.Count;
+}
+
+const std::vector<GpuPassTime>& GpuProfiler::GetPassTimes()
+{
+	return passTimes;
+}
+
+float GpuProfiler::GetFrameTime()
+{
+	return frameTime;
+}
+
+float GpuProfiler::GetAverageFrameTime()
+{
+	return averageFrameTime;
+}
+
+unsigned int GpuProfiler::GetFramesRead()
+{
+	return framesRead;
+}
+
+unsigned int GpuProfiler::GetFramesDropped()
+{
+	return framesDropped;
+}
+
+unsigned int GpuProfiler::GetPassesSkipped()
+{
+	return passesSkipped;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Times passes on the GPU with timestamp queries, reading the results back a few frames later so the CPU never waits
+// - Each frame in flight gets its own set of queries: a timestamp at the start of the frame, then one at the
+//   start and end of every pass (passes can nest)
+// - A frame's results are only asked for once it's GPU_PROFILER_LATENCY frames old, and are dropped (rather
+//   than waited on) if they still aren't in by the time its queries are needed again.  Frames where the GPU's
+//   clock wasn't steady are dropped too.
+// - Keeps an average of each pass's last GPU_PROFILER_AVERAGE_FRAMES times
+// - No D3D: the queries themselves are made and read by a GpuProfilerBackend
+
+#include <string>
+#include <vector>
+
+#define GPU_PROFILER_FRAMES 4				// Frames with queries in flight at once
+#define GPU_PROFILER_LATENCY 2				// Frames to wait before asking for a frame's results (less than GPU_PROFILER_FRAMES)
+#define GPU_PROFILER_MAX_TIMESTAMPS 64		// Per frame: one to start it, then two per pass
+#define GPU_PROFILER_AVERAGE_FRAMES 64
+
+// Issues and reads back the queries for the profiler.  Frames are numbered 0 to GPU_PROFILER_FRAMES - 1
+// (a frame's queries are used again GPU_PROFILER_FRAMES frames later), timestamps 0 to GPU_PROFILER_MAX_TIMESTAMPS - 1.
+class GpuProfilerBackend
+{
+public:
+	virtual ~GpuProfilerBackend() {}
+
+	// Brackets everything timed in a frame, so its timestamps can be checked for a steady clock
+	virtual void BeginFrame(unsigned int frame) = 0;
+	virtual void EndFrame(unsigned int frame) = 0;
+	virtual void Timestamp(unsigned int frame, unsigned int timestamp) = 0;
+
+	// Both return false if the GPU hasn't got that far yet, without waiting for it
+	virtual bool GetFrequency(unsigned int frame, unsigned long long& ticksPerSecond, bool& disjoint) = 0;
+	virtual bool GetTimestamp(unsigned int frame, unsigned int timestamp, unsigned long long& ticks) = 0;
+};
+
+struct GpuPassTime
+{
+	std::string Name;
+	unsigned int Depth;		// How many passes it's inside of
+	float Milliseconds;		// In the newest frame read back
+	float Average;			// Over the last GPU_PROFILER_AVERAGE_FRAMES frames this pass ran in
+};
+
+class GpuProfiler
+{
+public:
+	GpuProfiler(GpuProfilerBackend* backend);
+
+	// Everything between these two is timed as a frame, and their results are read back as they come in
+	void BeginFrame();
+	void EndFrame();
+
+	// Passes with more than GPU_PROFILER_MAX_TIMESTAMPS worth in front of them aren't timed
+	void BeginPass(const char* name);
+	void EndPass();
+
+	// From the newest frame read back, in the order its passes started
+	const std::vector<GpuPassTime>& GetPassTimes();
+	float GetFrameTime();			// First timestamp to last
+	float GetAverageFrameTime();
+	unsigned int GetFramesRead();
+	unsigned int GetFramesDropped();	// Results not in yet when their queries were needed again, or a disjoint clock
+	unsigned int GetPassesSkipped();	// Out of timestamps
+
+private:
+	struct Pass
+	{
+		std::string Name;
+		unsigned int Depth;
+		unsigned int Begin;		// Timestamps (both are set aside when the pass begins)
+		unsigned int End;
+	};
+
+	struct Frame
+	{
+		bool Pending;			// Issued, and not read back (or dropped) yet
+		unsigned long long Number;
+		unsigned int TimestampCount;
+		unsigned int PassCount;
+		std::vector<Pass> Passes;	// Only ever grows, so the names' memory is reused from frame to frame
+	};
+
+	// The last GPU_PROFILER_AVERAGE_FRAMES times of one pass (by name)
+	struct History
+	{
+		std::string Name;
+		float Times[GPU_PROFILER_AVERAGE_FRAMES];
+		unsigned int Count;
+		unsigned int Next;
+		float Sum;
+	};
+
+	bool ReadBack(unsigned int slot);
+	History& HistoryOf(const std::string& name);
+	float AddTime(History& history, float milliseconds);	// Returns the new average
+
+	GpuProfilerBackend* backend;
+	Frame frames[GPU_PROFILER_FRAMES];
+	unsigned long long frameNumber;	// Of the frame being issued
+	bool inFrame;
+	std::vector<unsigned int> openPasses;
+
+	std::vector<GpuPassTime> passTimes;
+	std::vector<History> histories;
+	History frameHistory;
+	float frameTime;
+	float averageFrameTime;
+	unsigned int framesRead;
+	unsigned int framesDropped;
+	unsigned int passesSkipped;
+};
@@ -0,0 +1,54 @@
+#include "GpuProfilerD3D11.h"
+
+
+GpuProfilerD3D11::GpuProfilerD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: context(context)
+{
+	D3D11_QUERY_DESC disjointDesc = {};
+	disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	D3D11_QUERY_DESC timestampDesc = {};
+	timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+	for (unsigned int f = 0; f < GPU_PROFILER_FRAMES; f++)
+	{
+		device->CreateQuery(&disjointDesc, disjointQueries[f].GetAddressOf());
+		for (unsigned int t = 0; t < GPU_PROFILER_MAX_TIMESTAMPS; t++)
+			device->CreateQuery(&timestampDesc, timestampQueries[f][t].GetAddressOf());
+	}
+}
+
+void GpuProfilerD3D11::BeginFrame(unsigned int frame)
+{
+	context->Begin(disjointQueries[frame].Get());
+}
+
+void GpuProfilerD3D11::EndFrame(unsigned int frame)
+{
+	context->End(disjointQueries[frame].Get());
+}
+
+void GpuProfilerD3D11::Timestamp(unsigned int frame, unsigned int timestamp)
+{
+	// Timestamps only have an End
+	context->End(timestampQueries[frame][timestamp].Get());
+}
+
+bool GpuProfilerD3D11::GetFrequency(unsigned int frame, unsigned long long& ticksPerSecond, bool& disjoint)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT data = {};
+	if (context->GetData(disjointQueries[frame].Get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	ticksPerSecond = data.Frequency;
+	disjoint = data.Disjoint != FALSE;
+	return true;
+}
+
+bool GpuProfilerD3D11::GetTimestamp(unsigned int frame, unsigned int timestamp, unsigned long long& ticks)
+{
+	UINT64 data = 0;
+	if (context->GetData(timestampQueries[frame][timestamp].Get(), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+
+	ticks = data;
+	return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// The GpuProfiler's D3D11 side
+// - A disjoint query and GPU_PROFILER_MAX_TIMESTAMPS timestamp queries for each frame in flight, made up front
+// - Results are asked for without flushing, so reading them never makes the CPU wait on the GPU
+
+#include "GpuProfiler.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+class GpuProfilerD3D11 : public GpuProfilerBackend
+{
+public:
+	GpuProfilerD3D11(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void BeginFrame(unsigned int frame) override;
+	void EndFrame(unsigned int frame) override;
+	void Timestamp(unsigned int frame, unsigned int timestamp) override;
+	bool GetFrequency(unsigned int frame, unsigned long long& ticksPerSecond, bool& disjoint) override;
+	bool GetTimestamp(unsigned int frame, unsigned int timestamp, unsigned long long& ticks) override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Query> disjointQueries[GPU_PROFILER_FRAMES];
+	Microsoft::WRL::ComPtr<ID3D11Query> timestampQueries[GPU_PROFILER_FRAMES][GPU_PROFILER_MAX_TIMESTAMPS];
+};
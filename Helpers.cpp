@@ -1,6 +1,9 @@
 
 #include <Windows.h>
+#include <algorithm>
 #include <codecvt>
+#include <cwctype>
+#include <filesystem>
 #include <locale>
 
 #include "Helpers.h"
@@ -66,6 +69,26 @@ std::wstring FixPath(const std::wstring& relativeFilePath)
 }
 
 
+// ----------------------------------------------------
+//  Gives every way of writing the same path (relative
+//  bits like "..\\", different slashes or casing) one
+//  single spelling, so it can be used as a lookup key.
+// 
+//  Usually given the result of FixPath().  The file
+//  doesn't need to exist.
+// ----------------------------------------------------
+std::wstring CanonicalPath(const std::wstring& filePath)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(filePath, error);
+	std::wstring result = error ? filePath : canonical.make_preferred().wstring();
+
+	// Windows paths are case insensitive
+	std::transform(result.begin(), result.end(), result.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+	return result;
+}
+
+
 // ----------------------------------------------------
 //  Helper function for converting a wide character 
 //  string to a standard ("narrow") character string
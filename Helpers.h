@@ -5,5 +5,6 @@
 // Helpers for determining the actual path to the executable
 std::wstring GetExePath();
 std::wstring FixPath(const std::wstring& relativeFilePath);
+std::wstring CanonicalPath(const std::wstring& filePath);
 std::string WideToNarrow(const std::wstring& str);
 std::wstring NarrowToWide(const std::string& str);
\ No newline at end of file
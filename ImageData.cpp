@@ -0,0 +1,773 @@
+#include "ImageData.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <system_error>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Minimal DEFLATE (RFC 1951) decoder, enough for PNG's zlib streams.
+	// Decodes canonical Huffman codes one bit at a time, which keeps the
+	// tables tiny and is plenty fast for offline asset processing.
+	// --------------------------------------------------------
+	struct BitReader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t pos;
+		unsigned int bitBuffer;
+		int bitCount;
+		bool overrun;
+
+		int GetBits(int count)
+		{
+			while (bitCount < count)
+			{
+				if (pos >= size)
+				{
+					overrun = true;
+					return 0;
+				}
+				bitBuffer |= (unsigned int)data[pos++] << bitCount;
+				bitCount += 8;
+			}
+			int value = (int)(bitBuffer & ((1u << count) - 1));
+			bitBuffer >>= count;
+			bitCount -= count;
+			return value;
+		}
+	};
+
+	struct Huffman
+	{
+		short counts[16];	// Number of codes of each length
+		short symbols[288];	// Symbols ordered by code
+	};
+
+	bool BuildHuffman(Huffman& h, const unsigned char* lengths, int count)
+	{
+		memset(h.counts, 0, sizeof(h.counts));
+		for (int i = 0; i < count; i++)
+			h.counts[lengths[i]]++;
+		if (h.counts[0] == count)
+			return true; // No codes at all is legal (e.g. an unused distance tree)
+
+		// Check for an over-subscribed code set
+		int left = 1;
+		for (int len = 1; len < 16; len++)
+		{
+			left <<= 1;
+			left -= h.counts[len];
+			if (left < 0)
+				return false;
+		}
+
+		short offsets[16] = {};
+		for (int len = 1; len < 15; len++)
+			offsets[len + 1] = offsets[len] + h.counts[len];
+		for (int i = 0; i < count; i++)
+		{
+			if (lengths[i] != 0)
+				h.symbols[offsets[lengths[i]]++] = (short)i;
+		}
+		return true;
+	}
+
+	int DecodeSymbol(BitReader& bits, const Huffman& h)
+	{
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (int len = 1; len < 16; len++)
+		{
+			code |= bits.GetBits(1);
+			int count = h.counts[len];
+			if (code - count < first)
+				return h.symbols[index + (code - first)];
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	const short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const short lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const short distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const short distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool InflateBlock(BitReader& bits, std::vector<unsigned char>& out, const Huffman& lengthCodes, const Huffman& distCodes)
+	{
+		while (true)
+		{
+			int symbol = DecodeSymbol(bits, lengthCodes);
+			if (symbol < 0 || bits.overrun)
+				return false;
+			if (symbol < 256)
+			{
+				out.push_back((unsigned char)symbol);
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			int length = lengthBase[symbol] + bits.GetBits(lengthExtra[symbol]);
+
+			int distSymbol = DecodeSymbol(bits, distCodes);
+			if (distSymbol < 0 || distSymbol >= 30)
+				return false;
+			size_t distance = (size_t)distBase[distSymbol] + bits.GetBits(distExtra[distSymbol]);
+			if (distance > out.size() || bits.overrun)
+				return false;
+
+			// Byte-by-byte copy, since the source and destination may overlap
+			size_t from = out.size() - distance;
+			for (int i = 0; i < length; i++)
+				out.push_back(out[from + i]);
+		}
+	}
+
+	struct FixedCodes
+	{
+		Huffman lengths;
+		Huffman dists;
+	};
+
+	FixedCodes BuildFixedCodes()
+	{
+		FixedCodes codes;
+		unsigned char lengths[288];
+		for (int i = 0; i < 144; i++) lengths[i] = 8;
+		for (int i = 144; i < 256; i++) lengths[i] = 9;
+		for (int i = 256; i < 280; i++) lengths[i] = 7;
+		for (int i = 280; i < 288; i++) lengths[i] = 8;
+		BuildHuffman(codes.lengths, lengths, 288);
+		for (int i = 0; i < 30; i++) lengths[i] = 5;
+		BuildHuffman(codes.dists, lengths, 30);
+		return codes;
+	}
+
+	unsigned int ReadBigEndian32(const unsigned char* p)
+	{
+		return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+	}
+
+	unsigned int Adler32(const unsigned char* data, size_t size)
+	{
+		unsigned int a = 1;
+		unsigned int b = 0;
+		while (size > 0)
+		{
+			// The most bytes before b can overflow
+			size_t count = std::min<size_t>(size, 5552);
+			size -= count;
+			while (count--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	// The CRC-32 each PNG chunk ends with (of its type and data), a byte at a time from a table
+	unsigned int Crc32(const unsigned char* data, size_t size)
+	{
+		struct Table
+		{
+			unsigned int Entries[256];
+			Table()
+			{
+				for (unsigned int i = 0; i < 256; i++)
+				{
+					unsigned int c = i;
+					for (int bit = 0; bit < 8; bit++)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					Entries[i] = c;
+				}
+			}
+		};
+		static const Table table;
+
+		unsigned int crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; i++)
+			crc = table.Entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	unsigned char PaethPredictor(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		if (pa <= pb && pa <= pc) return (unsigned char)a;
+		if (pb <= pc) return (unsigned char)b;
+		return (unsigned char)c;
+	}
+
+	// The bit depths the PNG spec allows for each color type (PNG 11.2.2)
+	bool IsValidBitDepth(int colorType, int bitDepth)
+	{
+		switch (colorType)
+		{
+		case 0: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+		case 3: return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+		case 2: case 4: case 6: return bitDepth == 8 || bitDepth == 16;
+		default: return false;
+		}
+	}
+
+	void WriteLittleEndian32(std::ofstream& file, unsigned int value)
+	{
+		unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+		file.write((const char*)bytes, 4);
+	}
+
+	unsigned int ReadLittleEndian32(const unsigned char* p)
+	{
+		return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+	}
+
+	// Block compressed DXGI formats: BC1-BC5 live in 70-84 and BC6H/BC7 in 94-99
+	bool IsBlockCompressed(unsigned int dxgiFormat)
+	{
+		return (dxgiFormat >= 70 && dxgiFormat <= 84) || (dxgiFormat >= 94 && dxgiFormat <= 99);
+	}
+
+	// BC1 and BC4 use 8 byte blocks, the rest 16
+	bool HasSmallBlocks(unsigned int dxgiFormat)
+	{
+		return (dxgiFormat >= 70 && dxgiFormat <= 72) || (dxgiFormat >= 79 && dxgiFormat <= 81);
+	}
+
+	// Where a file is written before it's renamed over the real one, so nothing ever reads it half written.
+	// The random part keeps two writers of the same file (say the game and TextureTool) out of each other's way.
+	std::filesystem::path TempPathFor(const std::filesystem::path& path)
+	{
+		std::filesystem::path temp = path;
+		temp += "." + std::to_string(std::random_device()()) + ".tmp";
+		return temp;
+	}
+
+	// Moves a finished temp file into place, or throws it away if it wasn't written completely
+	bool ReplaceWithTemp(const std::filesystem::path& temp, const std::filesystem::path& path, bool written)
+	{
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(temp, path, error);
+		if (!written || error)
+		{
+			std::filesystem::remove(temp, error);
+			return false;
+		}
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Decompresses a zlib stream (RFC 1950) holding DEFLATE
+// data, checking the Adler-32 of what comes out
+// --------------------------------------------------------
+bool InflateZlib(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+	// Skip the two byte zlib header (and reject preset dictionaries)
+	if (size < 2 || (data[0] & 0x0F) != 8 || (data[1] & 0x20))
+		return false;
+
+	// Anything already in the output isn't part of this stream
+	size_t start = out.size();
+
+	BitReader bits = { data, size, 2, 0, 0, false };
+	int lastBlock = 0;
+	while (!lastBlock)
+	{
+		lastBlock = bits.GetBits(1);
+		int type = bits.GetBits(2);
+
+		if (type == 0)
+		{
+			// Stored block: realign to a byte boundary and copy
+			bits.bitBuffer = 0;
+			bits.bitCount = 0;
+			if (bits.pos + 4 > bits.size)
+				return false;
+			unsigned int length = data[bits.pos] | (data[bits.pos + 1] << 8);
+			unsigned int inverse = data[bits.pos + 2] | (data[bits.pos + 3] << 8);
+			if (length != (~inverse & 0xFFFF))
+				return false;
+			bits.pos += 4;
+			if (bits.pos + length > bits.size)
+				return false;
+			out.insert(out.end(), data + bits.pos, data + bits.pos + length);
+			bits.pos += length;
+		}
+		else if (type == 1)
+		{
+			// Fixed Huffman codes (built once, thread-safe via static init)
+			static const FixedCodes fixed = BuildFixedCodes();
+			if (!InflateBlock(bits, out, fixed.lengths, fixed.dists))
+				return false;
+		}
+		else if (type == 2)
+		{
+			// Dynamic Huffman codes, which are themselves Huffman coded
+			static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			int lengthCount = bits.GetBits(5) + 257;
+			int distCount = bits.GetBits(5) + 1;
+			int codeCount = bits.GetBits(4) + 4;
+			if (lengthCount > 286 || distCount > 30)
+				return false;
+
+			unsigned char lengths[320] = {};
+			for (int i = 0; i < codeCount; i++)
+				lengths[order[i]] = (unsigned char)bits.GetBits(3);
+			Huffman codeLengthCodes;
+			if (!BuildHuffman(codeLengthCodes, lengths, 19))
+				return false;
+
+			int index = 0;
+			memset(lengths, 0, sizeof(lengths));
+			while (index < lengthCount + distCount)
+			{
+				int symbol = DecodeSymbol(bits, codeLengthCodes);
+				if (symbol < 0 || bits.overrun)
+					return false;
+				if (symbol < 16)
+				{
+					lengths[index++] = (unsigned char)symbol;
+					continue;
+				}
+
+				unsigned char repeatValue = 0;
+				int repeat = 0;
+				if (symbol == 16)
+				{
+					if (index == 0)
+						return false;
+					repeatValue = lengths[index - 1];
+					repeat = 3 + bits.GetBits(2);
+				}
+				else if (symbol == 17)
+					repeat = 3 + bits.GetBits(3);
+				else
+					repeat = 11 + bits.GetBits(7);
+
+				if (index + repeat > lengthCount + distCount)
+					return false;
+				while (repeat--)
+					lengths[index++] = repeatValue;
+			}
+
+			Huffman lengthCodes;
+			Huffman distCodes;
+			if (!BuildHuffman(lengthCodes, lengths, lengthCount) ||
+				!BuildHuffman(distCodes, lengths + lengthCount, distCount))
+				return false;
+			if (!InflateBlock(bits, out, lengthCodes, distCodes))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		if (bits.overrun)
+			return false;
+	}
+
+	// The Adler-32 follows on the next byte boundary (bits left over are just padding)
+	if (bits.pos + 4 > size)
+		return false;
+	return ReadBigEndian32(data + bits.pos) == Adler32(out.data() + start, out.size() - start);
+}
+
+
+bool ReadFileBytes(const std::filesystem::path& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !bytes.empty();
+}
+
+
+// --------------------------------------------------------
+// Loads an entire PNG file from disk and decodes it
+// --------------------------------------------------------
+bool LoadPNG(const std::filesystem::path& path, ImageData& image)
+{
+	std::vector<unsigned char> bytes;
+	if (!ReadFileBytes(path, bytes))
+		return false;
+	return DecodePNG(bytes.data(), bytes.size(), image);
+}
+
+
+// --------------------------------------------------------
+// Decodes PNG data already in memory into RGBA8
+//  - Grayscale is replicated into RGB, missing alpha is opaque
+//  - 16 bit channels keep their most significant byte
+//  - Interlaced (Adam7) images are not supported
+//  - Bit depths the spec doesn't allow for the color type,
+//    and anything bigger than a D3D11 texture, are rejected
+// --------------------------------------------------------
+bool DecodePNG(const unsigned char* data, size_t size, ImageData& image)
+{
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		return false;
+
+	unsigned int width = 0;
+	unsigned int height = 0;
+	int bitDepth = 0;
+	int colorType = -1;
+	int interlace = 0;
+	unsigned char palette[256][4] = {};
+	std::vector<unsigned char> compressed;
+
+	// Walk the chunks, gathering the header, palette and all image data
+	size_t pos = 8;
+	while (pos + 12 <= size)
+	{
+		unsigned int length = ReadBigEndian32(data + pos);
+		const unsigned char* type = data + pos + 4;
+		const unsigned char* chunk = data + pos + 8;
+		if (pos + 12 + (size_t)length > size)
+			return false;
+		if (ReadBigEndian32(chunk + length) != Crc32(type, length + 4))
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			width = ReadBigEndian32(chunk);
+			height = ReadBigEndian32(chunk + 4);
+			bitDepth = chunk[8];
+			colorType = chunk[9];
+			interlace = chunk[12];
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			for (unsigned int i = 0; i < length / 3 && i < 256; i++)
+			{
+				palette[i][0] = chunk[i * 3 + 0];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3)
+		{
+			for (unsigned int i = 0; i < length && i < 256; i++)
+				palette[i][3] = chunk[i];
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+		pos += 12 + (size_t)length;
+	}
+
+	int channels = 0;
+	switch (colorType)
+	{
+	case 0: channels = 1; break; // Grayscale
+	case 2: channels = 3; break; // RGB
+	case 3: channels = 1; break; // Palette indices
+	case 4: channels = 2; break; // Grayscale + alpha
+	case 6: channels = 4; break; // RGBA
+	default: return false;
+	}
+	if (width == 0 || height == 0 || width > PNG_MAX_DIMENSION || height > PNG_MAX_DIMENSION || interlace != 0)
+		return false;
+	if (!IsValidBitDepth(colorType, bitDepth))
+		return false;
+
+	std::vector<unsigned char> raw;
+	raw.reserve((size_t)height * (((size_t)width * channels * bitDepth + 7) / 8 + 1));
+	if (!InflateZlib(compressed.data(), compressed.size(), raw))
+		return false;
+
+	// Undo the per-scanline filters in place
+	size_t stride = ((size_t)width * channels * bitDepth + 7) / 8;
+	size_t bpp = std::max<size_t>(1, (size_t)channels * bitDepth / 8);
+	if (raw.size() < (stride + 1) * height)
+		return false;
+
+	std::vector<unsigned char> scanlines(stride * height);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned char filter = raw[y * (stride + 1)];
+		const unsigned char* src = &raw[y * (stride + 1) + 1];
+		unsigned char* dst = &scanlines[y * stride];
+		const unsigned char* prev = y > 0 ? &scanlines[(y - 1) * stride] : nullptr;
+
+		for (size_t x = 0; x < stride; x++)
+		{
+			int a = x >= bpp ? dst[x - bpp] : 0;
+			int b = prev ? prev[x] : 0;
+			int c = (prev && x >= bpp) ? prev[x - bpp] : 0;
+			switch (filter)
+			{
+			case 0: dst[x] = src[x]; break;
+			case 1: dst[x] = (unsigned char)(src[x] + a); break;
+			case 2: dst[x] = (unsigned char)(src[x] + b); break;
+			case 3: dst[x] = (unsigned char)(src[x] + ((a + b) >> 1)); break;
+			case 4: dst[x] = (unsigned char)(src[x] + PaethPredictor(a, b, c)); break;
+			default: return false;
+			}
+		}
+	}
+
+	// Expand whatever we have into RGBA8
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* row = &scanlines[y * stride];
+		unsigned char* out = &image.Pixels[(size_t)y * width * 4];
+		for (unsigned int x = 0; x < width; x++, out += 4)
+		{
+			// Grab each channel as an 8 bit value
+			unsigned char samples[4] = {};
+			for (int ch = 0; ch < channels; ch++)
+			{
+				size_t sampleIndex = (size_t)x * channels + ch;
+				if (bitDepth == 8)
+					samples[ch] = row[sampleIndex];
+				else if (bitDepth == 16)
+					samples[ch] = row[sampleIndex * 2];
+				else
+				{
+					size_t bit = sampleIndex * bitDepth;
+					int value = (row[bit / 8] >> (8 - bitDepth - (bit % 8))) & ((1 << bitDepth) - 1);
+					samples[ch] = colorType == 3 ? (unsigned char)value : (unsigned char)(value * 255 / ((1 << bitDepth) - 1));
+				}
+			}
+
+			switch (colorType)
+			{
+			case 0: out[0] = out[1] = out[2] = samples[0]; out[3] = 255; break;
+			case 2: out[0] = samples[0]; out[1] = samples[1]; out[2] = samples[2]; out[3] = 255; break;
+			case 3: memcpy(out, palette[samples[0]], 4); break;
+			case 4: out[0] = out[1] = out[2] = samples[0]; out[3] = samples[1]; break;
+			case 6: memcpy(out, samples, 4); break;
+			}
+		}
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Writes the image as a legacy (non-DX10 header) DDS with
+// RGBA8 bit masks, which loads as DXGI_FORMAT_R8G8B8A8_UNORM
+// --------------------------------------------------------
+bool SaveDDS(const std::filesystem::path& path, const ImageData& image)
+{
+	if (!image.IsValid())
+		return false;
+
+	std::filesystem::path temp = TempPathFor(path);
+	std::ofstream file(temp, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.write("DDS ", 4);
+	WriteLittleEndian32(file, 124);							// Header size
+	WriteLittleEndian32(file, 0x1 | 0x2 | 0x4 | 0x8 | 0x1000); // CAPS | HEIGHT | WIDTH | PITCH | PIXELFORMAT
+	WriteLittleEndian32(file, image.Height);
+	WriteLittleEndian32(file, image.Width);
+	WriteLittleEndian32(file, image.Width * 4);				// Row pitch
+	WriteLittleEndian32(file, 0);							// Depth
+	WriteLittleEndian32(file, 0);							// Mip count (0 = just the top level)
+	for (int i = 0; i < 11; i++)
+		WriteLittleEndian32(file, 0);						// Reserved
+
+	// Pixel format
+	WriteLittleEndian32(file, 32);
+	WriteLittleEndian32(file, 0x40 | 0x1);					// RGB | ALPHAPIXELS
+	WriteLittleEndian32(file, 0);							// No FourCC
+	WriteLittleEndian32(file, 32);							// Bits per pixel
+	WriteLittleEndian32(file, 0x000000FF);					// R mask
+	WriteLittleEndian32(file, 0x0000FF00);					// G mask
+	WriteLittleEndian32(file, 0x00FF0000);					// B mask
+	WriteLittleEndian32(file, 0xFF000000);					// A mask
+
+	WriteLittleEndian32(file, 0x1000);						// DDSCAPS_TEXTURE
+	for (int i = 0; i < 4; i++)
+		WriteLittleEndian32(file, 0);						// Caps 2-4 and reserved
+
+	file.write((const char*)image.Pixels.data(), image.Pixels.size());
+	file.close();
+	return ReplaceWithTemp(temp, path, file.good());
+}
+
+
+// --------------------------------------------------------
+// Writes a DDS with the "DX10" extended header, which lets
+// us store formats (like BC7) that legacy headers can't
+// describe.  The data must already contain every mip level.
+// --------------------------------------------------------
+bool SaveDDS(const std::filesystem::path& path, unsigned int dxgiFormat, unsigned int width, unsigned int height, unsigned int mipLevels, const std::vector<unsigned char>& data)
+{
+	if (width == 0 || height == 0 || mipLevels == 0 || data.empty())
+		return false;
+
+	bool blockCompressed = IsBlockCompressed(dxgiFormat);
+	unsigned int pitchOrLinearSize = blockCompressed ?
+		((width + 3) / 4) * ((height + 3) / 4) * (HasSmallBlocks(dxgiFormat) ? 8 : 16) :
+		width * 4;
+
+	std::filesystem::path temp = TempPathFor(path);
+	std::ofstream file(temp, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	unsigned int flags = 0x1 | 0x2 | 0x4 | 0x1000;			// CAPS | HEIGHT | WIDTH | PIXELFORMAT
+	flags |= blockCompressed ? 0x80000 : 0x8;				// LINEARSIZE or PITCH
+	if (mipLevels > 1)
+		flags |= 0x20000;									// MIPMAPCOUNT
+
+	file.write("DDS ", 4);
+	WriteLittleEndian32(file, 124);
+	WriteLittleEndian32(file, flags);
+	WriteLittleEndian32(file, height);
+	WriteLittleEndian32(file, width);
+	WriteLittleEndian32(file, pitchOrLinearSize);
+	WriteLittleEndian32(file, 0);							// Depth
+	WriteLittleEndian32(file, mipLevels);
+	for (int i = 0; i < 11; i++)
+		WriteLittleEndian32(file, 0);						// Reserved
+
+	// Pixel format just says "look at the DX10 header"
+	WriteLittleEndian32(file, 32);
+	WriteLittleEndian32(file, 0x4);							// FOURCC
+	file.write("DX10", 4);
+	for (int i = 0; i < 5; i++)
+		WriteLittleEndian32(file, 0);						// Bit count and masks
+
+	WriteLittleEndian32(file, 0x1000 | (mipLevels > 1 ? 0x400008 : 0)); // TEXTURE (| MIPMAP | COMPLEX)
+	for (int i = 0; i < 4; i++)
+		WriteLittleEndian32(file, 0);						// Caps 2-4 and reserved
+
+	// DX10 header
+	WriteLittleEndian32(file, dxgiFormat);
+	WriteLittleEndian32(file, 3);							// D3D11_RESOURCE_DIMENSION_TEXTURE2D
+	WriteLittleEndian32(file, 0);							// Misc flags
+	WriteLittleEndian32(file, 1);							// Array size
+	WriteLittleEndian32(file, 0);							// Misc flags 2
+
+	file.write((const char*)data.data(), data.size());
+	file.close();
+	return ReplaceWithTemp(temp, path, file.good());
+}
+
+
+// --------------------------------------------------------
+// Walks the header the way SaveDDS writes it and adds up
+// what every mip needs.  Anything cut short (or that isn't
+// one of ours) comes out false.
+// --------------------------------------------------------
+bool IsCompleteDDS(const unsigned char* data, size_t size)
+{
+	if (size < 128 || memcmp(data, "DDS ", 4) != 0 || ReadLittleEndian32(data + 4) != 124)
+		return false;
+
+	unsigned int height = ReadLittleEndian32(data + 12);
+	unsigned int width = ReadLittleEndian32(data + 16);
+	unsigned int mipLevels = std::max(1u, ReadLittleEndian32(data + 28));
+	unsigned int formatFlags = ReadLittleEndian32(data + 80);
+
+	// Big enough for any real texture, and small enough that the sums below can't wrap
+	if (width == 0 || height == 0 || width > (1u << 16) || height > (1u << 16) || mipLevels > 17)
+		return false;
+
+	size_t dataStart = 128;
+	unsigned int dxgiFormat = 0;
+	if ((formatFlags & 0x4) && memcmp(data + 84, "DX10", 4) == 0)
+	{
+		if (size < 148)
+			return false;
+		dxgiFormat = ReadLittleEndian32(data + 128);
+		dataStart = 148;
+	}
+	else if (!(formatFlags & 0x40) || ReadLittleEndian32(data + 88) != 32)
+		return false; // Legacy headers are only ever RGBA8
+
+	unsigned long long expected = 0;
+	for (unsigned int mip = 0; mip < mipLevels; mip++)
+	{
+		unsigned long long mipWidth = std::max(1u, width >> mip);
+		unsigned long long mipHeight = std::max(1u, height >> mip);
+		expected += IsBlockCompressed(dxgiFormat) ?
+			((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * (HasSmallBlocks(dxgiFormat) ? 8 : 16) :
+			mipWidth * mipHeight * 4;
+	}
+	return size - dataStart >= expected;
+}
+
+
+// --------------------------------------------------------
+// Simple bilinear resample (texel centers aligned)
+// --------------------------------------------------------
+ImageData ResizeBilinear(const ImageData& image, unsigned int newWidth, unsigned int newHeight)
+{
+	ImageData result;
+	result.Width = newWidth;
+	result.Height = newHeight;
+	result.Pixels.resize((size_t)newWidth * newHeight * 4);
+	if (!image.IsValid())
+		return result;
+
+	float scaleX = (float)image.Width / newWidth;
+	float scaleY = (float)image.Height / newHeight;
+	for (unsigned int y = 0; y < newHeight; y++)
+	{
+		float srcY = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+		unsigned int y0 = std::min((unsigned int)srcY, image.Height - 1);
+		unsigned int y1 = std::min(y0 + 1, image.Height - 1);
+		float ty = srcY - y0;
+
+		for (unsigned int x = 0; x < newWidth; x++)
+		{
+			float srcX = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+			unsigned int x0 = std::min((unsigned int)srcX, image.Width - 1);
+			unsigned int x1 = std::min(x0 + 1, image.Width - 1);
+			float tx = srcX - x0;
+
+			const unsigned char* p00 = &image.Pixels[((size_t)y0 * image.Width + x0) * 4];
+			const unsigned char* p10 = &image.Pixels[((size_t)y0 * image.Width + x1) * 4];
+			const unsigned char* p01 = &image.Pixels[((size_t)y1 * image.Width + x0) * 4];
+			const unsigned char* p11 = &image.Pixels[((size_t)y1 * image.Width + x1) * 4];
+			unsigned char* out = &result.Pixels[((size_t)y * newWidth + x) * 4];
+			for (int ch = 0; ch < 4; ch++)
+			{
+				float top = p00[ch] + (p10[ch] - p00[ch]) * tx;
+				float bottom = p01[ch] + (p11[ch] - p01[ch]) * tx;
+				out[ch] = (unsigned char)(top + (bottom - top) * ty + 0.5f);
+			}
+		}
+	}
+	return result;
+}
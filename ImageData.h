@@ -0,0 +1,46 @@
+#pragma once
+
+// Raw CPU-side image data and the file formats we read/write for it
+// - Deliberately free of Windows/D3D headers so the asset tools can run on any platform
+
+#include <filesystem>
+#include <vector>
+
+struct ImageData
+{
+	unsigned int Width = 0;
+	unsigned int Height = 0;
+	std::vector<unsigned char> Pixels; // Tightly packed RGBA8, row-major, top row first
+
+	bool IsValid() const { return Width > 0 && Height > 0 && Pixels.size() == (size_t)Width * Height * 4; }
+};
+
+// Largest PNG we'll decode in either direction (D3D11's texture size limit), which also keeps row sizes from overflowing
+#define PNG_MAX_DIMENSION 16384
+
+// Reads a whole file into memory
+bool ReadFileBytes(const std::filesystem::path& path, std::vector<unsigned char>& bytes);
+
+// Decodes a non-interlaced PNG (any color type, 1-16 bit) into RGBA8
+// - Rejects files with a chunk whose CRC doesn't match, a bit depth its color type doesn't allow, or bigger than PNG_MAX_DIMENSION
+bool LoadPNG(const std::filesystem::path& path, ImageData& image);
+bool DecodePNG(const unsigned char* data, size_t size, ImageData& image);
+
+// Decompresses a zlib stream (as in a PNG's IDAT chunks), appending to out
+// - False for anything malformed, or if the decompressed data doesn't match the stream's Adler-32
+bool InflateZlib(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+// Writes an uncompressed R8G8B8A8 DDS that DirectXTK's DDS loader understands
+bool SaveDDS(const std::filesystem::path& path, const ImageData& image);
+
+// Writes already-encoded texture data (every mip, largest first) with a DX10 extended header
+// - dxgiFormat is a DXGI_FORMAT value; block compressed and 32 bit-per-pixel formats are supported
+bool SaveDDS(const std::filesystem::path& path, unsigned int dxgiFormat, unsigned int width, unsigned int height, unsigned int mipLevels, const std::vector<unsigned char>& data);
+
+// The DDS writers above go through a temp file that's renamed into place, so a crash mid-write never leaves a
+// truncated file at path.  This catches one anyway (say, from something else): true only if the data holds the
+// whole header and every byte of every mip it describes.
+bool IsCompleteDDS(const unsigned char* data, size_t size);
+
+// Bilinearly resamples an image to a new size (used to match maps authored at different resolutions)
+ImageData ResizeBilinear(const ImageData& image, unsigned int newWidth, unsigned int newHeight);
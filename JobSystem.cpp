@@ -0,0 +1,277 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// The JobSystem this thread works for (if any), and which deque is its own
+	thread_local JobSystem* workerOf = nullptr;
+	thread_local unsigned int workerQueue = 0;
+}
+
+
+JobSystem::JobSystem(unsigned int threadCount)
+	: freeJobs(nullptr), queuedJobs(0), nextVictim(0), jobsRun(0), jobsStolen(0), stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	jobPool.reserve(JOB_POOL_SIZE);
+	for (unsigned int i = 0; i < JOB_POOL_SIZE; i++)
+	{
+		jobPool.push_back(std::make_unique<Job>());
+		FreeJob(jobPool.back().get());
+	}
+
+	for (unsigned int q = 0; q < threadCount; q++)
+	{
+		queues.push_back(std::make_unique<WorkQueue>());
+		queues.back()->Ring.resize(JOB_QUEUE_SIZE);
+	}
+	for (unsigned int q = 1; q < threadCount; q++)
+		threads.emplace_back(&JobSystem::WorkerLoop, this, q);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// --------------------------------------------------------
+// A job starts out waiting on each of its dependencies, plus
+// one more for itself, so it can't be queued by a dependency
+// finishing while the rest are still being added.  Any that
+// have already finished (or gone back to the pool, which
+// they only do once finished) are taken off straight away.
+// --------------------------------------------------------
+JobHandle JobSystem::Run(std::function<void()> work, const std::vector<JobHandle>& dependencies)
+{
+	Job* job = NewJob();
+	job->Work = std::move(work);
+	job->Waiting = (unsigned int)dependencies.size() + 1;
+	job->Done = false;
+	JobHandle handle(job, job->Generation);
+
+	for (const JobHandle& dependency : dependencies)
+	{
+		if (!dependency)
+		{
+			job->Waiting--;
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(dependency.Target->Mutex);
+		if (dependency.Target->Done || dependency.Target->Generation != dependency.Generation)
+			job->Waiting--;
+		else
+			dependency.Target->Dependents.push_back(job);
+	}
+
+	if (--job->Waiting == 0)
+		Push(job);
+	return handle;
+}
+
+void JobSystem::Wait(const JobHandle& job)
+{
+	while (!IsDone(job))
+	{
+		// Nothing to help with, so whatever's left is already running somewhere else
+		if (!RunOne())
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::IsDone(const JobHandle& job)
+{
+	return !job || job.Target->Done || job.Target->Generation != job.Generation;
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return (unsigned int)threads.size() + 1;
+}
+
+unsigned long long JobSystem::GetJobsRun()
+{
+	return jobsRun;
+}
+
+unsigned long long JobSystem::GetJobsStolen()
+{
+	return jobsStolen;
+}
+
+unsigned int JobSystem::CurrentQueue()
+{
+	return workerOf == this ? workerQueue : 0;
+}
+
+Job* JobSystem::NewJob()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (!freeJobs)
+	{
+		jobPool.push_back(std::make_unique<Job>());
+		return jobPool.back().get();
+	}
+
+	Job* job = freeJobs;
+	freeJobs = job->NextFree;
+	return job;
+}
+
+void JobSystem::FreeJob(Job* job)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	job->NextFree = freeJobs;
+	freeJobs = job;
+}
+
+void JobSystem::Push(Job* job)
+{
+	// Counted first, so it can't be taken (and uncounted) before it's counted
+	queuedJobs++;
+	{
+		WorkQueue& queue = *queues[CurrentQueue()];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.PushBack(job);
+	}
+
+	// Taking the lock means a worker can't miss this between checking the count and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	jobAvailable.notify_one();
+}
+
+// --------------------------------------------------------
+// Takes the newest job from this thread's own deque, or if
+// that's empty, the oldest from someone else's.  Each steal
+// starts at a different deque, so the thieves spread out.
+// --------------------------------------------------------
+bool JobSystem::RunOne()
+{
+	unsigned int own = CurrentQueue();
+	Job* job = nullptr;
+	{
+		WorkQueue& queue = *queues[own];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		job = queue.PopBack();
+	}
+
+	if (!job)
+	{
+		unsigned int queueCount = (unsigned int)queues.size();
+		unsigned int first = nextVictim++;
+		for (unsigned int i = 0; i < queueCount && !job; i++)
+		{
+			unsigned int victim = (first + i) % queueCount;
+			if (victim == own)
+				continue;
+
+			WorkQueue& queue = *queues[victim];
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			job = queue.PopFront();
+			if (job)
+				jobsStolen++;
+		}
+	}
+
+	if (!job)
+		return false;
+
+	queuedJobs--;
+	Execute(job);
+	return true;
+}
+
+// --------------------------------------------------------
+// Once Done is set nothing else can add itself to the
+// dependents, so they're queued without holding the lock.
+// The job then goes back to the pool with its generation
+// bumped, which is what tells old handles it's finished.
+// --------------------------------------------------------
+void JobSystem::Execute(Job* job)
+{
+	job->Work();
+	job->Work = nullptr; // Let go of anything it captured
+
+	{
+		std::lock_guard<std::mutex> lock(job->Mutex);
+		job->Done = true;
+	}
+	jobsRun++;
+
+	for (Job* dependent : job->Dependents)
+	{
+		if (--dependent->Waiting == 0)
+			Push(dependent);
+	}
+	job->Dependents.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(job->Mutex);
+		job->Generation++;
+	}
+	FreeJob(job);
+}
+
+void JobSystem::WorkQueue::PushBack(Job* job)
+{
+	if (Count == Ring.size())
+	{
+		// Full, so unwrap it into one twice the size
+		std::vector<Job*> bigger(std::max<size_t>(JOB_QUEUE_SIZE, Ring.size() * 2));
+		for (size_t i = 0; i < Count; i++)
+			bigger[i] = Ring[(Head + i) % Ring.size()];
+		Ring.swap(bigger);
+		Head = 0;
+	}
+	Ring[(Head + Count) % Ring.size()] = job;
+	Count++;
+}
+
+Job* JobSystem::WorkQueue::PopBack()
+{
+	if (Count == 0)
+		return nullptr;
+	Count--;
+	return Ring[(Head + Count) % Ring.size()];
+}
+
+Job* JobSystem::WorkQueue::PopFront()
+{
+	if (Count == 0)
+		return nullptr;
+	Job* job = Ring[Head];
+	Head = (Head + 1) % Ring.size();
+	Count--;
+	return job;
+}
+
+// --------------------------------------------------------
+// Each worker runs jobs until there are none left anywhere,
+// then sleeps until one's pushed.  It only exits once
+// stopping AND every queued job has been run.
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(unsigned int queue)
+{
+	workerOf = this;
+	workerQueue = queue;
+
+	while (true)
+	{
+		if (RunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		jobAvailable.wait(lock, [this]() { return stopping || queuedJobs > 0; });
+		if (stopping && queuedJobs == 0)
+			return;
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+// A work stealing job scheduler for spreading a frame's CPU work over every core
+// - Each worker thread has its own deque: it pushes and pops at the back (newest first, while its data is still in cache),
+//   and idle threads steal from the front (the oldest, and usually biggest, pieces of work)
+// - The main thread (and any other thread that isn't a worker) shares one more deque, so its jobs can be stolen too
+// - Jobs can wait on other jobs: they're only queued once everything they depend on has finished
+// - Waiting never blocks: the waiting thread runs (or steals) other jobs until the one it wants is done
+// - Jobs come from a pool and go back to it once they've run, and the deques are rings that only grow, so once
+//   the pool and rings are as big as a frame needs, handing out work never touches the heap
+// - No Windows/D3D dependencies, so it can be stress tested and benchmarked by the offline tools
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Chunks handed out per thread by ParallelFor when no chunk size is given.  More than one,
+// so a thread that gets a quick run of items can go back for more.
+#define JOB_CHUNKS_PER_THREAD 4
+
+// Fewest items ParallelFor puts in a chunk when it picks the size itself.  Handing a chunk to another
+// thread costs more than a few dozen small items, so loops shorter than this just run on the calling thread.
+#define JOB_MIN_CHUNK_SIZE 64
+
+#define JOB_POOL_SIZE 256		// Jobs made up front (more are made, and kept, if ever that many are in flight)
+#define JOB_QUEUE_SIZE 64		// Starting size of each thread's deque (doubled whenever it fills)
+
+struct Job
+{
+	std::function<void()> Work;				// Small captures (a couple of references) are stored inline, not on the heap
+	std::atomic<unsigned int> Waiting{ 0 };	// Unfinished dependencies, plus one until the job's been fully set up
+	std::atomic<bool> Done{ false };
+	std::atomic<unsigned int> Generation{ 0 };	// Bumped when the job goes back to the pool, so older handles to it read as done
+	std::mutex Mutex;						// Guards Dependents (and Done and Generation, for anyone adding themselves to them)
+	std::vector<Job*> Dependents;			// Queued once this finishes, if it was the last thing they were waiting on.  Keeps its capacity between runs.
+	Job* NextFree = nullptr;				// While it's in the pool
+};
+
+// One run of a pooled job.  Null handles count as done.
+struct JobHandle
+{
+	Job* Target = nullptr;
+	unsigned int Generation = 0;
+
+	JobHandle() {}
+	JobHandle(std::nullptr_t) {}
+	JobHandle(Job* target, unsigned int generation) : Target(target), Generation(generation) {}
+	explicit operator bool() const { return Target != nullptr; }
+};
+
+class JobSystem
+{
+public:
+	// Zero threads means one per hardware thread.  The count includes the thread(s) that hand out work, since
+	// they help while they wait, so one thread means no workers at all: jobs run when something waits on them.
+	JobSystem(unsigned int threadCount = 0);
+	~JobSystem(); // Finishes everything already queued, then joins
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Queues a job to run once every one of its dependencies has finished (null handles are ignored)
+	JobHandle Run(std::function<void()> work, const std::vector<JobHandle>& dependencies = {});
+
+	// Runs other jobs until this one has finished
+	void Wait(const JobHandle& job);
+	bool IsDone(const JobHandle& job);
+
+	// Calls work(begin, end) over [0, count) in chunks of chunkSize items (zero picks a size from the thread count,
+	// at least JOB_MIN_CHUNK_SIZE).  The calling thread takes chunks too, and only returns once every chunk is done.
+	template<typename Function>
+	void ParallelFor(unsigned int count, unsigned int chunkSize, Function work);
+
+	unsigned int GetThreadCount();
+	unsigned long long GetJobsRun();
+	unsigned long long GetJobsStolen(); // Taken from another thread's deque
+
+private:
+	// A deque as a ring buffer, which (unlike std::deque) doesn't allocate as jobs come and go
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::vector<Job*> Ring;
+		size_t Head = 0;
+		size_t Count = 0;
+
+		void PushBack(Job* job);
+		Job* PopBack();		// Null if empty
+		Job* PopFront();	// Null if empty
+	};
+
+	Job* NewJob();
+	void FreeJob(Job* job);
+	void Push(Job* job);
+	bool RunOne(); // False if there was nothing to run
+	void Execute(Job* job);
+	void WorkerLoop(unsigned int queue);
+	unsigned int CurrentQueue();
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<WorkQueue>> queues; // 0 is shared by every thread that isn't a worker
+	std::vector<std::unique_ptr<Job>> jobPool;		// Every job ever made, in use or not
+	Job* freeJobs;									// The ones that aren't, linked through NextFree
+	std::mutex poolMutex;
+	std::atomic<unsigned int> queuedJobs;
+	std::atomic<unsigned int> nextVictim;
+	std::atomic<unsigned long long> jobsRun;
+	std::atomic<unsigned long long> jobsStolen;
+	std::mutex sleepMutex;
+	std::condition_variable jobAvailable;
+	bool stopping;
+};
+
+
+// --------------------------------------------------------
+// Chunks are claimed from a shared counter rather than
+// split up front, so a thread that finishes early just
+// takes the next one.  One job per extra thread goes on
+// this thread's deque for the others to steal; any that
+// start after the chunks have run out return straight away.
+// Rather than keeping their handles, this counts them back
+// in, and each only captures two references, so the whole
+// thing runs without touching the heap.
+// --------------------------------------------------------
+template<typename Function>
+void JobSystem::ParallelFor(unsigned int count, unsigned int chunkSize, Function work)
+{
+	if (count == 0)
+		return;
+
+	unsigned int threadCount = GetThreadCount();
+	if (chunkSize == 0)
+		chunkSize = std::max((unsigned int)JOB_MIN_CHUNK_SIZE, count / (threadCount * JOB_CHUNKS_PER_THREAD));
+	unsigned int chunkCount = (count + chunkSize - 1) / chunkSize;
+	if (chunkCount == 1 || threadCount == 1)
+	{
+		for (unsigned int begin = 0; begin < count; begin += chunkSize)
+			work(begin, std::min(count, begin + chunkSize));
+		return;
+	}
+
+	std::atomic<unsigned int> nextChunk(0);
+	auto runChunks = [&]() {
+		for (unsigned int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+			work(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+	};
+
+	unsigned int helperCount = std::min(threadCount, chunkCount) - 1;
+	std::atomic<unsigned int> helpersLeft(helperCount);
+	for (unsigned int i = 0; i < helperCount; i++)
+	{
+		Run([&runChunks, &helpersLeft]() {
+			runChunks();
+			helpersLeft--;
+		});
+	}
+	runChunks();
+
+	// Nothing to help with means the helpers that are left are already running somewhere else
+	while (helpersLeft > 0)
+	{
+		if (!RunOne())
+			std::this_thread::yield();
+	}
+}
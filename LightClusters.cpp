@@ -0,0 +1,394 @@
+#include "LightClusters.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+static_assert(LIGHT_CLUSTERS_X <= 256 && LIGHT_CLUSTERS_Y <= 256 && LIGHT_CLUSTERS_Z <= 256, "Cluster ranges are stored in bytes");
+
+
+LightClusters::LightClusters(std::shared_ptr<JobSystem> jobs)
+	: jobs(jobs), globalLightCount(0), maxClusterLights(0), tanX(1), tanY(1), sliceNear(1), farClip(2), depthScale(1), depthBias(0)
+{
+	unsigned int threadCount = GetThreadCount();
+
+	// More groups than threads, so a thread that gets a quiet run of slices can pick up another
+	unsigned int groupCount = std::min((unsigned int)LIGHT_CLUSTERS_Z, threadCount == 1 ? 1 : threadCount * 2);
+	groups.resize(groupCount);
+	for (unsigned int g = 0; g < groupCount; g++)
+	{
+		groups[g].FirstSlice = LIGHT_CLUSTERS_Z * g / groupCount;
+		groups[g].EndSlice = LIGHT_CLUSTERS_Z * (g + 1) / groupCount;
+		groups[g].Counts.resize((groups[g].EndSlice - groups[g].FirstSlice) * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y);
+	}
+	clusters.resize(LIGHT_CLUSTER_COUNT);
+}
+
+
+template<typename Function>
+void LightClusters::ParallelFor(unsigned int count, Function work)
+{
+	if (!jobs)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			work(i);
+		return;
+	}
+
+	// One item per chunk: each is already a whole group of slices
+	jobs->ParallelFor(count, 1, [&](unsigned int begin, unsigned int end) {
+		PROFILE_SCOPE("Light clustering job");
+		for (unsigned int i = begin; i < end; i++)
+			work(i);
+	});
+}
+
+
+// --------------------------------------------------------
+// Three passes, each split over the worker threads:
+//  1. Every light moves to view space and finds the block
+//     of clusters its bounding box touches
+//  2. Each group of depth slices tests those lights against
+//     its own clusters (so no two threads share a list)
+//  3. The groups' lists are copied into one index list
+// --------------------------------------------------------
+void LightClusters::Build(const std::vector<Light>& lights, const XMFLOAT4X4& view, const XMFLOAT4X4& projection,
+	float nearClip, float farClip)
+{
+	tanX = 1.0f / projection._11;
+	tanY = 1.0f / projection._22;
+	float forward = projection._34; // 1 for left handed (+Z forward), -1 for right handed
+	this->farClip = farClip;
+
+	// Exponential slices: each one is the same ratio deeper than the last
+	sliceNear = std::min(std::max(nearClip, LIGHT_CLUSTER_MIN_DEPTH), farClip * 0.5f);
+	depthScale = LIGHT_CLUSTERS_Z / logf(farClip / sliceNear);
+	depthBias = -logf(sliceNear) * depthScale;
+	for (unsigned int z = 0; z <= LIGHT_CLUSTERS_Z; z++)
+		sliceDepths[z] = sliceNear * powf(farClip / sliceNear, (float)z / LIGHT_CLUSTERS_Z);
+	sliceDepths[0] = 0.0f; // Everything closer lands in the first slice too
+	sliceDepths[LIGHT_CLUSTERS_Z] = farClip;
+
+	// A tile's sides are planes through the camera, so its box in a slice spans both the near and far depths
+	for (unsigned int z = 0; z < LIGHT_CLUSTERS_Z; z++)
+	{
+		float zNear = sliceDepths[z];
+		float zFar = sliceDepths[z + 1];
+		for (unsigned int x = 0; x < LIGHT_CLUSTERS_X; x++)
+		{
+			float left = tanX * (2.0f * x / LIGHT_CLUSTERS_X - 1.0f);
+			float right = tanX * (2.0f * (x + 1) / LIGHT_CLUSTERS_X - 1.0f);
+			tileMinX[z][x] = std::min(left * zNear, left * zFar);
+			tileMaxX[z][x] = std::max(right * zNear, right * zFar);
+		}
+		for (unsigned int y = 0; y < LIGHT_CLUSTERS_Y; y++)
+		{
+			float top = tanY * (1.0f - 2.0f * y / LIGHT_CLUSTERS_Y);
+			float bottom = tanY * (1.0f - 2.0f * (y + 1) / LIGHT_CLUSTERS_Y);
+			tileMinY[z][y] = std::min(bottom * zNear, bottom * zFar);
+			tileMaxY[z][y] = std::max(top * zNear, top * zFar);
+		}
+	}
+
+	// Directional lights skip the grid entirely
+	lightIndices.clear();
+	for (unsigned int i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Type == LIGHT_TYPE_DIRECTIONAL)
+			lightIndices.push_back(i);
+	}
+	globalLightCount = (unsigned int)lightIndices.size();
+
+	unsigned int groupCount = (unsigned int)groups.size();
+	unsigned int lightCount = (unsigned int)lights.size();
+	clusterLights.resize(lightCount);
+	spotCones.resize(lightCount);
+	ParallelFor(groupCount, [&](unsigned int g) {
+		PrepareLights(lights, lightCount * g / groupCount, lightCount * (g + 1) / groupCount, view, forward);
+	});
+
+	ParallelFor(groupCount, [&](unsigned int g) { BinLights(groups[g]); });
+
+	std::vector<unsigned int> offsets(groupCount);
+	unsigned int indexCount = globalLightCount;
+	maxClusterLights = 0;
+	for (unsigned int g = 0; g < groupCount; g++)
+	{
+		offsets[g] = indexCount;
+		indexCount += groups[g].IndexCount;
+		maxClusterLights = std::max(maxClusterLights, groups[g].MaxCount);
+	}
+	lightIndices.resize(indexCount);
+	ParallelFor(groupCount, [&](unsigned int g) { WriteGroup(groups[g], offsets[g]); });
+}
+
+
+// --------------------------------------------------------
+// Finds each light's block of clusters from the box around
+// its sphere (for spot lights, the sphere around the cone),
+// four lights at a time.  The tangents are
+// conservative: the smallest X/depth of any point in the
+// box pairs the smallest X with the nearest depth if it's
+// negative, or with the furthest depth if not.
+// --------------------------------------------------------
+void LightClusters::PrepareLights(const std::vector<Light>& lights, unsigned int first, unsigned int end, const XMFLOAT4X4& view, float forward)
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR everything = XMVectorReplicate(FLT_MAX);
+	const XMVECTOR tangentX = XMVectorReplicate(tanX);
+	const XMVECTOR tangentY = XMVectorReplicate(tanY);
+	const XMVECTOR halfTilesX = XMVectorReplicate(LIGHT_CLUSTERS_X * 0.5f);
+	const XMVECTOR halfTilesY = XMVectorReplicate(LIGHT_CLUSTERS_Y * 0.5f);
+	const XMVECTOR lastTileX = XMVectorReplicate(LIGHT_CLUSTERS_X - 1.0f);
+	const XMVECTOR lastTileY = XMVectorReplicate(LIGHT_CLUSTERS_Y - 1.0f);
+	const XMVECTOR lastSlice = XMVectorReplicate(LIGHT_CLUSTERS_Z - 1.0f);
+	const XMVECTOR firstSliceDepth = XMVectorReplicate(sliceNear);
+	const XMVECTOR sliceScale = XMVectorReplicate(depthScale);
+	const XMVECTOR sliceBias = XMVectorReplicate(depthBias);
+
+	for (unsigned int i = first; i < end; i += 4)
+	{
+		unsigned int count = std::min(4u, end - i);
+
+		// Gather four lights (spare lanes get no range, and are never read back)
+		XMFLOAT4A worldX(0, 0, 0, 0), worldY(0, 0, 0, 0), worldZ(0, 0, 0, 0), range(0, 0, 0, 0);
+		for (unsigned int lane = 0; lane < count; lane++)
+		{
+			const Light& light = lights[i + lane];
+			XMFLOAT3 center = light.Position;
+			float radius = light.Range;
+			if (light.Type == LIGHT_TYPE_SPOT)
+				GetConeBoundingSphere(GetSpotLightCone(light), center, radius);
+			(&worldX.x)[lane] = center.x;
+			(&worldY.x)[lane] = center.y;
+			(&worldZ.x)[lane] = center.z;
+			(&range.x)[lane] = radius;
+		}
+		XMVECTOR positionX = XMLoadFloat4A(&worldX);
+		XMVECTOR positionY = XMLoadFloat4A(&worldY);
+		XMVECTOR positionZ = XMLoadFloat4A(&worldZ);
+		XMVECTOR radius = XMLoadFloat4A(&range);
+
+		// Into view space, one component of all four lights at a time
+		XMVECTOR x = XMVectorMultiplyAdd(positionX, XMVectorReplicate(view._11), XMVectorMultiplyAdd(positionY, XMVectorReplicate(view._21),
+			XMVectorMultiplyAdd(positionZ, XMVectorReplicate(view._31), XMVectorReplicate(view._41))));
+		XMVECTOR y = XMVectorMultiplyAdd(positionX, XMVectorReplicate(view._12), XMVectorMultiplyAdd(positionY, XMVectorReplicate(view._22),
+			XMVectorMultiplyAdd(positionZ, XMVectorReplicate(view._32), XMVectorReplicate(view._42))));
+		XMVECTOR z = XMVectorMultiplyAdd(positionX, XMVectorReplicate(view._13), XMVectorMultiplyAdd(positionY, XMVectorReplicate(view._23),
+			XMVectorMultiplyAdd(positionZ, XMVectorReplicate(view._33), XMVectorReplicate(view._43))));
+		XMVECTOR depth = XMVectorScale(z, forward);
+		XMVECTOR nearDepth = XMVectorSubtract(depth, radius);
+		XMVECTOR farDepth = XMVectorAdd(depth, radius);
+
+		XMVECTOR left = XMVectorSubtract(x, radius);
+		XMVECTOR right = XMVectorAdd(x, radius);
+		XMVECTOR bottom = XMVectorSubtract(y, radius);
+		XMVECTOR top = XMVectorAdd(y, radius);
+		XMVECTOR minTanX = XMVectorDivide(left, XMVectorSelect(farDepth, nearDepth, XMVectorLess(left, zero)));
+		XMVECTOR maxTanX = XMVectorDivide(right, XMVectorSelect(nearDepth, farDepth, XMVectorLess(right, zero)));
+		XMVECTOR minTanY = XMVectorDivide(bottom, XMVectorSelect(farDepth, nearDepth, XMVectorLess(bottom, zero)));
+		XMVECTOR maxTanY = XMVectorDivide(top, XMVectorSelect(nearDepth, farDepth, XMVectorLess(top, zero)));
+
+		// Lights reaching behind the camera could cover any tile
+		XMVECTOR aroundCamera = XMVectorLessOrEqual(nearDepth, zero);
+		minTanX = XMVectorSelect(minTanX, XMVectorNegate(everything), aroundCamera);
+		maxTanX = XMVectorSelect(maxTanX, everything, aroundCamera);
+		minTanY = XMVectorSelect(minTanY, XMVectorNegate(everything), aroundCamera);
+		maxTanY = XMVectorSelect(maxTanY, everything, aroundCamera);
+
+		// Visible if it has a range, reaches in front of the camera, starts before the far clip and isn't off to a side
+		XMVECTOR offSide = XMVectorOrInt(
+			XMVectorOrInt(XMVectorGreater(minTanX, tangentX), XMVectorLess(maxTanX, XMVectorNegate(tangentX))),
+			XMVectorOrInt(XMVectorGreater(minTanY, tangentY), XMVectorLess(maxTanY, XMVectorNegate(tangentY))));
+		XMVECTOR visible = XMVectorAndCInt(
+			XMVectorAndInt(XMVectorAndInt(XMVectorGreater(radius, zero), XMVectorGreater(farDepth, zero)), XMVectorLess(nearDepth, XMVectorReplicate(farClip))),
+			offSide);
+
+		// Tile columns and rows (rows count down from the top), and slices from the same log the pixel shader uses
+		XMVECTOR minX = XMVectorClamp(XMVectorFloor(XMVectorMultiply(XMVectorAdd(XMVectorDivide(minTanX, tangentX), one), halfTilesX)), zero, lastTileX);
+		XMVECTOR maxX = XMVectorClamp(XMVectorFloor(XMVectorMultiply(XMVectorAdd(XMVectorDivide(maxTanX, tangentX), one), halfTilesX)), zero, lastTileX);
+		XMVECTOR minY = XMVectorClamp(XMVectorFloor(XMVectorMultiply(XMVectorSubtract(one, XMVectorDivide(maxTanY, tangentY)), halfTilesY)), zero, lastTileY);
+		XMVECTOR maxY = XMVectorClamp(XMVectorFloor(XMVectorMultiply(XMVectorSubtract(one, XMVectorDivide(minTanY, tangentY)), halfTilesY)), zero, lastTileY);
+		XMVECTOR minZ = XMVectorClamp(XMVectorFloor(XMVectorMultiplyAdd(XMVectorLogE(XMVectorMax(nearDepth, firstSliceDepth)), sliceScale, sliceBias)), zero, lastSlice);
+		XMVECTOR maxZ = XMVectorClamp(XMVectorFloor(XMVectorMultiplyAdd(XMVectorLogE(XMVectorMax(farDepth, firstSliceDepth)), sliceScale, sliceBias)), zero, lastSlice);
+
+		// Scatter back out to each light
+		XMFLOAT4A centerX, centerY, centerDepth, radiusSquared, firstX, lastX, firstY, lastY, firstZ, lastZ;
+		uint32_t isVisible[4];
+		XMStoreFloat4A(&centerX, x);
+		XMStoreFloat4A(&centerY, y);
+		XMStoreFloat4A(&centerDepth, depth);
+		XMStoreFloat4A(&radiusSquared, XMVectorMultiply(radius, radius));
+		XMStoreFloat4A(&firstX, minX);
+		XMStoreFloat4A(&lastX, maxX);
+		XMStoreFloat4A(&firstY, minY);
+		XMStoreFloat4A(&lastY, maxY);
+		XMStoreFloat4A(&firstZ, minZ);
+		XMStoreFloat4A(&lastZ, maxZ);
+		XMStoreInt4(isVisible, visible);
+		for (unsigned int lane = 0; lane < count; lane++)
+		{
+			ClusterLight& prepared = clusterLights[i + lane];
+			prepared.X = (&centerX.x)[lane];
+			prepared.Y = (&centerY.x)[lane];
+			prepared.Depth = (&centerDepth.x)[lane];
+			prepared.RadiusSquared = (&radiusSquared.x)[lane];
+			prepared.MinX = (unsigned char)(&firstX.x)[lane];
+			prepared.MaxX = (unsigned char)(&lastX.x)[lane];
+			prepared.MinY = (unsigned char)(&firstY.x)[lane];
+			prepared.MaxY = (unsigned char)(&lastY.x)[lane];
+			prepared.MinZ = (unsigned char)(&firstZ.x)[lane];
+			prepared.MaxZ = (unsigned char)(&lastZ.x)[lane];
+			prepared.Visible = isVisible[lane] && lights[i + lane].Type != LIGHT_TYPE_DIRECTIONAL;
+			prepared.Spot = lights[i + lane].Type == LIGHT_TYPE_SPOT;
+			if (prepared.Visible && prepared.Spot)
+			{
+				// The cone moves to view space the same way, with its depth flipped to be positive
+				Cone cone = GetSpotLightCone(lights[i + lane]);
+				XMStoreFloat3(&cone.Apex, XMVector3Transform(XMLoadFloat3(&cone.Apex), XMLoadFloat4x4(&view)));
+				XMStoreFloat3(&cone.Direction, XMVector3TransformNormal(XMLoadFloat3(&cone.Direction), XMLoadFloat4x4(&view)));
+				cone.Apex.z *= forward;
+				cone.Direction.z *= forward;
+				spotCones[i + lane] = cone;
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Exact sphere against box tests for every cluster in each
+// light's block.  Within one row of tiles the sphere's slice
+// is a circle and the tile boxes only move to the right, so
+// the tiles it reaches are one unbroken run: trim the block
+// at both ends, then take everything in between.  Spot
+// lights then test the cone against each cluster's sphere.
+// --------------------------------------------------------
+void LightClusters::BinLights(SliceGroup& group)
+{
+	group.ClusterLights.clear();
+	const unsigned int clustersPerSlice = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+
+	for (unsigned int i = 0; i < clusterLights.size(); i++)
+	{
+		const ClusterLight& light = clusterLights[i];
+		if (!light.Visible || light.MaxZ < group.FirstSlice || light.MinZ >= group.EndSlice)
+			continue;
+
+		unsigned int firstSlice = std::max((unsigned int)light.MinZ, group.FirstSlice);
+		unsigned int endSlice = std::min((unsigned int)light.MaxZ + 1, group.EndSlice);
+		for (unsigned int z = firstSlice; z < endSlice; z++)
+		{
+			float dz = std::max(std::max(sliceDepths[z] - light.Depth, light.Depth - sliceDepths[z + 1]), 0.0f);
+			float remainingZ = light.RadiusSquared - dz * dz;
+			if (remainingZ < 0.0f)
+				continue;
+
+			for (unsigned int y = light.MinY; y <= light.MaxY; y++)
+			{
+				float dy = std::max(std::max(tileMinY[z][y] - light.Y, light.Y - tileMaxY[z][y]), 0.0f);
+				float remaining = remainingZ - dy * dy;
+				if (remaining < 0.0f)
+					continue;
+
+				float halfWidth = sqrtf(remaining);
+				int firstX = light.MinX;
+				int lastX = light.MaxX;
+				while (firstX <= lastX && tileMaxX[z][firstX] < light.X - halfWidth)
+					firstX++;
+				while (lastX >= firstX && tileMinX[z][lastX] > light.X + halfWidth)
+					lastX--;
+
+				unsigned int rowStart = (z - group.FirstSlice) * clustersPerSlice + y * LIGHT_CLUSTERS_X;
+				for (int x = firstX; x <= lastX; x++)
+				{
+					if (light.Spot)
+					{
+						XMFLOAT3 boxMin(tileMinX[z][x], tileMinY[z][y], sliceDepths[z]);
+						XMFLOAT3 boxMax(tileMaxX[z][x], tileMaxY[z][y], sliceDepths[z + 1]);
+						XMFLOAT3 center((boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f);
+						float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&boxMax), XMLoadFloat3(&boxMin)))) * 0.5f;
+						if (!ConeIntersectsSphere(spotCones[i], center, radius))
+							continue;
+					}
+					group.ClusterLights.push_back(rowStart + x);
+					group.ClusterLights.push_back(i);
+				}
+			}
+		}
+	}
+
+	// Counting sort by cluster.  Lights were visited in order, so each cluster's list stays sorted.
+	std::fill(group.Counts.begin(), group.Counts.end(), 0);
+	for (unsigned int p = 0; p < group.ClusterLights.size(); p += 2)
+		group.Counts[group.ClusterLights[p]]++;
+	group.IndexCount = (unsigned int)group.ClusterLights.size() / 2;
+	group.MaxCount = group.Counts.empty() ? 0 : *std::max_element(group.Counts.begin(), group.Counts.end());
+}
+
+
+void LightClusters::WriteGroup(SliceGroup& group, unsigned int indexOffset)
+{
+	const unsigned int clustersPerSlice = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+	unsigned int firstCluster = group.FirstSlice * clustersPerSlice;
+
+	// Counts become each cluster's next free slot
+	unsigned int offset = indexOffset;
+	for (unsigned int c = 0; c < group.Counts.size(); c++)
+	{
+		clusters[firstCluster + c].Offset = offset;
+		clusters[firstCluster + c].Count = group.Counts[c];
+		offset += group.Counts[c];
+		group.Counts[c] = clusters[firstCluster + c].Offset;
+	}
+
+	for (unsigned int p = 0; p < group.ClusterLights.size(); p += 2)
+		lightIndices[group.Counts[group.ClusterLights[p]]++] = group.ClusterLights[p + 1];
+}
+
+
+const std::vector<LightCluster>& LightClusters::GetClusters()
+{
+	return clusters;
+}
+
+const std::vector<unsigned int>& LightClusters::GetLightIndices()
+{
+	return lightIndices;
+}
+
+unsigned int LightClusters::GetGlobalLightCount()
+{
+	return globalLightCount;
+}
+
+float LightClusters::GetDepthScale()
+{
+	return depthScale;
+}
+
+float LightClusters::GetDepthBias()
+{
+	return depthBias;
+}
+
+void LightClusters::GetClusterBounds(unsigned int x, unsigned int y, unsigned int z, XMFLOAT3& boxMin, XMFLOAT3& boxMax)
+{
+	boxMin = XMFLOAT3(tileMinX[z][x], tileMinY[z][y], sliceDepths[z]);
+	boxMax = XMFLOAT3(tileMaxX[z][x], tileMaxY[z][y], sliceDepths[z + 1]);
+}
+
+unsigned int LightClusters::GetMaxClusterLights()
+{
+	return maxClusterLights;
+}
+
+unsigned int LightClusters::GetThreadCount()
+{
+	return jobs ? jobs->GetThreadCount() : 1;
+}
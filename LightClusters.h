@@ -0,0 +1,115 @@
+#pragma once
+
+// Clustered light culling for forward shading
+// - Splits the camera's frustum into a grid of "clusters": tiles across the screen, exponentially spaced slices in depth
+// - Lists the lights whose range reaches each cluster, so a pixel only loops over lights that can actually light it
+// - Spot lights are binned by the sphere around their cone, then each cluster is checked against the cone itself
+// - Only DirectXMath and the JobSystem (no D3D), so it can be built and benchmarked away from the renderer
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "Bounds.h"
+#include "Lights.h"
+#include "JobSystem.h"
+
+// Must match PixelShader_NormalMap.hlsl
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)
+
+// Depth slices start here (or at the near clip, if that's further).  Anything closer shares the first slice,
+// since a tiny near clip would otherwise spend most of the slices on the first few centimeters.
+#define LIGHT_CLUSTER_MIN_DEPTH 0.5f
+
+// Where one cluster's lights are in the index list (uint2 in the pixel shader)
+struct LightCluster
+{
+	unsigned int Offset;
+	unsigned int Count;
+};
+
+class LightClusters
+{
+public:
+	// Builds are spread over the job system's threads.  Without one, everything runs on the calling thread.
+	LightClusters(std::shared_ptr<JobSystem> jobs = nullptr);
+
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	// Rebuilds every cluster's light list for a (symmetric, perspective) camera.
+	// Directional lights reach everything, so they're listed once at the start of the index list instead.
+	void Build(const std::vector<Light>& lights, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection,
+		float nearClip, float farClip);
+
+	const std::vector<LightCluster>& GetClusters();		// X fastest, then Y (top row first), then depth
+	const std::vector<unsigned int>& GetLightIndices();	// The global lights, then every cluster's lights
+	unsigned int GetGlobalLightCount();
+
+	// A pixel's slice is floor(log(viewDepth) * scale + bias), clamped to the grid
+	float GetDepthScale();
+	float GetDepthBias();
+
+	// The view space box a cluster covers, for checking the binning
+	void GetClusterBounds(unsigned int x, unsigned int y, unsigned int z, DirectX::XMFLOAT3& boxMin, DirectX::XMFLOAT3& boxMax);
+
+	unsigned int GetMaxClusterLights(); // Busiest cluster from the last build
+	unsigned int GetThreadCount();
+
+private:
+	// A light's sphere in view space (depth is always positive), and the block of clusters its bounding box covers
+	struct ClusterLight
+	{
+		float X, Y, Depth, RadiusSquared;
+		unsigned char MinX, MaxX, MinY, MaxY, MinZ, MaxZ;
+		bool Visible;
+		bool Spot; // Its cone is in spotCones
+	};
+
+	// The lights found in one run of depth slices
+	struct SliceGroup
+	{
+		unsigned int FirstSlice;
+		unsigned int EndSlice;
+		std::vector<unsigned int> ClusterLights; // Pairs of (cluster within the group, light index), in light order
+		std::vector<unsigned int> Counts;
+		unsigned int IndexCount;
+		unsigned int MaxCount;
+	};
+
+	void PrepareLights(const std::vector<Light>& lights, unsigned int first, unsigned int end, const DirectX::XMFLOAT4X4& view, float forward);
+	void BinLights(SliceGroup& group);
+	void WriteGroup(SliceGroup& group, unsigned int indexOffset);
+
+	// Runs work(0) .. work(count - 1), spread over the job system's threads
+	template<typename Function>
+	void ParallelFor(unsigned int count, Function work);
+
+	std::shared_ptr<JobSystem> jobs;
+
+	std::vector<ClusterLight> clusterLights;
+	std::vector<Cone> spotCones; // View space (with positive depth), only filled in for spot lights
+	std::vector<SliceGroup> groups;
+	std::vector<LightCluster> clusters;
+	std::vector<unsigned int> lightIndices;
+	unsigned int globalLightCount;
+	unsigned int maxClusterLights;
+
+	// Tile edges as view space tangents, and the depth slice edges
+	float tanX;
+	float tanY;
+	float sliceNear;
+	float farClip;
+	float depthScale;
+	float depthBias;
+	float sliceDepths[LIGHT_CLUSTERS_Z + 1];
+
+	// Sideways extents of every tile in every slice
+	float tileMinX[LIGHT_CLUSTERS_Z][LIGHT_CLUSTERS_X];
+	float tileMaxX[LIGHT_CLUSTERS_Z][LIGHT_CLUSTERS_X];
+	float tileMinY[LIGHT_CLUSTERS_Z][LIGHT_CLUSTERS_Y];
+	float tileMaxY[LIGHT_CLUSTERS_Z][LIGHT_CLUSTERS_Y];
+};
@@ -0,0 +1,166 @@
+#include "LightManager.h"
+
+#include <cstring>
+
+
+LightManager::LightManager()
+	: lightsChanged(false), listChanged(false), version(0), rebuildCount(0)
+{
+}
+
+LightHandle LightManager::Add(const Light& light, bool active)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)slots.size();
+		slots.push_back({ 0, 0 });
+	}
+
+	slots[slot].Index = (unsigned int)lights.size();
+	lights.push_back(light);
+	lightSlots.push_back(slot);
+	activeIndices.push_back(active ? 0 : -1); // Real positions are handed out by Update()
+	listChanged |= active;
+	return { slot, slots[slot].Generation };
+}
+
+// --------------------------------------------------------
+// The last light moves into the hole, so the arrays stay
+// packed.  Only that light's slot needs to know.
+// --------------------------------------------------------
+void LightManager::Remove(LightHandle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	unsigned int index = slots[handle.Slot].Index;
+	unsigned int last = (unsigned int)lights.size() - 1;
+	listChanged |= activeIndices[index] >= 0;
+
+	lights[index] = lights[last];
+	lightSlots[index] = lightSlots[last];
+	activeIndices[index] = activeIndices[last];
+	slots[lightSlots[index]].Index = index;
+	lights.pop_back();
+	lightSlots.pop_back();
+	activeIndices.pop_back();
+
+	slots[handle.Slot].Generation++;
+	freeSlots.push_back(handle.Slot);
+}
+
+bool LightManager::IsValid(LightHandle handle)
+{
+	return handle.Slot < slots.size() && slots[handle.Slot].Generation == handle.Generation;
+}
+
+unsigned int LightManager::IndexOf(LightHandle handle)
+{
+	return slots[handle.Slot].Index;
+}
+
+const Light& LightManager::Get(LightHandle handle)
+{
+	return lights[IndexOf(handle)];
+}
+
+// --------------------------------------------------------
+// Active lights are patched in place, unless the list is
+// being rebuilt anyway.  Lights that haven't changed (bit
+// for bit) leave everything alone.
+// --------------------------------------------------------
+void LightManager::Set(LightHandle handle, const Light& light)
+{
+	unsigned int index = IndexOf(handle);
+	if (memcmp(&lights[index], &light, sizeof(Light)) == 0)
+		return;
+
+	lights[index] = light;
+	int activeIndex = activeIndices[index];
+	if (activeIndex >= 0 && !listChanged)
+	{
+		activeLights[activeIndex] = light;
+		lightsChanged = true;
+	}
+}
+
+void LightManager::SetShadowIndex(LightHandle handle, int shadowIndex)
+{
+	if (lights[IndexOf(handle)].ShadowIndex == shadowIndex)
+		return;
+
+	Light light = Get(handle);
+	light.ShadowIndex = shadowIndex;
+	Set(handle, light);
+}
+
+bool LightManager::IsActive(LightHandle handle)
+{
+	return activeIndices[IndexOf(handle)] >= 0;
+}
+
+void LightManager::SetActive(LightHandle handle, bool active)
+{
+	unsigned int index = IndexOf(handle);
+	if ((activeIndices[index] >= 0) == active)
+		return;
+
+	activeIndices[index] = active ? 0 : -1;
+	listChanged = true;
+}
+
+bool LightManager::Update()
+{
+	if (listChanged)
+	{
+		activeLights.clear();
+		activeHandles.clear();
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			if (activeIndices[i] < 0)
+				continue;
+			activeIndices[i] = (int)activeLights.size();
+			activeLights.push_back(lights[i]);
+			activeHandles.push_back({ lightSlots[i], slots[lightSlots[i]].Generation });
+		}
+		rebuildCount++;
+	}
+
+	bool changed = listChanged || lightsChanged;
+	listChanged = false;
+	lightsChanged = false;
+	if (changed)
+		version++;
+	return changed;
+}
+
+const std::vector<Light>& LightManager::GetActiveLights()
+{
+	return activeLights;
+}
+
+LightHandle LightManager::GetActiveHandle(unsigned int activeIndex)
+{
+	return activeHandles[activeIndex];
+}
+
+unsigned int LightManager::GetCount()
+{
+	return (unsigned int)lights.size();
+}
+
+unsigned int LightManager::GetVersion()
+{
+	return version;
+}
+
+unsigned int LightManager::GetRebuildCount()
+{
+	return rebuildCount;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Owns every light in the scene
+// - Lights are packed into one array, and found through handles that stay valid as other lights come and go
+// - Keeps the array of active lights the GPU reads, and only touches it when a light actually changes
+// - GetVersion() only goes up when something changed, so a steady scene can skip re-uploading and re-clustering
+// - No D3D, so it can be checked away from the renderer
+
+#include "Lights.h"
+
+#include <vector>
+
+struct LightHandle
+{
+	unsigned int Slot;			// Never reused while the light is alive
+	unsigned int Generation;	// Bumped when the slot is freed, so old handles stop matching
+};
+
+inline bool operator==(const LightHandle& a, const LightHandle& b)
+{
+	return a.Slot == b.Slot && a.Generation == b.Generation;
+}
+
+class LightManager
+{
+public:
+	LightManager();
+
+	LightHandle Add(const Light& light, bool active = true);
+	void Remove(LightHandle handle);
+	bool IsValid(LightHandle handle);
+
+	const Light& Get(LightHandle handle);
+	void Set(LightHandle handle, const Light& light);
+	void SetShadowIndex(LightHandle handle, int shadowIndex); // Cheap to call every frame: nothing happens if it's the same
+	bool IsActive(LightHandle handle);
+	void SetActive(LightHandle handle, bool active);
+
+	// Applies this frame's changes to the active light array.  Returns true if anything changed.
+	bool Update();
+
+	const std::vector<Light>& GetActiveLights();		// Ready to copy straight to the GPU
+	LightHandle GetActiveHandle(unsigned int activeIndex);	// Which light an active entry came from
+	unsigned int GetCount();
+	unsigned int GetVersion();			// Goes up by one every Update() that changed something
+	unsigned int GetRebuildCount();		// How many of those had to repack the whole active array
+
+private:
+	struct Slot
+	{
+		unsigned int Index;	// Into the packed arrays
+		unsigned int Generation;
+	};
+
+	unsigned int IndexOf(LightHandle handle);
+
+	// Packed, every light (active or not)
+	std::vector<Light> lights;
+	std::vector<unsigned int> lightSlots;
+	std::vector<int> activeIndices; // Where each light is in activeLights, or -1
+
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+
+	std::vector<Light> activeLights;
+	std::vector<LightHandle> activeHandles;
+
+	bool lightsChanged;	// Only values changed, which are patched in place
+	bool listChanged;	// Lights were added, removed, activated or deactivated
+	unsigned int version;
+	unsigned int rebuildCount;
+};
@@ -0,0 +1,68 @@
+#include "LightScattering.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+
+int ChooseScatteringSampleCount(float texelsToSun, const ScatteringSettings& settings)
+{
+	int count = (int)ceilf(texelsToSun / std::max(settings.TexelsPerSample, 0.01f));
+	return std::clamp(count, 1, std::clamp(settings.MaxSamples, 1, MAX_SCATTERING_SAMPLES));
+}
+
+// --------------------------------------------------------
+// With N steps each one fades by decay ^ (20 / N), so the
+// whole ray fades the same.  The weight then keeps the sum
+// of a fully lit ray, weight * (1 - d^N) / (1 - d) / N at
+// d = decay and N = 20, the same for every N.
+// --------------------------------------------------------
+void GetScatteringSampleWeights(int sampleCount, const ScatteringSettings& settings, float& decayPerSample, float& sampleWeight)
+{
+	decayPerSample = powf(settings.Decay, (float)SCATTERING_REFERENCE_SAMPLES / sampleCount);
+	if (settings.Decay > 0.9999f)
+		sampleWeight = settings.Weight / sampleCount; // No fading at all
+	else
+		sampleWeight = settings.Weight * (1.0f - decayPerSample) / (SCATTERING_REFERENCE_SAMPLES * (1.0f - settings.Decay));
+}
+
+XMFLOAT3 ScatterLightReference(const std::vector<XMFLOAT4>& occlusion, unsigned int width, unsigned int height,
+	XMFLOAT2 uv, XMFLOAT2 sunUV, XMFLOAT2 targetSize, const ScatteringSettings& settings)
+{
+	auto load = [&](int x, int y) {
+		x = std::clamp(x, 0, (int)width - 1);
+		y = std::clamp(y, 0, (int)height - 1);
+		return XMLoadFloat4(&occlusion[(size_t)y * width + x]);
+	};
+	auto sample = [&](float u, float v) {
+		float x = u * width - 0.5f;
+		float y = v * height - 0.5f;
+		int left = (int)floorf(x);
+		int top = (int)floorf(y);
+		float blendX = x - left;
+		float blendY = y - top;
+		XMVECTOR upper = XMVectorLerp(load(left, top), load(left + 1, top), blendX);
+		XMVECTOR lower = XMVectorLerp(load(left, top + 1), load(left + 1, top + 1), blendX);
+		return XMVectorLerp(upper, lower, blendY);
+	};
+
+	float toSunX = sunUV.x - uv.x;
+	float toSunY = sunUV.y - uv.y;
+	float texelsToSun = sqrtf(toSunX * targetSize.x * toSunX * targetSize.x + toSunY * targetSize.y * toSunY * targetSize.y);
+	int sampleCount = ChooseScatteringSampleCount(texelsToSun, settings);
+	float decayPerSample, sampleWeight;
+	GetScatteringSampleWeights(sampleCount, settings, decayPerSample, sampleWeight);
+
+	XMVECTOR total = XMVectorZero();
+	float fade = sampleWeight;
+	for (int i = 0; i < sampleCount; i++)
+	{
+		total = XMVectorAdd(total, XMVectorScale(sample(uv.x + toSunX * i / sampleCount, uv.y + toSunY * i / sampleCount), fade));
+		fade *= decayPerSample;
+	}
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVectorScale(total, settings.Exposure));
+	return result;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Screen space light scattering ("god rays"), shared by PixelShader_VolumetricLighting.hlsl and the CPU
+// - Each pixel marches towards the sun, adding up the unblocked sun it crosses, fading with every step
+// - The number of steps follows how far the pixel is from the sun, so steps stay about the same size
+// - Decay and weight are for the original fixed 20 steps, and are rescaled for any other count
+// - Only DirectXMath (no D3D), so the shader's math can be checked away from the renderer
+
+#include <DirectXMath.h>
+#include <vector>
+
+#define MAX_SCATTERING_SAMPLES 64		// Must match PixelShader_VolumetricLighting.hlsl
+#define SCATTERING_REFERENCE_SAMPLES 20	// The step count decay and weight are tuned for
+
+struct ScatteringSettings
+{
+	float Exposure;
+	float Weight;
+	float Decay;			// Fade per step at SCATTERING_REFERENCE_SAMPLES steps
+	float TexelsPerSample;	// Step length the count aims for, in the scattering target's texels
+	int MaxSamples;
+};
+
+// Steps for a pixel this many (scattering target) texels from the sun, between 1 and the max
+int ChooseScatteringSampleCount(float texelsToSun, const ScatteringSettings& settings);
+
+// The fade per step and each step's weight for that many steps, so the ray fades over the same
+// distance and a fully lit ray adds up to the same light as the reference step count
+void GetScatteringSampleWeights(int sampleCount, const ScatteringSettings& settings, float& decayPerSample, float& sampleWeight);
+
+// The shader's kernel for one pixel.  Occlusion is the full size sun/occluder image (RGBA, top row first),
+// read with clamped bilinear filtering.  UVs are 0-1 across the screen.
+DirectX::XMFLOAT3 ScatterLightReference(const std::vector<DirectX::XMFLOAT4>& occlusion, unsigned int width, unsigned int height,
+	DirectX::XMFLOAT2 uv, DirectX::XMFLOAT2 sunUV, DirectX::XMFLOAT2 targetSize, const ScatteringSettings& settings);
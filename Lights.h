@@ -10,6 +10,10 @@
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
 
+// A spot light's falloff is cut off where it drops below this (and rescaled so it fades to zero there),
+// which gives it a hard edge to cull against.  Must match ShaderIncludes.hlsli.
+#define SPOT_LIGHT_CUTOFF		(1.0f / 256.0f)
+
 struct Light 
 {
 	int Type;						// 0/1/2
@@ -18,6 +22,7 @@ struct Light
 	DirectX::XMFLOAT3 Position;		// Location of a light in space (1 and 2)
 	float Intensity;				
 	DirectX::XMFLOAT3 Color;
-	float SpotFalloff;				// How far light spreads from the center of a beam (type 2)
-	DirectX::XMFLOAT3 Padding;		// In order to make this exactly 16 bytes wide
+	float SpotFalloff;				// How far light spreads from the center of a beam (type 2).  An exponent: higher is narrower, must be above 0
+	int ShadowIndex;				// -1 if unshadowed. Directional: uses the shadow cascades. Others: first entry in the shadow atlas
+	DirectX::XMFLOAT2 Padding;		// In order to make this exactly 16 bytes wide
 };
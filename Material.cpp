@@ -1,10 +1,12 @@
 #include "Material.h"
+#include "MemoryTracker.h"
 
 Material::Material(DirectX::XMFLOAT4 tint, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader, float roughness)
     : tint(tint),
     vertexShader(vertexShader),
     pixelShader(pixelShader)
 {
+    MEMORY_SCOPE(MEMORY_MATERIAL);
     SetRoughness(roughness);
     textureSRVs = std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>();
     samplers = std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>>();
@@ -19,12 +21,12 @@ DirectX::XMFLOAT4 Material::GetTint()
     return tint;
 }
 
-std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
+const std::shared_ptr<SimpleVertexShader>& Material::GetVertexShader()
 {
     return vertexShader;
 }
 
-std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
+const std::shared_ptr<SimplePixelShader>& Material::GetPixelShader()
 {
     return pixelShader;
 }
@@ -56,11 +58,13 @@ void Material::SetRoughness(float newRoughness)
 
 void Material::AddTextureSRV(std::string srvName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
-    textureSRVs.insert({ srvName, srv });
+    MEMORY_SCOPE(MEMORY_MATERIAL);
+    textureSRVs[srvName] = srv; // Replaces any existing texture, e.g. a placeholder
 }
 
 void Material::AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
+    MEMORY_SCOPE(MEMORY_MATERIAL);
     samplers.insert({ samplerName, sampler });
 }
 
@@ -18,8 +18,8 @@ public:
 
 	// Getters
 	DirectX::XMFLOAT4 GetTint();
-	std::shared_ptr<SimpleVertexShader> GetVertexShader();
-	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	const std::shared_ptr<SimpleVertexShader>& GetVertexShader();
+	const std::shared_ptr<SimplePixelShader>& GetPixelShader();
 	float GetRoughness();
 
 	// Setters & Adders
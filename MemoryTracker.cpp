@@ -0,0 +1,214 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	// Plain arrays of atomics, zeroed before any constructor runs, since operator new can be called
+	// before main() (and after it returns)
+	struct Counters
+	{
+		std::atomic<unsigned long long> HeapBytes;
+		std::atomic<unsigned long long> HeapPeak;
+		std::atomic<unsigned long long> HeapAllocations;
+		std::atomic<unsigned long long> GpuBytes;
+		std::atomic<unsigned long long> GpuPeak;
+		std::atomic<unsigned long long> GpuResources;
+	};
+
+	Counters counters[MEMORY_TAG_COUNT];
+	Counters total;
+	std::atomic<unsigned long long> heapBudgets[MEMORY_TAG_COUNT];
+	std::atomic<unsigned long long> gpuBudgets[MEMORY_TAG_COUNT];
+
+	thread_local MemoryTag currentTag = MEMORY_OTHER;
+
+	void RaisePeak(std::atomic<unsigned long long>& peak, unsigned long long value)
+	{
+		unsigned long long seen = peak.load(std::memory_order_relaxed);
+		while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void Add(std::atomic<unsigned long long>& live, std::atomic<unsigned long long>& peak, std::atomic<unsigned long long>& count, unsigned long long bytes)
+	{
+		RaisePeak(peak, live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Remove(std::atomic<unsigned long long>& live, std::atomic<unsigned long long>& count, unsigned long long bytes)
+	{
+		live.fetch_sub(bytes, std::memory_order_relaxed);
+		count.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	MemoryUsage Read(const Counters& from)
+	{
+		MemoryUsage usage;
+		usage.HeapBytes = from.HeapBytes.load(std::memory_order_relaxed);
+		usage.HeapPeak = from.HeapPeak.load(std::memory_order_relaxed);
+		usage.HeapAllocations = from.HeapAllocations.load(std::memory_order_relaxed);
+		usage.GpuBytes = from.GpuBytes.load(std::memory_order_relaxed);
+		usage.GpuPeak = from.GpuPeak.load(std::memory_order_relaxed);
+		usage.GpuResources = from.GpuResources.load(std::memory_order_relaxed);
+		return usage;
+	}
+}
+
+MemoryScope::MemoryScope(MemoryTag tag)
+	: previous(currentTag)
+{
+	currentTag = tag;
+}
+
+MemoryScope::~MemoryScope()
+{
+	currentTag = previous;
+}
+
+MemoryTag GetMemoryTag()
+{
+	return currentTag;
+}
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+	switch (tag)
+	{
+	case MEMORY_OTHER: return "Other";
+	case MEMORY_MESH: return "Mesh";
+	case MEMORY_MATERIAL: return "Material";
+	case MEMORY_SIMPLE_SHADER: return "SimpleShader";
+	case MEMORY_SKY: return "Sky";
+	case MEMORY_TEXTURES: return "Textures";
+	case MEMORY_RENDER_TARGETS: return "Render targets";
+	case MEMORY_IMGUI: return "ImGui";
+	default: return "Unknown";
+	}
+}
+
+void TrackHeapAllocation(MemoryTag tag, unsigned long long bytes)
+{
+	Add(counters[tag].HeapBytes, counters[tag].HeapPeak, counters[tag].HeapAllocations, bytes);
+	Add(total.HeapBytes, total.HeapPeak, total.HeapAllocations, bytes);
+}
+
+void TrackHeapFree(MemoryTag tag, unsigned long long bytes)
+{
+	Remove(counters[tag].HeapBytes, counters[tag].HeapAllocations, bytes);
+	Remove(total.HeapBytes, total.HeapAllocations, bytes);
+}
+
+void TrackGpuAllocation(MemoryTag tag, unsigned long long bytes)
+{
+	Add(counters[tag].GpuBytes, counters[tag].GpuPeak, counters[tag].GpuResources, bytes);
+	Add(total.GpuBytes, total.GpuPeak, total.GpuResources, bytes);
+}
+
+void TrackGpuFree(MemoryTag tag, unsigned long long bytes)
+{
+	Remove(counters[tag].GpuBytes, counters[tag].GpuResources, bytes);
+	Remove(total.GpuBytes, total.GpuResources, bytes);
+}
+
+MemoryUsage GetMemoryUsage(MemoryTag tag)
+{
+	return Read(counters[tag]);
+}
+
+MemoryUsage GetTotalMemoryUsage()
+{
+	return Read(total);
+}
+
+void SetMemoryBudget(MemoryTag tag, MemoryBudget budget)
+{
+	heapBudgets[tag] = budget.HeapBytes;
+	gpuBudgets[tag] = budget.GpuBytes;
+}
+
+MemoryBudget GetMemoryBudget(MemoryTag tag)
+{
+	return { heapBudgets[tag].load(), gpuBudgets[tag].load() };
+}
+
+bool IsOverMemoryBudget(MemoryTag tag)
+{
+	MemoryUsage usage = GetMemoryUsage(tag);
+	MemoryBudget budget = GetMemoryBudget(tag);
+	return (budget.HeapBytes > 0 && usage.HeapBytes > budget.HeapBytes) ||
+		(budget.GpuBytes > 0 && usage.GpuBytes > budget.GpuBytes);
+}
+
+// --------------------------------------------------------
+// One line per tag, then the total.  Sizes are in KB, and a
+// budget of "-" means there isn't one.
+// --------------------------------------------------------
+bool WriteMemoryReport(const char* path)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	char line[256];
+	auto budgetText = [](char* text, size_t size, unsigned long long budget) {
+		if (budget > 0)
+			snprintf(text, size, "%llu", budget / 1024);
+		else
+			snprintf(text, size, "-");
+	};
+	auto writeLine = [&](const char* name, const MemoryUsage& usage, const MemoryBudget& budget, const char* note) {
+		char heapBudget[32];
+		char gpuBudget[32];
+		budgetText(heapBudget, sizeof(heapBudget), budget.HeapBytes);
+		budgetText(gpuBudget, sizeof(gpuBudget), budget.GpuBytes);
+		snprintf(line, sizeof(line), "%-16s %12llu %12llu %12s %10llu %12llu %12llu %12s %10llu %s\n", name,
+			usage.HeapBytes / 1024, usage.HeapPeak / 1024, heapBudget, usage.HeapAllocations,
+			usage.GpuBytes / 1024, usage.GpuPeak / 1024, gpuBudget, usage.GpuResources, note);
+		file << line;
+	};
+
+	snprintf(line, sizeof(line), "%-16s %12s %12s %12s %10s %12s %12s %12s %10s\n", "Tag",
+		"Heap KB", "Heap peak", "Heap budget", "Allocs", "GPU KB", "GPU peak", "GPU budget", "Resources");
+	file << line;
+	for (unsigned int tag = 0; tag < MEMORY_TAG_COUNT; tag++)
+	{
+		MemoryTag memoryTag = (MemoryTag)tag;
+		writeLine(GetMemoryTagName(memoryTag), GetMemoryUsage(memoryTag), GetMemoryBudget(memoryTag),
+			IsOverMemoryBudget(memoryTag) ? "OVER BUDGET" : "");
+	}
+	writeLine("Total", GetTotalMemoryUsage(), { 0, 0 }, "");
+	return (bool)file;
+}
+
+unsigned long long EstimateTextureBytes(unsigned int width, unsigned int height, unsigned int arraySize, unsigned int mipLevels,
+	unsigned int bitsPerPixel, bool blockCompressed, unsigned int sampleCount)
+{
+	if (mipLevels == 0)
+	{
+		// The full chain, down to 1x1
+		unsigned int size = std::max(width, height);
+		mipLevels = 1;
+		while (size > 1)
+		{
+			size /= 2;
+			mipLevels++;
+		}
+	}
+
+	unsigned long long bytes = 0;
+	for (unsigned int mip = 0; mip < mipLevels; mip++)
+	{
+		unsigned long long mipWidth = std::max(width >> mip, 1u);
+		unsigned long long mipHeight = std::max(height >> mip, 1u);
+		if (blockCompressed)
+			bytes += ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * bitsPerPixel * 16 / 8;
+		else
+			bytes += mipWidth * mipHeight * bitsPerPixel / 8;
+	}
+	return bytes * std::max(arraySize, 1u) * std::max(sampleCount, 1u);
+}
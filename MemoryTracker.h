@@ -0,0 +1,88 @@
+#pragma once
+
+// Keeps count of the memory each part of the game is using, on the heap and (roughly) on the GPU
+// - MEMORY_SCOPE(MEMORY_MESH) tags every heap allocation the current thread makes for the rest of the block.  Frees are
+//   counted against whatever tag the memory was allocated under, whichever scope they happen in.
+// - The heap side only counts anything when AllocationCounter.cpp (which replaces operator new) is linked in
+// - GPU resources are counted from an estimate of their size, worked out from their descriptions (see
+//   MemoryTrackerD3D11.h): the real size depends on how the driver lays them out, so it's usually a little more
+// - Keeps a live and a peak count for each tag, checks them against budgets, and can write them all out to a file
+// - Counting is lock free and never allocates (it's called from operator new).  No Windows/D3D, so it can be
+//   checked by the offline tools.
+
+#define MEMORY_SCOPE_NAME_INNER(line) memoryScope##line
+#define MEMORY_SCOPE_NAME(line) MEMORY_SCOPE_NAME_INNER(line)
+#define MEMORY_SCOPE(tag) MemoryScope MEMORY_SCOPE_NAME(__LINE__)(tag)
+
+enum MemoryTag
+{
+	MEMORY_OTHER,			// Anything allocated outside a scope
+	MEMORY_MESH,
+	MEMORY_MATERIAL,
+	MEMORY_SIMPLE_SHADER,
+	MEMORY_SKY,
+	MEMORY_TEXTURES,
+	MEMORY_RENDER_TARGETS,
+	MEMORY_IMGUI,
+	MEMORY_TAG_COUNT
+};
+
+struct MemoryUsage
+{
+	unsigned long long HeapBytes;
+	unsigned long long HeapPeak;
+	unsigned long long HeapAllocations;	// Still live
+	unsigned long long GpuBytes;
+	unsigned long long GpuPeak;
+	unsigned long long GpuResources;	// Still live
+};
+
+// Zero means no budget
+struct MemoryBudget
+{
+	unsigned long long HeapBytes;
+	unsigned long long GpuBytes;
+};
+
+// Tags the heap allocations made by this thread while it's alive
+class MemoryScope
+{
+public:
+	MemoryScope(MemoryTag tag);
+	~MemoryScope();
+
+	MemoryScope(const MemoryScope&) = delete;
+	MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+	MemoryTag previous;
+};
+
+// The tag this thread's allocations are getting
+MemoryTag GetMemoryTag();
+const char* GetMemoryTagName(MemoryTag tag);
+
+// Called by operator new and delete (AllocationCounter.cpp)
+void TrackHeapAllocation(MemoryTag tag, unsigned long long bytes);
+void TrackHeapFree(MemoryTag tag, unsigned long long bytes);
+
+// A GPU resource was made or destroyed (MemoryTrackerD3D11.h does both for D3D11 resources)
+void TrackGpuAllocation(MemoryTag tag, unsigned long long bytes);
+void TrackGpuFree(MemoryTag tag, unsigned long long bytes);
+
+MemoryUsage GetMemoryUsage(MemoryTag tag);
+// Every tag together.  The peaks are of the total, not the sum of each tag's peak.
+MemoryUsage GetTotalMemoryUsage();
+
+void SetMemoryBudget(MemoryTag tag, MemoryBudget budget);
+MemoryBudget GetMemoryBudget(MemoryTag tag);
+// Whether a tag's live (not peak) heap or GPU use is over its budget
+bool IsOverMemoryBudget(MemoryTag tag);
+
+// A table of every tag's use against its budget.  Returns false if the file couldn't be written.
+bool WriteMemoryReport(const char* path);
+
+// The bytes a texture's mips take: every mip of every array slice (cube faces are slices), mipLevels of 0 meaning
+// the full chain.  Block compressed formats take bitsPerPixel * 16 / 8 bytes for every 4x4 block, rounded up.
+unsigned long long EstimateTextureBytes(unsigned int width, unsigned int height, unsigned int arraySize, unsigned int mipLevels,
+	unsigned int bitsPerPixel, bool blockCompressed, unsigned int sampleCount = 1);
@@ -0,0 +1,246 @@
+#include "MemoryTrackerD3D11.h"
+
+#include <atomic>
+#include <wrl/client.h>
+
+namespace
+{
+	// {5B0C8F3A-7E21-4C6D-9A44-2D1F6E8B3C57}
+	const GUID MemoryTrackerGuid = { 0x5b0c8f3a, 0x7e21, 0x4c6d, { 0x9a, 0x44, 0x2d, 0x1f, 0x6e, 0x8b, 0x3c, 0x57 } };
+
+	// Set as a resource's private data, which holds a reference to it until the resource is destroyed
+	class GpuAllocation final : public IUnknown
+	{
+	public:
+		GpuAllocation(MemoryTag tag, unsigned long long bytes)
+			: references(1), tag(tag), bytes(bytes)
+		{
+			TrackGpuAllocation(tag, bytes);
+		}
+
+		~GpuAllocation()
+		{
+			TrackGpuFree(tag, bytes);
+		}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+		{
+			if (riid != __uuidof(IUnknown))
+			{
+				*object = nullptr;
+				return E_NOINTERFACE;
+			}
+			AddRef();
+			*object = this;
+			return S_OK;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override
+		{
+			return ++references;
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG left = --references;
+			if (left == 0)
+				delete this;
+			return left;
+		}
+
+	private:
+		std::atomic<ULONG> references;
+		MemoryTag tag;
+		unsigned long long bytes;
+	};
+}
+
+unsigned int GetFormatBitsPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+		return 64;
+
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+		return 32;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+		return 16;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+		return 8;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	case DXGI_FORMAT_UNKNOWN:
+		return 0;
+
+	// Everything else in use here (RGBA8, R32, depth/stencil, 10:10:10:2, 11:11:10...) is 32 bits
+	default:
+		return 32;
+	}
+}
+
+bool IsBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+unsigned long long EstimateResourceBytes(ID3D11Resource* resource)
+{
+	D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	resource->GetType(&dimension);
+
+	switch (dimension)
+	{
+	case D3D11_RESOURCE_DIMENSION_BUFFER:
+	{
+		D3D11_BUFFER_DESC desc = {};
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+		return desc.ByteWidth;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+	{
+		D3D11_TEXTURE1D_DESC desc = {};
+		static_cast<ID3D11Texture1D*>(resource)->GetDesc(&desc);
+		return EstimateTextureBytes(desc.Width, 1, desc.ArraySize, desc.MipLevels,
+			GetFormatBitsPerPixel(desc.Format), IsBlockCompressed(desc.Format));
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+	{
+		D3D11_TEXTURE2D_DESC desc = {};
+		static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+		return EstimateTextureBytes(desc.Width, desc.Height, desc.ArraySize, desc.MipLevels,
+			GetFormatBitsPerPixel(desc.Format), IsBlockCompressed(desc.Format), desc.SampleDesc.Count);
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+	{
+		// Each mip is half as deep as the last, so it's added up a slice at a time like an array that shrinks
+		D3D11_TEXTURE3D_DESC desc = {};
+		static_cast<ID3D11Texture3D*>(resource)->GetDesc(&desc);
+		unsigned int mipLevels = desc.MipLevels;
+		if (mipLevels == 0)
+			mipLevels = 32;
+
+		unsigned long long bytes = 0;
+		for (unsigned int mip = 0; mip < mipLevels; mip++)
+		{
+			unsigned int width = desc.Width >> mip;
+			unsigned int height = desc.Height >> mip;
+			unsigned int depth = desc.Depth >> mip;
+			if (width == 0 && height == 0 && depth == 0)
+				break;
+			bytes += EstimateTextureBytes(width ? width : 1, height ? height : 1, depth ? depth : 1, 1,
+				GetFormatBitsPerPixel(desc.Format), IsBlockCompressed(desc.Format));
+		}
+		return bytes;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+void TrackGpuResource(ID3D11Resource* resource, MemoryTag tag)
+{
+	if (!resource)
+		return;
+
+	// Already tracked?
+	IUnknown* existing = nullptr;
+	UINT size = sizeof(existing);
+	if (SUCCEEDED(resource->GetPrivateData(MemoryTrackerGuid, &size, &existing)) && existing)
+	{
+		existing->Release();
+		return;
+	}
+
+	// The resource takes its own reference, so this one's given up straight away
+	GpuAllocation* allocation = new GpuAllocation(tag, EstimateResourceBytes(resource));
+	resource->SetPrivateDataInterface(MemoryTrackerGuid, allocation);
+	allocation->Release();
+}
+
+void TrackGpuResource(ID3D11View* view, MemoryTag tag)
+{
+	if (!view)
+		return;
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	view->GetResource(resource.GetAddressOf());
+	TrackGpuResource(resource.Get(), tag);
+}
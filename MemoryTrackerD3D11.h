@@ -0,0 +1,23 @@
+#pragma once
+
+// The MemoryTracker's D3D11 side
+// - Works out roughly how many bytes a buffer or texture takes from its description
+// - TrackGpuResource() counts a resource under a tag, and stops counting it when the runtime destroys it
+//   (a small object set as the resource's private data is released along with it), so there's nothing to
+//   call when it's released
+
+#include "MemoryTracker.h"
+
+#include <d3d11.h>
+
+unsigned int GetFormatBitsPerPixel(DXGI_FORMAT format);
+// Block compressed formats' bits per pixel are for each pixel of a 4x4 block
+bool IsBlockCompressed(DXGI_FORMAT format);
+
+// Every mip and slice of a texture, or a buffer's width.  0 for anything else.
+unsigned long long EstimateResourceBytes(ID3D11Resource* resource);
+
+// Resources already being tracked are left under the tag they have
+void TrackGpuResource(ID3D11Resource* resource, MemoryTag tag);
+// The resource a view is of
+void TrackGpuResource(ID3D11View* view, MemoryTag tag);
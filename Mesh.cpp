@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include "MemoryTrackerD3D11.h"
 #include <fstream>
 #include <vector>
 #include <DirectXMath.h>
@@ -13,6 +14,7 @@ Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCo
 
 Mesh::Mesh(const wchar_t* filename, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
+	MEMORY_SCOPE(MEMORY_MESH);
 	indexCount = 0;
 	// Author: Chris Cascioli
 	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
@@ -227,8 +229,13 @@ Mesh::~Mesh()
 
 void Mesh::Init(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
+	MEMORY_SCOPE(MEMORY_MESH);
 	CalculateTangents(vertices, vertexCount, indices, indexCount);
 
+	bounds = EmptyAABB();
+	for (int i = 0; i < vertexCount; i++)
+		GrowAABB(bounds, vertices[i].Position);
+
 	// Below code mostly copied from Game.cpp starter code
 
 	{
@@ -252,6 +259,7 @@ void Mesh::Init(Vertex* vertices, int vertexCount, unsigned int* indices, int in
 		// Actually create the buffer on the GPU with the initial data
 		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
 		device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+		TrackGpuResource(vertexBuffer.Get(), MEMORY_MESH);
 	}
 
 	// Create an INDEX BUFFER
@@ -276,6 +284,7 @@ void Mesh::Init(Vertex* vertices, int vertexCount, unsigned int* indices, int in
 		// Actually create the buffer with the initial data
 		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 		device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+		TrackGpuResource(indexBuffer.Get(), MEMORY_MESH);
 	}
 }
 
@@ -294,6 +303,11 @@ unsigned int Mesh::GetIndexCount()
 	return indexCount;
 }
 
+AABB Mesh::GetBounds()
+{
+	return bounds;
+}
+
 void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
 	// Below code mostly copied from Game.cpp starter code
@@ -318,6 +332,14 @@ void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 	}
 }
 
+void Mesh::Draw(CommandBuffer& commands)
+{
+	// Same as above, for whichever executor runs the commands
+	commands.SetVertexBuffer(vertexBuffer.Get(), sizeof(Vertex), 0);
+	commands.SetIndexBuffer(indexBuffer.Get());
+	commands.DrawIndexed(indexCount, 0, 0);
+}
+
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Calculates the tangents of the vertices in a mesh
@@ -7,6 +7,8 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include "Vertex.h"
+#include "Bounds.h"
+#include "CommandBuffer.h"
 
 class Mesh
 {
@@ -37,15 +39,25 @@ public:
 	/// <returns>The number of indices in this mesh</returns>
 	unsigned int GetIndexCount();
 	/// <summary>
+	/// Returns the box around every vertex of this mesh
+	/// </summary>
+	/// <returns>This mesh's local space bounds</returns>
+	AABB GetBounds();
+	/// <summary>
 	/// Draws this mesh
 	/// </summary>
 	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	/// <summary>
+	/// Records the commands to draw this mesh
+	/// </summary>
+	void Draw(CommandBuffer& commands);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 
 	unsigned int indexCount;
+	AABB bounds;
 
 	void Init(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
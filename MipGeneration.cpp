@@ -0,0 +1,208 @@
+#include "MipGeneration.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_USE_SSE2
+#endif
+
+namespace
+{
+	// One level of one face, as linear RGBA floats
+	struct FloatImage
+	{
+		unsigned int Width = 0;
+		unsigned int Height = 0;
+		std::vector<float> Pixels;
+	};
+
+	FloatImage ToFloat(const ImageData& image, MipContent content)
+	{
+		// Every 8 bit value maps to one float, so just build a table per channel type
+		float colorTable[256];
+		float dataTable[256];
+		for (int i = 0; i < 256; i++)
+		{
+			float value = i / 255.0f;
+			dataTable[i] = value;
+			switch (content)
+			{
+			case MIP_CONTENT_GAMMA:			colorTable[i] = powf(value, MIP_GAMMA); break;
+			case MIP_CONTENT_NORMAL_MAP:	colorTable[i] = value * 2.0f - 1.0f; break;
+			default:						colorTable[i] = value; break;
+			}
+		}
+
+		FloatImage result;
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Pixels.resize(image.Pixels.size());
+		for (size_t i = 0; i < image.Pixels.size(); i += 4)
+		{
+			result.Pixels[i + 0] = colorTable[image.Pixels[i + 0]];
+			result.Pixels[i + 1] = colorTable[image.Pixels[i + 1]];
+			result.Pixels[i + 2] = colorTable[image.Pixels[i + 2]];
+			result.Pixels[i + 3] = dataTable[image.Pixels[i + 3]]; // Alpha is never gamma corrected
+		}
+		return result;
+	}
+
+	unsigned char Quantize(float value)
+	{
+		return (unsigned char)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	// --------------------------------------------------------
+	// Averages each 2x2 square of one source row pair into one
+	// destination row, then writes the 8 bit version of it.
+	// Odd sizes just clamp, so the last texel is reused.
+	// --------------------------------------------------------
+	void FilterRow(const FloatImage& source, FloatImage& dest, ImageData& destBytes, unsigned int y, MipContent content)
+	{
+		unsigned int y0 = std::min(y * 2, source.Height - 1);
+		unsigned int y1 = std::min(y * 2 + 1, source.Height - 1);
+		const float* row0 = &source.Pixels[(size_t)y0 * source.Width * 4];
+		const float* row1 = &source.Pixels[(size_t)y1 * source.Width * 4];
+		float* out = &dest.Pixels[(size_t)y * dest.Width * 4];
+		unsigned char* outBytes = &destBytes.Pixels[(size_t)y * dest.Width * 4];
+
+		for (unsigned int x = 0; x < dest.Width; x++)
+		{
+			unsigned int x0 = std::min(x * 2, source.Width - 1) * 4;
+			unsigned int x1 = std::min(x * 2 + 1, source.Width - 1) * 4;
+			float* pixel = &out[x * 4];
+
+			// Each pixel is exactly one RGBA register
+#ifdef MIP_USE_SSE2
+			__m128 sum = _mm_add_ps(
+				_mm_add_ps(_mm_loadu_ps(&row0[x0]), _mm_loadu_ps(&row0[x1])),
+				_mm_add_ps(_mm_loadu_ps(&row1[x0]), _mm_loadu_ps(&row1[x1])));
+			_mm_storeu_ps(pixel, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+			for (int ch = 0; ch < 4; ch++)
+				pixel[ch] = (row0[x0 + ch] + row0[x1 + ch] + row1[x0 + ch] + row1[x1 + ch]) * 0.25f;
+#endif
+
+			unsigned char* pixelBytes = &outBytes[x * 4];
+			switch (content)
+			{
+			case MIP_CONTENT_GAMMA:
+				for (int ch = 0; ch < 3; ch++)
+					pixelBytes[ch] = Quantize(powf(pixel[ch], 1.0f / MIP_GAMMA));
+				break;
+
+			case MIP_CONTENT_NORMAL_MAP:
+			{
+				// Averaged normals get shorter, so push them back out to unit length
+				float length = sqrtf(pixel[0] * pixel[0] + pixel[1] * pixel[1] + pixel[2] * pixel[2]);
+				if (length > 0.0001f)
+				{
+					for (int ch = 0; ch < 3; ch++)
+						pixel[ch] /= length;
+				}
+				for (int ch = 0; ch < 3; ch++)
+					pixelBytes[ch] = Quantize(pixel[ch] * 0.5f + 0.5f);
+				break;
+			}
+
+			default:
+				for (int ch = 0; ch < 3; ch++)
+					pixelBytes[ch] = Quantize(pixel[ch]);
+				break;
+			}
+			pixelBytes[3] = Quantize(pixel[3]);
+		}
+	}
+}
+
+
+unsigned int CalculateMipCount(unsigned int width, unsigned int height)
+{
+	unsigned int count = 1;
+	for (unsigned int size = std::max(width, height); size > 1; size /= 2)
+		count++;
+	return count;
+}
+
+
+std::vector<ImageData> GenerateMipChain(const ImageData& image, MipContent content, unsigned int threadCount)
+{
+	std::vector<std::vector<ImageData>> chains = GenerateMipChains({ image }, content, threadCount);
+	return chains.empty() ? std::vector<ImageData>() : chains[0];
+}
+
+
+// --------------------------------------------------------
+// Each level depends on the one above it, so levels are done
+// in order, but every row of every face within a level is
+// independent.  Those rows are handed out to threads through
+// a shared counter, the same way the block compressor works.
+// --------------------------------------------------------
+std::vector<std::vector<ImageData>> GenerateMipChains(const std::vector<ImageData>& faces, MipContent content, unsigned int threadCount)
+{
+	if (faces.empty() || !faces[0].IsValid())
+		return {};
+	for (const ImageData& face : faces)
+	{
+		if (!face.IsValid() || face.Width != faces[0].Width || face.Height != faces[0].Height)
+			return {};
+	}
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	unsigned int mipCount = CalculateMipCount(faces[0].Width, faces[0].Height);
+	std::vector<std::vector<ImageData>> chains(faces.size());
+	std::vector<FloatImage> previous(faces.size());
+	std::vector<FloatImage> current(faces.size());
+	for (size_t f = 0; f < faces.size(); f++)
+	{
+		chains[f].reserve(mipCount);
+		chains[f].push_back(faces[f]);
+		previous[f] = ToFloat(faces[f], content);
+	}
+
+	for (unsigned int mip = 1; mip < mipCount; mip++)
+	{
+		unsigned int width = std::max(1u, previous[0].Width / 2);
+		unsigned int height = std::max(1u, previous[0].Height / 2);
+		for (size_t f = 0; f < faces.size(); f++)
+		{
+			current[f].Width = width;
+			current[f].Height = height;
+			current[f].Pixels.resize((size_t)width * height * 4);
+
+			ImageData level;
+			level.Width = width;
+			level.Height = height;
+			level.Pixels.resize((size_t)width * height * 4);
+			chains[f].push_back(std::move(level));
+		}
+
+		unsigned int totalRows = height * (unsigned int)faces.size();
+		std::atomic<unsigned int> nextRow(0);
+		auto worker = [&]() {
+			for (unsigned int row = nextRow++; row < totalRows; row = nextRow++)
+			{
+				unsigned int face = row / height;
+				FilterRow(previous[face], current[face], chains[face][mip], row % height, content);
+			}
+		};
+
+		// Not worth spinning up threads for the tiny levels
+		unsigned int levelThreads = std::min(threadCount, std::max(1u, totalRows / 32));
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < levelThreads; i++)
+			threads.emplace_back(worker);
+		worker(); // This thread helps too
+		for (std::thread& thread : threads)
+			thread.join();
+
+		std::swap(previous, current);
+	}
+	return chains;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// CPU mipmap chain generation for texture assets
+// - 2x2 box filter, done in linear space on floats so error doesn't build up level to level
+// - Rows (of every face at once, for cube maps) are filtered in parallel, with SSE2 where available
+
+#include "ImageData.h"
+
+#include <vector>
+
+// How the 8 bit values in an image should be interpreted while filtering
+enum MipContent
+{
+	MIP_CONTENT_LINEAR,		// Plain data (roughness, metalness, packed maps)
+	MIP_CONTENT_GAMMA,		// Gamma encoded color (albedo, sky); filtered after un-gamma correcting
+	MIP_CONTENT_NORMAL_MAP	// Tangent space normals in RGB; renormalized after filtering
+};
+
+// The gamma our shaders assume when un-gamma correcting color textures
+#define MIP_GAMMA 2.2f
+
+// Number of levels in a full chain, down to 1x1
+unsigned int CalculateMipCount(unsigned int width, unsigned int height);
+
+// Builds a full mip chain.  Element 0 is the source image itself.  Zero threads means "one per hardware thread".
+std::vector<ImageData> GenerateMipChain(const ImageData& image, MipContent content, unsigned int threadCount = 0);
+
+// Builds full chains for several same-sized images (e.g. the six faces of a cube map) together.
+// Returns an empty vector if the faces don't all match.  Indexed [face][mip].
+std::vector<std::vector<ImageData>> GenerateMipChains(const std::vector<ImageData>& faces, MipContent content, unsigned int threadCount = 0);
@@ -39,10 +39,13 @@ float4 main(VertexToPixel input) : SV_TARGET
 
 		float3 lightDirection = lights[i].direction;
 		float attenuation = 1.0;
-		if (lights[i].type == 1) {
+		if (lights[i].type != LIGHT_TYPE_DIRECTIONAL) {
 			lightDirection = normalize(input.worldPosition - lights[i].position);
 			attenuation = Attenuate(lights[i], input.worldPosition);
 		}
+		if (lights[i].type == LIGHT_TYPE_SPOT) {
+			attenuation *= SpotAmount(lights[i], -lightDirection);
+		}
 
 		diffuse += CalculateDiffuse(input.normal, lightDirection) * attenuation;
 		specular += CalculateSpecular(lights[i], input.normal, viewVector, roughness, lightDirection) * attenuation * pixelSpecular;
@@ -1,28 +1,25 @@
 #include "ShaderIncludes.hlsli"
 
+#define MAX_BLUR_TAPS 8	// Must match Blur.h
+
+// One direction of a separable box blur.  Run across, then down.
 cbuffer ExternalData : register(b0) {
-	int blurRadius;		// in pixel units
-	float pixelWidth;	// in UV space units
-	float pixelHeight;	// in UV space units
+	float2 direction;			// One texel along the blur, in UV space units
+	int tapCount;
+	float4 taps[MAX_BLUR_TAPS];	// x = offset in texels, y = weight.  Tap 0 is the center, the rest are mirrored.
 }
 
 Texture2D Screen			: register(t0);
-SamplerState ClampSampler	: register(s0);
+SamplerState ClampSampler	: register(s0);	// Must be bilinear: most taps land between two texels to read both
 
 float4 main(VertexToPixel_Fullscreen input) : SV_TARGET
 {
-	float4 pixelColor = 0;
-	int sampleCount = 0;
-
-	for (int x = -blurRadius; x <= blurRadius; x++) {
-		for (int y = -blurRadius; y <= blurRadius; y++) {
-			float2 uv = input.uv + float2(x * pixelWidth, y * pixelHeight);
+	float4 pixelColor = Screen.Sample(ClampSampler, input.uv) * taps[0].y;
 
-			pixelColor += Screen.Sample(ClampSampler, uv);
-			sampleCount++;
-		}
+	for (int i = 1; i < tapCount; i++) {
+		float2 offset = direction * taps[i].x;
+		pixelColor += (Screen.Sample(ClampSampler, input.uv + offset) + Screen.Sample(ClampSampler, input.uv - offset)) * taps[i].y;
 	}
 
-	// Averaging color across all pixels sampled
-	return pixelColor / sampleCount;
-}
\ No newline at end of file
+	return pixelColor;
+}
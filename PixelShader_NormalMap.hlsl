@@ -1,14 +1,31 @@
 #include "ShaderIncludes.hlsli"
 
-#define MAX_LIGHTS 5
+#define MAX_SHADOW_CASCADES 4	// Must match ShadowCascades.h
+#define LIGHT_CLUSTERS_X 16		// Must match LightClusters.h
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
 
 cbuffer ExternalData : register(b0) {
 	float4 colorTint;
 	float3 cameraPos;		// The position of the current camera in world space
-	int numLights;			// Specular constant based on mesh material
-	Light lights[MAX_LIGHTS];
+	int globalLightCount;	// Lights that reach every pixel (directional), listed first in LightIndices
+
+	matrix shadowViewProjections[MAX_SHADOW_CASCADES];
+	float4 cascadeEnds;		// View space depth where each cascade stops
+	int cascadeCount;
+
+	float2 clusterTileSize;		// Pixels across each cluster's tile of the screen
+	float clusterDepthScale;	// A pixel's depth slice is log(viewDepth) * scale + bias
+	float clusterDepthBias;
 }
 
+// One tile of the shadow atlas (matches ShadowAtlas.h)
+struct ShadowAtlasEntry
+{
+	matrix viewProjection;
+	float4 atlasRect;		// UV offset (xy) and size (zw) of the tile within the atlas
+};
+
 struct PS_Output
 {
 	float4 color		: SV_TARGET0; // Render Target index 0
@@ -17,34 +34,125 @@ struct PS_Output
 
 
 Texture2D AlbedoTexture		: register(t0);	// "t" registers for textures
+#ifdef PACKED_ORM
+Texture2D ORMMap			: register(t1); // R = occlusion, G = roughness, B = metalness
+#else
 Texture2D RoughnessMap		: register(t1);
+#endif
 Texture2D NormalMap			: register(t2);
+#ifndef PACKED_ORM
 Texture2D MetalnessMap		: register(t3);
-Texture2D ShadowMap			: register(t4);
+#endif
+Texture2DArray ShadowMap	: register(t4);	// One slice per cascade
+StructuredBuffer<ShadowAtlasEntry> ShadowAtlasEntries : register(t5);
+Texture2D ShadowAtlas		: register(t6);	// Shadow maps of every other shadowed light
+StructuredBuffer<Light> Lights			: register(t7);
+StructuredBuffer<uint2> LightClusters	: register(t8);	// Offset and count of each cluster's run of LightIndices
+StructuredBuffer<uint> LightIndices		: register(t9);
 SamplerState BasicSampler	: register(s0);	// "s" registers for samplers
 SamplerComparisonState ShadowSampler : register(s1);
 
 
+// Reads a point or spot light's shadow from its tile of the atlas (point lights have six, one per cube face)
+float SampleShadowAtlas(Light light, float3 worldPosition)
+{
+	int entryIndex = light.shadowIndex;
+	if (light.type == LIGHT_TYPE_POINT)
+	{
+		// Pick the cube face, in +X -X +Y -Y +Z -Z order
+		float3 fromLight = worldPosition - light.position;
+		float3 distances = abs(fromLight);
+		if (distances.x >= distances.y && distances.x >= distances.z)
+			entryIndex += fromLight.x < 0 ? 1 : 0;
+		else if (distances.y >= distances.z)
+			entryIndex += fromLight.y < 0 ? 3 : 2;
+		else
+			entryIndex += fromLight.z < 0 ? 5 : 4;
+	}
+	ShadowAtlasEntry entry = ShadowAtlasEntries[entryIndex];
+
+	float4 shadowMapPos = mul(entry.viewProjection, float4(worldPosition, 1.0f));
+	shadowMapPos /= shadowMapPos.w; // These are perspective projections
+	if (shadowMapPos.z > 1.0f)
+		return 1.0f; // Out of the light's range, so it isn't lighting this anyway
+
+	float2 shadowUV = shadowMapPos.xy * 0.5f + 0.5f;
+	shadowUV.y = 1 - shadowUV.y;
+
+	// Move into the tile, staying half a texel inside so filtering never reads a neighbor
+	float2 atlasSize;
+	ShadowAtlas.GetDimensions(atlasSize.x, atlasSize.y);
+	float2 halfTexel = 0.5f / atlasSize;
+	float2 atlasUV = clamp(entry.atlasRect.xy + shadowUV * entry.atlasRect.zw, entry.atlasRect.xy + halfTexel, entry.atlasRect.xy + entry.atlasRect.zw - halfTexel);
+	return ShadowAtlas.SampleCmpLevelZero(ShadowSampler, atlasUV, shadowMapPos.z).r;
+}
+
+
+// One light's diffuse and specular at this pixel, shadowed if the light has a shadow map
+float3 CalculateLight(Light light, float3 worldPosition, float3 normal, float3 viewVector,
+	float3 albedo, float roughness, float metalness, float3 fresnelAt0, float cascadeShadow)
+{
+	float3 directionToLight = -light.direction;
+	float intensity = light.intensity;
+	if (light.type != LIGHT_TYPE_DIRECTIONAL) {
+		directionToLight = light.position - worldPosition;
+		intensity *= Attenuate(light, worldPosition); // Reaches zero at the light's range, where the clusters stop listing it
+	}
+	directionToLight = normalize(directionToLight);
+	if (light.type == LIGHT_TYPE_SPOT)
+		intensity *= SpotAmount(light, directionToLight); // Likewise at the edge of the cone
+
+	float3 diffuse = CalculateDiffuse(normal, directionToLight); // diffuse component for this pixel
+	float3 fresnel;
+	float3 specular = MicrofacetBRDF(normal, directionToLight, viewVector, roughness, fresnelAt0, fresnel); // specular component for this pixel
+	diffuse = DiffuseEnergyConserve(diffuse, fresnel, metalness);
+
+	float3 lightColor = (diffuse * albedo + specular) * intensity * light.color;
+
+	// Shadowed directional lights use the cascades, every other shadowed light has part of the atlas
+	if (light.shadowIndex >= 0)
+	{
+		if (light.type == LIGHT_TYPE_DIRECTIONAL)
+			lightColor *= cascadeShadow;
+		else
+			lightColor *= SampleShadowAtlas(light, worldPosition);
+	}
+	return lightColor;
+}
+
+
 PS_Output main(VertexToPixel_NormalMap input)
 {
 	PS_Output output;
 	// ========== SHADOW MAPPING CODE ==========
-	// Perform the perspective divide (divide by W) ourselves as the rasterizer will not do it automatically
-	input.shadowMapPos /= input.shadowMapPos.w;
-	// Convert the normalized device coordinates to UVs for sampling
-	float2 shadowUV = input.shadowMapPos.xy * 0.5f + 0.5f;
-	shadowUV.y = 1 - shadowUV.y; // Flip the Y since UVs have an opposite Y axis
-	
-	float distToLight = input.shadowMapPos.z; // Distance from the light to this surface
-	// Get a ratio of comparison results using SampleCmpLevelZero()
-	float shadowAmount = ShadowMap.SampleCmpLevelZero(
-		ShadowSampler,
-		shadowUV,
-		distToLight).r;
+	// Pick the first cascade that reaches this far from the camera.  Anything past the last one is unshadowed.
+	int cascade = 0;
+	while (cascade < cascadeCount && input.viewDepth > cascadeEnds[cascade])
+		cascade++;
+
+	float cascadeShadow = 1.0f;
+	if (cascade < cascadeCount)
+	{
+		// Light projections are orthographic, so there's no need to divide by W
+		float4 shadowMapPos = mul(shadowViewProjections[cascade], float4(input.worldPosition, 1.0f));
+		// Convert the normalized device coordinates to UVs for sampling
+		float2 shadowUV = shadowMapPos.xy * 0.5f + 0.5f;
+		shadowUV.y = 1 - shadowUV.y; // Flip the Y since UVs have an opposite Y axis
+
+		float distToLight = shadowMapPos.z; // Distance from the light to this surface
+		// Get a ratio of comparison results using SampleCmpLevelZero()
+		cascadeShadow = ShadowMap.SampleCmpLevelZero(
+			ShadowSampler,
+			float3(shadowUV, cascade),
+			distToLight).r;
+	}
 	
 	// ========== NON-SHADOW CODE ==========
 	// Normal map code
-	float3 textureNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1;
+	// Only X and Y are read (normal maps are BC5 compressed), Z is rebuilt from them
+	float3 textureNormal;
+	textureNormal.xy = NormalMap.Sample(BasicSampler, input.uv).rg * 2 - 1;
+	textureNormal.z = sqrt(saturate(1 - dot(textureNormal.xy, textureNormal.xy)));
 	textureNormal = normalize(textureNormal);
 
 	float3x3 TBN = CalculateTBN(normalize(input.normal), normalize(input.tangent));
@@ -52,40 +160,37 @@ PS_Output main(VertexToPixel_NormalMap input)
 
 	// Texture code
 	float3 albedo = pow(AlbedoTexture.Sample(BasicSampler, input.uv).rgb, 2.2f) * colorTint.rgb; // un-gamma correcting
+#ifdef PACKED_ORM
+	// One fetch for all three scalar maps (occlusion in .r is unused until we have an ambient term)
+	float3 orm = ORMMap.Sample(BasicSampler, input.uv).rgb;
+	float roughness = orm.g;
+	float metalness = orm.b;
+#else
 	float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
 	float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+#endif
 
 	float3 fresnelAt0 = lerp(F0_NON_METAL, albedo.rgb, metalness); // Metals' f0 value is stored in albedo textures, nonmetals' is a constant
 
 	// Vector code
 	float3 viewVector = normalize(cameraPos - input.worldPosition);
 
-	float3 totalColor;
+	float3 totalColor = 0;
 
 	// Using BRDFs
-	for (int i = 0; i < numLights; i++) {
-		float3 directionToLight = -lights[i].direction;
-		float intensity = lights[i].intensity;
-		if (lights[i].type == 1) { // Values for point lights
-			directionToLight = lights[i].position - input.worldPosition;
-			intensity *= Attenuate(lights[i], input.worldPosition);
-		}
-		directionToLight = normalize(directionToLight);
-
-		float3 diffuse = CalculateDiffuse(input.normal, directionToLight); // diffuse component for this pixel
-		float3 fresnel;
-		float3 specular = MicrofacetBRDF(input.normal, directionToLight, viewVector, roughness, fresnelAt0, fresnel); // specular component for this pixel
-		diffuse = DiffuseEnergyConserve(diffuse, fresnel, metalness);
-
-		float3 lightColor = (diffuse * albedo + specular) * lights[i].intensity * lights[i].color;
-
-		// Shadow the light results only from the main directional light
-		if (i == 0)
-		{
-			lightColor *= shadowAmount;
-		}
-
-		totalColor += lightColor;
+	// Lights that reach everywhere come first
+	for (int i = 0; i < globalLightCount; i++) {
+		totalColor += CalculateLight(Lights[LightIndices[i]], input.worldPosition, input.normal, viewVector,
+			albedo, roughness, metalness, fresnelAt0, cascadeShadow);
+	}
+
+	// Then only the lights listed for this pixel's cluster
+	uint2 tile = min(uint2(input.screenPosition.xy / clusterTileSize), uint2(LIGHT_CLUSTERS_X - 1, LIGHT_CLUSTERS_Y - 1));
+	uint slice = (uint)clamp(floor(log(input.viewDepth) * clusterDepthScale + clusterDepthBias), 0, LIGHT_CLUSTERS_Z - 1);
+	uint2 cluster = LightClusters[(slice * LIGHT_CLUSTERS_Y + tile.y) * LIGHT_CLUSTERS_X + tile.x];
+	for (uint j = 0; j < cluster.y; j++) {
+		totalColor += CalculateLight(Lights[LightIndices[cluster.x + j]], input.worldPosition, input.normal, viewVector,
+			albedo, roughness, metalness, fresnelAt0, cascadeShadow);
 	}
 
 	// Gamma correcting and returning
@@ -0,0 +1,4 @@
+// Variant of the normal mapped PBR shader that reads occlusion, roughness
+// and metalness from a single packed texture (see TextureProcessing.h)
+#define PACKED_ORM
+#include "PixelShader_NormalMap.hlsl"
@@ -1,12 +1,9 @@
 #include "ShaderIncludes.hlsli"
 
-#define MAX_LIGHTS 5
-
 cbuffer ExternalData : register(b0) {
 	float4 colorTint;
 	float3 cameraPos;		// The position of the current camera in world space
-	int numLights;			// Specular constant based on mesh material
-	Light lights[MAX_LIGHTS];
+	Light sun;				// Only drawn in the sky if it's a directional light
 }
 
 TextureCube SkyTexture	: register(t0);
@@ -25,8 +22,8 @@ PS_Output main(VertexToPixel_Sky input)
 	
 	float sunOverlap = 0;
 
-	if (lights[0].type == LIGHT_TYPE_DIRECTIONAL) {
-        sunOverlap = pow(clamp(dot(lights[0].direction, -normalize(input.sampleDir)), 0, 1), 100);
+	if (sun.type == LIGHT_TYPE_DIRECTIONAL) {
+        sunOverlap = pow(clamp(dot(sun.direction, -normalize(input.sampleDir)), 0, 1), 100);
     }
 	
 	float4 sunAdjustment = sunOverlap * SkyTexture.Sample(SkySampler, input.sampleDir);
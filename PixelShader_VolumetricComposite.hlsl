@@ -0,0 +1,42 @@
+#include "ShaderIncludes.hlsli"
+
+// Adds the reduced resolution light scattering to the scene.  Each pixel blends the four nearest
+// scattering texels like bilinear filtering would, but texels at a different depth count for less,
+// so light doesn't bleed over the edges of things in front of the sun.
+cbuffer ExternalData : register(b0)
+{
+    float2 scatteringSize;  // Texels in the scattering target
+    float nearClip;
+    float farClip;
+    float depthSharpness;   // How quickly a depth difference (relative to this pixel's depth) stops counting
+}
+
+Texture2D Screen			: register(t0);
+Texture2D Scattering		: register(t1);	// rgb = scattered light, a = view depth
+Texture2D Depth				: register(t2);
+SamplerState ClampSampler   : register(s0);
+
+float4 main(VertexToPixel_Fullscreen input) : SV_TARGET
+{
+    float depth = Depth.Load(int3(input.position.xy, 0)).r;
+    float viewDepth = nearClip * farClip / (farClip - depth * (farClip - nearClip));
+
+    float2 texel = input.uv * scatteringSize - 0.5f;
+    float2 corner = floor(texel);
+    float2 blend = texel - corner;
+
+    float3 totalLight = 0;
+    float totalWeight = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int2 offset = int2(i & 1, i >> 1);
+        float4 scattering = Scattering.Load(int3(clamp(corner + offset, 0, scatteringSize - 1), 0));
+        float bilinear = (offset.x ? blend.x : 1 - blend.x) * (offset.y ? blend.y : 1 - blend.y);
+        float difference = abs(scattering.a - viewDepth) / viewDepth;
+        float weight = bilinear / (1 + difference * depthSharpness);
+        totalLight += scattering.rgb * weight;
+        totalWeight += weight;
+    }
+
+    return Screen.Sample(ClampSampler, input.uv) + float4(totalLight / max(totalWeight, 0.0001f), 1);
+}
@@ -1,31 +1,53 @@
 #include "ShaderIncludes.hlsli"
 
+#define MAX_SCATTERING_SAMPLES 64		// Must match LightScattering.h
+#define SCATTERING_REFERENCE_SAMPLES 20
+
+// Light scattering towards the sun, at a reduced resolution.  PixelShader_VolumetricComposite.hlsl
+// scales the result back up.  The math matches ScatterLightReference() in LightScattering.cpp.
 cbuffer ExternalData : register(b0)
 {
-    int numSamples;
     float exposure;
     float weight;
-    float decay;
-    float4 sunPosition; // Location of the sun, in screen coordinates
+    float decay;            // Per step at SCATTERING_REFERENCE_SAMPLES steps
+    float texelsPerSample;  // Step length to aim for, in this target's texels
+    float4 sunPosition;     // Location of the sun, in screen coordinates
+    float2 targetSize;      // Texels in this (reduced) target
+    float occlusionMip;     // SunAndOcclusion mip closest to this target's size
+    int maxSamples;
+    float nearClip;
+    float farClip;
 }
 
-Texture2D Screen			: register(t0);
-Texture2D SunAndOcclusion	: register(t1);
+Texture2D SunAndOcclusion	: register(t0);	// Full size, with mips
+Texture2D Depth				: register(t1);	// The scene's (full size) depth buffer
 SamplerState ClampSampler   : register(s0);
 
+// rgb = scattered light, a = view depth of this texel, for the composite to compare against
 float4 main(VertexToPixel_Fullscreen input) : SV_TARGET
 {
-    float4 totalLight;
     float2 sunUV = sunPosition.xy;
     sunUV.x = (sunUV.x + 1) / 2;
     sunUV.y = (1 - sunUV.y) / 2;
     float2 distanceToSun = sunUV - input.uv;
-    float2 deltaSun = distanceToSun / numSamples;
-    for (int i = 0; i < numSamples; i++)
-    {
-        totalLight += pow(decay, i) * weight * SunAndOcclusion.Sample(ClampSampler, input.uv + deltaSun * i) / numSamples;
 
+    // Further from the sun takes more steps, so they stay about texelsPerSample long
+    int sampleCount = clamp((int)ceil(length(distanceToSun * targetSize) / texelsPerSample), 1, min(maxSamples, MAX_SCATTERING_SAMPLES));
+    float decayPerSample = pow(decay, (float)SCATTERING_REFERENCE_SAMPLES / sampleCount);
+    float sampleWeight = decay > 0.9999f ? weight / sampleCount : weight * (1 - decayPerSample) / (SCATTERING_REFERENCE_SAMPLES * (1 - decay));
+
+    float2 deltaSun = distanceToSun / sampleCount;
+    float3 totalLight = 0;
+    float fade = sampleWeight;
+    for (int i = 0; i < sampleCount; i++)
+    {
+        totalLight += fade * SunAndOcclusion.SampleLevel(ClampSampler, input.uv + deltaSun * i, occlusionMip).rgb;
+        fade *= decayPerSample;
     }
-    totalLight *= exposure;
-    return Screen.Sample(ClampSampler, input.uv) + float4(totalLight.xyz, 1);
-}
\ No newline at end of file
+
+    float2 depthSize;
+    Depth.GetDimensions(depthSize.x, depthSize.y);
+    float depth = Depth.Load(int3(input.uv * depthSize, 0)).r;
+    float viewDepth = nearClip * farClip / (farClip - depth * (farClip - nearClip));
+    return float4(totalLight * exposure, viewDepth);
+}
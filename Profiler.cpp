@@ -0,0 +1,185 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+Profiler::Profiler()
+	: threads(), threadCount(0), history(PROFILER_HISTORY_FRAMES), newestFrame(0), frameCount(0), paused(false)
+{
+	firstTimestamp = ProfilerTimestamp();
+	firstTime = std::chrono::steady_clock::now();
+	frameStart = firstTimestamp;
+
+	// Until there's been long enough to measure it
+#ifdef PROFILER_USE_TIMESTAMP_COUNTER
+	ticksPerSecond = 3e9;
+#else
+	ticksPerSecond = (double)std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+}
+
+Profiler::~Profiler()
+{
+	for (unsigned int t = 0; t < threadCount; t++)
+		delete threads[t];
+}
+
+ProfilerThread* Profiler::RegisterThread()
+{
+	ProfilerThread* thread = new ProfilerThread();
+	std::lock_guard<std::mutex> lock(registerMutex);
+	thread->Index = threadCount;
+
+	// Past the limit a thread still records (so zones don't need checking), but nothing collects it
+	if (threadCount < PROFILER_MAX_THREADS)
+	{
+		threads[threadCount] = thread;
+		threadCount.store(threadCount + 1, std::memory_order_release);
+	}
+	return thread;
+}
+
+// --------------------------------------------------------
+// Copies each thread's new zones out of its ring.  The
+// thread may be writing while this reads, so once they're
+// copied the ring's position is checked again: anything
+// the thread could have lapped since (and so overwritten
+// mid-copy) is thrown away, the same as zones that were
+// already gone before the copy started.
+// --------------------------------------------------------
+void Profiler::EndFrame()
+{
+	unsigned long long now = ProfilerTimestamp();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - firstTime).count();
+	if (seconds > 0.1)
+		ticksPerSecond = (now - firstTimestamp) / seconds;
+
+	unsigned int count = threadCount.load(std::memory_order_acquire);
+	if (paused)
+	{
+		for (unsigned int t = 0; t < count; t++)
+			threads[t]->Read = threads[t]->Written.load(std::memory_order_acquire);
+		frameStart = now;
+		return;
+	}
+
+	ProfilerFrame& frame = history[(newestFrame + 1) % PROFILER_HISTORY_FRAMES];
+	frame.Events.clear();
+	frame.ThreadCount = 0;
+	frame.Dropped = 0;
+	for (unsigned int t = 0; t < count; t++)
+	{
+		ProfilerThread* thread = threads[t];
+		unsigned long long written = thread->Written.load(std::memory_order_acquire);
+		unsigned long long first = thread->Read;
+		if (written - first > PROFILER_EVENTS_PER_THREAD)
+			first = written - PROFILER_EVENTS_PER_THREAD;
+
+		size_t copied = frame.Events.size();
+		for (unsigned long long i = first; i < written; i++)
+			frame.Events.push_back(thread->Events[i & (PROFILER_EVENTS_PER_THREAD - 1)]);
+
+		// The thread might be writing event "lapped" right now, into the slot of lapped - PROFILER_EVENTS_PER_THREAD
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long lapped = thread->Written.load(std::memory_order_relaxed);
+		if (lapped >= PROFILER_EVENTS_PER_THREAD && lapped - PROFILER_EVENTS_PER_THREAD + 1 > first)
+		{
+			size_t torn = (size_t)(std::min(lapped - PROFILER_EVENTS_PER_THREAD + 1, written) - first);
+			frame.Events.erase(frame.Events.begin() + copied, frame.Events.begin() + copied + torn);
+		}
+
+		frame.Dropped += (unsigned int)((written - thread->Read) - (frame.Events.size() - copied));
+		thread->Read = written;
+		if (frame.Events.size() > copied)
+			frame.ThreadCount = t + 1;
+	}
+
+	frame.Start = frameStart;
+	frame.End = now;
+	frameStart = now;
+	newestFrame = (newestFrame + 1) % PROFILER_HISTORY_FRAMES;
+	frameCount = std::min(frameCount + 1, (unsigned int)PROFILER_HISTORY_FRAMES);
+}
+
+void Profiler::SetPaused(bool paused)
+{
+	this->paused = paused;
+}
+
+bool Profiler::IsPaused()
+{
+	return paused;
+}
+
+unsigned int Profiler::GetFrameCount()
+{
+	return frameCount;
+}
+
+const ProfilerFrame& Profiler::GetFrame(unsigned int age)
+{
+	return history[(newestFrame + PROFILER_HISTORY_FRAMES - age) % PROFILER_HISTORY_FRAMES];
+}
+
+double Profiler::GetTicksPerSecond()
+{
+	return ticksPerSecond;
+}
+
+double Profiler::ToMilliseconds(unsigned long long ticks)
+{
+	return ticks * 1000.0 / ticksPerSecond;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	// Times are in microseconds, from the start of the oldest frame
+	unsigned long long origin = frameCount > 0 ? GetFrame(frameCount - 1).Start : 0;
+	auto microseconds = [&](unsigned long long ticks) { return ticks * 1000000.0 / ticksPerSecond; };
+	auto writeName = [&](const char* name) {
+		file << '"';
+		for (const char* c = name; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				file << '\\';
+			file << *c;
+		}
+		file << '"';
+	};
+
+	file << "{\"traceEvents\":[\n";
+	file.precision(3);
+	file << std::fixed;
+	bool first = true;
+	unsigned int count = threadCount.load(std::memory_order_acquire);
+	for (unsigned int t = 0; t < count; t++)
+	{
+		// The game's first zones are on the main thread, before any others start
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+			<< ",\"args\":{\"name\":\"" << (t == 0 ? "Main thread" : "Thread ") << (t == 0 ? "" : std::to_string(t)) << "\"}}";
+		first = false;
+	}
+	for (unsigned int age = frameCount; age-- > 0;)
+	{
+		const ProfilerFrame& frame = GetFrame(age);
+		for (const ProfilerEvent& event : frame.Events)
+		{
+			// Zones that started before the first frame would have negative times
+			if (event.Start < origin)
+				continue;
+			file << (first ? "" : ",\n") << "{\"name\":";
+			writeName(event.Name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.Thread
+				<< ",\"ts\":" << microseconds(event.Start - origin)
+				<< ",\"dur\":" << microseconds(event.End - event.Start) << "}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// Hierarchical CPU profiler: nested, named zones timed on any thread and collected once a frame
+// - PROFILE_SCOPE("Name") times the rest of the enclosing block.  Names must outlive the history (string literals).
+// - Each thread writes its finished zones into a ring buffer of its own, which only EndFrame() reads,
+//   so recording a zone never takes a lock (just two timestamp reads and one store)
+// - Keeps the last PROFILER_HISTORY_FRAMES frames for the GUI, and can write them out as a Chrome trace
+//   (open it in chrome://tracing or ui.perfetto.dev)
+// - No Windows/D3D dependencies, so it can be used (and measured) by the offline tools too
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_TIMESTAMP_COUNTER
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TIMESTAMP_COUNTER
+#endif
+
+// Zones a thread can finish between two EndFrame()s, less one, before the oldest are lost (a power of two)
+#define PROFILER_EVENTS_PER_THREAD 8192
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_HISTORY_FRAMES 240
+
+#define PROFILE_SCOPE_NAME_INNER(line) profileScope##line
+#define PROFILE_SCOPE_NAME(line) PROFILE_SCOPE_NAME_INNER(line)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_NAME(__LINE__)(name)
+
+// The CPU's timestamp counter where there is one (a few nanoseconds to read, and the same rate on every
+// core on anything recent), otherwise the steady clock.  The profiler works out the rate as it goes.
+inline unsigned long long ProfilerTimestamp()
+{
+#ifdef PROFILER_USE_TIMESTAMP_COUNTER
+	return __rdtsc();
+#else
+	return (unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+struct ProfilerEvent
+{
+	const char* Name;
+	unsigned long long Start;	// Timestamps (see Profiler::GetTicksPerSecond())
+	unsigned long long End;
+	unsigned int Thread;		// Threads are numbered in the order they first open a zone
+	unsigned int Depth;			// How many of the thread's zones were already open
+};
+
+struct ProfilerFrame
+{
+	unsigned long long Start;
+	unsigned long long End;
+	std::vector<ProfilerEvent> Events;	// Every zone that finished during the frame, thread by thread
+	unsigned int ThreadCount;			// Highest thread number in Events, plus one
+	unsigned int Dropped;				// Zones lost because a thread's ring wrapped before they were collected
+};
+
+// One thread's ring.  Only that thread writes Events and Written (and publishes each event by bumping
+// Written); only the collecting thread touches Read.
+struct ProfilerThread
+{
+	ProfilerEvent Events[PROFILER_EVENTS_PER_THREAD];
+	std::atomic<unsigned long long> Written;
+	unsigned long long Read;
+	unsigned int Depth;
+	unsigned int Index;
+};
+
+class Profiler
+{
+public:
+	// Gets the one and only instance of this class
+	static Profiler& GetInstance()
+	{
+		static Profiler instance;
+		return instance;
+	}
+
+	Profiler(Profiler const&) = delete;
+	void operator=(Profiler const&) = delete;
+
+private:
+	Profiler();
+
+public:
+	~Profiler();
+
+	// The calling thread's ring, made the first time it's asked for
+	static ProfilerThread* GetThread()
+	{
+		static thread_local ProfilerThread* thread = GetInstance().RegisterThread();
+		return thread;
+	}
+
+	// Collects every zone finished since the last call into a new frame.  Call it from one thread
+	// only (the main one, between frames).  While paused, zones are still collected but thrown away.
+	void EndFrame();
+	void SetPaused(bool paused);
+	bool IsPaused();
+
+	// Age 0 is the newest frame
+	unsigned int GetFrameCount();
+	const ProfilerFrame& GetFrame(unsigned int age);
+
+	double GetTicksPerSecond();
+	double ToMilliseconds(unsigned long long ticks);
+
+	// Every frame in the history, oldest first, as "complete" events in the Chrome trace format
+	bool ExportChromeTrace(const std::string& path);
+
+private:
+	ProfilerThread* RegisterThread();
+
+	ProfilerThread* threads[PROFILER_MAX_THREADS];
+	std::atomic<unsigned int> threadCount;
+	std::mutex registerMutex;
+
+	std::vector<ProfilerFrame> history;	// A ring of PROFILER_HISTORY_FRAMES
+	unsigned int newestFrame;
+	unsigned int frameCount;
+	unsigned long long frameStart;
+	bool paused;
+
+	// The timestamp rate, measured against the steady clock since the profiler started
+	unsigned long long firstTimestamp;
+	std::chrono::steady_clock::time_point firstTime;
+	double ticksPerSecond;
+};
+
+// Times its own lifetime as a zone on the current thread
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+		: name(name), thread(Profiler::GetThread())
+	{
+		depth = thread->Depth++;
+		start = ProfilerTimestamp();
+	}
+
+	~ProfileScope()
+	{
+		unsigned long long end = ProfilerTimestamp();
+		thread->Depth--;
+		unsigned long long written = thread->Written.load(std::memory_order_relaxed);
+		ProfilerEvent& event = thread->Events[written & (PROFILER_EVENTS_PER_THREAD - 1)];
+		event.Name = name;
+		event.Start = start;
+		event.End = end;
+		event.Thread = thread->Index;
+		event.Depth = depth;
+		thread->Written.store(written + 1, std::memory_order_release);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name;
+	ProfilerThread* thread;
+	unsigned long long start;
+	unsigned int depth;
+};
@@ -0,0 +1,147 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+
+
+RenderTargetPool::RenderTargetPool(unsigned int framesToKeep)
+	: framesToKeep(framesToKeep)
+{
+}
+
+void RenderTargetPool::BeginFrame()
+{
+	targets.clear();
+}
+
+unsigned int RenderTargetPool::Request(const RenderTargetDesc& desc, unsigned int pass)
+{
+	targets.push_back({ desc, pass, pass, 0 });
+	return (unsigned int)targets.size() - 1;
+}
+
+void RenderTargetPool::Use(unsigned int target, unsigned int pass)
+{
+	targets[target].FirstPass = std::min(targets[target].FirstPass, pass);
+	targets[target].LastPass = std::max(targets[target].LastPass, pass);
+}
+
+// --------------------------------------------------------
+// Targets are placed in the order they start, each into
+// the first slot of its description that's free by then.
+// For intervals that's never more slots than the most
+// targets alive at once, and since the order only depends
+// on what was asked for, the same frame lands in the same
+// slots every time.
+// --------------------------------------------------------
+void RenderTargetPool::Allocate()
+{
+	createdSlots.clear();
+	releasedSlots.clear();
+	for (Slot& slot : slots)
+		slot.LastPass = -1;
+
+	order.resize(targets.size());
+	for (unsigned int i = 0; i < targets.size(); i++)
+		order[i] = i;
+	// Ties in request order, as a stable sort would leave them (std::stable_sort allocates a buffer every frame)
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		return targets[a].FirstPass != targets[b].FirstPass ? targets[a].FirstPass < targets[b].FirstPass : a < b;
+	});
+
+	for (unsigned int index : order)
+	{
+		Target& target = targets[index];
+		unsigned int found = (unsigned int)slots.size();
+		for (unsigned int s = 0; s < slots.size(); s++)
+		{
+			if (slots[s].HasTexture && slots[s].Desc == target.Desc && slots[s].LastPass < (int)target.FirstPass)
+			{
+				found = s;
+				break;
+			}
+		}
+
+		if (found == slots.size())
+		{
+			if (!freeSlots.empty())
+			{
+				found = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else
+				slots.push_back({});
+			slots[found].Desc = target.Desc;
+			slots[found].HasTexture = true;
+			createdSlots.push_back(found);
+		}
+
+		slots[found].LastPass = (int)target.LastPass;
+		target.Slot = found;
+	}
+
+	// Textures sitting idle for long enough go, so a setting that's
+	// been changed (or a pass that's been turned off) doesn't hang on
+	for (unsigned int s = 0; s < slots.size(); s++)
+	{
+		if (!slots[s].HasTexture)
+			continue;
+
+		slots[s].IdleFrames = slots[s].LastPass < 0 ? slots[s].IdleFrames + 1 : 0;
+		if (slots[s].IdleFrames > framesToKeep)
+		{
+			slots[s].HasTexture = false;
+			slots[s].IdleFrames = 0;
+			freeSlots.push_back(s);
+			releasedSlots.push_back(s);
+		}
+	}
+}
+
+unsigned int RenderTargetPool::GetSlot(unsigned int target)
+{
+	return targets[target].Slot;
+}
+
+const RenderTargetDesc& RenderTargetPool::GetDesc(unsigned int target)
+{
+	return targets[target].Desc;
+}
+
+unsigned int RenderTargetPool::GetTargetCount()
+{
+	return (unsigned int)targets.size();
+}
+
+unsigned int RenderTargetPool::GetTextureCount()
+{
+	return (unsigned int)(slots.size() - freeSlots.size());
+}
+
+unsigned int RenderTargetPool::GetSlotCount()
+{
+	return (unsigned int)slots.size();
+}
+
+const RenderTargetDesc& RenderTargetPool::GetSlotDesc(unsigned int slot)
+{
+	return slots[slot].Desc;
+}
+
+const std::vector<unsigned int>& RenderTargetPool::GetCreatedSlots()
+{
+	return createdSlots;
+}
+
+const std::vector<unsigned int>& RenderTargetPool::GetReleasedSlots()
+{
+	return releasedSlots;
+}
+
+void RenderTargetPool::Clear()
+{
+	targets.clear();
+	slots.clear();
+	freeSlots.clear();
+	createdSlots.clear();
+	releasedSlots.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Hands out the render targets the post processing passes need, fresh each frame
+// - Passes ask for a size and format, and say which passes (numbered in the order they run) touch the target
+// - Targets whose passes don't overlap share one texture, and textures are kept from frame to frame
+//   while they're still being asked for, so a steady frame creates nothing
+// - Textures nobody asked for in a few frames are let go
+// - No D3D: it only hands out slot numbers, and whoever owns the D3D side creates and releases a texture per slot
+
+#include <vector>
+
+#define RENDER_TARGET_MIPS 1	// A full mip chain that can be made with GenerateMips
+
+struct RenderTargetDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;	// A DXGI_FORMAT
+	unsigned int Flags;		// RENDER_TARGET_ flags
+};
+
+inline bool operator==(const RenderTargetDesc& a, const RenderTargetDesc& b)
+{
+	return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format && a.Flags == b.Flags;
+}
+
+class RenderTargetPool
+{
+public:
+	RenderTargetPool(unsigned int framesToKeep = 3);
+
+	// Forgets last frame's targets (but not their textures)
+	void BeginFrame();
+
+	// Targets live from the first pass that uses them to the last, inclusive
+	unsigned int Request(const RenderTargetDesc& desc, unsigned int pass);
+	void Use(unsigned int target, unsigned int pass);
+
+	// Gives every target this frame a slot, then works out which slots need textures made or released
+	void Allocate();
+
+	unsigned int GetSlot(unsigned int target);
+	const RenderTargetDesc& GetDesc(unsigned int target);
+	unsigned int GetTargetCount();		// Asked for this frame
+	unsigned int GetTextureCount();		// Slots that currently have a texture
+	unsigned int GetSlotCount();		// Including empty ones, for sizing the owner's arrays
+	const RenderTargetDesc& GetSlotDesc(unsigned int slot);
+	const std::vector<unsigned int>& GetCreatedSlots();		// Need a texture made this frame
+	const std::vector<unsigned int>& GetReleasedSlots();	// Their textures should go, this frame
+
+	// Lets every texture go at once (after a resize, nothing will match anyway)
+	void Clear();
+
+private:
+	struct Target
+	{
+		RenderTargetDesc Desc;
+		unsigned int FirstPass;
+		unsigned int LastPass;
+		unsigned int Slot;
+	};
+
+	struct Slot
+	{
+		RenderTargetDesc Desc;
+		bool HasTexture;
+		unsigned int IdleFrames;	// Frames in a row no target used it
+		int LastPass;				// This frame, -1 if it's still free
+	};
+
+	unsigned int framesToKeep;
+	std::vector<Target> targets;
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;	// Without a texture, ready to be given a new description
+	std::vector<unsigned int> createdSlots;
+	std::vector<unsigned int> releasedSlots;
+	std::vector<unsigned int> order;		// Scratch, targets sorted by first pass
+};
@@ -30,7 +30,7 @@ struct VertexToPixel
 struct VertexToPixel_NormalMap
 {
 	float4 screenPosition	: SV_POSITION;	// XYZW position (System Value Position)
-	float4 shadowMapPos		: SHADOW_POSITION; // XYZW position of this pixel in the shadow map
+	float viewDepth			: VIEW_DEPTH;	// Distance in front of the camera, used to pick a shadow cascade
 	float3 normal			: NORMAL;		// Surface normal
 	float3 tangent			: TANGENT;		// Surface tangent
 	float3 worldPosition	: POSITION;		// Position in world space
@@ -58,6 +58,7 @@ struct VertexToPixel_Fullscreen
 #define LIGHT_TYPE_DIRECTIONAL	0
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
+#define SPOT_LIGHT_CUTOFF		(1.0f / 256.0f)	// Must match Lights.h
 #define MAX_SPECULAR_EXPONENT 256.0f
 
 struct Light {
@@ -68,7 +69,8 @@ struct Light {
 	float intensity;
 	float3 color;
 	float spotFalloff;
-	float3 padding;
+	int shadowIndex;	// -1 if unshadowed (see Lights.h)
+	float2 padding;
 };
 
 float3 CalculateDiffuse(float3 normal, float3 directionToLight) {
@@ -88,6 +90,14 @@ float Attenuate(Light light, float3 worldPos)
 	return att * att;
 }
 
+// How much of a spot light's beam reaches this direction.  Fades to exactly zero at the cutoff,
+// so the cone the CPU culls with is really where the light ends.
+float SpotAmount(Light light, float3 directionToLight)
+{
+	float beam = pow(saturate(dot(-directionToLight, normalize(light.direction))), light.spotFalloff);
+	return saturate((beam - SPOT_LIGHT_CUTOFF) / (1.0f - SPOT_LIGHT_CUTOFF));
+}
+
 float3x3 CalculateTBN(float3 inputNormal, float3 inputTangent) { // Assumes input values are normalized
 	inputTangent = normalize(inputTangent - inputNormal * dot(inputTangent, inputNormal));
 	float3 inputBitangent = cross(inputTangent, inputNormal);
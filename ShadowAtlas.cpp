@@ -0,0 +1,191 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+
+ShadowAtlas::ShadowAtlas(unsigned int atlasSize, unsigned int minTileSize)
+	: atlasSize(atlasSize),
+	minTileSize(std::min(minTileSize, atlasSize))
+{
+	unsigned int levelCount = 1;
+	for (unsigned int size = atlasSize; size > this->minTileSize; size /= 2)
+		levelCount++;
+	freeTiles.resize(levelCount);
+	Clear();
+}
+
+bool ShadowAtlas::Allocate(unsigned int size, ShadowAtlasRegion& region)
+{
+	if (size > atlasSize)
+		return false;
+	if (!TakeFreeTile(LevelOf(size), region))
+		return false;
+	usedArea += (unsigned long long)region.Size * region.Size;
+	return true;
+}
+
+// --------------------------------------------------------
+// A freed tile merges with its three siblings if they're
+// all free too, then the merged tile tries the same one
+// level up
+// --------------------------------------------------------
+void ShadowAtlas::Free(const ShadowAtlasRegion& region)
+{
+	usedArea -= (unsigned long long)region.Size * region.Size;
+
+	ShadowAtlasRegion tile = region;
+	for (unsigned int level = LevelOf(tile.Size); level > 0; level--)
+	{
+		unsigned int parentSize = tile.Size * 2;
+		unsigned int parentX = tile.X - tile.X % parentSize;
+		unsigned int parentY = tile.Y - tile.Y % parentSize;
+
+		std::vector<ShadowAtlasRegion>& tiles = freeTiles[level];
+		std::vector<size_t> siblings;
+		for (size_t i = 0; i < tiles.size() && siblings.size() < 3; i++)
+		{
+			if (tiles[i].X - tiles[i].X % parentSize == parentX && tiles[i].Y - tiles[i].Y % parentSize == parentY)
+				siblings.push_back(i);
+		}
+		if (siblings.size() < 3)
+		{
+			tiles.push_back(tile);
+			return;
+		}
+
+		// Erase back to front so the earlier indices stay valid
+		for (size_t i = siblings.size(); i-- > 0;)
+			tiles.erase(tiles.begin() + siblings[i]);
+		tile = { parentX, parentY, parentSize };
+	}
+	freeTiles[0].push_back(tile);
+}
+
+void ShadowAtlas::Clear()
+{
+	for (std::vector<ShadowAtlasRegion>& tiles : freeTiles)
+		tiles.clear();
+	freeTiles[0].push_back({ 0, 0, atlasSize });
+	usedArea = 0;
+}
+
+unsigned int ShadowAtlas::GetAtlasSize()
+{
+	return atlasSize;
+}
+
+unsigned int ShadowAtlas::GetMinTileSize()
+{
+	return minTileSize;
+}
+
+unsigned int ShadowAtlas::GetLargestFreeTile()
+{
+	for (unsigned int level = 0; level < freeTiles.size(); level++)
+	{
+		if (!freeTiles[level].empty())
+			return atlasSize >> level;
+	}
+	return 0;
+}
+
+unsigned long long ShadowAtlas::GetUsedArea()
+{
+	return usedArea;
+}
+
+float ShadowAtlas::GetFragmentation()
+{
+	unsigned long long freeArea = (unsigned long long)atlasSize * atlasSize - usedArea;
+	if (freeArea == 0)
+		return 0.0f;
+	unsigned long long largest = (unsigned long long)GetLargestFreeTile() * GetLargestFreeTile();
+	return 1.0f - (float)largest / freeArea;
+}
+
+ShadowAtlasEntry ShadowAtlas::CreateEntry(const ShadowAtlasView& view)
+{
+	ShadowAtlasEntry entry;
+	XMStoreFloat4x4(&entry.ViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view.View), XMLoadFloat4x4(&view.Projection)));
+	entry.AtlasRect = XMFLOAT4(
+		(float)view.Region.X / atlasSize,
+		(float)view.Region.Y / atlasSize,
+		(float)view.Region.Size / atlasSize,
+		(float)view.Region.Size / atlasSize);
+	return entry;
+}
+
+unsigned int ShadowAtlas::LevelOf(unsigned int size)
+{
+	unsigned int level = 0;
+	for (unsigned int tileSize = atlasSize / 2; tileSize >= size && level + 1 < freeTiles.size(); tileSize /= 2)
+		level++;
+	return level;
+}
+
+// --------------------------------------------------------
+// Uses a free tile of the right size if there is one, and
+// otherwise splits a bigger one into quarters
+// --------------------------------------------------------
+bool ShadowAtlas::TakeFreeTile(unsigned int level, ShadowAtlasRegion& region)
+{
+	std::vector<ShadowAtlasRegion>& tiles = freeTiles[level];
+	if (!tiles.empty())
+	{
+		region = tiles.back();
+		tiles.pop_back();
+		return true;
+	}
+
+	ShadowAtlasRegion parent;
+	if (level == 0 || !TakeFreeTile(level - 1, parent))
+		return false;
+
+	unsigned int size = parent.Size / 2;
+	tiles.push_back({ parent.X + size, parent.Y + size, size });
+	tiles.push_back({ parent.X, parent.Y + size, size });
+	tiles.push_back({ parent.X + size, parent.Y, size });
+	region = { parent.X, parent.Y, size };
+	return true;
+}
+
+
+unsigned int ChooseShadowTileSize(float screenFraction, unsigned int minTileSize, unsigned int maxTileSize)
+{
+	float wanted = std::clamp(screenFraction, 0.0f, 1.0f) * maxTileSize;
+	unsigned int size = minTileSize;
+	while (size < wanted && size < maxTileSize)
+		size *= 2;
+	return size;
+}
+
+void CalculatePointLightShadowViews(XMFLOAT3 position, float range, XMFLOAT4X4 views[6], XMFLOAT4X4& projection)
+{
+	const XMVECTOR directions[6] = {
+		XMVectorSet(1, 0, 0, 0), XMVectorSet(-1, 0, 0, 0),
+		XMVectorSet(0, 1, 0, 0), XMVectorSet(0, -1, 0, 0),
+		XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 0, -1, 0) };
+	const XMVECTOR ups[6] = {
+		XMVectorSet(0, 1, 0, 0), XMVectorSet(0, 1, 0, 0),
+		XMVectorSet(0, 0, -1, 0), XMVectorSet(0, 0, 1, 0),
+		XMVectorSet(0, 1, 0, 0), XMVectorSet(0, 1, 0, 0) };
+
+	XMVECTOR eye = XMLoadFloat3(&position);
+	for (int face = 0; face < 6; face++)
+		XMStoreFloat4x4(&views[face], XMMatrixLookToLH(eye, directions[face], ups[face]));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, std::max(range * 0.005f, 0.01f), range));
+}
+
+void CalculateSpotLightShadowView(const Cone& cone, XMFLOAT4X4& view, XMFLOAT4X4& projection)
+{
+	// Any up works, as long as it isn't along the cone
+	XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+	XMVECTOR up = fabsf(cone.Direction.y) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&cone.Apex), direction, up));
+
+	float fieldOfView = 2.0f * acosf(cone.CosAngle);
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(fieldOfView, 1.0f, std::max(cone.Range * 0.005f, 0.01f), cone.Range));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// Shares one large depth texture between the shadow maps of many lights
+// - A quadtree allocator: the atlas is split into quarters, those into quarters, and so on,
+//   so every tile is a power of two and neighboring free tiles merge back together when freed
+// - Also builds the cameras lights need: point lights get one tile per cube face, spot lights one tile around their cone
+// - Only DirectXMath (no D3D), so the allocator can be checked away from the renderer
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Bounds.h"
+
+#define MAX_SHADOW_ATLAS_ENTRIES 64	// Size of the GPU buffer of entries (6 per point light, 1 per spot light)
+
+struct ShadowAtlasRegion
+{
+	unsigned int X;
+	unsigned int Y;
+	unsigned int Size;	// Always square, and always a power of two
+};
+
+// Everything the CPU needs to render one tile of the atlas
+struct ShadowAtlasView
+{
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	ShadowAtlasRegion Region;
+	Cone CullingCone;	// Spot lights only draw what's inside their cone.  Zero range for other lights.
+};
+
+// Everything the pixel shader needs to read one tile (matches the HLSL struct)
+struct ShadowAtlasEntry
+{
+	DirectX::XMFLOAT4X4 ViewProjection;
+	DirectX::XMFLOAT4 AtlasRect;	// UV offset (xy) and size (zw) of the tile within the atlas
+};
+
+class ShadowAtlas
+{
+public:
+	ShadowAtlas(unsigned int atlasSize = 2048, unsigned int minTileSize = 128);
+
+	// Size is rounded up to a power of two (and at least the smallest tile).  Returns false if no tile that big is free.
+	bool Allocate(unsigned int size, ShadowAtlasRegion& region);
+	void Free(const ShadowAtlasRegion& region);
+	void Clear();
+
+	unsigned int GetAtlasSize();
+	unsigned int GetMinTileSize();
+	unsigned int GetLargestFreeTile();	// 0 if the atlas is full
+	unsigned long long GetUsedArea();	// In texels
+	float GetFragmentation();			// 0 when all free space is one tile, towards 1 as it's split into smaller ones
+
+	ShadowAtlasEntry CreateEntry(const ShadowAtlasView& view);
+
+private:
+	unsigned int atlasSize;
+	unsigned int minTileSize;
+	unsigned long long usedArea;
+
+	// Free tiles by level: level 0 is the whole atlas, each level down is a quarter of the size
+	std::vector<std::vector<ShadowAtlasRegion>> freeTiles;
+
+	unsigned int LevelOf(unsigned int size);
+	bool TakeFreeTile(unsigned int level, ShadowAtlasRegion& region);
+};
+
+// Power of two tile size for a light covering screenFraction (0-1) of the screen's height
+unsigned int ChooseShadowTileSize(float screenFraction, unsigned int minTileSize, unsigned int maxTileSize);
+
+// The six 90 degree cameras around a point light, in +X, -X, +Y, -Y, +Z, -Z order
+// (the same order the pixel shader picks faces in)
+void CalculatePointLightShadowViews(DirectX::XMFLOAT3 position, float range, DirectX::XMFLOAT4X4 views[6], DirectX::XMFLOAT4X4& projection);
+
+// One camera looking down a spot light's cone, just wide enough to see all of it
+void CalculateSpotLightShadowView(const Cone& cone, DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& projection);
@@ -0,0 +1,129 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+
+void CalculateCascadeSplits(float nearClip, float farClip, unsigned int count, float lambda, float splits[])
+{
+	for (unsigned int i = 0; i <= count; i++)
+	{
+		float fraction = (float)i / count;
+		float uniform = nearClip + (farClip - nearClip) * fraction;
+		float logarithmic = nearClip * powf(farClip / nearClip, fraction);
+		splits[i] = uniform + (logarithmic - uniform) * lambda;
+	}
+
+	// Avoid any floating point drift at the ends
+	splits[0] = nearClip;
+	splits[count] = farClip;
+}
+
+
+// --------------------------------------------------------
+// Builds the corners in view space straight from the
+// projection's scale terms, rather than un-projecting NDC
+// corners: with a 0.01 to 1000 depth range the inverse of
+// the full view-projection loses too much float precision.
+// --------------------------------------------------------
+void CalculateFrustumSliceCorners(const XMFLOAT4X4& cameraView, const XMFLOAT4X4& cameraProjection,
+	float sliceNear, float sliceFar, XMFLOAT3 corners[8])
+{
+	// How far the frustum spreads sideways per unit of depth
+	float tanX = 1.0f / cameraProjection._11;
+	float tanY = 1.0f / cameraProjection._22;
+	float forward = cameraProjection._34; // 1 for left handed (+Z forward), -1 for right handed
+
+	// Only rotation and translation, so this inverse is well behaved
+	XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&cameraView));
+
+	const float signs[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+	for (int i = 0; i < 4; i++)
+	{
+		XMVECTOR nearPoint = XMVectorSet(signs[i][0] * tanX * sliceNear, signs[i][1] * tanY * sliceNear, forward * sliceNear, 1);
+		XMVECTOR farPoint = XMVectorSet(signs[i][0] * tanX * sliceFar, signs[i][1] * tanY * sliceFar, forward * sliceFar, 1);
+		XMStoreFloat3(&corners[i], XMVector3TransformCoord(nearPoint, inverseView));
+		XMStoreFloat3(&corners[i + 4], XMVector3TransformCoord(farPoint, inverseView));
+	}
+}
+
+
+// --------------------------------------------------------
+// The smallest sphere around a frustum slice is centered on
+// its axis, where the near and far corners are equally far
+// away (or at the far end, for long and wide slices).  This
+// is much tighter than centering on the average corner.
+// --------------------------------------------------------
+ShadowCascade FitShadowCascade(const XMFLOAT3 corners[8], XMFLOAT3 lightDirection, float casterDistance, unsigned int resolution)
+{
+	XMVECTOR nearCenter = XMVectorZero();
+	XMVECTOR farCenter = XMVectorZero();
+	for (int i = 0; i < 4; i++)
+	{
+		nearCenter += XMLoadFloat3(&corners[i]);
+		farCenter += XMLoadFloat3(&corners[i + 4]);
+	}
+	nearCenter /= 4.0f;
+	farCenter /= 4.0f;
+
+	// Solve |nearCenter + t * axis - nearCorner| = |nearCenter + t * axis - farCorner| for t
+	XMVECTOR axis = farCenter - nearCenter;
+	XMVECTOR toNear = nearCenter - XMLoadFloat3(&corners[0]);
+	XMVECTOR toFar = nearCenter - XMLoadFloat3(&corners[4]);
+	float denominator = 2.0f * XMVectorGetX(XMVector3Dot(axis, toNear - toFar));
+	float t = denominator != 0.0f ? (XMVectorGetX(XMVector3LengthSq(toFar)) - XMVectorGetX(XMVector3LengthSq(toNear))) / denominator : 0.5f;
+	XMVECTOR center = nearCenter + axis * std::clamp(t, 0.0f, 1.0f);
+
+	float radius = 0;
+	for (int i = 0; i < 8; i++)
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&corners[i]) - center)));
+	radius = ceilf(radius * 16.0f) / 16.0f; // Keeps tiny float differences from changing the size frame to frame
+
+	// Widen the box by one snapping step (a whole number of texels): halfSize = radius + step / 2
+	unsigned int stepTexels = std::max(1u, (unsigned int)(resolution * SHADOW_CASCADE_SNAP + 0.5f));
+	float halfSize = radius * resolution / (resolution - stepTexels);
+	float step = halfSize * 2.0f * stepTexels / resolution;
+
+	// Snap the center to whole steps in light space.  The light space origin then always lands on a
+	// texel corner, and nothing below depends on where exactly in the step the camera is.
+	XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+	XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+	XMMATRIX rotation = XMMatrixLookToLH(XMVectorZero(), direction, up);
+	XMVECTOR lightCenter = XMVectorRound(XMVector3TransformNormal(center, rotation) / step) * step;
+
+	// Back the light up far enough to also catch things between it and the slice
+	XMVECTOR eye = lightCenter - XMVectorSet(0, 0, halfSize + casterDistance, 0);
+	XMMATRIX view = XMMatrixMultiply(rotation, XMMatrixTranslationFromVector(-eye));
+	XMMATRIX projection = XMMatrixOrthographicOffCenterLH(-halfSize, halfSize, -halfSize, halfSize, 0.0f, halfSize * 2.0f + casterDistance);
+
+	ShadowCascade cascade = {};
+	XMStoreFloat4x4(&cascade.View, view);
+	XMStoreFloat4x4(&cascade.Projection, projection);
+	XMStoreFloat4x4(&cascade.ViewProjection, XMMatrixMultiply(view, projection));
+	cascade.Radius = radius;
+	cascade.HalfSize = halfSize;
+	return cascade;
+}
+
+
+unsigned int CalculateShadowCascades(const ShadowCascadeSettings& settings, const XMFLOAT4X4& cameraView, const XMFLOAT4X4& cameraProjection,
+	float nearClip, float farClip, XMFLOAT3 lightDirection, ShadowCascade cascades[MAX_SHADOW_CASCADES])
+{
+	unsigned int count = std::clamp(settings.CascadeCount, 1u, (unsigned int)MAX_SHADOW_CASCADES);
+	float shadowFar = std::min(farClip, settings.MaxShadowDistance);
+
+	float splits[MAX_SHADOW_CASCADES + 1];
+	CalculateCascadeSplits(nearClip, shadowFar, count, settings.SplitLambda, splits);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 corners[8];
+		CalculateFrustumSliceCorners(cameraView, cameraProjection, splits[i], splits[i + 1], corners);
+		cascades[i] = FitShadowCascade(corners, lightDirection, settings.CasterDistance, settings.Resolution);
+		cascades[i].SplitNear = splits[i];
+		cascades[i].SplitFar = splits[i + 1];
+	}
+	return count;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// Cascaded shadow map fitting for a directional light
+// - Splits the camera's view range into slices and fits one orthographic shadow camera to each
+// - Only DirectXMath (no D3D), so the math can be checked away from the renderer
+
+#include <DirectXMath.h>
+
+#define MAX_SHADOW_CASCADES 4
+
+// Cascades move in steps of this fraction of their width (rounded to whole texels) instead of
+// following the camera exactly, so their cached static shadows stay good until it has moved a
+// whole step (see StaticShadowCache.h).  They're one step wider, so the slice still fits.
+#define SHADOW_CASCADE_SNAP 0.125f
+
+struct ShadowCascadeSettings
+{
+	unsigned int CascadeCount = 4;
+	float SplitLambda = 0.8f;			// Blend between uniform (0) and logarithmic (1) split distances
+	float MaxShadowDistance = 60.0f;	// Nothing further from the camera than this is shadowed
+	float CasterDistance = 25.0f;		// How far towards the light to still catch shadow casters
+	unsigned int Resolution = 1024;		// Of each cascade's shadow map, needed for texel snapping
+};
+
+struct ShadowCascade
+{
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMFLOAT4X4 ViewProjection;
+	float SplitNear;	// View space depth range this cascade covers
+	float SplitFar;
+	float Radius;		// Of the sphere the cascade was fitted to
+	float HalfSize;		// Of the orthographic box around it, half a snapping step more than Radius
+};
+
+// Fills splits[0..count] with view space depths from nearClip to farClip.
+// lambda = 0 spaces them evenly, 1 spaces them logarithmically (same ratio from one to the next).
+void CalculateCascadeSplits(float nearClip, float farClip, unsigned int count, float lambda, float splits[]);
+
+// World space corners of the part of a (symmetric, perspective) camera frustum between
+// two view space depths.  The first four are on the near side.
+void CalculateFrustumSliceCorners(const DirectX::XMFLOAT4X4& cameraView, const DirectX::XMFLOAT4X4& cameraProjection,
+	float sliceNear, float sliceFar, DirectX::XMFLOAT3 corners[8]);
+
+// Fits an orthographic light camera around a frustum slice (corners as above).
+// - Bounds are a sphere, so they don't change size as the camera turns
+// - Its light space position is snapped to whole steps (see SHADOW_CASCADE_SNAP), each a whole number of
+//   shadow map texels, so shadows don't shimmer as the camera moves and the matrices stay exactly the same
+//   until the camera has moved a whole step
+ShadowCascade FitShadowCascade(const DirectX::XMFLOAT3 corners[8], DirectX::XMFLOAT3 lightDirection, float casterDistance, unsigned int resolution);
+
+// Splits the camera's frustum and fits every cascade.  Returns the number of cascades written.
+unsigned int CalculateShadowCascades(const ShadowCascadeSettings& settings, const DirectX::XMFLOAT4X4& cameraView, const DirectX::XMFLOAT4X4& cameraProjection,
+	float nearClip, float farClip, DirectX::XMFLOAT3 lightDirection, ShadowCascade cascades[MAX_SHADOW_CASCADES]);
@@ -0,0 +1,83 @@
+#include "ShadowCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+
+// --------------------------------------------------------
+// Everything happens in the cascade's clip space.  Its
+// projection is orthographic, so that's just a linear
+// remapping of light space: the cascade covers -1 to 1 in
+// X and Y, and Z grows away from the light.
+// --------------------------------------------------------
+unsigned int CullShadowCasters(ShadowCascade& cascade, const std::vector<AABB>& objectBounds, const std::vector<unsigned int>& staticObjects,
+	const std::vector<unsigned int>& receivers, std::vector<unsigned int>& casters)
+{
+	casters.clear();
+
+	std::vector<AABB> clipBounds(objectBounds.size());
+	for (size_t i = 0; i < objectBounds.size(); i++)
+		clipBounds[i] = TransformAABB(objectBounds[i], cascade.ViewProjection);
+
+	std::vector<bool> isStatic(objectBounds.size(), false);
+	for (unsigned int index : staticObjects)
+		isStatic[index] = true;
+
+	// The part of the cascade that visible receivers actually cover
+	AABB receiverBounds = EmptyAABB();
+	for (unsigned int index : receivers)
+	{
+		AABB bounds = clipBounds[index];
+		bounds.Min.x = std::max(bounds.Min.x, -1.0f);
+		bounds.Min.y = std::max(bounds.Min.y, -1.0f);
+		bounds.Max.x = std::min(bounds.Max.x, 1.0f);
+		bounds.Max.y = std::min(bounds.Max.y, 1.0f);
+		if (IsEmpty(bounds))
+			continue;
+		GrowAABB(receiverBounds, bounds.Min);
+		GrowAABB(receiverBounds, bounds.Max);
+	}
+
+	// Start at the front of the box around the slice, so every receiver is behind the near plane.
+	// The light's view is unscaled, so _33 is per world unit.
+	float nearZ = 1.0f - 2.0f * cascade.HalfSize * cascade.Projection._33;
+	for (unsigned int i = 0; i < (unsigned int)clipBounds.size(); i++)
+	{
+		const AABB& bounds = clipBounds[i];
+		if (bounds.Max.x < -1.0f || bounds.Min.x > 1.0f ||
+			bounds.Max.y < -1.0f || bounds.Min.y > 1.0f ||
+			bounds.Min.z > 1.0f)
+			continue;
+
+		if (isStatic[i])
+		{
+			casters.push_back(i);
+			nearZ = std::min(nearZ, bounds.Min.z);
+			continue;
+		}
+
+		if (IsEmpty(receiverBounds) ||
+			bounds.Max.x < receiverBounds.Min.x || bounds.Min.x > receiverBounds.Max.x ||
+			bounds.Max.y < receiverBounds.Min.y || bounds.Min.y > receiverBounds.Max.y ||
+			bounds.Min.z > receiverBounds.Max.z)
+			continue;
+
+		casters.push_back(i);
+	}
+
+	// Round the near plane out to whole steps (see SHADOW_DEPTH_STEP)
+	float step = SHADOW_DEPTH_STEP * cascade.Projection._33;
+	nearZ = floorf(nearZ / step) * step;
+
+	// Remap the old depth range so nearZ lands on 0, keeping the far plane on 1
+	float scale = 1.0f / (1.0f - nearZ);
+	cascade.Projection._13 *= scale;
+	cascade.Projection._23 *= scale;
+	cascade.Projection._33 *= scale;
+	cascade.Projection._43 = (cascade.Projection._43 - nearZ) * scale;
+	XMStoreFloat4x4(&cascade.ViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&cascade.View), XMLoadFloat4x4(&cascade.Projection)));
+
+	return (unsigned int)(objectBounds.size() - casters.size());
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Shadow caster culling for a single shadow cascade
+// - Receivers are objects the camera can see.  Only the part of the cascade they cover matters.
+// - Dynamic casters must overlap that part as seen from the light, and be no further from the light than
+//   the furthest receiver.  Nearer to the light is fine, however far (the cascade is extruded towards it).
+// - Static casters are kept anywhere in the cascade.  Their shadows are cached (see StaticShadowCache.h),
+//   so which ones are drawn mustn't depend on where the camera looks.
+// - The cascade's near plane is then fitted to the static casters, instead of a fixed range.  The far
+//   plane stays at the back of the cascade's box, which every receiver in its slice is in front of.
+//   Neither depends on the camera or on dynamic objects, so the matrices only change when the cascade
+//   steps, the light turns or a static object moves.  Dynamic casters in front of the near plane must be
+//   drawn without depth clipping, which flattens them onto it.
+
+#include "Bounds.h"
+#include "ShadowCascades.h"
+
+#include <vector>
+
+// Fitted near planes are rounded out to multiples of this many world units, so
+// static casters moving a little don't change the cascade (and its cached shadows)
+#define SHADOW_DEPTH_STEP 2.0f
+
+// objectBounds are world space, staticObjects and receivers index into them.  Fills casters with
+// the indices worth drawing into this cascade and returns how many objects were culled.
+unsigned int CullShadowCasters(ShadowCascade& cascade, const std::vector<AABB>& objectBounds, const std::vector<unsigned int>& staticObjects,
+	const std::vector<unsigned int>& receivers, std::vector<unsigned int>& casters);
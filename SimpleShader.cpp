@@ -1,9 +1,20 @@
 #include "SimpleShader.h"
+#include "MemoryTrackerD3D11.h"
+#include "Profiler.h"
+
+#include <atomic>
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// What this thread is recording into, if anything (see BeginRecording())
+static thread_local ID3D11DeviceContext* recordingContext = 0;
+static thread_local unsigned int recordingSlot = 0;
+static thread_local unsigned long long recording = 0;
+static thread_local CommandBuffer* recordingCommands = 0;
+static std::atomic<unsigned long long> recordingCount(0);
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -50,6 +61,11 @@ void ISimpleShader::CleanUp()
 	{
 		delete[] constantBuffers[i].LocalDataBuffer;
 	}
+	for (RecordingCopy& copy : recordingCopies)
+	{
+		copy.Recording = 0;
+		copy.Buffers.clear();
+	}
 
 	if (constantBuffers)
 	{
@@ -80,6 +96,9 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
+	// Everything reflection builds (and the constant buffers) counts as the shader's
+	MEMORY_SCOPE(MEMORY_SIMPLE_SHADER);
+
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, shaderBlob.GetAddressOf());
 	if (hr != S_OK)
@@ -197,6 +216,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		TrackGpuResource(constantBuffers[b].ConstantBuffer.Get(), MEMORY_SIMPLE_SHADER);
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
@@ -240,10 +260,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(const char* name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
+	std::map<std::string, SimpleShaderVariable, std::less<>>::iterator result =
 		varTable.find(name);
 
 	// Did we find the key?
@@ -264,10 +284,10 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(const char* name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
+	std::map<std::string, SimpleConstantBuffer*, std::less<>>::iterator result =
 		cbTable.find(name);
 
 	// Did we find the key?
@@ -322,6 +342,102 @@ void ISimpleShader::LogWarning(std::string message) { Log(message, FOREGROUND_RE
 void ISimpleShader::LogWarningW(std::wstring message) { LogW(message, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY); }
 
 
+// --------------------------------------------------------
+// Points this thread's shaders at another context, with
+// their own copies of the constant buffers' local data
+//
+// context - Where to set shaders, resources and buffers
+// slot    - Which copies to use, from 1 to
+//           SIMPLE_SHADER_RECORDING_SLOTS.  Only one thread
+//           can be recording in each slot at once.
+// --------------------------------------------------------
+void ISimpleShader::BeginRecording(ID3D11DeviceContext* context, unsigned int slot)
+{
+	if (slot == 0 || slot > SIMPLE_SHADER_RECORDING_SLOTS)
+		return;
+
+	recordingContext = context;
+	recordingSlot = slot;
+	recording = ++recordingCount;
+}
+
+// --------------------------------------------------------
+// Back to each shader's own context and local data
+// --------------------------------------------------------
+void ISimpleShader::EndRecording()
+{
+	recordingContext = 0;
+	recordingSlot = 0;
+}
+
+ID3D11DeviceContext* ISimpleShader::Context()
+{
+	return recordingContext ? recordingContext : deviceContext.Get();
+}
+
+// --------------------------------------------------------
+// Sends this thread's shaders' state changes into a command
+// buffer instead of onto a context, until given nullptr
+// --------------------------------------------------------
+void ISimpleShader::RecordCommands(CommandBuffer* commands)
+{
+	recordingCommands = commands;
+}
+
+CommandBuffer* ISimpleShader::GetRecordingCommands()
+{
+	return recordingCommands;
+}
+
+CommandBuffer* ISimpleShader::Commands()
+{
+	return recordingCommands;
+}
+
+// --------------------------------------------------------
+// What each stage's SetShaderAndCBs() does, as commands.
+// Returns false if this thread isn't recording commands.
+// --------------------------------------------------------
+bool ISimpleShader::RecordShaderAndCBs(ShaderStage stage, void* shader, void* inputLayout)
+{
+	CommandBuffer* commands = Commands();
+	if (!commands)
+		return false;
+
+	commands->SetShader(stage, shader, inputLayout);
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		// Skip "buffers" that aren't true constant buffers
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+			continue;
+
+		commands->SetConstantBuffer(stage, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// The local data buffer this thread should read and write.
+// A recording slot's copies are refreshed from the shader's
+// own buffers the first time they're used in each recording,
+// so they start from whatever was set before it began.
+// --------------------------------------------------------
+unsigned char* ISimpleShader::LocalData(unsigned int bufferIndex)
+{
+	if (recordingSlot == 0)
+		return constantBuffers[bufferIndex].LocalDataBuffer;
+
+	RecordingCopy& copy = recordingCopies[recordingSlot - 1];
+	if (copy.Recording != recording)
+	{
+		copy.Buffers.resize(constantBufferCount);
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+			copy.Buffers[i].assign(constantBuffers[i].LocalDataBuffer, constantBuffers[i].LocalDataBuffer + constantBuffers[i].Size);
+		copy.Recording = recording;
+	}
+	return copy.Buffers[bufferIndex].data();
+}
+
 // --------------------------------------------------------
 // Sets the shader and associated constant buffers in Direct3D
 // --------------------------------------------------------
@@ -342,16 +458,24 @@ void ISimpleShader::SetShader()
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
+	PROFILE_SCOPE("CopyAllBufferData");
+
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
 	// Loop through the constant buffers and copy all data
+	CommandBuffer* commands = Commands();
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
+		if (commands)
+		{
+			commands->UpdateConstants(constantBuffers[i].ConstantBuffer.Get(), LocalData(i), constantBuffers[i].Size);
+			continue;
+		}
+		Context()->UpdateSubresource(
 			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+			LocalData(i), 0, 0);
 	}
 }
 
@@ -380,9 +504,14 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
+	if (CommandBuffer* commands = Commands())
+	{
+		commands->UpdateConstants(cb->ConstantBuffer.Get(), LocalData(index), cb->Size);
+		return;
+	}
+	Context()->UpdateSubresource(
 		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+		LocalData(index), 0, 0);
 }
 
 // --------------------------------------------------------
@@ -392,7 +521,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(const char* bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -402,9 +531,14 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
+	if (CommandBuffer* commands = Commands())
+	{
+		commands->UpdateConstants(cb->ConstantBuffer.Get(), LocalData((unsigned int)(cb - constantBuffers)), cb->Size);
+		return;
+	}
+	Context()->UpdateSubresource(
 		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+		LocalData((unsigned int)(cb - constantBuffers)), 0, 0);
 }
 
 
@@ -417,7 +551,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(const char* name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -447,7 +581,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 
 	// Set the data in the local data buffer
 	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
+		LocalData(var->ConstantBufferIndex) + var->ByteOffset,
 		data,
 		size);
 
@@ -458,7 +592,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(const char* name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +600,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(const char* name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +608,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(const char* name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +616,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(const char* name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +624,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(const char* name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +632,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(const char* name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +640,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(const char* name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +648,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(const char* name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +656,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(const char* name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,7 +664,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
@@ -539,7 +673,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(const char* name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -547,7 +681,7 @@ bool ISimpleShader::HasVariable(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified SRV
 // --------------------------------------------------------
-bool ISimpleShader::HasShaderResourceView(std::string name)
+bool ISimpleShader::HasShaderResourceView(const char* name)
 {
 	return GetShaderResourceViewInfo(name) != 0;
 }
@@ -555,7 +689,7 @@ bool ISimpleShader::HasShaderResourceView(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified sampler
 // --------------------------------------------------------
-bool ISimpleShader::HasSamplerState(std::string name)
+bool ISimpleShader::HasSamplerState(const char* name)
 {
 	return GetSamplerInfo(name) != 0;
 }
@@ -563,7 +697,7 @@ bool ISimpleShader::HasSamplerState(std::string name)
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(const char* name)
 {
 	return FindVariable(name, -1);
 }
@@ -573,10 +707,10 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(const char* name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
+	std::map<std::string, SimpleSRV*, std::less<>>::iterator result =
 		textureTable.find(name);
 
 	// Did we find the key?
@@ -608,10 +742,10 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(const char* name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
+	std::map<std::string, SimpleSampler*, std::less<>>::iterator result =
 		samplerTable.find(name);
 
 	// Did we find the key?
@@ -661,7 +795,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(const char* name)
 {
 	return FindConstantBuffer(name);
 }
@@ -868,9 +1002,13 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Into a command buffer, if this thread is recording one
+	if (RecordShaderAndCBs(SHADER_STAGE_VERTEX, shader.Get(), inputLayout.Get()))
+		return;
+
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	Context()->IASetInputLayout(inputLayout.Get());
+	Context()->VSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -880,7 +1018,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
+		Context()->VSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -895,7 +1033,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -911,7 +1049,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetShaderResource(SHADER_STAGE_VERTEX, srvInfo->BindIndex, srv.Get());
+	else
+		Context()->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -925,7 +1066,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -941,7 +1082,10 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetSampler(SHADER_STAGE_VERTEX, sampInfo->BindIndex, samplerState.Get());
+	else
+		Context()->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1010,9 +1154,13 @@ void SimplePixelShader::SetShaderAndCBs()
 {
 	// Is shader valid?
 	if (!shaderValid) return;
+
+	// Into a command buffer, if this thread is recording one
+	if (RecordShaderAndCBs(SHADER_STAGE_PIXEL, shader.Get()))
+		return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	Context()->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1022,7 +1170,7 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
+		Context()->PSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -1037,7 +1185,7 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1053,7 +1201,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetShaderResource(SHADER_STAGE_PIXEL, srvInfo->BindIndex, srv.Get());
+	else
+		Context()->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1067,7 +1218,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1083,7 +1234,10 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetSampler(SHADER_STAGE_PIXEL, sampInfo->BindIndex, samplerState.Get());
+	else
+		Context()->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1155,8 +1309,12 @@ void SimpleDomainShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Into a command buffer, if this thread is recording one
+	if (RecordShaderAndCBs(SHADER_STAGE_DOMAIN, shader.Get()))
+		return;
+
 	// Set the shader
-	deviceContext->DSSetShader(shader.Get(), 0, 0);
+	Context()->DSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1166,7 +1324,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
+		Context()->DSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -1181,7 +1339,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1197,7 +1355,10 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetShaderResource(SHADER_STAGE_DOMAIN, srvInfo->BindIndex, srv.Get());
+	else
+		Context()->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1211,7 +1372,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1227,7 +1388,10 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetSampler(SHADER_STAGE_DOMAIN, sampInfo->BindIndex, samplerState.Get());
+	else
+		Context()->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1298,8 +1462,12 @@ void SimpleHullShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Into a command buffer, if this thread is recording one
+	if (RecordShaderAndCBs(SHADER_STAGE_HULL, shader.Get()))
+		return;
+
 	// Set the shader
-	deviceContext->HSSetShader(shader.Get(), 0, 0);
+	Context()->HSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1309,7 +1477,7 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
+		Context()->HSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -1324,7 +1492,7 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1340,7 +1508,10 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetShaderResource(SHADER_STAGE_HULL, srvInfo->BindIndex, srv.Get());
+	else
+		Context()->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1354,7 +1525,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1370,7 +1541,10 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetSampler(SHADER_STAGE_HULL, sampInfo->BindIndex, samplerState.Get());
+	else
+		Context()->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1549,7 +1723,9 @@ bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPt
 	desc.Usage               = D3D11_USAGE_DEFAULT;
 
 	// Attempt to create the buffer and return the result
+	// The buffer is the caller's, so it's tracked under their tag
 	HRESULT result = device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	TrackGpuResource(buffer.Get(), GetMemoryTag());
 	return (result == S_OK);
 }
 
@@ -1572,8 +1748,12 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Into a command buffer, if this thread is recording one
+	if (RecordShaderAndCBs(SHADER_STAGE_GEOMETRY, shader.Get()))
+		return;
+
 	// Set the shader
-	deviceContext->GSSetShader(shader.Get(), 0, 0);
+	Context()->GSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1583,7 +1763,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
+		Context()->GSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -1598,7 +1778,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1614,7 +1794,10 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetShaderResource(SHADER_STAGE_GEOMETRY, srvInfo->BindIndex, srv.Get());
+	else
+		Context()->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1628,7 +1811,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1644,7 +1827,10 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (CommandBuffer* commands = Commands())
+		commands->SetSampler(SHADER_STAGE_GEOMETRY, sampInfo->BindIndex, samplerState.Get());
+	else
+		Context()->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1783,7 +1969,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader.Get(), 0, 0);
+	Context()->CSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1793,7 +1979,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
+		Context()->CSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			constantBuffers[i].ConstantBuffer.GetAddressOf());
@@ -1822,7 +2008,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
 {
-	deviceContext->Dispatch(groupsX, groupsY, groupsZ);
+	Context()->Dispatch(groupsX, groupsY, groupsZ);
 }
 
 // --------------------------------------------------------
@@ -1847,7 +2033,7 @@ void SimpleComputeShader::DispatchByGroups(unsigned int groupsX, unsigned int gr
 // --------------------------------------------------------
 void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ)
 {
-	deviceContext->Dispatch(
+	Context()->Dispatch(
 		max((unsigned int)ceil((float)threadsX / this->threadsX), 1),
 		max((unsigned int)ceil((float)threadsY / this->threadsY), 1),
 		max((unsigned int)ceil((float)threadsZ / this->threadsZ), 1));
@@ -1856,7 +2042,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 // Determines if this shader has the specified UAV
 // --------------------------------------------------------
-bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
+bool SimpleComputeShader::HasUnorderedAccessView(const char* name)
 {
 	return GetUnorderedAccessViewIndex(name) != -1;
 }
@@ -1869,7 +2055,7 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1885,7 +2071,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	Context()->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1899,7 +2085,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1915,7 +2101,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	Context()->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1930,7 +2116,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(const char* name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1946,7 +2132,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetUnorderedAccessViews(bindIndex, 1, uav.GetAddressOf(), &appendConsumeOffset);
+	Context()->CSSetUnorderedAccessViews(bindIndex, 1, uav.GetAddressOf(), &appendConsumeOffset);
 
 	// Success
 	return true;
@@ -1955,10 +2141,10 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(const char* name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
+	std::map<std::string, unsigned int, std::less<>>::iterator result =
 		uavTable.find(name);
 
 	// Did we find the key?
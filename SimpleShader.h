@@ -7,7 +7,9 @@
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
-#include <unordered_map>
+#include "CommandBuffer.h"
+
+#include <map>
 #include <vector>
 #include <string>
 
@@ -57,6 +59,12 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// How many threads can record with the same shaders at
+// once (see ISimpleShader::BeginRecording)
+// --------------------------------------------------------
+#define SIMPLE_SHADER_RECORDING_SLOTS 16
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -73,46 +81,67 @@ public:
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(const std::string& bufferName) { CopyBufferData(bufferName.c_str()); }
+	void CopyBufferData(const char* bufferName);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const std::string& name, const void* data, unsigned int size) { return SetData(name.c_str(), data, size); }
+	bool SetData(const char* name, const void* data, unsigned int size);
+
+	bool SetInt(const std::string& name, int data) { return SetInt(name.c_str(), data); }
+	bool SetInt(const char* name, int data);
+	bool SetFloat(const std::string& name, float data) { return SetFloat(name.c_str(), data); }
+	bool SetFloat(const char* name, float data);
+	bool SetFloat2(const std::string& name, const float data[2]) { return SetFloat2(name.c_str(), data); }
+	bool SetFloat2(const char* name, const float data[2]);
+	bool SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data) { return SetFloat2(name.c_str(), data); }
+	bool SetFloat2(const char* name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const std::string& name, const float data[3]) { return SetFloat3(name.c_str(), data); }
+	bool SetFloat3(const char* name, const float data[3]);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data) { return SetFloat3(name.c_str(), data); }
+	bool SetFloat3(const char* name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const std::string& name, const float data[4]) { return SetFloat4(name.c_str(), data); }
+	bool SetFloat4(const char* name, const float data[4]);
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data) { return SetFloat4(name.c_str(), data); }
+	bool SetFloat4(const char* name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const std::string& name, const float data[16]) { return SetMatrix4x4(name.c_str(), data); }
+	bool SetMatrix4x4(const char* name, const float data[16]);
+	bool SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data) { return SetMatrix4x4(name.c_str(), data); }
+	bool SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4 data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
-	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	bool SetShaderResourceView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) { return SetShaderResourceView(name.c_str(), srv); }
+	virtual bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
+	bool SetSamplerState(const std::string& name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) { return SetSamplerState(name.c_str(), samplerState); }
+	virtual bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
 
 	// Simple resource checking
-	bool HasVariable(std::string name);
-	bool HasShaderResourceView(std::string name);
-	bool HasSamplerState(std::string name);
+	bool HasVariable(const std::string& name) { return HasVariable(name.c_str()); }
+	bool HasVariable(const char* name);
+	bool HasShaderResourceView(const std::string& name) { return HasShaderResourceView(name.c_str()); }
+	bool HasShaderResourceView(const char* name);
+	bool HasSamplerState(const std::string& name) { return HasSamplerState(name.c_str()); }
+	bool HasSamplerState(const char* name);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const std::string& name) { return GetVariableInfo(name.c_str()); }
+	const SimpleShaderVariable* GetVariableInfo(const char* name);
 	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(const std::string& name) { return GetShaderResourceViewInfo(name.c_str()); }
+	const SimpleSRV* GetShaderResourceViewInfo(const char* name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	size_t GetShaderResourceViewCount() { return textureTable.size(); }
 	
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(const std::string& name) { return GetSamplerInfo(name.c_str()); }
+	const SimpleSampler* GetSamplerInfo(const char* name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	size_t GetSamplerCount() { return samplerTable.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(const std::string& name) { return GetBufferInfo(name.c_str()); }
+	const SimpleConstantBuffer* GetBufferInfo(const char* name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 	
 	// Misc getters
@@ -122,6 +151,23 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Recording from other threads (into deferred contexts)
+	// - Until EndRecording(), every shader this thread uses sets its shaders, resources and
+	//   constant buffers on the given context instead of its own
+	// - Variables are set in the slot's own copy of each constant buffer, which starts out as
+	//   whatever was set outside of recording, so threads don't overwrite each other's values
+	// - Slots are 1 to SIMPLE_SHADER_RECORDING_SLOTS, and each may only record on one thread at a time
+	static void BeginRecording(ID3D11DeviceContext* context, unsigned int slot);
+	static void EndRecording();
+
+	// Recording into a CommandBuffer instead of onto a context
+	// - Until this is called again with nullptr, every shader this thread uses writes the shaders,
+	//   resources, constant buffers and constant data it would have set into the buffer instead
+	// - Works alongside BeginRecording(): variables still come from the slot's copies
+	// - Compute shaders can't be recorded, since there's no command to dispatch them
+	static void RecordCommands(CommandBuffer* commands);
+	static CommandBuffer* GetRecordingCommands();
+
 protected:
 	
 	bool shaderValid;
@@ -133,13 +179,15 @@ protected:
 	unsigned int constantBufferCount;
 	
 	// Maps for variables and buffers
+	// - std::less<> lets them be searched with a const char* as well as a std::string,
+	//   without building a temporary std::string for every lookup
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+	std::map<std::string, SimpleConstantBuffer*, std::less<>> cbTable;
+	std::map<std::string, SimpleShaderVariable, std::less<>> varTable;
+	std::map<std::string, SimpleSRV*, std::less<>> textureTable;
+	std::map<std::string, SimpleSampler*, std::less<>> samplerTable;
 
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
@@ -151,8 +199,25 @@ protected:
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(const char* name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(const char* name);
+
+	// The context and local constant buffer data this thread should use (see BeginRecording)
+	ID3D11DeviceContext* Context();
+	unsigned char* LocalData(unsigned int bufferIndex);
+
+	// The command buffer this thread is recording into, if any (see RecordCommands)
+	CommandBuffer* Commands();
+	// Writes the shader and its constant buffers into the command buffer, if there is one
+	bool RecordShaderAndCBs(ShaderStage stage, void* shader, void* inputLayout = nullptr);
+
+	// Each recording slot's copy of the local data buffers, made the first time it's needed in a recording
+	struct RecordingCopy
+	{
+		unsigned long long Recording = 0;
+		std::vector<std::vector<unsigned char>> Buffers;
+	};
+	RecordingCopy recordingCopies[SIMPLE_SHADER_RECORDING_SLOTS];
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -178,8 +243,10 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	bool perInstanceCompatible;
@@ -201,8 +268,10 @@ public:
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
@@ -221,8 +290,10 @@ public:
 	~SimpleDomainShader();
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
@@ -241,8 +312,10 @@ public:
 	~SimpleHullShader();
 	Microsoft::WRL::ComPtr<ID3D11HullShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
@@ -261,8 +334,10 @@ public:
 	~SimpleGeometryShader();
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -300,17 +375,22 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool HasUnorderedAccessView(std::string name);
+	bool HasUnorderedAccessView(const std::string& name) { return HasUnorderedAccessView(name.c_str()); }
+	bool HasUnorderedAccessView(const char* name);
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
-	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetShaderResourceView(const char* name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(const char* name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetUnorderedAccessView(const std::string& name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1) { return SetUnorderedAccessView(name.c_str(), uav, appendConsumeOffset); }
+	bool SetUnorderedAccessView(const char* name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(const std::string& name) { return GetUnorderedAccessViewIndex(name.c_str()); }
+	int GetUnorderedAccessViewIndex(const char* name);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
+	std::map<std::string, unsigned int, std::less<>> uavTable;
 
 	unsigned int threadsX;
 	unsigned int threadsY;
@@ -1,16 +1,20 @@
 #include "Sky.h"
+#include "MemoryTracker.h"
 
-#include <WICTextureLoader.h>
 #include <format>
 
 using namespace DirectX;
 
-Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const wchar_t* textureFilepath, const wchar_t* vsFilepath, const wchar_t* psFilepath)
+Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const wchar_t* textureFilepath, const wchar_t* vsFilepath, const wchar_t* psFilepath, std::shared_ptr<AssetManager> assets)
 	: mesh(mesh),
 	samplerState(samplerState),
 	device(device),
-	context(context)
+	context(context),
+	commands(1024),
+	executor(context)
 {
+	MEMORY_SCOPE(MEMORY_SKY);
+
 	// Doing some concatenation so only one url has to be passed in instead of six
 	wchar_t right[1000];
 	wchar_t left[1000];
@@ -25,10 +29,20 @@ Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState>
 	swprintf_s(down, wcslen(textureFilepath) + 10, L"%s\\down.png", textureFilepath);
 	swprintf_s(front, wcslen(textureFilepath) + 11, L"%s\\front.png", textureFilepath);
 	swprintf_s(back, wcslen(textureFilepath) + 10, L"%s\\back.png", textureFilepath);
-	skyTextureSRV = CreateCubemap(right, left, up, down, front, back);
-
-	vertexShader = std::make_shared<SimpleVertexShader>(device, context, vsFilepath);
-	pixelShader = std::make_shared<SimplePixelShader>(device, context, psFilepath);
+	if (assets)
+	{
+		// Shared with anything else using the same files.  Shows a plain cube until the real one is ready.
+		skyTextureSRV = assets->GetCubemap({ right, left, up, down, front, back },
+			[this](Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) { skyTextureSRV = srv; });
+		vertexShader = assets->GetVertexShader(vsFilepath);
+		pixelShader = assets->GetPixelShader(psFilepath);
+	}
+	else
+	{
+		skyTextureSRV = CreateCubemap(right, left, up, down, front, back);
+		vertexShader = std::make_shared<SimpleVertexShader>(device, context, vsFilepath);
+		pixelShader = std::make_shared<SimplePixelShader>(device, context, psFilepath);
+	}
 
 	Init();
 }
@@ -39,8 +53,18 @@ Sky::~Sky()
 
 void Sky::Draw(std::shared_ptr<Camera> camera)
 {
-	context->RSSetState(rasterizerState.Get());
-	context->OMSetDepthStencilState(depthState.Get(), 0);
+	commands.Reset();
+	Draw(commands, camera);
+	executor.Execute(commands);
+}
+
+void Sky::Draw(CommandBuffer& commands, std::shared_ptr<Camera> camera)
+{
+	CommandBuffer* previous = ISimpleShader::GetRecordingCommands();
+	ISimpleShader::RecordCommands(&commands);
+
+	commands.SetRasterizerState(rasterizerState.Get());
+	commands.SetDepthStencilState(depthState.Get(), 0);
 
 	vertexShader->SetMatrix4x4("view", camera->GetViewMatrix());
 	vertexShader->SetMatrix4x4("projection", camera->GetProjectionMatrix());
@@ -53,11 +77,13 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	vertexShader->SetShader();
 	pixelShader->SetShader();
 
-	mesh->Draw(context);
+	mesh->Draw(commands);
 
 	// Resetting states
-	context->RSSetState(nullptr);
-	context->OMSetDepthStencilState(nullptr, 0);
+	commands.SetRasterizerState(nullptr);
+	commands.SetDepthStencilState(nullptr, 0);
+
+	ISimpleShader::RecordCommands(previous);
 }
 
 std::shared_ptr<SimpleVertexShader> Sky::GetVertexShader()
@@ -71,10 +97,10 @@ std::shared_ptr<SimplePixelShader> Sky::GetPixelShader()
 }
 
 // --------------------------------------------------------
-// Loads six individual textures (the six faces of a cube map), then
-// creates a blank cube map and copies each of the six textures to
-// another face.  Afterwards, creates a shader resource view for
-// the cube map and cleans up all of the temporary resources.
+// Loads six individual textures (the six faces of a cube map),
+// builds a full mip chain for each face on the CPU, then creates
+// the cube map with every face and mip as initial data and
+// returns a shader resource view for it.
 // --------------------------------------------------------
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	const wchar_t* right,
@@ -84,78 +110,8 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	const wchar_t* front,
 	const wchar_t* back)
 {
-	// Load the 6 textures into an array.
-	// - We need references to the TEXTURES, not SHADER RESOURCE VIEWS!
-	// - Explicitly NOT generating mipmaps, as we don't need them for the sky!
-	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[6] = {};
-	CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)textures[0].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)textures[1].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)textures[2].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
-	CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
-
-	// We'll assume all of the textures are the same color format and resolution,
-	// so get the description of the first texture
-	D3D11_TEXTURE2D_DESC faceDesc = {};
-	textures[0]->GetDesc(&faceDesc);
-
-	// Describe the resource for the cube map, which is simply 
-	// a "texture 2d array" with the TEXTURECUBE flag set.  
-	// This is a special GPU resource format, NOT just a 
-	// C++ array of textures!!!
-	D3D11_TEXTURE2D_DESC cubeDesc = {};
-	cubeDesc.ArraySize = 6;            // Cube map!
-	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE; // We'll be using as a texture in a shader
-	cubeDesc.CPUAccessFlags = 0;       // No read back
-	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
-	cubeDesc.Width = faceDesc.Width;   // Match the size
-	cubeDesc.Height = faceDesc.Height; // Match the size
-	cubeDesc.MipLevels = 1;            // Only need 1
-	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // This should be treated as a CUBE, not 6 separate textures
-	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
-	cubeDesc.SampleDesc.Count = 1;
-	cubeDesc.SampleDesc.Quality = 0;
-
-	// Create the final texture resource to hold the cube map
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
-	device->CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
-
-	// Loop through the individual face textures and copy them,
-	// one at a time, to the cube map texure
-	for (int i = 0; i < 6; i++)
-	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,  // Which mip (zero, since there's only one)
-			i,  // Which array element?
-			1); // How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		context->CopySubresourceRegion(
-			cubeMapTexture.Get(),  // Destination resource
-			subresource,           // Dest subresource index (one of the array elements)
-			0, 0, 0,               // XYZ location of copy
-			textures[i].Get(),     // Source resource
-			0,                     // Source subresource index (we're assuming there's only one)
-			0);                    // Source subresource "box" of data to copy (zero means the whole thing)
-	}
-
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = cubeDesc.Format;         // Same format as texture
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;        // Only need access to 1 mip
-	srvDesc.TextureCube.MostDetailedMip = 0;  // Index of the first mip we want to see
-
-	// Make the SRV
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
-	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
-
-	// Send back the SRV, which is what we need for our shaders
-	return cubeSRV;
+	// Order matters here!  +X, -X, +Y, -Y, +Z, -Z
+	return CreatePreparedTexture(device, PrepareCubemap({ right, left, up, down, front, back }));
 }
 
 void Sky::Init()
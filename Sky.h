@@ -8,6 +8,8 @@
 #include "DXCore.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "AssetManager.h"
+#include "CommandBufferD3D11.h"
 
 #include <memory>
 #include <wrl/client.h>
@@ -15,10 +17,12 @@
 class Sky
 {
 public:
-	Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const wchar_t* textureFilepath, const wchar_t* vsFilepath, const wchar_t* psFilepath);
+	Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const wchar_t* textureFilepath, const wchar_t* vsFilepath, const wchar_t* psFilepath, std::shared_ptr<AssetManager> assets = nullptr);
 	~Sky();
 
 	void Draw(std::shared_ptr<Camera> camera);
+	// Records the sky's draw (and putting the states back after) without running it
+	void Draw(CommandBuffer& commands, std::shared_ptr<Camera> camera);
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 
@@ -42,6 +46,9 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Device> device; // Holding onto these so that cube maps can be created as needed
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context; // Holding onto these so that cube maps can be created as needed
 
+	CommandBuffer commands; // Draw() records into this, then runs it on the context
+	CommandBufferD3D11 executor;
+
 	void Init();
 };
 
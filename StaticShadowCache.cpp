@@ -0,0 +1,43 @@
+#include "StaticShadowCache.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+
+StaticShadowCache::StaticShadowCache()
+{
+	Invalidate();
+}
+
+// --------------------------------------------------------
+// Matrices are compared bit for bit.  Cascades are snapped
+// to whole steps and their near planes rounded to whole
+// depth steps, so they come out exactly the same until the
+// camera has moved a step or something static has changed.
+// --------------------------------------------------------
+bool StaticShadowCache::NeedsUpdate(unsigned int cascade, const XMFLOAT4X4& viewProjection, const StaticShadowCaster* casters, size_t casterCount)
+{
+	CachedState& state = cached[cascade];
+	bool same = state.Valid &&
+		memcmp(&state.ViewProjection, &viewProjection, sizeof(XMFLOAT4X4)) == 0 &&
+		state.Casters.size() == casterCount;
+	for (size_t i = 0; same && i < casterCount; i++)
+	{
+		same = state.Casters[i].Index == casters[i].Index &&
+			state.Casters[i].TransformVersion == casters[i].TransformVersion;
+	}
+	if (same)
+		return false;
+
+	state.Valid = true;
+	state.ViewProjection = viewProjection;
+	state.Casters.assign(casters, casters + casterCount);
+	return true;
+}
+
+void StaticShadowCache::Invalidate()
+{
+	for (CachedState& state : cached)
+		state.Valid = false;
+}
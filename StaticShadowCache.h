@@ -0,0 +1,43 @@
+#pragma once
+
+// Decides when a cascade's cached static shadow map has to be re-rendered
+// - Static casters are drawn once into their own depth map, which is copied into the
+//   cascade each frame before the dynamic casters are drawn on top
+// - A cascade's cache goes stale when its matrices change, when a different set of static
+//   casters is needed, or when any of their transforms changes.  The matrices only depend on
+//   the light, the static casters and which step the cascade is on (see SHADOW_CASCADE_SNAP
+//   and ShadowCulling.h), not on exactly where the camera is or on dynamic objects.
+// - No D3D, so the invalidation rules can be checked away from the renderer
+
+#include "ShadowCascades.h"
+
+#include <vector>
+
+struct StaticShadowCaster
+{
+	unsigned int Index;				// Which object
+	unsigned int TransformVersion;	// See Transform::GetVersion()
+};
+
+class StaticShadowCache
+{
+public:
+	StaticShadowCache();
+
+	// Compares this frame's state for a cascade with the one its cache was rendered with.
+	// Returns true if it's stale, in which case the caller must re-render it this frame.
+	bool NeedsUpdate(unsigned int cascade, const DirectX::XMFLOAT4X4& viewProjection, const StaticShadowCaster* casters, size_t casterCount);
+
+	// Forces every cascade to re-render next time (e.g. when the shadow maps are recreated)
+	void Invalidate();
+
+private:
+	struct CachedState
+	{
+		bool Valid;
+		DirectX::XMFLOAT4X4 ViewProjection;
+		std::vector<StaticShadowCaster> Casters;
+	};
+
+	CachedState cached[MAX_SHADOW_CASCADES];
+};
@@ -0,0 +1,197 @@
+#include "TextureLoader.h"
+#include "MemoryTrackerD3D11.h"
+
+#include <DDSTextureLoader.h>
+
+#include <chrono>
+
+
+namespace
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateSolidTexture(Microsoft::WRL::ComPtr<ID3D11Device> device, const unsigned char color[4], bool cube)
+	{
+		PreparedTexture texture;
+		ImageData pixel;
+		pixel.Width = 1;
+		pixel.Height = 1;
+		pixel.Pixels.assign(color, color + 4);
+		texture.Mips.assign(cube ? 6 : 1, { pixel });
+		return CreatePreparedTexture(device, texture);
+	}
+}
+
+
+TextureLoader::TextureLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int threadCount)
+	: device(device),
+	workers(threadCount)
+{
+	MEMORY_SCOPE(MEMORY_TEXTURES);
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	const unsigned char flatNormal[4] = { 128, 128, 255, 255 };
+	const unsigned char orm[4] = { 255, 128, 0, 255 };
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	placeholders[PLACEHOLDER_WHITE] = CreateSolidTexture(device, white, false);
+	placeholders[PLACEHOLDER_FLAT_NORMAL] = CreateSolidTexture(device, flatNormal, false);
+	placeholders[PLACEHOLDER_ORM] = CreateSolidTexture(device, orm, false);
+	placeholders[PLACEHOLDER_CUBE] = CreateSolidTexture(device, grey, true);
+}
+
+TextureLoader::~TextureLoader()
+{
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::LoadCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName, PlaceholderType placeholder, LoadedCallback onLoaded)
+{
+	return Queue([=]() { return PrepareCompressedTexture(textureFolder, textureName); }, placeholder, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::LoadPackedORM(const std::filesystem::path& textureFolder, const std::string& materialName, LoadedCallback onLoaded)
+{
+	return Queue([=]() { return PreparePackedORM(textureFolder, materialName); }, PLACEHOLDER_ORM, onLoaded);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::LoadCubemap(const std::vector<std::filesystem::path>& facePaths, LoadedCallback onLoaded)
+{
+	return Queue([=]() { return PrepareCubemap(facePaths); }, PLACEHOLDER_CUBE, onLoaded);
+}
+
+// --------------------------------------------------------
+// Checks each pending load without blocking and uploads the
+// ones whose decoding has finished
+// --------------------------------------------------------
+void TextureLoader::ProcessCompletedLoads()
+{
+	for (size_t i = 0; i < pendingLoads.size();)
+	{
+		if (pendingLoads[i].texture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		// Take it out of the list first, as the callback is free to queue more loads
+		PendingLoad load = std::move(pendingLoads[i]);
+		pendingLoads.erase(pendingLoads.begin() + i);
+		Complete(load);
+	}
+}
+
+void TextureLoader::FinishAllLoads()
+{
+	while (!pendingLoads.empty())
+	{
+		PendingLoad load = std::move(pendingLoads.front());
+		pendingLoads.erase(pendingLoads.begin());
+		Complete(load);
+	}
+}
+
+unsigned int TextureLoader::GetPendingLoadCount()
+{
+	return (unsigned int)pendingLoads.size();
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::GetPlaceholder(PlaceholderType type)
+{
+	return placeholders[type];
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::Load(std::function<PreparedTexture()> prepare, PlaceholderType placeholder, PreparedCallback onPrepared)
+{
+	PendingLoad load;
+	load.texture = workers.Submit([prepare]() {
+		MEMORY_SCOPE(MEMORY_TEXTURES);
+		return prepare();
+	});
+	load.onPrepared = onPrepared;
+	pendingLoads.push_back(std::move(load));
+	return placeholders[placeholder];
+}
+
+// --------------------------------------------------------
+// Creates the real texture and hands it over.  Anything that
+// failed to load just keeps its placeholder.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureLoader::Queue(std::function<PreparedTexture()> prepare, PlaceholderType placeholder, LoadedCallback onLoaded)
+{
+	Microsoft::WRL::ComPtr<ID3D11Device> device = this->device;
+	return Load(prepare, placeholder, [device, onLoaded](PreparedTexture& texture) {
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv = CreatePreparedTexture(device, texture);
+		if (srv && onLoaded)
+			onLoaded(srv);
+	});
+}
+
+void TextureLoader::Complete(PendingLoad& load)
+{
+	MEMORY_SCOPE(MEMORY_TEXTURES);
+	PreparedTexture texture = load.texture.get();
+	if (load.onPrepared)
+		load.onPrepared(texture);
+}
+
+// --------------------------------------------------------
+// DDS data goes through DirectXTK, which understands the block
+// compressed formats.  Raw mips become an immutable RGBA8
+// texture (or cube map) with every subresource filled in.
+// Either way it's tracked under the caller's memory tag.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreatePreparedTexture(Microsoft::WRL::ComPtr<ID3D11Device> device, const PreparedTexture& texture)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (!texture.DDSData.empty())
+	{
+		if (FAILED(DirectX::CreateDDSTextureFromMemory(device.Get(), texture.DDSData.data(), texture.DDSData.size(), nullptr, srv.GetAddressOf())))
+			return nullptr;
+		TrackGpuResource(srv.Get(), GetMemoryTag());
+		return srv;
+	}
+	if (texture.Mips.empty() || texture.Mips[0].empty())
+		return nullptr;
+
+	unsigned int faceCount = (unsigned int)texture.Mips.size();
+	unsigned int mipCount = (unsigned int)texture.Mips[0].size();
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.ArraySize = faceCount;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // ImageData is always RGBA8
+	desc.Width = texture.Mips[0][0].Width;
+	desc.Height = texture.Mips[0][0].Height;
+	desc.MipLevels = mipCount;
+	desc.MiscFlags = texture.IsCubemap() ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE; // Never changes after creation
+	desc.SampleDesc.Count = 1;
+
+	// One entry per subresource, ordered face by face with each face's mips in order
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(faceCount * mipCount);
+	for (unsigned int face = 0; face < faceCount; face++)
+	{
+		for (unsigned int mip = 0; mip < mipCount; mip++)
+		{
+			D3D11_SUBRESOURCE_DATA& data = initialData[D3D11CalcSubresource(mip, face, mipCount)];
+			data.pSysMem = texture.Mips[face][mip].Pixels.data();
+			data.SysMemPitch = texture.Mips[face][mip].Width * 4;
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> resource;
+	if (FAILED(device->CreateTexture2D(&desc, initialData.data(), resource.GetAddressOf())))
+		return nullptr;
+	TrackGpuResource(resource.Get(), GetMemoryTag());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	if (texture.IsCubemap())
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = mipCount;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = mipCount;
+	}
+	device->CreateShaderResourceView(resource.Get(), &srvDesc, srv.GetAddressOf());
+	return srv;
+}
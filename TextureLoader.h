@@ -0,0 +1,74 @@
+#pragma once
+
+// Loads textures in the background so startup doesn't wait on decoding
+// - Files are read, decoded and mipmapped on a WorkerPool
+// - The main thread only creates the GPU resources, in ProcessCompletedLoads()
+// - Until then, requests hand back a small placeholder so rendering can start right away
+
+#include "DXCore.h"
+#include "TextureProcessing.h"
+#include "WorkerPool.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wrl/client.h>
+
+// What a placeholder should look like while the real texture loads
+enum PlaceholderType
+{
+	PLACEHOLDER_WHITE,		// Albedo (the material tint shows through)
+	PLACEHOLDER_FLAT_NORMAL,	// Tangent space (0, 0, 1)
+	PLACEHOLDER_ORM,			// Unoccluded, half rough, not metal
+	PLACEHOLDER_CUBE			// Plain grey cube map
+};
+
+class TextureLoader
+{
+public:
+	// Called on the main thread once the real texture has been created
+	typedef std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> LoadedCallback;
+
+	// Called on the main thread with the decoded data, for callers that create the texture themselves
+	typedef std::function<void(PreparedTexture&)> PreparedCallback;
+
+	TextureLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int threadCount = 0);
+	~TextureLoader();
+
+	// Each of these queues a background load and returns the placeholder to use in the meantime
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName, PlaceholderType placeholder, LoadedCallback onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadPackedORM(const std::filesystem::path& textureFolder, const std::string& materialName, LoadedCallback onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadCubemap(const std::vector<std::filesystem::path>& facePaths, LoadedCallback onLoaded);
+
+	// Runs any preparation in the background, then hands the result over instead of uploading it
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Load(std::function<PreparedTexture()> prepare, PlaceholderType placeholder, PreparedCallback onPrepared);
+
+	// Uploads any loads that have finished decoding.  Call once per frame on the main thread.
+	void ProcessCompletedLoads();
+
+	// Blocks until every queued load has been uploaded
+	void FinishAllLoads();
+
+	unsigned int GetPendingLoadCount();
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetPlaceholder(PlaceholderType type);
+
+private:
+	struct PendingLoad
+	{
+		std::future<PreparedTexture> texture;
+		PreparedCallback onPrepared;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Queue(std::function<PreparedTexture()> prepare, PlaceholderType placeholder, LoadedCallback onLoaded);
+	void Complete(PendingLoad& load);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholders[4];
+	std::vector<PendingLoad> pendingLoads;
+	WorkerPool workers; // Declared last so it shuts down (and finishes its tasks) first
+};
+
+// Creates the GPU texture for already prepared data, or returns null if that fails
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreatePreparedTexture(Microsoft::WRL::ComPtr<ID3D11Device> device, const PreparedTexture& texture);
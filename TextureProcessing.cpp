@@ -0,0 +1,295 @@
+#include "TextureProcessing.h"
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <system_error>
+
+namespace
+{
+	bool HasSuffix(const std::string& name, const std::string& suffix)
+	{
+		return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// Reads a cached DDS, but only if all of it is there
+	bool ReadCachedDDS(const std::filesystem::path& path, std::vector<unsigned char>& bytes)
+	{
+		if (path.empty() || !ReadFileBytes(path, bytes) || !IsCompleteDDS(bytes.data(), bytes.size()))
+		{
+			bytes.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// Fills in the hash once a prepared texture's data is final
+	PreparedTexture FinishPreparing(PreparedTexture&& prepared)
+	{
+		unsigned long long hash = HashBytes(prepared.DDSData.data(), prepared.DDSData.size());
+		for (const std::vector<ImageData>& face : prepared.Mips)
+		{
+			for (const ImageData& mip : face)
+			{
+				hash = HashBytes(&mip.Width, sizeof(mip.Width), hash);
+				hash = HashBytes(&mip.Height, sizeof(mip.Height), hash);
+				hash = HashBytes(mip.Pixels.data(), mip.Pixels.size(), hash);
+			}
+		}
+		prepared.ContentHash = hash;
+		return std::move(prepared);
+	}
+}
+
+
+size_t PreparedTexture::GetByteSize() const
+{
+	// DDS headers are tiny compared to the data, so the file size is close enough
+	size_t size = DDSData.size();
+	for (const std::vector<ImageData>& face : Mips)
+	{
+		for (const ImageData& mip : face)
+			size += mip.Pixels.size();
+	}
+	return size;
+}
+
+
+// --------------------------------------------------------
+// Packs occlusion, roughness and metalness into the R, G
+// and B channels of a single texture.  Alpha is left at 1.
+// --------------------------------------------------------
+ImageData PackORM(const ImageData* occlusion, const ImageData& roughness, const ImageData& metalness)
+{
+	// Use the largest input's resolution so no detail is thrown away
+	unsigned int width = std::max(roughness.Width, metalness.Width);
+	unsigned int height = std::max(roughness.Height, metalness.Height);
+	if (occlusion)
+	{
+		width = std::max(width, occlusion->Width);
+		height = std::max(height, occlusion->Height);
+	}
+
+	// Resample anything that doesn't match (metal maps are often authored tiny)
+	auto matchSize = [width, height](const ImageData& image) {
+		return (image.Width == width && image.Height == height) ? image : ResizeBilinear(image, width, height);
+	};
+	ImageData r = matchSize(roughness);
+	ImageData m = matchSize(metalness);
+	ImageData o;
+	if (occlusion)
+		o = matchSize(*occlusion);
+
+	ImageData packed;
+	packed.Width = width;
+	packed.Height = height;
+	packed.Pixels.resize((size_t)width * height * 4);
+	size_t pixelCount = (size_t)width * height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		unsigned char* out = &packed.Pixels[i * 4];
+		out[ORM_CHANNEL_OCCLUSION] = occlusion ? o.Pixels[i * 4] : 255;
+		out[ORM_CHANNEL_ROUGHNESS] = r.Pixels[i * 4];
+		out[ORM_CHANNEL_METALNESS] = m.Pixels[i * 4];
+		out[3] = 255;
+	}
+	return packed;
+}
+
+
+std::filesystem::path GetCachedTexturePath(const std::filesystem::path& textureFolder, const std::string& cachedName)
+{
+	return textureFolder / "Cache" / ("v" + std::to_string(TEXTURE_CACHE_VERSION)) / (cachedName + ".dds");
+}
+
+
+// --------------------------------------------------------
+// Simple timestamp-based cache check
+// --------------------------------------------------------
+bool IsCacheFresh(const std::filesystem::path& cachedFile, std::initializer_list<std::filesystem::path> sources)
+{
+	std::error_code error;
+	auto cachedTime = std::filesystem::last_write_time(cachedFile, error);
+	if (error)
+		return false;
+
+	for (const std::filesystem::path& source : sources)
+	{
+		if (source.empty() || !std::filesystem::exists(source, error))
+			continue;
+		if (std::filesystem::last_write_time(source, error) > cachedTime || error)
+			return false;
+	}
+	return true;
+}
+
+
+std::filesystem::path BuildPackedORM(const std::filesystem::path& textureFolder, const std::string& materialName, bool forceRebuild)
+{
+	std::filesystem::path roughnessPath = textureFolder / (materialName + "_roughness.png");
+	std::filesystem::path metalnessPath = textureFolder / (materialName + "_metal.png");
+	std::filesystem::path occlusionPath = textureFolder / (materialName + "_ao.png");
+	std::filesystem::path cachedPath = GetCachedTexturePath(textureFolder, materialName + "_orm");
+
+	if (!forceRebuild && IsCacheFresh(cachedPath, { roughnessPath, metalnessPath, occlusionPath }))
+		return cachedPath;
+
+	ImageData roughness;
+	ImageData metalness;
+	ImageData occlusion;
+	if (!LoadPNG(roughnessPath, roughness) || !LoadPNG(metalnessPath, metalness))
+		return std::filesystem::path();
+	bool hasOcclusion = LoadPNG(occlusionPath, occlusion);
+
+	ImageData packed = PackORM(hasOcclusion ? &occlusion : nullptr, roughness, metalness);
+
+	std::error_code error;
+	std::filesystem::create_directories(cachedPath.parent_path(), error);
+	std::vector<ImageData> mips = GenerateMipChain(packed, MIP_CONTENT_LINEAR);
+	if (!SaveCompressedDDS(cachedPath, CompressMipChain(mips, BC_FORMAT_BC7)))
+		return std::filesystem::path();
+	return cachedPath;
+}
+
+
+std::filesystem::path BuildCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName, BCFormat format, bool forceRebuild)
+{
+	std::filesystem::path sourcePath = textureFolder / (textureName + ".png");
+	std::filesystem::path cachedPath = GetCachedTexturePath(textureFolder, textureName);
+
+	if (!forceRebuild && IsCacheFresh(cachedPath, { sourcePath }))
+		return cachedPath;
+
+	ImageData source;
+	if (!LoadPNG(sourcePath, source))
+		return std::filesystem::path();
+
+	std::error_code error;
+	std::filesystem::create_directories(cachedPath.parent_path(), error);
+	std::vector<ImageData> mips = GenerateMipChain(source, ChooseMipContent(textureName));
+	if (!SaveCompressedDDS(cachedPath, CompressMipChain(mips, format)))
+		return std::filesystem::path();
+	return cachedPath;
+}
+
+
+PreparedTexture PrepareCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName)
+{
+	PreparedTexture prepared;
+	BCFormat format = ChooseBCFormat(textureName);
+	std::filesystem::path cachedPath = BuildCompressedTexture(textureFolder, textureName, format);
+
+	// A cached file can be newer than its source and still be no good (cut short by a crash, say), so it's rebuilt
+	bool cached = ReadCachedDDS(cachedPath, prepared.DDSData);
+	if (!cached && !cachedPath.empty())
+	{
+		cachedPath = BuildCompressedTexture(textureFolder, textureName, format, true);
+		cached = ReadCachedDDS(cachedPath, prepared.DDSData);
+	}
+	if (cached)
+	{
+		prepared.CachedFile = cachedPath;
+		return FinishPreparing(std::move(prepared));
+	}
+
+	ImageData source;
+	if (LoadPNG(textureFolder / (textureName + ".png"), source))
+		prepared.Mips.push_back(GenerateMipChain(source, ChooseMipContent(textureName)));
+	return FinishPreparing(std::move(prepared));
+}
+
+
+PreparedTexture PreparePackedORM(const std::filesystem::path& textureFolder, const std::string& materialName)
+{
+	PreparedTexture prepared;
+	std::filesystem::path cachedPath = BuildPackedORM(textureFolder, materialName);
+	bool cached = ReadCachedDDS(cachedPath, prepared.DDSData);
+	if (!cached && !cachedPath.empty())
+	{
+		cachedPath = BuildPackedORM(textureFolder, materialName, true);
+		cached = ReadCachedDDS(cachedPath, prepared.DDSData);
+	}
+	if (cached)
+	{
+		prepared.CachedFile = cachedPath;
+		return FinishPreparing(std::move(prepared));
+	}
+
+	ImageData roughness;
+	ImageData metalness;
+	ImageData occlusion;
+	if (!LoadPNG(textureFolder / (materialName + "_roughness.png"), roughness) || !LoadPNG(textureFolder / (materialName + "_metal.png"), metalness))
+		return prepared;
+	bool hasOcclusion = LoadPNG(textureFolder / (materialName + "_ao.png"), occlusion);
+
+	prepared.Mips.push_back(GenerateMipChain(PackORM(hasOcclusion ? &occlusion : nullptr, roughness, metalness), MIP_CONTENT_LINEAR));
+	return FinishPreparing(std::move(prepared));
+}
+
+
+PreparedTexture PrepareCubemap(const std::vector<std::filesystem::path>& facePaths)
+{
+	PreparedTexture prepared;
+	std::vector<ImageData> faces(facePaths.size());
+	int loadedFace = -1;
+	for (size_t i = 0; i < faces.size(); i++)
+	{
+		if (LoadPNG(facePaths[i], faces[i]))
+			loadedFace = (int)i;
+	}
+	if (loadedFace < 0)
+		return prepared;
+
+	// A cube map needs all six faces, so any that are missing are filled
+	// with the average color of one that loaded rather than left black
+	for (ImageData& face : faces)
+	{
+		if (face.IsValid())
+			continue;
+
+		const ImageData& source = faces[loadedFace];
+		unsigned long long sum[4] = {};
+		for (size_t p = 0; p < source.Pixels.size(); p++)
+			sum[p % 4] += source.Pixels[p];
+
+		size_t pixelCount = (size_t)source.Width * source.Height;
+		face.Width = source.Width;
+		face.Height = source.Height;
+		face.Pixels.resize(source.Pixels.size());
+		for (size_t p = 0; p < face.Pixels.size(); p++)
+			face.Pixels[p] = (unsigned char)(sum[p % 4] / pixelCount);
+	}
+
+	// Sky textures are gamma encoded color, so filter accordingly.  Faces are done in parallel.
+	prepared.Mips = GenerateMipChains(faces, MIP_CONTENT_GAMMA);
+	return FinishPreparing(std::move(prepared));
+}
+
+
+// --------------------------------------------------------
+//  - Normal maps only need X and Y (Z is rebuilt in the shader): BC5
+//  - Single channel maps: BC4
+//  - Everything else (albedo, packed maps): BC7
+// --------------------------------------------------------
+BCFormat ChooseBCFormat(const std::string& textureName)
+{
+	if (HasSuffix(textureName, "_normals"))
+		return BC_FORMAT_BC5;
+	if (HasSuffix(textureName, "_roughness") || HasSuffix(textureName, "_metal") || HasSuffix(textureName, "_ao"))
+		return BC_FORMAT_BC4;
+	return BC_FORMAT_BC7;
+}
+
+
+// --------------------------------------------------------
+//  - Normal maps: renormalized
+//  - Albedo: filtered in linear space, since it's authored gamma encoded
+//  - Everything else is plain data
+// --------------------------------------------------------
+MipContent ChooseMipContent(const std::string& textureName)
+{
+	if (HasSuffix(textureName, "_normals"))
+		return MIP_CONTENT_NORMAL_MAP;
+	if (HasSuffix(textureName, "_albedo"))
+		return MIP_CONTENT_GAMMA;
+	return MIP_CONTENT_LINEAR;
+}
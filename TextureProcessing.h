@@ -0,0 +1,72 @@
+#pragma once
+
+// Asset-processing stage that turns authored textures into GPU-friendly ones
+// - Results are cached on disk next to the source textures (in a "Cache" folder)
+// - No Windows/D3D dependencies, so the same code backs the offline TextureTool
+
+#include "ImageData.h"
+#include "BlockCompression.h"
+#include "MipGeneration.h"
+
+#include <filesystem>
+#include <string>
+
+// Channel layout of a packed occlusion/roughness/metalness texture
+#define ORM_CHANNEL_OCCLUSION	0	// R
+#define ORM_CHANNEL_ROUGHNESS	1	// G
+#define ORM_CHANNEL_METALNESS	2	// B
+
+// Packs three single-channel maps (read from their red channels) into one RGBA image.
+// Occlusion may be null, in which case it is fully unoccluded (1.0).
+// Inputs of different sizes are resampled up to the largest of them.
+ImageData PackORM(const ImageData* occlusion, const ImageData& roughness, const ImageData& metalness);
+
+// A texture that's ready to go to the GPU, but hasn't yet
+// - Produced on worker threads, so the main thread only has to create the resource
+struct PreparedTexture
+{
+	std::vector<unsigned char> DDSData;			// Preferably the cached, block compressed file's contents...
+	std::vector<std::vector<ImageData>> Mips;	// ...otherwise uncompressed mips, [face][mip] (6 faces for a cube map)
+	unsigned long long ContentHash = 0;			// Of the data above, so identical textures can share one GPU copy
+	std::filesystem::path CachedFile;			// Where DDSData was read from, so a file the GPU won't take can be rebuilt
+
+	bool IsValid() const { return !DDSData.empty() || !Mips.empty(); }
+	bool IsCubemap() const { return Mips.size() == 6; }
+	size_t GetByteSize() const;
+};
+
+// Bumped whenever processing changes in a way that makes older cached files wrong
+#define TEXTURE_CACHE_VERSION	2
+
+// Where the processed version of a source texture lives, e.g.
+// "Textures/wood_roughness.png" + "_orm" -> "Textures/Cache/v2/wood_orm.dds"
+std::filesystem::path GetCachedTexturePath(const std::filesystem::path& textureFolder, const std::string& cachedName);
+
+// Is the cached file present and newer than every (existing) source?
+bool IsCacheFresh(const std::filesystem::path& cachedFile, std::initializer_list<std::filesystem::path> sources);
+
+// Builds (or reuses) the packed ORM texture for a material following our
+// "<name>_roughness.png", "<name>_metal.png", optional "<name>_ao.png" naming.
+// The result is BC7 compressed, with a full mip chain.  Returns the path of the cached DDS, or an empty path if the sources could not be read.
+std::filesystem::path BuildPackedORM(const std::filesystem::path& textureFolder, const std::string& materialName, bool forceRebuild = false);
+
+// Builds (or reuses) a block compressed, fully mipmapped copy of "<textureName>.png", cached as "Cache/v2/<textureName>.dds".
+// Returns the path of the cached DDS, or an empty path if the source could not be read.
+std::filesystem::path BuildCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName, BCFormat format, bool forceRebuild = false);
+
+// Everything needed to upload a material texture.  Uses the compressed cache when possible, rebuilding a cached
+// file that's cut short, and falling back to mipmapping the PNG in memory if the cache can't be written.
+PreparedTexture PrepareCompressedTexture(const std::filesystem::path& textureFolder, const std::string& textureName);
+
+// Same as above for a packed ORM texture (see BuildPackedORM)
+PreparedTexture PreparePackedORM(const std::filesystem::path& textureFolder, const std::string& materialName);
+
+// Loads and mipmaps the six faces of a cube map, ordered +X, -X, +Y, -Y, +Z, -Z.
+// Faces that fail to load are filled with the average color of one that didn't.
+PreparedTexture PrepareCubemap(const std::vector<std::filesystem::path>& facePaths);
+
+// The format we compress each kind of map to, based on our "_albedo"/"_normals"/etc. suffixes
+BCFormat ChooseBCFormat(const std::string& textureName);
+
+// How each kind of map is filtered when building its mips, from the same suffixes
+MipContent ChooseMipContent(const std::string& textureName);
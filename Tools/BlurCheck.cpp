@@ -0,0 +1,144 @@
+// Correctness check for the separable blur (Blur.h and PixelShader_Blur.hlsl)
+// - Not part of the Visual Studio project; it builds the game's Blur.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc BlurCheck.cpp ../Blur.cpp -o BlurCheck
+//
+// Usage:
+//   BlurCheck [width] [height]
+//     Blurs a noisy test image at every radius two ways, both done on the CPU the way the GPU would:
+//     the old full (2r+1) x (2r+1) box, one texel per read, and the separable blur from CalculateBlurTaps,
+//     with bilinear reads between texels and an 8 bit texture between the passes.  Exits non-zero if they
+//     differ by more than that 8 bit rounding allows.
+
+#include "../Blur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Image
+	{
+		int Width;
+		int Height;
+		std::vector<float> Texels; // One channel is enough: every channel is blurred the same way
+
+		float Load(int x, int y) const
+		{
+			// Clamp addressing, like the post process sampler
+			x = std::clamp(x, 0, Width - 1);
+			y = std::clamp(y, 0, Height - 1);
+			return Texels[y * Width + x];
+		}
+	};
+
+	// What the blur shader used to do: every texel in the box, each read at its center
+	Image BoxBlurReference(const Image& source, int radius)
+	{
+		Image result = { source.Width, source.Height, std::vector<float>(source.Texels.size()) };
+		for (int y = 0; y < source.Height; y++)
+		{
+			for (int x = 0; x < source.Width; x++)
+			{
+				float total = 0;
+				for (int dy = -radius; dy <= radius; dy++)
+				{
+					for (int dx = -radius; dx <= radius; dx++)
+						total += source.Load(x + dx, y + dy);
+				}
+				result.Texels[y * source.Width + x] = total / ((2 * radius + 1) * (2 * radius + 1));
+			}
+		}
+		return result;
+	}
+
+	// A bilinear read at a texel position along one axis (whole numbers are texel centers)
+	float SampleLinear(const Image& source, int x, int y, float offset, bool across)
+	{
+		float position = offset;
+		int first = (int)floorf(position);
+		float blend = position - first;
+		float a = across ? source.Load(x + first, y) : source.Load(x, y + first);
+		float b = across ? source.Load(x + first + 1, y) : source.Load(x, y + first + 1);
+		return a + (b - a) * blend;
+	}
+
+	// One pass of PixelShader_Blur.hlsl
+	Image BlurPass(const Image& source, const BlurTaps& taps, bool across)
+	{
+		Image result = { source.Width, source.Height, std::vector<float>(source.Texels.size()) };
+		for (int y = 0; y < source.Height; y++)
+		{
+			for (int x = 0; x < source.Width; x++)
+			{
+				float total = source.Load(x, y) * taps.Taps[0].y;
+				for (int i = 1; i < taps.Count; i++)
+				{
+					total += (SampleLinear(source, x, y, taps.Taps[i].x, across) +
+						SampleLinear(source, x, y, -taps.Taps[i].x, across)) * taps.Taps[i].y;
+				}
+				result.Texels[y * source.Width + x] = total;
+			}
+		}
+		return result;
+	}
+
+	// Stored in an R8G8B8A8_UNORM target between passes
+	void Quantize(Image& image)
+	{
+		for (float& texel : image.Texels)
+			texel = roundf(std::clamp(texel, 0.0f, 1.0f) * 255.0f) / 255.0f;
+	}
+
+	Image SeparableBlurReference(const Image& source, int radius)
+	{
+		BlurTaps taps = CalculateBlurTaps(radius);
+		Image across = BlurPass(source, taps, true);
+		Quantize(across);
+		Image result = BlurPass(across, taps, false);
+		Quantize(result);
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// Odd sizes by default, so the clamped edges don't line up with pairs of taps
+	int width = argc >= 2 ? atoi(argv[1]) : 67;
+	int height = argc >= 3 ? atoi(argv[2]) : 45;
+
+	// Noise over a gradient, already 8 bit like the scene it blurs
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> noise(-0.3f, 0.3f);
+	Image source = { width, height, std::vector<float>(width * height) };
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			source.Texels[y * width + x] = 0.5f * x / width + 0.2f * y / height + noise(random) + 0.3f;
+	}
+	Quantize(source);
+
+	// Each pass rounds to the nearest 8 bit step, and the first pass's rounding is averaged by the second
+	const float tolerance = 1.0f / 255.0f + 0.0001f;
+	bool failed = false;
+	for (int radius = 0; radius <= MAX_BLUR_RADIUS; radius++)
+	{
+		Image box = BoxBlurReference(source, radius);
+		Image separable = SeparableBlurReference(source, radius);
+		float maxError = 0;
+		for (size_t i = 0; i < box.Texels.size(); i++)
+			maxError = std::max(maxError, fabsf(box.Texels[i] - separable.Texels[i]));
+
+		BlurTaps taps = CalculateBlurTaps(radius);
+		bool mismatch = maxError > tolerance;
+		failed |= mismatch;
+		printf("radius %2d: %3d reads per pixel instead of %3d, max difference %.2f steps%s\n",
+			radius, 2 * (2 * taps.Count - 1), (2 * radius + 1) * (2 * radius + 1), maxError * 255.0f, mismatch ? "  MISMATCH" : "");
+	}
+
+	return failed ? 1 : 0;
+}
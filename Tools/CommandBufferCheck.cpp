@@ -0,0 +1,354 @@
+// Correctness check and submission benchmark for the render command buffers (CommandBuffer, CommandRecorder)
+// - Not part of the Visual Studio project; it builds the game's CommandBuffer.cpp and CommandRecorder.cpp on their own,
+//   plus DrawLists.cpp and JobSystem.cpp for recording on several threads
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. CommandBufferCheck.cpp ../CommandBuffer.cpp ../CommandRecorder.cpp ../DrawLists.cpp ../JobSystem.cpp ../Profiler.cpp -o CommandBufferCheck
+//
+// Usage:
+//   CommandBufferCheck [maxThreads] [frames]
+//     Writes every kind of command and reads it back, through a buffer small enough to have to grow.  Records a
+//     made up main pass (the commands the game's SimpleShaders and Meshes write for each draw, over a few
+//     materials and meshes) and checks the redundant state counts against the ones worked out by hand.  Checks
+//     that recording the same frame again, splitting it over 1, 2, 4... threads with DrawLists, or replaying a
+//     kept copy all submit exactly the same commands (same hash), and that a buffer stops allocating once it's
+//     grown to fit a frame.  Then times recording and null-executing 1k, 10k and 100k draws.  Exits non-zero
+//     if anything is wrong.
+
+#include "../CommandBuffer.h"
+#include "../CommandRecorder.h"
+#include "../DrawLists.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Stand-ins for D3D objects: nothing reads through them, so any distinct address will do
+	void* Fake(unsigned int kind, unsigned int index)
+	{
+		return (void*)(uintptr_t)(0x10000 * (kind + 1) + 16 * index);
+	}
+
+	enum FakeKind { VERTEX_SHADER, PIXEL_SHADER, INPUT_LAYOUT, CONSTANT_BUFFER, TEXTURE, SAMPLER, VERTEX_BUFFER, INDEX_BUFFER, STATE };
+
+	const unsigned int MaterialCount = 4;
+	const unsigned int MeshCount = 3;
+
+	// What Game::DrawScene records for one entity: the shaders' variables, constants, resources and the mesh.
+	// Draws are sorted by material, like they'd be if the game sorted them.
+	void RecordDraw(CommandBuffer& commands, unsigned int draw, unsigned int drawCount)
+	{
+		unsigned int material = (unsigned int)((unsigned long long)draw * MaterialCount / drawCount);
+		unsigned int mesh = draw % MeshCount;
+
+		// Vertex shader: world, worldInvTranspose, view, projection
+		float vsConstants[64];
+		for (unsigned int i = 0; i < 64; i++)
+			vsConstants[i] = i < 32 ? (float)(draw * 64 + i) : (float)(i % 7);
+		commands.UpdateConstants(Fake(CONSTANT_BUFFER, 0), vsConstants, sizeof(vsConstants));
+
+		// Pixel shader: the tint and roughness change per material, the rest is the same all frame
+		float psConstants[48];
+		for (unsigned int i = 0; i < 48; i++)
+			psConstants[i] = i < 4 ? (float)material : (float)(i % 5);
+		commands.UpdateConstants(Fake(CONSTANT_BUFFER, 1), psConstants, sizeof(psConstants));
+		for (unsigned int t = 0; t < 6; t++)
+			commands.SetShaderResource(SHADER_STAGE_PIXEL, t, Fake(TEXTURE, t));
+		commands.SetShaderResource(SHADER_STAGE_PIXEL, 6, Fake(TEXTURE, 100 + material));
+		commands.SetSampler(SHADER_STAGE_PIXEL, 0, Fake(SAMPLER, 0));
+
+		commands.SetShader(SHADER_STAGE_VERTEX, Fake(VERTEX_SHADER, 0), Fake(INPUT_LAYOUT, 0));
+		commands.SetConstantBuffer(SHADER_STAGE_VERTEX, 0, Fake(CONSTANT_BUFFER, 0));
+		commands.SetShader(SHADER_STAGE_PIXEL, Fake(PIXEL_SHADER, material % 2));
+		commands.SetConstantBuffer(SHADER_STAGE_PIXEL, 0, Fake(CONSTANT_BUFFER, 1));
+
+		commands.SetVertexBuffer(Fake(VERTEX_BUFFER, mesh), 48, 0);
+		commands.SetIndexBuffer(Fake(INDEX_BUFFER, mesh));
+		commands.DrawIndexed(36 * (mesh + 1), 0, 0);
+	}
+
+	const unsigned int CommandsPerDraw = 17;
+
+	void RecordFrame(CommandBuffer& commands, unsigned int first, unsigned int end, unsigned int drawCount)
+	{
+		for (unsigned int d = first; d < end; d++)
+			RecordDraw(commands, d, drawCount);
+	}
+
+	// Every kind of command, read back with exactly what went in
+	bool RoundTrip()
+	{
+		CommandBuffer commands(16);
+		unsigned char data[37];
+		for (unsigned int i = 0; i < sizeof(data); i++)
+			data[i] = (unsigned char)(i * 7);
+
+		for (unsigned int repeat = 0; repeat < 100; repeat++)
+		{
+			commands.SetShader(SHADER_STAGE_VERTEX, Fake(VERTEX_SHADER, repeat), Fake(INPUT_LAYOUT, repeat));
+			commands.SetConstantBuffer(SHADER_STAGE_HULL, 3, Fake(CONSTANT_BUFFER, repeat));
+			commands.UpdateConstants(Fake(CONSTANT_BUFFER, repeat), data, repeat % sizeof(data));
+			commands.SetShaderResource(SHADER_STAGE_DOMAIN, 127, Fake(TEXTURE, repeat));
+			commands.SetSampler(SHADER_STAGE_GEOMETRY, 15, Fake(SAMPLER, repeat));
+			commands.SetVertexBuffer(Fake(VERTEX_BUFFER, repeat), 48, 16);
+			commands.SetIndexBuffer(Fake(INDEX_BUFFER, repeat));
+			commands.SetRasterizerState(Fake(STATE, repeat));
+			commands.SetDepthStencilState(Fake(STATE, repeat + 1), 5);
+			commands.DrawIndexed(repeat, 2, -3);
+			commands.Draw(repeat + 1, 4);
+		}
+
+		CommandBuffer appended(16);
+		appended.Append(commands);
+		appended.Append(commands);
+
+		for (const CommandBuffer* buffer : { &commands, &appended })
+		{
+			unsigned int index = 0;
+			bool ok = true;
+			size_t walked = 0;
+			ForEachCommand(*buffer, [&](const CommandHeader& header) {
+				unsigned int repeat = (index / COMMAND_TYPE_COUNT) % 100;
+				ok &= header.Type == index % COMMAND_TYPE_COUNT && header.Size % COMMAND_ALIGNMENT == 0;
+				ok &= (uintptr_t)&header % COMMAND_ALIGNMENT == 0;
+				walked += header.Size;
+				switch (header.Type)
+				{
+				case COMMAND_SET_SHADER:
+				{
+					const SetShaderCommand& c = (const SetShaderCommand&)header;
+					ok &= header.Stage == SHADER_STAGE_VERTEX && c.Shader == Fake(VERTEX_SHADER, repeat) && c.InputLayout == Fake(INPUT_LAYOUT, repeat);
+					break;
+				}
+				case COMMAND_SET_CONSTANT_BUFFER:
+					ok &= header.Stage == SHADER_STAGE_HULL && header.Slot == 3 && ((const SetResourceCommand&)header).Resource == Fake(CONSTANT_BUFFER, repeat);
+					break;
+				case COMMAND_UPDATE_CONSTANTS:
+				{
+					const UpdateConstantsCommand& c = (const UpdateConstantsCommand&)header;
+					ok &= c.Buffer == Fake(CONSTANT_BUFFER, repeat) && c.DataSize == repeat % sizeof(data);
+					ok &= memcmp(&c + 1, data, c.DataSize) == 0 && header.Size >= sizeof(c) + c.DataSize;
+					break;
+				}
+				case COMMAND_SET_SHADER_RESOURCE:
+					ok &= header.Stage == SHADER_STAGE_DOMAIN && header.Slot == 127 && ((const SetResourceCommand&)header).Resource == Fake(TEXTURE, repeat);
+					break;
+				case COMMAND_SET_SAMPLER:
+					ok &= header.Stage == SHADER_STAGE_GEOMETRY && header.Slot == 15 && ((const SetResourceCommand&)header).Resource == Fake(SAMPLER, repeat);
+					break;
+				case COMMAND_SET_VERTEX_BUFFER:
+				{
+					const SetVertexBufferCommand& c = (const SetVertexBufferCommand&)header;
+					ok &= c.Buffer == Fake(VERTEX_BUFFER, repeat) && c.Stride == 48 && c.Offset == 16;
+					break;
+				}
+				case COMMAND_SET_INDEX_BUFFER:
+					ok &= ((const SetResourceCommand&)header).Resource == Fake(INDEX_BUFFER, repeat);
+					break;
+				case COMMAND_SET_RASTERIZER_STATE:
+					ok &= ((const SetStateCommand&)header).State == Fake(STATE, repeat);
+					break;
+				case COMMAND_SET_DEPTH_STENCIL_STATE:
+				{
+					const SetStateCommand& c = (const SetStateCommand&)header;
+					ok &= c.State == Fake(STATE, repeat + 1) && c.StencilRef == 5;
+					break;
+				}
+				case COMMAND_DRAW_INDEXED:
+				{
+					const DrawCommand& c = (const DrawCommand&)header;
+					ok &= c.Count == repeat && c.Start == 2 && c.BaseVertex == -3;
+					break;
+				}
+				case COMMAND_DRAW:
+				{
+					const DrawCommand& c = (const DrawCommand&)header;
+					ok &= c.Count == repeat + 1 && c.Start == 4;
+					break;
+				}
+				default:
+					ok = false;
+				}
+				index++;
+			});
+
+			if (!ok || index != buffer->GetCommandCount() || walked != buffer->GetSize())
+				return false;
+		}
+		return commands.GetGrowCount() > 0 && appended.GetCommandCount() == 2 * commands.GetCommandCount();
+	}
+
+	// Worked out from RecordDraw: after the first draw, the six shared textures, the sampler, the vertex shader and
+	// both constant buffer binds never change, and the pixel shader, its constants and the material's texture only
+	// change when the material does
+	bool RedundantCounts()
+	{
+		const unsigned int drawCount = 1200;
+		CommandBuffer commands;
+		RecordFrame(commands, 0, drawCount, drawCount);
+
+		CommandRecorder recorder;
+		recorder.Execute(commands);
+		const CommandStats& stats = recorder.GetStats();
+
+		unsigned long long expected[COMMAND_TYPE_COUNT] = {};
+		expected[COMMAND_SET_SHADER_RESOURCE] = 6 * (drawCount - 1) + (drawCount - MaterialCount);
+		expected[COMMAND_SET_SAMPLER] = drawCount - 1;
+		expected[COMMAND_SET_SHADER] = (drawCount - 1) + (drawCount - MaterialCount);
+		expected[COMMAND_SET_CONSTANT_BUFFER] = 2 * (drawCount - 1);
+		expected[COMMAND_UPDATE_CONSTANTS] = drawCount - MaterialCount; // Pixel constants only change with the material
+		expected[COMMAND_SET_VERTEX_BUFFER] = 0; // Every draw uses a different mesh from the one before
+		expected[COMMAND_SET_INDEX_BUFFER] = 0;
+
+		bool ok = stats.Commands == drawCount * CommandsPerDraw && stats.Draws == drawCount;
+		unsigned long long redundant = 0;
+		for (unsigned int type = 0; type < COMMAND_TYPE_COUNT; type++)
+		{
+			ok &= stats.RedundantByType[type] == expected[type];
+			redundant += expected[type];
+		}
+		ok &= stats.Redundant == redundant;
+
+		printf("Redundant state: %llu of %llu commands (%.1f%%)%s\n", stats.Redundant, stats.Commands, 100.0 * stats.Redundant / stats.Commands, ok ? "" : "  WRONG");
+		for (unsigned int type = 0; type < COMMAND_TYPE_COUNT; type++)
+		{
+			if (stats.ByType[type] > 0)
+				printf("    %-24s %7llu (%llu redundant)\n", CommandRecorder::GetCommandName((CommandType)type), stats.ByType[type], stats.RedundantByType[type]);
+		}
+
+		// Forgetting what's bound makes the next run's first draw bind everything again, but constants stay
+		recorder.ResetStats();
+		recorder.ResetState();
+		recorder.Execute(commands);
+		ok &= recorder.GetStats().RedundantByType[COMMAND_SET_SAMPLER] == drawCount - 1;
+		ok &= recorder.GetStats().RedundantByType[COMMAND_UPDATE_CONSTANTS] == drawCount - MaterialCount;
+		return ok;
+	}
+
+	unsigned long long Hash(const CommandBuffer& commands)
+	{
+		CommandRecorder recorder;
+		recorder.Execute(commands);
+		return recorder.GetHash();
+	}
+
+	// The same frame submits the same commands however it's recorded
+	bool Deterministic(unsigned int maxThreads)
+	{
+		const unsigned int drawCount = 5000;
+		CommandBuffer reference;
+		RecordFrame(reference, 0, drawCount, drawCount);
+		unsigned long long referenceHash = Hash(reference);
+
+		bool ok = true;
+		CommandBuffer again(64);
+		for (int repeat = 0; repeat < 3; repeat++)
+		{
+			again.Reset();
+			RecordFrame(again, 0, drawCount, drawCount);
+			ok &= Hash(again) == referenceHash;
+		}
+
+		// Executing each list's buffer in list order is the same stream as recording on one thread
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			class NoBackend : public DrawListBackend
+			{
+				void BeginList(unsigned int) override {}
+				void FinishList(unsigned int) override {}
+				void ExecuteList(unsigned int) override {}
+			} backend;
+			DrawLists drawLists(&backend, std::make_shared<JobSystem>(threads));
+			drawLists.SetMinDrawsPerList(16);
+			std::vector<CommandBuffer> lists(DRAW_LISTS_MAX);
+
+			for (int repeat = 0; repeat < 5; repeat++)
+			{
+				drawLists.Record(drawCount, [&](unsigned int list, unsigned int first, unsigned int end) {
+					CommandBuffer& commands = lists[list == DRAW_LIST_IMMEDIATE ? 0 : list];
+					commands.Reset();
+					RecordFrame(commands, first, end, drawCount);
+				});
+
+				CommandRecorder recorder;
+				recorder.SetKeepRecording(true);
+				for (unsigned int list = 0; list < std::max(1u, (unsigned int)drawLists.GetRanges().size()); list++)
+					recorder.Execute(lists[list]);
+				bool same = recorder.GetHash() == referenceHash && recorder.GetStats().Draws == drawCount;
+
+				// A kept copy replays into the same thing
+				CommandRecorder replay;
+				replay.Execute(recorder.GetRecording());
+				same &= replay.GetHash() == referenceHash && replay.GetStats().Redundant == recorder.GetStats().Redundant;
+				ok &= same;
+			}
+			printf("%2u threads: %u lists, %s\n", threads, std::max(1u, (unsigned int)drawLists.GetRanges().size()), ok ? "same commands" : "DIFFERENT COMMANDS");
+		}
+		return ok;
+	}
+
+	// Once a buffer's grown to fit a frame, recording it again doesn't allocate
+	bool SteadyState()
+	{
+		CommandBuffer commands(256);
+		unsigned int grown = 0;
+		for (int frame = 0; frame < 10; frame++)
+		{
+			commands.Reset();
+			RecordFrame(commands, 0, 3000, 3000);
+			if (frame == 0)
+				grown = commands.GetGrowCount();
+		}
+		bool ok = grown > 0 && commands.GetGrowCount() == grown;
+		printf("Steady state: grew %u times on the first frame, %u times after (%zu KB)\n", grown, commands.GetGrowCount() - grown, commands.GetCapacity() / 1024);
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxThreads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+	int frames = argc >= 3 ? atoi(argv[2]) : 20;
+
+	bool failed = false;
+
+	bool roundTrip = RoundTrip();
+	failed |= !roundTrip;
+	printf("Round trip: %s\n", roundTrip ? "ok" : "WRONG");
+
+	failed |= !RedundantCounts();
+	failed |= !Deterministic(maxThreads);
+	failed |= !SteadyState();
+
+	// Submission: recording a frame, then running it through the recorder (the cost of walking it, without a GPU)
+	const unsigned int drawCounts[] = { 1000, 10000, 100000 };
+	for (unsigned int drawCount : drawCounts)
+	{
+		CommandBuffer commands;
+		CommandRecorder recorder;
+		double bestRecord = 1e9, bestExecute = 1e9;
+		for (int f = 0; f < frames; f++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			commands.Reset();
+			RecordFrame(commands, 0, drawCount, drawCount);
+			auto recorded = std::chrono::steady_clock::now();
+			recorder.ResetState();
+			recorder.Execute(commands);
+			auto executed = std::chrono::steady_clock::now();
+
+			bestRecord = std::min(bestRecord, std::chrono::duration<double, std::milli>(recorded - start).count());
+			bestExecute = std::min(bestExecute, std::chrono::duration<double, std::milli>(executed - recorded).count());
+		}
+		printf("%6u draws: record %7.3f ms, execute %7.3f ms  (%.1f ns per command, %zu KB)\n", drawCount, bestRecord, bestExecute,
+			(bestRecord + bestExecute) * 1e6 / ((double)drawCount * CommandsPerDraw), commands.GetSize() / 1024);
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+// Correctness check for the spot light cone tests (ConeIntersectsSphere and ConeIntersectsAABB in Bounds)
+// - Not part of the Visual Studio project; it builds the game's Bounds.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc ConeCullingCheck.cpp ../Bounds.cpp -o ConeCullingCheck
+//
+// Usage:
+//   ConeCullingCheck [shapes]
+//     Tries spheres and boxes inside a cone, well outside it, just either side of its edge, behind its apex and
+//     past its far end, for 20 and 60 degree cones and a spot light's near 90 degree one.  Then tries the given number
+//     of random spheres and boxes against random cones and checks that neither test ever culls one that touches
+//     the cone (Game::DrawShadowAtlas culls spot light shadow casters with ConeIntersectsAABB, so that would lose
+//     shadows), measured against an exact distance for spheres and sample points for boxes.  Also prints how
+//     much they keep that doesn't touch.  Exits non-zero if anything is wrong.
+
+#include "../Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	Cone MakeCone(XMFLOAT3 apex, XMFLOAT3 direction, float range, float halfAngle)
+	{
+		Cone cone;
+		cone.Apex = apex;
+		XMStoreFloat3(&cone.Direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		cone.Range = range;
+		cone.CosAngle = cosf(halfAngle);
+		cone.SinAngle = sinf(halfAngle);
+		return cone;
+	}
+
+	// A point at a distance from the apex and an angle off the axis, turned around it by spin
+	XMFLOAT3 PointInCone(const Cone& cone, float distance, float angle, float spin)
+	{
+		XMVECTOR direction = XMLoadFloat3(&cone.Direction);
+		XMVECTOR side = XMVector3Normalize(XMVector3Cross(direction, fabsf(cone.Direction.y) > 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0)));
+		XMVECTOR other = XMVector3Cross(direction, side);
+		XMVECTOR across = side * cosf(spin) + other * sinf(spin);
+		XMFLOAT3 point;
+		XMStoreFloat3(&point, XMLoadFloat3(&cone.Apex) + (direction * cosf(angle) + across * sinf(angle)) * distance);
+		return point;
+	}
+
+	AABB BoxAround(XMFLOAT3 center, float halfSize)
+	{
+		return { { center.x - halfSize, center.y - halfSize, center.z - halfSize }, { center.x + halfSize, center.y + halfSize, center.z + halfSize } };
+	}
+
+	// Exact distance from a point to the solid cone (0 inside).  Around its axis the cone is a circular
+	// sector: the side runs from the apex out to the rim, then the far end is an arc of radius Range.
+	float DistanceToCone(const Cone& cone, XMFLOAT3 point)
+	{
+		XMVECTOR toPoint = XMLoadFloat3(&point) - XMLoadFloat3(&cone.Apex);
+		float along = XMVectorGetX(XMVector3Dot(toPoint, XMLoadFloat3(&cone.Direction)));
+		float across = sqrtf(std::max(XMVectorGetX(XMVector3LengthSq(toPoint)) - along * along, 0.0f));
+		float length = sqrtf(along * along + across * across);
+
+		bool withinAngle = along >= length * cone.CosAngle;
+		if (withinAngle && length <= cone.Range)
+			return 0.0f;
+
+		// Nearest point on the side, from the apex to the rim
+		float t = std::clamp(along * cone.CosAngle + across * cone.SinAngle, 0.0f, cone.Range);
+		float toSide = hypotf(along - t * cone.CosAngle, across - t * cone.SinAngle);
+		return withinAngle ? std::min(toSide, length - cone.Range) : toSide;
+	}
+
+	bool Inside(const Cone& cone, XMFLOAT3 point)
+	{
+		return DistanceToCone(cone, point) == 0.0f;
+	}
+
+	// The named cases, for both tests.  Distances outside the cone are measured from its surface.
+	bool Cases(const Cone& cone, const char* name)
+	{
+		bool ok = true;
+		float range = cone.Range;
+		float halfAngle = acosf(cone.CosAngle);
+		float radius = range * 0.02f;
+		float halfSize = radius / sqrtf(3.0f); // Box with the sphere as its circumsphere
+
+		// Inside: on the axis, and off it near the edge
+		for (float spin = 0; spin < XM_2PI; spin += 0.7f)
+		{
+			XMFLOAT3 onAxis = PointInCone(cone, range * 0.5f, 0, spin);
+			XMFLOAT3 offAxis = PointInCone(cone, range * 0.5f, halfAngle * 0.9f, spin);
+			ok &= ConeIntersectsSphere(cone, onAxis, radius) && ConeIntersectsAABB(cone, BoxAround(onAxis, halfSize));
+			ok &= ConeIntersectsSphere(cone, offAxis, radius) && ConeIntersectsAABB(cone, BoxAround(offAxis, halfSize));
+		}
+
+		// Outside, well to the side, sideways from the apex
+		float outsideAngle = std::min(halfAngle + 0.3f, XM_PIDIV2 + 0.2f);
+		for (float spin = 0; spin < XM_2PI; spin += 0.7f)
+		{
+			XMFLOAT3 side = PointInCone(cone, range * 0.5f, outsideAngle, spin);
+			bool apart = DistanceToCone(cone, side) > radius * 4.0f;
+			ok &= apart && !ConeIntersectsSphere(cone, side, radius) && !ConeIntersectsAABB(cone, BoxAround(side, halfSize));
+		}
+
+		// The edge: a sphere just reaching across the side is kept, one just short of it isn't
+		for (float spin = 0; spin < XM_2PI; spin += 0.7f)
+		{
+			float distance = range * 0.5f;
+			float angle = halfAngle + asinf(radius / distance);	// The sphere's center is exactly radius from the side
+			XMFLOAT3 touching = PointInCone(cone, distance, angle - 0.01f * radius / distance, spin);
+			XMFLOAT3 apart = PointInCone(cone, distance, angle + 0.01f * radius / distance, spin);
+			ok &= DistanceToCone(cone, touching) < radius && DistanceToCone(cone, apart) > radius;
+			ok &= ConeIntersectsSphere(cone, touching, radius) && !ConeIntersectsSphere(cone, apart, radius);
+
+			// A box mostly outside, but reaching just inside the edge
+			XMFLOAT3 rim = PointInCone(cone, distance, halfAngle * 0.999f, spin);
+			XMFLOAT3 axis = PointInCone(cone, distance, 0, spin);
+			XMVECTOR outward = XMVector3Normalize(XMLoadFloat3(&rim) - XMLoadFloat3(&axis));
+			XMFLOAT3 center;
+			XMStoreFloat3(&center, XMLoadFloat3(&rim) + outward * halfSize * 0.9f);
+			ok &= Inside(cone, rim) && !Inside(cone, center) && ConeIntersectsAABB(cone, BoxAround(center, halfSize));
+		}
+
+		// Behind the apex: kept if it reaches past it, culled if it doesn't
+		XMFLOAT3 behindNear = PointInCone(cone, radius * 0.5f, XM_PI, 0);
+		XMFLOAT3 behindFar = PointInCone(cone, radius * 4.0f + range * 0.1f, XM_PI, 0);
+		ok &= ConeIntersectsSphere(cone, behindNear, radius) && ConeIntersectsAABB(cone, BoxAround(behindNear, halfSize));
+		ok &= !ConeIntersectsSphere(cone, behindFar, radius) && !ConeIntersectsAABB(cone, BoxAround(behindFar, halfSize));
+
+		// Past the far end
+		XMFLOAT3 farInside = PointInCone(cone, range + radius * 0.5f, 0, 0);
+		XMFLOAT3 farOutside = PointInCone(cone, range + radius * 4.0f, 0, 0);
+		ok &= ConeIntersectsSphere(cone, farInside, radius) && ConeIntersectsAABB(cone, BoxAround(farInside, halfSize));
+		ok &= !ConeIntersectsSphere(cone, farOutside, radius) && !ConeIntersectsAABB(cone, BoxAround(farOutside, halfSize));
+
+		return Check(ok, name);
+	}
+
+	// Random shapes against random cones: never culled when they touch
+	bool Random(unsigned int shapes)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> fraction(0.0f, 1.0f);
+
+		bool ok = true;
+		unsigned int spheresTouching = 0, spheresKept = 0, spheresApartKept = 0;
+		unsigned int boxesTouching = 0, boxesKept = 0;
+		for (unsigned int i = 0; i < shapes; i++)
+		{
+			// Mostly spot light cones (from their falloff, up to nearly 90 degrees), some narrow ones
+			Light light = {};
+			light.Type = LIGHT_TYPE_SPOT;
+			light.Position = { unit(random) * 5, unit(random) * 5, unit(random) * 5 };
+			light.Direction = { unit(random), unit(random), unit(random) };
+			light.Range = 1.0f + fraction(random) * 20.0f;
+			light.SpotFalloff = i % 4 == 0 ? 200.0f + fraction(random) * 2000.0f : 1.0f + fraction(random) * 60.0f;
+			Cone cone = GetSpotLightCone(light);
+
+			// Half anywhere around the light, half close to the cone's side where the tests are hardest
+			XMFLOAT3 center = i % 2
+				? XMFLOAT3(light.Position.x + unit(random) * light.Range * 1.5f, light.Position.y + unit(random) * light.Range * 1.5f, light.Position.z + unit(random) * light.Range * 1.5f)
+				: PointInCone(cone, fraction(random) * light.Range * 1.2f, acosf(cone.CosAngle) + unit(random) * 0.3f, fraction(random) * XM_2PI);
+			float size = light.Range * (0.01f + fraction(random) * 0.3f);
+
+			// Sphere: exact, allowing for float error right at the surface
+			float distance = DistanceToCone(cone, center);
+			bool touching = distance < size * 0.999f;
+			bool kept = ConeIntersectsSphere(cone, center, size);
+			ok &= !touching || kept;
+			spheresTouching += touching;
+			spheresKept += kept;
+			spheresApartKept += kept && distance > size * 1.001f;
+
+			// Box: touching if any sample point is inside the cone
+			XMFLOAT3 halfExtents = { size * (0.2f + fraction(random)), size * (0.2f + fraction(random)), size * (0.2f + fraction(random)) };
+			AABB box = { { center.x - halfExtents.x, center.y - halfExtents.y, center.z - halfExtents.z },
+				{ center.x + halfExtents.x, center.y + halfExtents.y, center.z + halfExtents.z } };
+			bool sampleInside = false;
+			const int samples = 6;
+			for (int x = 0; x <= samples && !sampleInside; x++)
+			{
+				for (int y = 0; y <= samples && !sampleInside; y++)
+				{
+					for (int z = 0; z <= samples && !sampleInside; z++)
+					{
+						XMFLOAT3 point = {
+							box.Min.x + (box.Max.x - box.Min.x) * x / samples,
+							box.Min.y + (box.Max.y - box.Min.y) * y / samples,
+							box.Min.z + (box.Max.z - box.Min.z) * z / samples };
+						sampleInside = Inside(cone, point);
+					}
+				}
+			}
+			bool boxKept = ConeIntersectsAABB(cone, box);
+			ok &= !sampleInside || boxKept;
+			boxesTouching += sampleInside;
+			boxesKept += boxKept;
+		}
+
+		printf("  spheres: %u of %u touch, %u kept (%u that don't touch)\n", spheresTouching, shapes, spheresKept, spheresApartKept);
+		printf("  boxes: at least %u of %u touch, %u kept\n", boxesTouching, shapes, boxesKept);
+		return Check(ok, "Random shapes that touch a cone are never culled");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int shapes = argc >= 2 ? (unsigned int)atoi(argv[1]) : 200000;
+
+	bool failed = false;
+	failed |= !Cases(MakeCone({ 1, 2, 3 }, { 0.3f, -1, 0.2f }, 10.0f, XMConvertToRadians(20.0f)), "Narrow cone (20 degrees)");
+	failed |= !Cases(MakeCone({ -4, 1, 0 }, { 0, 0, 1 }, 6.0f, XMConvertToRadians(60.0f)), "Medium cone (60 degrees)");
+
+	Light light = {};
+	light.Position = { 0, 5, 0 };
+	light.Direction = { 0, -1, 0 };
+	light.Range = 8.0f;
+	light.SpotFalloff = 1.0f;
+	failed |= !Cases(GetSpotLightCone(light), "Wide spot light cone (falloff 1, about 90 degrees)");
+
+	failed |= !Random(shapes);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+// Correctness check and benchmark for splitting draws over threads (DrawLists)
+// - Not part of the Visual Studio project; it builds the game's DrawLists.cpp and JobSystem.cpp on their own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. DrawListsCheck.cpp ../DrawLists.cpp ../JobSystem.cpp ../Profiler.cpp -o DrawListsCheck
+//
+// Usage:
+//   DrawListsCheck [maxThreads] [frames]
+//     Records draws through a backend that just writes each list's draws down, the way a deferred context would.
+//     Checks that SplitDraws covers every draw once in even runs, that each list is recorded start to finish on
+//     one thread, that nothing executes until every list is finished, and that executing the lists in order puts
+//     every draw on the "immediate context" in its original order.  Then times recording 1k, 10k and 100k draws
+//     (each packing a constant buffer's worth of data) on 1, 2, 4... threads.  Exits non-zero if anything is wrong.
+
+#include "../DrawLists.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// What a draw leaves in a command list: which draw it was, and its constants
+	struct RecordedDraw
+	{
+		unsigned int Draw;
+		float Constants[32];
+	};
+
+	// Stands in for D3D11's deferred contexts, checking it's used the way they have to be
+	class RecordingBackend : public DrawListBackend
+	{
+	public:
+		RecordingBackend() : submitThread(std::this_thread::get_id()), errors(0), executed(0)
+		{
+			for (List& list : lists)
+				list.Draws.reserve(1024);
+		}
+
+		void BeginList(unsigned int list) override
+		{
+			List& l = lists[list];
+			if (l.Recording)
+				Error();
+			l.Recording = true;
+			l.Finished = false;
+			l.Thread = std::this_thread::get_id();
+			l.Draws.clear();
+		}
+
+		void FinishList(unsigned int list) override
+		{
+			List& l = lists[list];
+			if (!l.Recording || l.Thread != std::this_thread::get_id())
+				Error();
+			l.Recording = false;
+			l.Finished = true;
+		}
+
+		// Every list has to be finished before the first one runs, and they have to run in order
+		void ExecuteList(unsigned int list) override
+		{
+			if (std::this_thread::get_id() != submitThread || list != executed)
+				Error();
+			if (list == 0)
+			{
+				for (unsigned int l = 0; l < DRAW_LISTS_MAX; l++)
+				{
+					if (lists[l].Recording)
+						Error();
+				}
+			}
+
+			List& l = lists[list];
+			if (!l.Finished)
+				Error();
+			l.Finished = false;
+			immediate.insert(immediate.end(), l.Draws.begin(), l.Draws.end());
+			executed++;
+		}
+
+		// What the game does for each draw: fill in its constants, then record it wherever it's going
+		void Draw(unsigned int list, unsigned int draw)
+		{
+			RecordedDraw recorded;
+			recorded.Draw = draw;
+			float world[16], view[16];
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				world[i] = (float)((draw + i) % 7);
+				view[i] = (float)(i % 5);
+			}
+			for (unsigned int r = 0; r < 4; r++)
+			{
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					float sum = 0;
+					for (unsigned int k = 0; k < 4; k++)
+						sum += world[r * 4 + k] * view[k * 4 + c];
+					recorded.Constants[r * 4 + c] = sum;
+					recorded.Constants[16 + r * 4 + c] = world[c * 4 + r];
+				}
+			}
+
+			if (list == DRAW_LIST_IMMEDIATE)
+			{
+				if (std::this_thread::get_id() != submitThread)
+					Error();
+				immediate.push_back(recorded);
+				return;
+			}
+
+			List& l = lists[list];
+			if (!l.Recording || l.Thread != std::this_thread::get_id())
+				Error();
+			l.Draws.push_back(recorded);
+		}
+
+		void StartFrame()
+		{
+			immediate.clear();
+			executed = 0;
+		}
+
+		// The draws came out once each, in order
+		bool CheckFrame(unsigned int drawCount)
+		{
+			if (immediate.size() != drawCount)
+				return false;
+			for (unsigned int d = 0; d < drawCount; d++)
+			{
+				if (immediate[d].Draw != d)
+					return false;
+			}
+			return errors == 0;
+		}
+
+		unsigned int GetErrors() { return errors; }
+
+	private:
+		struct List
+		{
+			bool Recording = false;
+			bool Finished = false;
+			std::thread::id Thread;
+			std::vector<RecordedDraw> Draws;
+		};
+
+		void Error()
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			errors++;
+		}
+
+		std::thread::id submitThread;
+		List lists[DRAW_LISTS_MAX];
+		std::vector<RecordedDraw> immediate;
+		std::mutex errorMutex;
+		unsigned int errors;
+		unsigned int executed;
+	};
+
+	// Contiguous, in order, covering everything, at least minDraws each, no more than maxLists, and even
+	bool CheckSplit(unsigned int drawCount, unsigned int maxLists, unsigned int minDraws)
+	{
+		std::vector<DrawListRange> ranges;
+		SplitDraws(drawCount, maxLists, minDraws, ranges);
+		if (drawCount == 0)
+			return ranges.empty();
+		if (ranges.empty() || ranges.size() > std::max(1u, maxLists) || ranges.front().First != 0 || ranges.back().End != drawCount)
+			return false;
+
+		unsigned int smallest = UINT_MAX, largest = 0;
+		for (unsigned int r = 0; r < ranges.size(); r++)
+		{
+			unsigned int size = ranges[r].End - ranges[r].First;
+			if (ranges[r].End <= ranges[r].First || (r > 0 && ranges[r].First != ranges[r - 1].End))
+				return false;
+			if (ranges.size() > 1 && size < minDraws)
+				return false;
+			smallest = std::min(smallest, size);
+			largest = std::max(largest, size);
+		}
+
+		// As many lists as it could have used
+		unsigned int possible = std::max(1u, std::min(maxLists, drawCount / std::max(1u, minDraws)));
+		return largest - smallest <= 1 && ranges.size() == possible;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxThreads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+	int frames = argc >= 3 ? atoi(argv[2]) : 20;
+
+	bool failed = false;
+
+	// Splitting on its own
+	{
+		unsigned int bad = 0;
+		const unsigned int drawCounts[] = { 0, 1, 2, 15, 16, 17, 63, 64, 65, 127, 128, 1000, 4097, 100000 };
+		for (unsigned int drawCount : drawCounts)
+		{
+			for (unsigned int maxLists = 0; maxLists <= DRAW_LISTS_MAX; maxLists++)
+			{
+				for (unsigned int minDraws : { 0u, 1u, 16u, 64u, 1000u })
+					bad += !CheckSplit(drawCount, maxLists, minDraws);
+			}
+		}
+		failed |= bad > 0;
+		printf("Splitting: %u bad splits\n", bad);
+	}
+
+	// Recording and playing back, on several thread counts, with every split size
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(threads);
+		RecordingBackend backend;
+		DrawLists drawLists(&backend, jobs);
+		auto record = [&](unsigned int list, unsigned int first, unsigned int end) {
+			for (unsigned int d = first; d < end; d++)
+				backend.Draw(list, d);
+		};
+
+		unsigned int bad = 0, deferred = 0;
+		const unsigned int drawCounts[] = { 0, 1, 63, 64, 128, 1000, 20000 };
+		for (unsigned int drawCount : drawCounts)
+		{
+			for (unsigned int minDraws : { 1u, 64u })
+			{
+				drawLists.SetMinDrawsPerList(minDraws);
+				for (int repeat = 0; repeat < 10; repeat++)
+				{
+					backend.StartFrame();
+					drawLists.Record(drawCount, record);
+					bad += !backend.CheckFrame(drawCount);
+					deferred += !drawLists.GetRanges().empty();
+				}
+			}
+		}
+
+		// More than one thread has to actually use lists, or none of the above checked them
+		bool ok = bad == 0 && (threads == 1 ? deferred == 0 : deferred > 0);
+		failed |= !ok;
+		printf("%2u threads: %u frames out of order or misused (%u backend errors), %u frames used lists%s\n",
+			threads, bad, backend.GetErrors(), deferred, ok ? "" : "  WRONG");
+	}
+
+	// Scaling
+	const unsigned int drawCounts[] = { 1000, 10000, 100000 };
+	for (unsigned int drawCount : drawCounts)
+	{
+		double oneThread = 0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(threads);
+			RecordingBackend backend;
+			DrawLists drawLists(&backend, jobs);
+			auto record = [&](unsigned int list, unsigned int first, unsigned int end) {
+				for (unsigned int d = first; d < end; d++)
+					backend.Draw(list, d);
+			};
+
+			double best = 1e9;
+			for (int f = 0; f < frames; f++)
+			{
+				backend.StartFrame();
+				auto start = std::chrono::steady_clock::now();
+				drawLists.Record(drawCount, record);
+				best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				failed |= !backend.CheckFrame(drawCount);
+			}
+			if (threads == 1)
+				oneThread = best;
+			printf("%6u draws, %2u threads: %7.3f ms in %u lists  (%.2fx)\n",
+				drawCount, threads, best, std::max(1u, (unsigned int)drawLists.GetRanges().size()), oneThread / best);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
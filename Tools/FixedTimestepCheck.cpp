@@ -0,0 +1,259 @@
+// Correctness check for the fixed timestep loop (FixedTimestep), driven by a fake clock
+// - Not part of the Visual Studio project; it builds the game's FixedTimestep.cpp on its own and runs the same
+//   loop as DXCore::Run, with frame times made up here instead of read from the performance counter
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. FixedTimestepCheck.cpp ../FixedTimestep.cpp -o FixedTimestepCheck
+//
+// Usage:
+//   FixedTimestepCheck [seconds]
+//     Runs the given amount of (fake) time at several frame rates and checks that the simulation keeps pace
+//     with real time, takes the same steps and ends in exactly the same state whatever the frame rate or
+//     jitter, stops at the most steps allowed in a frame and drops the rest, interpolates to a step behind
+//     real time, and copes with the tick rate changing part way.  Exits non-zero if anything is wrong.
+
+#include "../FixedTimestep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Something to simulate: a position that depends on every step before it
+	struct Body
+	{
+		float Position;
+		float Velocity;
+
+		void Step(float stepTime, float simulationTime)
+		{
+			Velocity += (std::sin(simulationTime) - Position * 0.1f) * stepTime;
+			Position += Velocity * stepTime;
+		}
+	};
+
+	struct Frame
+	{
+		unsigned int Steps;
+		float Interpolation;
+		float RenderPosition;	// Between the last two steps' positions
+	};
+
+	// DXCore::Run's loop, with the frame times given
+	std::vector<Frame> Run(FixedTimestep& timestep, const std::vector<double>& frameTimes, Body& body, std::vector<float>* stepPositions = nullptr)
+	{
+		std::vector<Frame> frames;
+		float previous = body.Position;
+		for (double frameTime : frameTimes)
+		{
+			timestep.Advance(frameTime);
+			while (timestep.Step())
+			{
+				previous = body.Position;
+				body.Step(timestep.GetStepTime(), timestep.GetSimulationTime());
+				if (stepPositions)
+					stepPositions->push_back(body.Position);
+			}
+
+			float interpolation = timestep.GetInterpolation();
+			frames.push_back({ timestep.GetStepsThisFrame(), interpolation, previous + (body.Position - previous) * interpolation });
+		}
+		return frames;
+	}
+
+	std::vector<double> SteadyFrames(double seconds, double framesPerSecond)
+	{
+		return std::vector<double>((size_t)(seconds * framesPerSecond), 1.0 / framesPerSecond);
+	}
+
+	// Steady frame rates take steady numbers of steps, and always keep pace with real time
+	bool FrameRates(double seconds)
+	{
+		bool ok = true;
+		const double rates[] = { 30, 60, 75, 144, 240, 1000 };
+		for (double rate : rates)
+		{
+			FixedTimestep timestep(60.0f, 5);
+			Body body = {};
+			std::vector<Frame> frames = Run(timestep, SteadyFrames(seconds, rate), body);
+
+			unsigned int fewest = 100;
+			unsigned int most = 0;
+			for (const Frame& frame : frames)
+			{
+				fewest = std::min(fewest, frame.Steps);
+				most = std::max(most, frame.Steps);
+				ok &= frame.Interpolation >= 0.0f && frame.Interpolation <= 1.0f;
+			}
+
+			// Within a step of real time (rounding can leave the last one a hair short)
+			double realTime = frames.size() / rate;
+			double expectedSteps = realTime * 60.0;
+			ok &= std::fabs((double)timestep.GetStepCount() - expectedSteps) <= 1.0;
+			ok &= timestep.GetDroppedTime() == 0.0;
+
+			// Slower frames take every step they need, faster ones take at most one
+			if (rate < 60)
+				ok &= most <= (unsigned int)std::ceil(60.0 / rate) && fewest >= (unsigned int)std::floor(60.0 / rate);
+			else
+				ok &= most <= 1;
+			printf("  %5.0f fps: %llu steps in %.2f s, %u to %u a frame\n", rate, timestep.GetStepCount(), realTime, fewest, most);
+		}
+		return Check(ok, "Steps keep pace with real time at any frame rate");
+	}
+
+	// The point of it all: whatever the frames, the same steps give the same state
+	bool Reproducible(double seconds)
+	{
+		std::vector<float> reference;
+		FixedTimestep referenceTimestep(60.0f, 5);
+		Body referenceBody = {};
+		Run(referenceTimestep, SteadyFrames(seconds, 60), referenceBody, &reference);
+
+		bool ok = !reference.empty();
+		std::mt19937 random(1234);
+		const double rates[] = { 37, 144, 500 };
+		for (double rate : rates)
+		{
+			// Jittery frames, between half and one and a half of the average
+			std::uniform_real_distribution<double> jitter(0.5 / rate, 1.5 / rate);
+			std::vector<double> frameTimes;
+			for (double time = 0; time < seconds; )
+			{
+				frameTimes.push_back(jitter(random));
+				time += frameTimes.back();
+			}
+
+			std::vector<float> positions;
+			FixedTimestep timestep(60.0f, 5);
+			Body body = {};
+			Run(timestep, frameTimes, body, &positions);
+
+			size_t common = std::min(positions.size(), reference.size());
+			ok &= common + 2 >= reference.size();
+			for (size_t i = 0; i < common; i++)
+				ok &= positions[i] == reference[i];
+		}
+		return Check(ok, "Same state after each step, whatever the frame times");
+	}
+
+	// A long frame only gets maxSteps, and the rest of it is dropped rather than caught up on later
+	bool Hitch()
+	{
+		FixedTimestep timestep(60.0f, 5);
+		Body body = {};
+		std::vector<double> frameTimes = SteadyFrames(1.0, 60);
+		frameTimes.push_back(2.0);
+		frameTimes.push_back(1.0 / 60);
+		frameTimes.push_back(1.0 / 60);
+		std::vector<Frame> frames = Run(timestep, frameTimes, body);
+
+		size_t hitch = frameTimes.size() - 3;
+		bool ok = frames[hitch].Steps == 5;
+		ok &= std::fabs(timestep.GetDroppedTime() - (2.0 - 5.0 / 60)) < 1e-9;
+		ok &= frames[hitch + 1].Steps <= 2 && frames[hitch + 2].Steps <= 2;
+		ok &= frames[hitch].Interpolation < 1e-6f;
+
+		// Fewer steps allowed, fewer taken
+		timestep.SetMaxSteps(2);
+		timestep.Advance(1.0);
+		unsigned int steps = 0;
+		while (timestep.Step())
+			steps++;
+		ok &= steps == 2;
+
+		// No time, or time going backwards, takes no steps
+		timestep.Advance(0.0);
+		ok &= !timestep.Step();
+		timestep.Advance(-1.0);
+		ok &= !timestep.Step();
+		return Check(ok, "Long frames stop at the most steps and drop the rest");
+	}
+
+	// Something moving steadily is drawn exactly one step behind real time, without stutter
+	bool Interpolation(double seconds)
+	{
+		const float speed = 3.0f;
+		bool ok = true;
+		const double rates[] = { 24, 60, 144, 1000 };
+		for (double rate : rates)
+		{
+			FixedTimestep timestep(50.0f, 10);
+			float previous = 0;
+			float current = 0;
+			double realTime = 0;
+			float worst = 0;
+			float lastDrawn = -1;
+			bool backwards = false;
+			for (unsigned int frame = 0; frame < (unsigned int)(seconds * rate); frame++)
+			{
+				realTime += 1.0 / rate;
+				timestep.Advance(1.0 / rate);
+				while (timestep.Step())
+				{
+					previous = current;
+					current = speed * timestep.GetSimulationTime();
+				}
+				float drawn = previous + (current - previous) * timestep.GetInterpolation();
+				float expected = speed * (float)std::max(realTime - timestep.GetStepTime(), 0.0);
+				if (timestep.GetStepCount() >= 2)
+					worst = std::max(worst, std::fabs(drawn - expected));
+				backwards |= drawn < lastDrawn;
+				lastDrawn = drawn;
+			}
+			ok &= worst < 1e-3f * (float)seconds && !backwards;
+			printf("  %5.0f fps: drawn within %g of one step behind real time\n", rate, worst);
+		}
+		return Check(ok, "Interpolation draws a step behind real time");
+	}
+
+	// Time already built up is kept, in steps of the new length
+	bool TickRateChange()
+	{
+		FixedTimestep timestep(60.0f, 100);
+		timestep.Advance(0.5);
+		while (timestep.Step())
+		{
+		}
+		bool ok = timestep.GetStepCount() == 30;
+
+		timestep.SetTickRate(20.0f);
+		ok &= std::fabs(timestep.GetTickRate() - 20.0f) < 1e-4f;
+		ok &= std::fabs(timestep.GetStepTime() - 0.05f) < 1e-7f;
+		timestep.Advance(0.5);
+		while (timestep.Step())
+		{
+		}
+		ok &= timestep.GetStepCount() == 40;
+		ok &= std::fabs(timestep.GetSimulationTime() - 1.0f) < 1e-4f;
+
+		// Going faster with time left over still stops the interpolation at the latest state
+		timestep.Advance(0.04);
+		timestep.SetTickRate(100.0f);
+		ok &= timestep.GetInterpolation() == 1.0f;
+		return Check(ok, "Tick rate changes");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = argc >= 2 ? atof(argv[1]) : 60.0;
+
+	bool failed = false;
+	failed |= !FrameRates(seconds);
+	failed |= !Reproducible(seconds);
+	failed |= !Hitch();
+	failed |= !Interpolation(seconds);
+	failed |= !TickRateChange();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,413 @@
+// Correctness check for the per-frame memory (FrameArena, FrameAllocator) and proof that a steady frame doesn't touch the heap
+// - Not part of the Visual Studio project; it builds the game's FrameArena.cpp on its own, plus FrameGraph.cpp,
+//   RenderTargetPool.cpp, GpuProfiler.cpp and JobSystem.cpp for a frame like the game's, and AllocationCounter.cpp (which reports
+//   to MemoryTracker.cpp) to count every operator new in the program
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. FrameArenaCheck.cpp ../FrameArena.cpp ../AllocationCounter.cpp ../MemoryTracker.cpp ../FrameGraph.cpp ../RenderTargetPool.cpp ../GpuProfiler.cpp ../JobSystem.cpp -o FrameArenaCheck
+//
+// Usage:
+//   FrameArenaCheck [threads] [frames]
+//     Checks that allocations are aligned and don't overlap (from several threads at once too), that memory lasts
+//     exactly FRAME_ARENA_FRAMES frames, that a block that ran out grows to fit and stops overflowing, and that
+//     FrameVector and a string on a FrameAllocator work like their std::allocator versions.  Then builds and runs a
+//     frame like Game's (its ParallelFor loops on the job system, the culling and shadow setup's lists, frame graph
+//     passes timed by the GPU profiler) for the given number of frames, and checks that once it's warmed up not one heap allocation is made.  Also
+//     times the arena against new and delete.  Exits non-zero if anything is wrong.
+
+#include "../AllocationCounter.h"
+#include "../FrameArena.h"
+#include "../FrameGraph.h"
+#include "../GpuProfiler.h"
+#include "../JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Every alignment up to 256 is honoured, and nothing handed out overlaps anything else
+	bool Alignment()
+	{
+		FrameArena arena(4096);
+		arena.NextFrame();
+
+		struct Range { uintptr_t Begin, End; };
+		std::vector<Range> ranges;
+		bool ok = true;
+		for (unsigned int i = 0; i < 2000; i++)
+		{
+			size_t alignment = (size_t)1 << (i % 9);
+			size_t size = 1 + (i * 37) % 300;
+			uintptr_t pointer = (uintptr_t)arena.Allocate(size, alignment);
+			ok &= pointer % alignment == 0;
+			ranges.push_back({ pointer, pointer + size });
+		}
+
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.Begin < b.Begin; });
+		for (size_t i = 1; i < ranges.size(); i++)
+			ok &= ranges[i].Begin >= ranges[i - 1].End;
+		return Check(ok, "Alignment and overlap");
+	}
+
+	// What's written in a frame is still there through the next, and its memory is used again after that
+	bool Lifetime()
+	{
+		FrameArena arena(1024);
+		arena.NextFrame();
+
+		bool ok = true;
+		std::vector<unsigned int*> frames;
+		for (unsigned int frame = 0; frame < 10; frame++)
+		{
+			unsigned int* values = (unsigned int*)arena.Allocate(64 * sizeof(unsigned int), alignof(unsigned int));
+			for (unsigned int i = 0; i < 64; i++)
+				values[i] = frame * 1000 + i;
+			frames.push_back(values);
+
+			// Everything from the frames still alive is untouched
+			for (unsigned int age = 0; age < FRAME_ARENA_FRAMES && age <= frame; age++)
+			{
+				for (unsigned int i = 0; i < 64; i++)
+					ok &= frames[frame - age][i] == (frame - age) * 1000 + i;
+			}
+			arena.NextFrame();
+		}
+
+		// Each block is used again from the start once it comes back round
+		ok &= frames[FRAME_ARENA_FRAMES] == frames[0];
+		ok &= frames[1] != frames[0];
+
+		const char* copy = arena.CopyString("Light scattering composite");
+		ok &= strcmp(copy, "Light scattering composite") == 0;
+		return Check(ok, "Lifetime");
+	}
+
+	// A block that runs out overflows into heap chunks for that frame, then is grown to fit
+	bool Growth()
+	{
+		FrameArena arena(256);
+		auto frame = [&](unsigned int bytes) {
+			arena.NextFrame();
+			bool ok = true;
+			for (unsigned int i = 0; i < bytes / 100; i++)
+			{
+				unsigned char* memory = (unsigned char*)arena.Allocate(100, 4);
+				memset(memory, i & 0xFF, 100);
+				ok &= memory[99] == (i & 0xFF);
+			}
+			return ok;
+		};
+
+		bool ok = true;
+		for (unsigned int f = 0; f < FRAME_ARENA_FRAMES * 2; f++)
+			ok &= frame(100000);
+		unsigned int overflows = arena.GetOverflowCount();
+		ok &= overflows > 0;
+		ok &= arena.GetPeak() >= 100000;
+
+		unsigned long long heapBefore = GetHeapAllocationCount();
+		for (unsigned int f = 0; f < 50; f++)
+			ok &= frame(100000);
+		ok &= arena.GetOverflowCount() == overflows;
+		ok &= GetHeapAllocationCount() == heapBefore;
+		ok &= arena.GetCapacity() >= 100000;
+		printf("Growth: %u heap chunks while growing to %zu KB, then none: %s\n", overflows, arena.GetCapacity() / 1024, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Several threads at once, each filling what it gets with its own pattern
+	bool Threads(unsigned int threadCount)
+	{
+		FrameArena arena(64 * 1024); // Small enough that they overflow into chunks together too
+		bool ok = true;
+		for (unsigned int frame = 0; frame < 4; frame++)
+		{
+			arena.NextFrame();
+			std::vector<std::vector<unsigned int*>> allocations(threadCount);
+			std::vector<std::thread> threads;
+			for (unsigned int t = 0; t < threadCount; t++)
+			{
+				threads.emplace_back([&arena, &allocations, t]() {
+					allocations[t].reserve(20000);
+					for (unsigned int i = 0; i < 20000; i++)
+					{
+						unsigned int* memory = (unsigned int*)arena.Allocate(4 * sizeof(unsigned int), 16);
+						for (unsigned int j = 0; j < 4; j++)
+							memory[j] = (t << 24) | i;
+						allocations[t].push_back(memory);
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+
+			for (unsigned int t = 0; t < threadCount; t++)
+			{
+				for (unsigned int i = 0; i < allocations[t].size(); i++)
+				{
+					for (unsigned int j = 0; j < 4; j++)
+						ok &= allocations[t][i][j] == ((t << 24) | i);
+				}
+			}
+		}
+		printf("%u threads allocating at once: %s\n", threadCount, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// The containers, on the arena and (with no arena) on the heap
+	bool Containers()
+	{
+		FrameArena arena(1024);
+		arena.NextFrame();
+		bool ok = true;
+
+		for (FrameArena* on : { &arena, (FrameArena*)nullptr })
+		{
+			FrameVector<unsigned long long> values{ FrameAllocator<unsigned long long>(on) };
+			for (unsigned long long i = 0; i < 10000; i++)
+				values.push_back(i * i);
+			for (unsigned long long i = 0; i < 10000; i++)
+				ok &= values[(size_t)i] == i * i;
+
+			FrameVector<unsigned long long> copy(values);
+			ok &= copy == values && copy.get_allocator() == values.get_allocator();
+
+			typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char>> FrameString;
+			FrameString name{ FrameAllocator<char>(on) };
+			for (int i = 0; i < 20; i++)
+				name += "Shadow cascades ";
+			ok &= name.size() == 20 * 16 && name.compare(0, 15, "Shadow cascades") == 0;
+		}
+		return Check(ok, "FrameVector and FrameString");
+	}
+
+	// Times come back the moment they're asked for
+	class InstantGpu : public GpuProfilerBackend
+	{
+	public:
+		unsigned long long Clock = 0;
+		unsigned long long Times[GPU_PROFILER_FRAMES][GPU_PROFILER_MAX_TIMESTAMPS] = {};
+
+		void BeginFrame(unsigned int) override {}
+		void EndFrame(unsigned int) override {}
+		void Timestamp(unsigned int frame, unsigned int timestamp) override { Times[frame][timestamp] = Clock += 1000; }
+		bool GetFrequency(unsigned int, unsigned long long& ticksPerSecond, bool& disjoint) override
+		{
+			ticksPerSecond = 1000000000;
+			disjoint = false;
+			return true;
+		}
+		bool GetTimestamp(unsigned int frame, unsigned int timestamp, unsigned long long& ticks) override
+		{
+			ticks = Times[frame][timestamp];
+			return true;
+		}
+	};
+
+	class NullTargets : public FrameGraphBackend
+	{
+	public:
+		unsigned int Binds = 0;
+
+		void CreateTexture(unsigned int, const RenderTargetDesc&) override {}
+		void ReleaseTexture(unsigned int) override {}
+		void PlaceTransient(unsigned int, unsigned int) override {}
+		void BindTargets(const unsigned int*, unsigned int, int, unsigned int, unsigned int) override { Binds++; }
+		void UnbindShaderResources(const unsigned int*, unsigned int) override {}
+	};
+
+	// The size of the blur passes' taps, which they capture by value
+	struct Taps
+	{
+		float Weights[64];
+		int Count;
+	};
+
+	// --------------------------------------------------------
+	// A frame shaped like the game's: Update's loops over the
+	// job system (a few entities, which run inline, then bounds
+	// and per-cascade work, which don't), its short lived lists
+	// (visible flags, static casters, shadow requests), then the
+	// frame graph built, compiled and run with every pass timed
+	// --------------------------------------------------------
+	struct GameFrame
+	{
+		JobSystem Jobs;
+		FrameArena Arena;
+		NullTargets Targets;
+		InstantGpu Gpu;
+		FrameGraph Graph;
+		GpuProfiler Profiler;
+		std::vector<unsigned int> ShadowCasters; // Kept from frame to frame, like Game's
+		std::vector<unsigned int> CachedCasters;
+		Taps BlurTaps;
+		unsigned int Work;
+
+		GameFrame(unsigned int threads) : Jobs(threads), Graph(&Targets, 3, &Arena), Profiler(&Gpu), BlurTaps(), Work(0)
+		{
+			Graph.SetPassHooks(
+				[this](const char* name) { Profiler.BeginPass(name); },
+				[this](const char*) { Profiler.EndPass(); });
+		}
+
+		void Run(unsigned int frame)
+		{
+			Arena.NextFrame();
+			const unsigned int entityCount = 500 + frame % 3; // A little different every frame
+
+			// Update, and the fixed steps before it
+			float positions[6] = {};
+			for (unsigned int step = 0; step < 1 + frame % 2; step++)
+			{
+				Jobs.ParallelFor(6, 0, [&](unsigned int begin, unsigned int end) {
+					for (unsigned int i = begin; i < end; i++)
+						positions[i] += 0.01f * (float)i;
+				});
+			}
+			FrameVector<unsigned char> visible(entityCount, 0, FrameAllocator<unsigned char>(&Arena));
+			Jobs.ParallelFor(entityCount, 0, [&](unsigned int begin, unsigned int end) {
+				for (unsigned int i = begin; i < end; i++)
+					visible[i] = (i * 7 + frame) % 3 != 0;
+			});
+			unsigned int culled[4] = {};
+			Jobs.ParallelFor(4, 1, [&](unsigned int begin, unsigned int end) {
+				for (unsigned int c = begin; c < end; c++)
+					culled[c] = (unsigned int)std::count(visible.begin(), visible.end(), (unsigned char)0) + c;
+			});
+			Work += culled[3] + (unsigned int)positions[5];
+			ShadowCasters.clear();
+			for (unsigned int i = 0; i < entityCount; i++)
+			{
+				if (visible[i])
+					ShadowCasters.push_back(i);
+			}
+			FrameVector<unsigned int> staticCasters{ FrameAllocator<unsigned int>(&Arena) };
+			for (unsigned int i : ShadowCasters)
+			{
+				if (i % 4 == 0)
+					staticCasters.push_back(i);
+			}
+			CachedCasters.assign(staticCasters.begin(), staticCasters.end());
+
+			struct ShadowRequest { unsigned int Light, TileSize; };
+			FrameVector<ShadowRequest> requests{ FrameAllocator<ShadowRequest>(&Arena) };
+			for (unsigned int light = 0; light < 40; light++)
+				requests.push_back({ light, 64u << ((light * 5 + frame) % 4) });
+			std::sort(requests.begin(), requests.end(), [](const ShadowRequest& a, const ShadowRequest& b) {
+				return a.TileSize != b.TileSize ? a.TileSize > b.TileSize : a.Light < b.Light;
+			});
+
+			// Draw
+			Graph.Reset();
+			unsigned int backBuffer = Graph.Import("Back buffer", 1280, 720, true);
+			unsigned int depth = Graph.Import("Depth buffer", 1280, 720);
+			unsigned int scene = Graph.Create("Scene", { 1280, 720, 28, 0 });
+			unsigned int pass = Graph.AddPass("Main", [this]() { Work++; });
+			Graph.Write(pass, scene, FRAME_GRAPH_RENDER_TARGET, true);
+			Graph.Write(pass, depth, FRAME_GRAPH_DEPTH_TARGET, true);
+
+			unsigned int source = scene;
+			const char* blurNames[] = { "Blur half", "Blur across", "Blur down" };
+			for (const char* name : blurNames)
+			{
+				unsigned int output = Graph.Create(name, { 640, 360, 28, 0 });
+				Taps taps = BlurTaps;
+				pass = Graph.AddPass(name, [this, source, taps]() { Work += taps.Count + source; });
+				Graph.Read(pass, source);
+				Graph.Write(pass, output, FRAME_GRAPH_RENDER_TARGET, true);
+				source = output;
+			}
+
+			pass = Graph.AddPass("Light scattering composite", [this, source, depth, backBuffer, scene]() { Work += source + depth + backBuffer + scene; });
+			Graph.Read(pass, source);
+			Graph.Read(pass, depth);
+			Graph.Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET, true);
+			pass = Graph.AddPass("ImGui", [this]() { Work++; }, true);
+			Graph.Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET);
+
+			Graph.Compile();
+			Profiler.BeginFrame();
+			Graph.Execute();
+			Profiler.EndFrame();
+		}
+	};
+
+	bool SteadyState(unsigned int threads, unsigned int frames)
+	{
+		GameFrame game(threads);
+		const unsigned int warmUp = 10;
+		for (unsigned int f = 0; f < warmUp; f++)
+			game.Run(f);
+
+		unsigned long long before = GetHeapAllocationCount();
+		unsigned long long bytesBefore = GetHeapAllocatedBytes();
+		for (unsigned int f = warmUp; f < warmUp + frames; f++)
+			game.Run(f);
+		unsigned long long allocations = GetHeapAllocationCount() - before;
+
+		bool ok = allocations == 0 && game.Profiler.GetPassTimes().size() == 6 && game.Work > 0;
+		printf("%u steady frames: %llu heap allocations (%llu bytes), arena peak %zu KB: %s\n", frames, allocations,
+			GetHeapAllocatedBytes() - bytesBefore, game.Arena.GetPeak() / 1024, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// What the same lists cost on the heap, for comparison
+	void Bench()
+	{
+		const unsigned int count = 1000000;
+		FrameArena arena(count * 48);
+		volatile uintptr_t sink = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int frame = 0; frame < 4; frame++)
+		{
+			arena.NextFrame();
+			for (unsigned int i = 0; i < count; i++)
+				sink = sink + (uintptr_t)arena.Allocate(16 + i % 32, 8);
+		}
+		auto arenaDone = std::chrono::steady_clock::now();
+		std::vector<void*> pointers(count);
+		for (unsigned int frame = 0; frame < 4; frame++)
+		{
+			for (unsigned int i = 0; i < count; i++)
+				pointers[i] = ::operator new(16 + i % 32);
+			for (unsigned int i = 0; i < count; i++)
+				::operator delete(pointers[i]);
+		}
+		auto heapDone = std::chrono::steady_clock::now();
+
+		double arenaNs = std::chrono::duration<double, std::nano>(arenaDone - start).count() / (4.0 * count);
+		double heapNs = std::chrono::duration<double, std::nano>(heapDone - arenaDone).count() / (4.0 * count);
+		printf("Allocating: %.1f ns from the arena, %.1f ns with new and delete\n", arenaNs, heapNs);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int threads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+	unsigned int frames = argc >= 3 ? (unsigned int)atoi(argv[2]) : 1000;
+
+	bool failed = false;
+	failed |= !Alignment();
+	failed |= !Lifetime();
+	failed |= !Growth();
+	failed |= !Threads(threads);
+	failed |= !Containers();
+	failed |= !SteadyState(threads, frames);
+	Bench();
+
+	return failed ? 1 : 0;
+}
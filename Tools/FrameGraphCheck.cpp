@@ -0,0 +1,404 @@
+// Correctness check for the frame graph compiler (FrameGraph)
+// - Not part of the Visual Studio project; it builds the game's FrameGraph.cpp and RenderTargetPool.cpp on its own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. FrameGraphCheck.cpp ../FrameGraph.cpp ../FrameArena.cpp ../RenderTargetPool.cpp -o FrameGraphCheck
+//
+// Usage:
+//   FrameGraphCheck [randomFrames]
+//     Runs the game's frame at every blur setting, a frame with passes nothing needs, then many random frames,
+//     through a backend that records what would be bound the way D3D11 binds it.  Each pass's execute binds its
+//     inputs to shader slots (and leaves them there, like the game's passes).  It fails if anything is ever read
+//     while it's still bound as a target, or drawn into while it's still bound as an input (D3D11 would quietly
+//     unbind one of them), or if a pass is dropped that something needed.  Exits non-zero if anything is wrong.
+
+#include "../FrameGraph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const unsigned int FormatRGBA8 = 28;
+	const unsigned int FormatRGBA16F = 10;
+	const unsigned int ShaderSlots = 16;
+
+	// Textures are named by what they really are: "slot 3" for the pool's, the import's name otherwise
+	class RecordingBackend : public FrameGraphBackend
+	{
+	public:
+		std::vector<std::string> ResourceTextures;	// This frame's, by resource
+		std::vector<std::string> BoundTargets;
+		std::string ShaderSlots[::ShaderSlots];
+		unsigned int Hazards = 0;
+		unsigned int TextureCreates = 0;
+		unsigned int BindCalls = 0;
+		unsigned int UnbindCalls = 0;
+
+		void Import(unsigned int resource, const std::string& name)
+		{
+			TextureOf(resource) = name;
+		}
+
+		std::string& TextureOf(unsigned int resource)
+		{
+			if (resource >= ResourceTextures.size())
+				ResourceTextures.resize(resource + 1);
+			return ResourceTextures[resource];
+		}
+
+		void CreateTexture(unsigned int slot, const RenderTargetDesc&) override
+		{
+			TextureCreates++;
+			Forget("slot " + std::to_string(slot));
+		}
+
+		void ReleaseTexture(unsigned int slot) override
+		{
+			Forget("slot " + std::to_string(slot));
+		}
+
+		void PlaceTransient(unsigned int resource, unsigned int slot) override
+		{
+			TextureOf(resource) = "slot " + std::to_string(slot);
+		}
+
+		void BindTargets(const unsigned int* renderTargets, unsigned int count, int depthTarget, unsigned int, unsigned int) override
+		{
+			BindCalls++;
+			BoundTargets.clear();
+			for (unsigned int i = 0; i < count; i++)
+				BoundTargets.push_back(TextureOf(renderTargets[i]));
+			if (depthTarget >= 0)
+				BoundTargets.push_back(TextureOf(depthTarget));
+			for (const std::string& target : BoundTargets)
+				CheckNotInput(target);
+		}
+
+		void UnbindShaderResources(const unsigned int* resources, unsigned int count) override
+		{
+			UnbindCalls++;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				for (std::string& slot : ShaderSlots)
+					slot = slot == TextureOf(resources[i]) ? "" : slot;
+			}
+		}
+
+		// What a pass's execute does with its inputs
+		void BindInputs(const std::vector<unsigned int>& reads)
+		{
+			for (unsigned int i = 0; i < reads.size(); i++)
+			{
+				const std::string& texture = TextureOf(reads[i]);
+				if (std::find(BoundTargets.begin(), BoundTargets.end(), texture) != BoundTargets.end())
+				{
+					printf("  %s read while bound as a target\n", texture.c_str());
+					Hazards++;
+				}
+				ShaderSlots[i] = texture;
+			}
+		}
+
+		// ...and a pass that binds its own targets
+		void DrawInto(unsigned int resource)
+		{
+			CheckNotInput(TextureOf(resource));
+			BoundTargets.clear();
+		}
+
+	private:
+		void CheckNotInput(const std::string& texture)
+		{
+			for (const std::string& slot : ShaderSlots)
+			{
+				if (slot == texture)
+				{
+					printf("  %s drawn into while bound as an input\n", texture.c_str());
+					Hazards++;
+					return;
+				}
+			}
+		}
+
+		// A new (or released) texture isn't bound anywhere
+		void Forget(const std::string& texture)
+		{
+			for (std::string& slot : ShaderSlots)
+				slot = slot == texture ? "" : slot;
+			for (std::string& target : BoundTargets)
+				target = target == texture ? "" : target;
+		}
+	};
+
+	struct Frame
+	{
+		std::vector<std::string> Ran;
+		std::vector<std::string> MustRun;
+	};
+
+	// The passes Game::Draw() adds
+	Frame AddGameFrame(FrameGraph& graph, RecordingBackend& backend, int blurRadius, unsigned int blurDownsample, bool debugView)
+	{
+		const unsigned int width = 1280;
+		const unsigned int height = 720;
+		Frame frame;
+		graph.Reset();
+
+		unsigned int backBuffer = graph.Import("Back buffer", width, height, true);
+		unsigned int depthBuffer = graph.Import("Depth buffer", width, height);
+		unsigned int shadowMap = graph.Import("Shadow cascades", 2048, 2048);
+		unsigned int shadowAtlas = graph.Import("Shadow atlas", 4096, 4096);
+		backend.Import(backBuffer, "Back buffer");
+		backend.Import(depthBuffer, "Depth buffer");
+		backend.Import(shadowMap, "Shadow cascades");
+		backend.Import(shadowAtlas, "Shadow atlas");
+		unsigned int scene = graph.Create("Scene", { width, height, FormatRGBA8, 0 });
+		unsigned int sunAndOccluders = graph.Create("Sun and occluders", { width, height, FormatRGBA8, RENDER_TARGET_MIPS });
+
+		auto addPass = [&](const std::string& name, std::vector<unsigned int> reads, std::vector<unsigned int> ownTargets, bool sideEffects = false) {
+			frame.MustRun.push_back(name);
+			return graph.AddPass(name.c_str(), [&backend, &frame, name, reads, ownTargets]() {
+				frame.Ran.push_back(name);
+				for (unsigned int target : ownTargets)
+					backend.DrawInto(target);
+				backend.BindInputs(reads);
+			}, sideEffects);
+		};
+
+		unsigned int pass = addPass("Shadow cascades", {}, { shadowMap });
+		graph.Write(pass, shadowMap, FRAME_GRAPH_UNBOUND, true);
+		pass = addPass("Shadow atlas", {}, { shadowAtlas });
+		graph.Write(pass, shadowAtlas, FRAME_GRAPH_UNBOUND, true);
+		pass = addPass("Main", { shadowMap, shadowAtlas }, {});
+		graph.Read(pass, shadowMap);
+		graph.Read(pass, shadowAtlas);
+		graph.Write(pass, scene, FRAME_GRAPH_RENDER_TARGET, true);
+		graph.Write(pass, sunAndOccluders, FRAME_GRAPH_RENDER_TARGET, true);
+		graph.Write(pass, depthBuffer, FRAME_GRAPH_DEPTH_TARGET, true);
+		pass = addPass("Sky", {}, {});
+		graph.Write(pass, scene, FRAME_GRAPH_RENDER_TARGET);
+		graph.Write(pass, sunAndOccluders, FRAME_GRAPH_RENDER_TARGET);
+		graph.Write(pass, depthBuffer, FRAME_GRAPH_DEPTH_TARGET);
+
+		unsigned int screen = scene;
+		if (blurRadius > 0)
+		{
+			auto blurPass = [&](const char* name, unsigned int downsample) {
+				unsigned int output = graph.Create(name, { width / downsample, height / downsample, FormatRGBA8, 0 });
+				unsigned int blurPass = addPass(name, { screen }, {});
+				graph.Read(blurPass, screen);
+				graph.Write(blurPass, output, FRAME_GRAPH_RENDER_TARGET, true);
+				screen = output;
+			};
+			for (unsigned int downsample = 2; downsample <= blurDownsample; downsample *= 2)
+				blurPass(downsample == 2 ? "Blur half" : "Blur quarter", downsample);
+			blurPass("Blur across", blurDownsample);
+			blurPass("Blur down", blurDownsample);
+		}
+
+		// A debug view of the depth buffer that nothing shows: it and the pass feeding it should be dropped
+		if (debugView)
+		{
+			unsigned int linearDepth = graph.Create("Linear depth", { width, height, FormatRGBA16F, 0 });
+			unsigned int debug = graph.Create("Debug view", { width, height, FormatRGBA8, 0 });
+			pass = graph.AddPass("Linear depth", [&frame]() { frame.Ran.push_back("Linear depth"); });
+			graph.Read(pass, depthBuffer);
+			graph.Write(pass, linearDepth, FRAME_GRAPH_RENDER_TARGET, true);
+			pass = graph.AddPass("Debug view", [&frame]() { frame.Ran.push_back("Debug view"); });
+			graph.Read(pass, linearDepth);
+			graph.Write(pass, debug, FRAME_GRAPH_RENDER_TARGET, true);
+		}
+
+		unsigned int scattering = graph.Create("Light scattering", { width / 2, height / 2, FormatRGBA16F, 0 });
+		pass = addPass("Light scattering", { sunAndOccluders, depthBuffer }, {});
+		graph.Read(pass, sunAndOccluders);
+		graph.Read(pass, depthBuffer);
+		graph.Write(pass, scattering, FRAME_GRAPH_RENDER_TARGET, true);
+		pass = addPass("Light scattering composite", { screen, scattering, depthBuffer }, {});
+		graph.Read(pass, screen);
+		graph.Read(pass, scattering);
+		graph.Read(pass, depthBuffer);
+		graph.Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET, true);
+		pass = addPass("ImGui", {}, {}, true);
+		graph.Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET);
+
+		graph.Compile();
+		graph.Execute();
+		return frame;
+	}
+
+	// Passes over a few shared resources, reading and writing at random.  Returns false if a pass that
+	// writes an output, has side effects, or feeds one that ran was dropped.
+	bool RunRandomFrame(FrameGraph& graph, RecordingBackend& backend, std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> passCount(1, 12);
+		std::uniform_int_distribution<int> resourceCount(2, 8);
+		std::uniform_int_distribution<int> percent(0, 99);
+
+		graph.Reset();
+		std::vector<unsigned int> resources;
+		int count = resourceCount(random);
+		for (int r = 0; r < count; r++)
+		{
+			bool imported = percent(random) < 30;
+			std::string name = (imported ? "Import " : "Target ") + std::to_string(r);
+			unsigned int size = 256u >> (percent(random) % 2);
+			unsigned int resource = imported ? graph.Import(name.c_str(), size, size, percent(random) < 50) : graph.Create(name.c_str(), { size, size, FormatRGBA8, 0 });
+			if (imported)
+				backend.Import(resource, name);
+			resources.push_back(resource);
+		}
+
+		struct RandomPass
+		{
+			std::vector<unsigned int> Reads;
+			std::vector<unsigned int> Writes;
+			bool SideEffects;
+			bool Ran;
+		};
+		std::vector<RandomPass> passes(passCount(random));
+		for (unsigned int p = 0; p < passes.size(); p++)
+		{
+			RandomPass& randomPass = passes[p];
+			randomPass.SideEffects = percent(random) < 25;
+			randomPass.Ran = false;
+			for (unsigned int resource : resources)
+			{
+				// Never both: a pass can't read what it draws into
+				int roll = percent(random);
+				if (roll < 20)
+					randomPass.Reads.push_back(resource);
+				else if (roll < 35)
+					randomPass.Writes.push_back(resource);
+			}
+
+			bool ownTargets = percent(random) < 15;
+			unsigned int pass = graph.AddPass(("Pass " + std::to_string(p)).c_str(), [&backend, &passes, p, ownTargets]() {
+				passes[p].Ran = true;
+				if (ownTargets)
+				{
+					for (unsigned int target : passes[p].Writes)
+						backend.DrawInto(target);
+				}
+				backend.BindInputs(passes[p].Reads);
+			}, randomPass.SideEffects);
+			for (unsigned int resource : randomPass.Reads)
+				graph.Read(pass, resource);
+			bool depthUsed = false;
+			for (unsigned int resource : randomPass.Writes)
+			{
+				FrameGraphTarget target = FRAME_GRAPH_RENDER_TARGET;
+				if (ownTargets)
+					target = FRAME_GRAPH_UNBOUND;
+				else if (!depthUsed && percent(random) < 25)
+				{
+					target = FRAME_GRAPH_DEPTH_TARGET;
+					depthUsed = true;
+				}
+				graph.Write(pass, resource, target, percent(random) < 50);
+			}
+
+		}
+
+		graph.Compile();
+		graph.Execute();
+
+		// A pass that ran and read something must have had every earlier writer of it run too, unless one in
+		// between overwrote it.  Side effects always run.
+		bool ok = true;
+		for (unsigned int p = 0; p < passes.size(); p++)
+		{
+			if (passes[p].SideEffects && !passes[p].Ran)
+			{
+				printf("  pass %u has side effects but was dropped\n", p);
+				ok = false;
+			}
+			if (!passes[p].Ran)
+				continue;
+			for (unsigned int resource : passes[p].Reads)
+			{
+				for (int w = (int)p - 1; w >= 0; w--)
+				{
+					if (std::find(passes[w].Writes.begin(), passes[w].Writes.end(), resource) == passes[w].Writes.end())
+						continue;
+					if (!passes[w].Ran)
+					{
+						printf("  pass %u was dropped, but pass %u reads what it wrote\n", w, p);
+						ok = false;
+					}
+					break; // Conservatively only the nearest writer: it may have overwritten the rest
+				}
+			}
+		}
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int randomFrames = argc >= 2 ? atoi(argv[1]) : 10000;
+	bool failed = false;
+
+	// The game's frame, several times over at each setting (with switches between them) on one graph
+	{
+		RecordingBackend backend;
+		FrameGraph graph(&backend);
+		const int blurSettings[][2] = { { 0, 1 }, { 4, 1 }, { 4, 2 }, { 4, 4 }, { 0, 1 } };
+		for (const int* setting : blurSettings)
+		{
+			unsigned int creates = backend.TextureCreates;
+			unsigned int hazards = backend.Hazards;
+			Frame frame;
+			for (int f = 0; f < 3; f++)
+				frame = AddGameFrame(graph, backend, setting[0], setting[1], false);
+			bool allRan = frame.Ran == frame.MustRun;
+			failed |= !allRan || backend.Hazards != hazards;
+
+			// Only the first frame after a switch should make anything
+			unsigned int steadyCreates = backend.TextureCreates;
+			AddGameFrame(graph, backend, setting[0], setting[1], false);
+			bool steady = backend.TextureCreates == steadyCreates;
+			failed |= !steady;
+			printf("blur %s: %u passes, %u target changes, %u inputs unbound, %u render targets in %u textures (%u made)%s\n",
+				setting[0] == 0 ? "off    " : setting[1] == 1 ? "full   " : setting[1] == 2 ? "half   " : "quarter",
+				(unsigned int)frame.Ran.size(), graph.GetBindCount(), graph.GetUnbindCount(), graph.GetPool().GetTargetCount(),
+				graph.GetPool().GetTextureCount(), steadyCreates - creates,
+				allRan && steady && backend.Hazards == hazards ? "" : "  WRONG");
+		}
+
+		Frame frame = AddGameFrame(graph, backend, 4, 2, true);
+		bool dropped = frame.Ran == frame.MustRun;
+		for (unsigned int p = 0; p < graph.GetPassCount(); p++)
+			dropped &= graph.IsCulled(p) == (strcmp(graph.GetPassName(p), "Linear depth") == 0 || strcmp(graph.GetPassName(p), "Debug view") == 0);
+		failed |= !dropped;
+		printf("With an unused debug view: %u of %u passes ran, %u render targets%s\n",
+			(unsigned int)frame.Ran.size(), graph.GetPassCount(), graph.GetPool().GetTargetCount(), dropped ? "" : "  WRONG");
+	}
+
+	// Random frames, all on one graph so what's bound carries over from frame to frame
+	{
+		std::mt19937 random(1);
+		RecordingBackend backend;
+		FrameGraph graph(&backend);
+		unsigned int wrong = 0;
+		unsigned int passes = 0;
+		unsigned int culled = 0;
+		for (int f = 0; f < randomFrames; f++)
+		{
+			unsigned int hazards = backend.Hazards;
+			wrong += !RunRandomFrame(graph, backend, random) || backend.Hazards != hazards;
+			passes += graph.GetPassCount();
+			for (unsigned int p = 0; p < graph.GetPassCount(); p++)
+				culled += graph.IsCulled(p);
+		}
+		failed |= wrong > 0;
+		printf("%d random frames: %u passes, %u dropped, %u frames wrong\n", randomFrames, passes, culled, wrong);
+	}
+
+	return failed ? 1 : 0;
+}
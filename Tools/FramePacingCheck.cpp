@@ -0,0 +1,266 @@
+// Correctness check for the frame limiter and latency history (FramePacing), driven by a fake clock
+// - Not part of the Visual Studio project; it builds the game's FramePacing.cpp on its own and runs the same
+//   wait as DXCore::WaitForNextFrame, with a clock, sleeps that wake up late and frame work all made up here
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. FramePacingCheck.cpp ../FramePacing.cpp -o FramePacingCheck
+//
+// Usage:
+//   FramePacingCheck [seconds]
+//     Runs the given amount of (fake) time at several target frame rates, with a precise timer and with a
+//     1 ms one, and checks that frames are let go at the target rate and never early, that the spin margin
+//     follows how late sleeps wake up, that a frame running long isn't caught up on with short ones, that the
+//     target can change or be turned off, and that the latency history averages right.
+//     Exits non-zero if anything is wrong.
+
+#include "../FramePacing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Time only moves when something here moves it
+	struct FakeClock
+	{
+		double Now;
+		double TimerTick;		// Sleeps end on a multiple of this (zero for a high resolution timer)
+		double WakeUpMin;		// Then wake up somewhere between these late
+		double WakeUpMax;
+		std::mt19937 Random;
+
+		double Slept;
+		double Spun;
+
+		FakeClock(double timerTick, double wakeUpMin, double wakeUpMax)
+			: Now(0), TimerTick(timerTick), WakeUpMin(wakeUpMin), WakeUpMax(wakeUpMax), Random(1234), Slept(0), Spun(0)
+		{
+		}
+
+		void Sleep(double seconds)
+		{
+			double end = Now + seconds;
+			if (TimerTick > 0)
+				end = std::ceil(end / TimerTick) * TimerTick;
+			end += std::uniform_real_distribution<double>(WakeUpMin, WakeUpMax)(Random);
+			Slept += end - Now;
+			Now = end;
+		}
+
+		void Spin()
+		{
+			Now += 1e-6;
+			Spun += 1e-6;
+		}
+	};
+
+	// DXCore::WaitForNextFrame's limiter half.  Returns when the frame was let go.
+	double WaitForNextFrame(FrameLimiter& limiter, FakeClock& clock)
+	{
+		double sleepTime = limiter.GetSleepTime(clock.Now);
+		if (sleepTime > 0)
+		{
+			double start = clock.Now;
+			clock.Sleep(sleepTime);
+			limiter.Slept(sleepTime, clock.Now - start);
+		}
+		while (limiter.GetWaitTime(clock.Now) > 0)
+			clock.Spin();
+		limiter.StartFrame(clock.Now);
+		return clock.Now;
+	}
+
+	// Frames start at the target rate, never before they're due and hardly ever after
+	bool Rates(double seconds, FakeClock timer, const char* name)
+	{
+		bool ok = true;
+		const float rates[] = { 30, 60, 144, 240 };
+		for (float rate : rates)
+		{
+			FakeClock clock = timer;
+			FrameLimiter limiter(rate);
+			std::uniform_real_distribution<double> work(0.001, 0.003);
+
+			double period = 1.0 / rate;
+			double first = WaitForNextFrame(limiter, clock);
+			unsigned int frames = (unsigned int)(seconds * rate);
+			double worstEarly = 0;
+			double worstLate = 0;
+			for (unsigned int frame = 1; frame <= frames; frame++)
+			{
+				clock.Now += work(clock.Random);
+				double start = WaitForNextFrame(limiter, clock);
+				double due = first + frame * period;
+				worstEarly = std::max(worstEarly, due - start);
+				worstLate = std::max(worstLate, start - due);
+			}
+
+			double measuredRate = frames / (clock.Now - first);
+			ok &= std::fabs(measuredRate - rate) < rate * 1e-4;
+			ok &= worstEarly < 1e-9;
+			ok &= limiter.GetLateFrames() == 0;
+			printf("  %s, %3.0f fps: %.3f fps measured, latest frame %.1f us, spun %.3f ms a frame, margin %.2f ms\n",
+				name, rate, measuredRate, worstLate * 1e6, clock.Spun * 1000.0 / frames, limiter.GetSpinMargin() * 1000.0);
+		}
+		return ok;
+	}
+
+	// The margin follows how late sleeps wake up: narrow for a precise timer, wide enough for a coarse one,
+	// and widened straight away by one late wake up, which costs at most the one late frame
+	bool SpinMargin(double seconds)
+	{
+		bool ok = true;
+
+		FakeClock precise(0, 0.00005, 0.0004);
+		FrameLimiter preciseLimiter(144);
+		for (unsigned int frame = 0; frame < seconds * 144; frame++)
+		{
+			precise.Now += 0.002;
+			WaitForNextFrame(preciseLimiter, precise);
+		}
+		ok &= preciseLimiter.GetSpinMargin() < 0.0007;
+		ok &= precise.Spun < precise.Slept * 0.2;
+
+		FakeClock coarse(1.0 / 64, 0, 0.0005);
+		FrameLimiter coarseLimiter(60);
+		for (unsigned int frame = 0; frame < seconds * 60; frame++)
+		{
+			coarse.Now += 0.002;
+			WaitForNextFrame(coarseLimiter, coarse);
+		}
+		ok &= coarseLimiter.GetSpinMargin() > 0.01;
+		ok &= coarseLimiter.GetLateFrames() <= 1;	// Before it knew
+
+		// One sleep wakes up 5 ms late
+		FakeClock spike(0, 0.00005, 0.0004);
+		FrameLimiter spikeLimiter(60);
+		for (unsigned int frame = 0; frame < 600; frame++)
+		{
+			spike.Now += 0.002;
+			if (frame == 300)
+			{
+				spike.WakeUpMin = 0.005;
+				spike.WakeUpMax = 0.005;
+			}
+			WaitForNextFrame(spikeLimiter, spike);
+			if (frame == 300)
+			{
+				ok &= spikeLimiter.GetSpinMargin() > 0.005;
+				spike.WakeUpMin = 0.00005;
+				spike.WakeUpMax = 0.0004;
+			}
+		}
+		ok &= spikeLimiter.GetLateFrames() <= 1;
+		ok &= spikeLimiter.GetSpinMargin() < 0.001;
+
+		printf("  margin %.2f ms with a precise timer, %.2f ms with a 15.6 ms tick, %llu late frame(s) from one late wake up\n",
+			preciseLimiter.GetSpinMargin() * 1000.0, coarseLimiter.GetSpinMargin() * 1000.0, spikeLimiter.GetLateFrames());
+		return Check(ok, "Spin margin follows how late sleeps wake up");
+	}
+
+	// Frames that run long aren't held back, and the ones after them don't rush to catch up
+	bool LongFrames()
+	{
+		FakeClock clock(0, 0.00005, 0.0004);
+		FrameLimiter limiter(60);
+		double period = 1.0 / 60;
+		double last = WaitForNextFrame(limiter, clock);
+		double shortest = 1;
+		bool ok = true;
+		for (unsigned int frame = 1; frame < 200; frame++)
+		{
+			bool slow = frame >= 50 && frame < 60;
+			clock.Now += slow ? 0.05 : 0.002;
+			double start = WaitForNextFrame(limiter, clock);
+			if (slow)
+				ok &= start - last < 0.05 + 1e-9;
+			else
+				shortest = std::min(shortest, start - last);
+			last = start;
+		}
+		ok &= shortest > period - FRAME_LIMITER_SPIN_SLACK;
+		return Check(ok, "Long frames aren't caught up on");
+	}
+
+	// Changing the target takes effect from the next frame, and no target means no waiting
+	bool TargetChanges()
+	{
+		FakeClock clock(0, 0.00005, 0.0004);
+		FrameLimiter limiter(60);
+		double last = WaitForNextFrame(limiter, clock);
+		bool ok = true;
+		for (unsigned int frame = 1; frame < 400; frame++)
+		{
+			if (frame == 100)
+				limiter.SetTargetFps(120);
+			if (frame == 200)
+				limiter.SetTargetFps(0);
+			if (frame == 300)
+				limiter.SetTargetFps(30);
+
+			clock.Now += 0.001;
+			double before = clock.Now;
+			double start = WaitForNextFrame(limiter, clock);
+			double interval = start - last;
+			if (frame > 100 && frame < 200)
+				ok &= std::fabs(interval - 1.0 / 120) < FRAME_LIMITER_SPIN_SLACK;
+			if (frame >= 200 && frame < 300)
+				ok &= start == before;
+			if (frame > 300)
+				ok &= std::fabs(interval - 1.0 / 30) < FRAME_LIMITER_SPIN_SLACK;
+			last = start;
+		}
+		ok &= std::fabs(limiter.GetTargetFps() - 30.0f) < 1e-3f;
+
+		FrameLimiter unlimited;
+		ok &= unlimited.GetTargetFps() == 0.0f;
+		unlimited.StartFrame(1.0);
+		ok &= unlimited.GetWaitTime(1.0) == 0 && unlimited.GetSleepTime(1.0) == 0;
+		return Check(ok, "Target changes, and no target");
+	}
+
+	bool History()
+	{
+		LatencyHistory history;
+		bool ok = history.GetSampleCount() == 0 && history.GetAverage() == 0.0f && history.GetLatest() == 0.0f;
+
+		history.Add(0.010);
+		history.Add(0.020);
+		ok &= history.GetSampleCount() == 2 && history.GetOffset() == 0;
+		ok &= std::fabs(history.GetAverage() - 15.0f) < 1e-4f && std::fabs(history.GetWorst() - 20.0f) < 1e-4f;
+		ok &= std::fabs(history.GetLatest() - 20.0f) < 1e-4f;
+
+		// Wraps around, keeping only the newest
+		for (int i = 0; i < FRAME_LATENCY_HISTORY + 10; i++)
+			history.Add(0.001 * (i % 4 + 1));
+		ok &= history.GetSampleCount() == FRAME_LATENCY_HISTORY;
+		ok &= std::fabs(history.GetAverage() - 2.5f) < 1e-3f && std::fabs(history.GetWorst() - 4.0f) < 1e-4f;
+		ok &= std::fabs(history.GetSamples()[history.GetOffset()] - ((history.GetOffset() - 2) % 4 + 1)) < 1e-4f;
+		return Check(ok, "Latency history");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = argc >= 2 ? atof(argv[1]) : 60.0;
+
+	bool failed = false;
+	bool rates = Rates(seconds, FakeClock(0, 0.00005, 0.0004), "precise timer");
+	rates &= Rates(seconds, FakeClock(0.001, 0, 0.0005), "1 ms tick    ");
+	failed |= !Check(rates, "Frames start at the target rate, never early");
+	failed |= !SpinMargin(seconds);
+	failed |= !LongFrames();
+	failed |= !TargetChanges();
+	failed |= !History();
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,359 @@
+// Correctness check for the GPU profiler's query ring and read back (GpuProfiler)
+// - Not part of the Visual Studio project; it builds the game's GpuProfiler.cpp (and, for the pass hooks,
+//   FrameGraph.cpp and RenderTargetPool.cpp) on its own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. GpuProfilerCheck.cpp ../GpuProfiler.cpp ../FrameGraph.cpp ../FrameArena.cpp ../RenderTargetPool.cpp -o GpuProfilerCheck
+//
+// Usage:
+//   GpuProfilerCheck [randomFrames]
+//     Runs frames against a fake GPU that finishes each frame a set number of frames after it's issued (and
+//     sometimes has a disjoint clock), with passes that take known times.  Checks that results are never asked
+//     for before GPU_PROFILER_LATENCY frames, that every frame is either read back with exactly the times it
+//     took or counted as dropped, that averages cover the right frames, and that nested, overflowing and frame
+//     graph passes are timed as they should be.  Exits non-zero if anything is wrong.
+
+#include "../GpuProfiler.h"
+#include "../FrameGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const unsigned long long TicksPerSecond = 25000000;
+
+	// Each frame's queries hold the GPU clock when they were reached, and become readable once the
+	// GPU "finishes" the frame, Delay frames after the CPU ends it
+	class FakeGpu : public GpuProfilerBackend
+	{
+	public:
+		unsigned long long Clock = 1000;
+		unsigned long long CpuFrame = 0;	// Frames the CPU has ended
+		unsigned int Delay = 1;
+		bool NextDisjoint = false;
+		unsigned int Mistakes = 0;
+		std::vector<unsigned long long> Read;	// CPU frames whose results were read (and usable), in order
+
+		void Work(double milliseconds)
+		{
+			Clock += (unsigned long long)llround(milliseconds * TicksPerSecond / 1000.0);
+		}
+
+		void BeginFrame(unsigned int frame) override
+		{
+			Slots[frame] = {};
+			Slots[frame].Issued = CpuFrame;
+			Slots[frame].Disjoint = NextDisjoint;
+			Slots[frame].Open = true;
+		}
+
+		void EndFrame(unsigned int frame) override
+		{
+			Slots[frame].Open = false;
+			Slots[frame].ReadyAt = CpuFrame + Delay;
+		}
+
+		void Timestamp(unsigned int frame, unsigned int timestamp) override
+		{
+			if (!Slots[frame].Open || timestamp >= GPU_PROFILER_MAX_TIMESTAMPS)
+				Mistakes++;
+			Slots[frame].Timestamps[timestamp] = Clock;
+		}
+
+		bool GetFrequency(unsigned int frame, unsigned long long& ticksPerSecond, bool& disjoint) override
+		{
+			if (!Ready(frame))
+				return false;
+			ticksPerSecond = TicksPerSecond;
+			disjoint = Slots[frame].Disjoint;
+			if (!disjoint)
+				Read.push_back(Slots[frame].Issued);
+			return true;
+		}
+
+		bool GetTimestamp(unsigned int frame, unsigned int timestamp, unsigned long long& ticks) override
+		{
+			if (!Ready(frame))
+				return false;
+			ticks = Slots[frame].Timestamps[timestamp];
+			return true;
+		}
+
+	private:
+		struct Slot
+		{
+			unsigned long long Issued;
+			unsigned long long ReadyAt;
+			bool Open;
+			bool Disjoint;
+			unsigned long long Timestamps[GPU_PROFILER_MAX_TIMESTAMPS];
+		};
+
+		// Asking too early is the one thing the profiler promises never to do
+		bool Ready(unsigned int frame)
+		{
+			Slot& slot = Slots[frame];
+			if (slot.Open || CpuFrame < slot.Issued + GPU_PROFILER_LATENCY)
+				Mistakes++;
+			return !slot.Open && CpuFrame >= slot.ReadyAt;
+		}
+
+		Slot Slots[GPU_PROFILER_FRAMES] = {};
+	};
+
+	struct ExpectedFrame
+	{
+		std::vector<std::string> Names;
+		std::vector<double> Times;
+		double FrameTime;
+	};
+
+	// A frame of the game's passes, each taking a time that changes from frame to frame
+	ExpectedFrame RunFrame(GpuProfiler& profiler, FakeGpu& gpu, unsigned long long frame, std::mt19937& random)
+	{
+		const char* names[] = { "Shadow cascades", "Shadow atlas", "Main", "Sky", "Light scattering", "Light scattering composite", "ImGui" };
+		std::uniform_real_distribution<double> time(0.05, 3.0);
+		ExpectedFrame expected = {};
+
+		profiler.BeginFrame();
+		unsigned long long start = gpu.Clock;
+		for (unsigned int p = 0; p < 7; p++)
+		{
+			// Light scattering is sometimes turned off
+			if (p == 4 && frame % 3 == 0)
+				continue;
+			double ms = time(random);
+			profiler.BeginPass(names[p]);
+			gpu.Work(ms);
+			profiler.EndPass();
+			gpu.Work(0.01); // Between passes
+			expected.Names.push_back(names[p]);
+			expected.Times.push_back(ms);
+		}
+		expected.FrameTime = (gpu.Clock - start) * 1000.0 / TicksPerSecond;
+		profiler.EndFrame();
+		gpu.CpuFrame++;
+		return expected;
+	}
+
+	bool Near(double a, double b)
+	{
+		return fabs(a - b) < 0.0005;
+	}
+
+	// Runs frames with the GPU behind by whatever delay() says, checking each frame read back against what it took
+	bool RunFrames(unsigned int frames, std::function<unsigned int(unsigned long long)> delay, double disjointChance,
+		unsigned int& read, unsigned int& dropped, unsigned int& lowestAge)
+	{
+		FakeGpu gpu;
+		GpuProfiler profiler(&gpu);
+		std::mt19937 random(frames);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		std::vector<ExpectedFrame> expected;
+		std::map<std::string, std::deque<double>> windows; // The last GPU_PROFILER_AVERAGE_FRAMES times of each pass read
+		bool ok = true;
+		lowestAge = UINT_MAX;
+
+		for (unsigned long long f = 0; f < frames; f++)
+		{
+			gpu.Delay = delay(f);
+			gpu.NextDisjoint = unit(random) < disjointChance;
+			size_t readBefore = gpu.Read.size();
+			expected.push_back(RunFrame(profiler, gpu, f, random));
+			if (gpu.Read.size() == readBefore)
+				continue;
+
+			// Frames must come back in order, and every one read counts towards the averages
+			for (size_t r = readBefore; r < gpu.Read.size(); r++)
+			{
+				unsigned long long frame = gpu.Read[r];
+				if (r > 0 && frame <= gpu.Read[r - 1])
+					ok = false;
+				lowestAge = std::min(lowestAge, (unsigned int)(f - frame));
+				const ExpectedFrame& e = expected[frame];
+				for (unsigned int p = 0; p < e.Names.size(); p++)
+				{
+					std::deque<double>& window = windows[e.Names[p]];
+					window.push_back(e.Times[p]);
+					if (window.size() > GPU_PROFILER_AVERAGE_FRAMES)
+						window.pop_front();
+				}
+			}
+
+			// Only the newest frame read is shown
+			const ExpectedFrame& e = expected[gpu.Read.back()];
+			const std::vector<GpuPassTime>& times = profiler.GetPassTimes();
+			if (times.size() != e.Names.size() || !Near(profiler.GetFrameTime(), e.FrameTime))
+			{
+				ok = false;
+				continue;
+			}
+			for (unsigned int p = 0; p < times.size(); p++)
+			{
+				const std::deque<double>& window = windows[e.Names[p]];
+				double sum = 0;
+				for (double t : window)
+					sum += t;
+				if (times[p].Name != e.Names[p] || times[p].Depth != 0 || !Near(times[p].Milliseconds, e.Times[p]) ||
+					!Near(times[p].Average, sum / window.size()))
+					ok = false;
+			}
+		}
+
+		read = profiler.GetFramesRead();
+		dropped = profiler.GetFramesDropped();
+		ok &= gpu.Mistakes == 0;
+
+		// Whatever wasn't read or dropped is still in flight, and there's only room for so many
+		unsigned int inFlight = frames - read - dropped;
+		ok &= inFlight <= GPU_PROFILER_FRAMES;
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int randomFrames = argc >= 2 ? (unsigned int)atoi(argv[1]) : 10000;
+	bool failed = false;
+
+	// A GPU that keeps up: every frame is read back, exactly GPU_PROFILER_LATENCY frames late
+	{
+		unsigned int read, dropped, lowestAge;
+		bool ok = RunFrames(1000, [](unsigned long long) { return 1u; }, 0.0, read, dropped, lowestAge);
+		ok &= dropped == 0 && read == 1000 - GPU_PROFILER_LATENCY && lowestAge == GPU_PROFILER_LATENCY;
+		failed |= !ok;
+		printf("GPU keeping up: %u of 1000 frames read, %u dropped, %u frames late%s\n", read, dropped, lowestAge, ok ? "" : "  WRONG");
+	}
+
+	// A GPU just as far behind as the ring allows: still every frame, but later
+	{
+		unsigned int read, dropped, lowestAge;
+		bool ok = RunFrames(1000, [](unsigned long long) { return (unsigned int)GPU_PROFILER_FRAMES - 1; }, 0.0, read, dropped, lowestAge);
+		ok &= dropped == 0 && read == 1000 - (GPU_PROFILER_FRAMES - 1) && lowestAge == GPU_PROFILER_FRAMES - 1;
+		failed |= !ok;
+		printf("GPU %u frames behind: %u of 1000 frames read, %u dropped, %u frames late%s\n",
+			GPU_PROFILER_FRAMES - 1, read, dropped, lowestAge, ok ? "" : "  WRONG");
+	}
+
+	// Further behind than that: frames are dropped rather than waited for
+	{
+		unsigned int read, dropped, lowestAge;
+		bool ok = RunFrames(1000, [](unsigned long long) { return (unsigned int)GPU_PROFILER_FRAMES + 2; }, 0.0, read, dropped, lowestAge);
+		ok &= read == 0 && dropped == 1000 - GPU_PROFILER_FRAMES;
+		failed |= !ok;
+		printf("GPU %u frames behind: %u of 1000 frames read, %u dropped%s\n", GPU_PROFILER_FRAMES + 2, read, dropped, ok ? "" : "  WRONG");
+	}
+
+	// Anything in between, now and then with a disjoint clock
+	{
+		std::mt19937 random(7);
+		std::uniform_int_distribution<unsigned int> delays(0, GPU_PROFILER_FRAMES + 1);
+		unsigned int read, dropped, lowestAge;
+		bool ok = RunFrames(randomFrames, [&](unsigned long long) { return delays(random); }, 0.05, read, dropped, lowestAge);
+		ok &= read > 0 && dropped > 0 && lowestAge >= GPU_PROFILER_LATENCY;
+		failed |= !ok;
+		printf("%u frames with random delays: %u read, %u dropped, never sooner than %u frames%s\n",
+			randomFrames, read, dropped, lowestAge, ok ? "" : "  WRONG");
+	}
+
+	// Nested passes, and more of them than there are timestamps for
+	{
+		FakeGpu gpu;
+		GpuProfiler profiler(&gpu);
+		profiler.BeginFrame();
+		profiler.BeginPass("Outer");
+		gpu.Work(1.0);
+		profiler.BeginPass("Inner");
+		gpu.Work(2.0);
+		profiler.EndPass();
+		profiler.EndPass();
+		for (unsigned int p = 0; p < GPU_PROFILER_MAX_TIMESTAMPS; p++)
+		{
+			profiler.BeginPass("Many");
+			gpu.Work(0.5);
+			profiler.EndPass();
+		}
+		profiler.BeginPass("Left open");
+		gpu.Work(0.25);
+		profiler.EndFrame();
+		for (unsigned int f = 0; f < GPU_PROFILER_LATENCY; f++)
+		{
+			gpu.CpuFrame++;
+			profiler.BeginFrame();
+			profiler.EndFrame();
+		}
+
+		// Two timestamps for the frame, four for the nested pair, then as many twos as fit
+		unsigned int timed = (GPU_PROFILER_MAX_TIMESTAMPS - 6) / 2;
+		const std::vector<GpuPassTime>& times = profiler.GetPassTimes();
+		bool ok = gpu.Mistakes == 0 && profiler.GetFramesRead() == 1 && times.size() == 2 + timed &&
+			times[0].Name == "Outer" && times[0].Depth == 0 && Near(times[0].Milliseconds, 3.0) &&
+			times[1].Name == "Inner" && times[1].Depth == 1 && Near(times[1].Milliseconds, 2.0) &&
+			times.back().Name == "Many" && Near(times.back().Milliseconds, 0.5) &&
+			profiler.GetPassesSkipped() == GPU_PROFILER_MAX_TIMESTAMPS - timed + 1;
+		failed |= !ok;
+		printf("Nesting and overflow: %u passes timed, %u skipped%s\n",
+			(unsigned int)times.size(), profiler.GetPassesSkipped(), ok ? "" : "  WRONG");
+	}
+
+	// Timed through the frame graph's hooks: culled passes aren't timed
+	{
+		class NullBackend : public FrameGraphBackend
+		{
+		public:
+			void CreateTexture(unsigned int, const RenderTargetDesc&) override {}
+			void ReleaseTexture(unsigned int) override {}
+			void PlaceTransient(unsigned int, unsigned int) override {}
+			void BindTargets(const unsigned int*, unsigned int, int, unsigned int, unsigned int) override {}
+			void UnbindShaderResources(const unsigned int*, unsigned int) override {}
+		};
+
+		NullBackend backend;
+		FrameGraph graph(&backend);
+		FakeGpu gpu;
+		GpuProfiler profiler(&gpu);
+		graph.SetPassHooks(
+			[&](const char* name) { profiler.BeginPass(name); },
+			[&](const char*) { profiler.EndPass(); });
+
+		for (unsigned int f = 0; f <= GPU_PROFILER_LATENCY; f++)
+		{
+			graph.Reset();
+			unsigned int backBuffer = graph.Import("Back buffer", 1280, 720, true);
+			unsigned int scene = graph.Create("Scene", { 1280, 720, 28, 0 });
+			unsigned int unused = graph.Create("Debug view", { 1280, 720, 28, 0 });
+			unsigned int pass = graph.AddPass("Main", [&]() { gpu.Work(4.0); });
+			graph.Write(pass, scene, FRAME_GRAPH_RENDER_TARGET, true);
+			pass = graph.AddPass("Debug view", [&]() { gpu.Work(100.0); });
+			graph.Read(pass, scene);
+			graph.Write(pass, unused, FRAME_GRAPH_RENDER_TARGET, true);
+			pass = graph.AddPass("Composite", [&]() { gpu.Work(1.0); });
+			graph.Read(pass, scene);
+			graph.Write(pass, backBuffer, FRAME_GRAPH_RENDER_TARGET, true);
+			graph.Compile();
+
+			profiler.BeginFrame();
+			graph.Execute();
+			profiler.EndFrame();
+			gpu.CpuFrame++;
+		}
+
+		const std::vector<GpuPassTime>& times = profiler.GetPassTimes();
+		bool ok = gpu.Mistakes == 0 && times.size() == 2 &&
+			times[0].Name == "Main" && Near(times[0].Milliseconds, 4.0) &&
+			times[1].Name == "Composite" && Near(times[1].Milliseconds, 1.0) && Near(profiler.GetFrameTime(), 5.0);
+		failed |= !ok;
+		printf("Frame graph passes: %u timed, %.3f ms frame%s\n", (unsigned int)times.size(), profiler.GetFrameTime(), ok ? "" : "  WRONG");
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,849 @@
+// Correctness check for the PNG decoder and the DEFLATE decompressor under it (ImageData)
+// - Not part of the Visual Studio project; it builds the game's ImageData.cpp on its own, plus ContentHash.cpp
+//   to hash what the shipped textures decode to
+// - The streams it decodes come from a small DEFLATE encoder here (literals, matches, and every block type),
+//   written from RFC 1951 rather than from the decoder, and from the shipped PNGs, which other tools encoded
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. ImageDataCheck.cpp ../ImageData.cpp ../ContentHash.cpp -o ImageDataCheck
+//
+// Usage:
+//   ImageDataCheck [textureFolder]
+//     Round trips test data through stored, fixed Huffman and dynamic Huffman blocks (alone and mixed in one
+//     stream, with matches reaching back across blocks), checks that streams with bad lengths, distances,
+//     codes or checksums are rejected, and that PNGs with a bad chunk CRC are too, as are ones with a bit depth
+//     their color type doesn't allow or bigger than PNG_MAX_DIMENSION.  Writes DDS files (in the system temp
+//     folder) and checks that every truncation of them fails IsCompleteDDS and no temp files are left.  Then
+//     decodes every shipped PNG in textureFolder (../Assets/Textures by default) and compares each against the
+//     size and pixel hash a zlib based reference decoder gave.  Exits non-zero if anything is wrong.
+
+#include "../ContentHash.h"
+#include "../ImageData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Bits go in from the least significant end of each byte, as DEFLATE packs them
+	struct BitWriter
+	{
+		std::vector<unsigned char> Bytes;
+		unsigned int Buffer = 0;
+		int Count = 0;
+
+		void Put(unsigned int value, int bits)
+		{
+			for (int i = 0; i < bits; i++)
+			{
+				Buffer |= ((value >> i) & 1) << Count;
+				if (++Count == 8)
+				{
+					Bytes.push_back((unsigned char)Buffer);
+					Buffer = 0;
+					Count = 0;
+				}
+			}
+		}
+
+		// Huffman codes go most significant bit first
+		void PutCode(unsigned int code, int length)
+		{
+			for (int i = length - 1; i >= 0; i--)
+				Put((code >> i) & 1, 1);
+		}
+
+		void Align()
+		{
+			if (Count > 0)
+				Put(0, 8 - Count);
+		}
+	};
+
+	struct Code
+	{
+		unsigned int Bits;
+		int Length;
+	};
+
+	// Canonical codes from code lengths (RFC 1951, 3.2.2)
+	std::vector<Code> CanonicalCodes(const std::vector<int>& lengths)
+	{
+		int counts[16] = {};
+		for (int length : lengths)
+			counts[length]++;
+		counts[0] = 0;
+
+		unsigned int next[16] = {};
+		unsigned int code = 0;
+		for (int length = 1; length < 16; length++)
+		{
+			code = (code + counts[length - 1]) << 1;
+			next[length] = code;
+		}
+
+		std::vector<Code> codes(lengths.size());
+		for (size_t i = 0; i < lengths.size(); i++)
+		{
+			codes[i].Length = lengths[i];
+			if (lengths[i] != 0)
+				codes[i].Bits = next[lengths[i]]++;
+		}
+		return codes;
+	}
+
+	// Huffman code lengths for the given symbol frequencies, no longer than maxLength.  Too long, and the
+	// frequencies are flattened until they fit.
+	std::vector<int> HuffmanLengths(std::vector<unsigned int> frequencies, int maxLength)
+	{
+		while (true)
+		{
+			struct Node { unsigned long long Weight; int Left, Right; };
+			std::vector<Node> nodes;
+			std::vector<int> live;
+			for (size_t i = 0; i < frequencies.size(); i++)
+			{
+				if (frequencies[i] > 0)
+				{
+					live.push_back((int)nodes.size());
+					nodes.push_back({ frequencies[i], -1, (int)i });
+				}
+			}
+
+			std::vector<int> lengths(frequencies.size(), 0);
+			if (live.size() == 1)
+			{
+				lengths[nodes[0].Right] = 1;
+				return lengths;
+			}
+
+			while (live.size() > 1)
+			{
+				std::sort(live.begin(), live.end(), [&](int a, int b) { return nodes[a].Weight > nodes[b].Weight; });
+				int a = live.back(); live.pop_back();
+				int b = live.back(); live.pop_back();
+				live.push_back((int)nodes.size());
+				nodes.push_back({ nodes[a].Weight + nodes[b].Weight, a, b });
+			}
+
+			// Depth of every leaf
+			int longest = 0;
+			std::vector<std::pair<int, int>> stack = { { live[0], 0 } };
+			while (!stack.empty())
+			{
+				std::pair<int, int> top = stack.back();
+				stack.pop_back();
+				const Node& node = nodes[top.first];
+				if (node.Left < 0)
+				{
+					lengths[node.Right] = top.second;
+					longest = std::max(longest, top.second);
+				}
+				else
+				{
+					stack.push_back({ node.Left, top.second + 1 });
+					stack.push_back({ node.Right, top.second + 1 });
+				}
+			}
+			if (longest <= maxLength)
+				return lengths;
+
+			for (unsigned int& frequency : frequencies)
+				frequency = frequency > 0 ? frequency / 2 + 1 : 0;
+		}
+	}
+
+	const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// A literal, or a match of Length bytes from Distance back
+	struct Token
+	{
+		int Length;
+		int Distance;
+		unsigned char Literal;
+	};
+
+	int LengthIndex(int length)
+	{
+		int index = 28;
+		while (lengthBase[index] > length)
+			index--;
+		return index;
+	}
+
+	int DistanceIndex(int distance)
+	{
+		int index = 29;
+		while (distBase[index] > distance)
+			index--;
+		return index;
+	}
+
+	// Greedy LZ77 over [begin, end), matching anything up to 32 KB back (including before begin)
+	std::vector<Token> FindMatches(const std::vector<unsigned char>& data, size_t begin, size_t end)
+	{
+		std::vector<Token> tokens;
+		std::vector<int> head(1 << 16, -1);
+		std::vector<int> previous(data.size(), -1);
+		auto hash = [&](size_t i) { return (data[i] * 506832829u ^ data[i + 1] * 2654435761u ^ data[i + 2] * 40503u) & 0xFFFF; };
+		auto insert = [&](size_t i) { if (i + 2 < data.size()) { unsigned int h = hash(i); previous[i] = head[h]; head[h] = (int)i; } };
+
+		size_t from = begin > 32768 ? begin - 32768 : 0;
+		for (size_t i = from; i < begin; i++)
+			insert(i);
+
+		size_t i = begin;
+		while (i < end)
+		{
+			int bestLength = 0;
+			int bestDistance = 0;
+			if (i + 2 < end)
+			{
+				int candidate = head[hash(i)];
+				for (int chain = 0; candidate >= 0 && chain < 64; chain++, candidate = previous[candidate])
+				{
+					int distance = (int)(i - candidate);
+					if (distance > 32768)
+						break;
+					int length = 0;
+					while (length < 258 && i + length < end && data[candidate + length] == data[i + length])
+						length++;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			if (bestLength >= 3)
+			{
+				tokens.push_back({ bestLength, bestDistance, 0 });
+				for (int k = 0; k < bestLength; k++)
+					insert(i + k);
+				i += bestLength;
+			}
+			else
+			{
+				tokens.push_back({ 0, 0, data[i] });
+				insert(i);
+				i++;
+			}
+		}
+		return tokens;
+	}
+
+	void WriteTokens(BitWriter& out, const std::vector<Token>& tokens, const std::vector<Code>& lengthCodes, const std::vector<Code>& distCodes)
+	{
+		for (const Token& token : tokens)
+		{
+			if (token.Length == 0)
+			{
+				out.PutCode(lengthCodes[token.Literal].Bits, lengthCodes[token.Literal].Length);
+				continue;
+			}
+			int lengthIndex = LengthIndex(token.Length);
+			out.PutCode(lengthCodes[257 + lengthIndex].Bits, lengthCodes[257 + lengthIndex].Length);
+			out.Put(token.Length - lengthBase[lengthIndex], lengthExtra[lengthIndex]);
+			int distIndex = DistanceIndex(token.Distance);
+			out.PutCode(distCodes[distIndex].Bits, distCodes[distIndex].Length);
+			out.Put(token.Distance - distBase[distIndex], distExtra[distIndex]);
+		}
+		out.PutCode(lengthCodes[256].Bits, lengthCodes[256].Length);
+	}
+
+	std::vector<Code> FixedLengthCodes()
+	{
+		std::vector<int> lengths(288);
+		for (int i = 0; i < 288; i++)
+			lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+		return CanonicalCodes(lengths);
+	}
+
+	void WriteFixedBlock(BitWriter& out, const std::vector<Token>& tokens, bool last)
+	{
+		out.Put(last, 1);
+		out.Put(1, 2);
+		WriteTokens(out, tokens, FixedLengthCodes(), CanonicalCodes(std::vector<int>(30, 5)));
+	}
+
+	// Code lengths from this block's own symbol counts, sent run length coded (16, 17 and 18) with a code of their own
+	void WriteDynamicBlock(BitWriter& out, const std::vector<Token>& tokens, bool last)
+	{
+		std::vector<unsigned int> lengthCounts(286, 0);
+		std::vector<unsigned int> distCounts(30, 0);
+		lengthCounts[256] = 1;
+		distCounts[0] = distCounts[1] = 1; // Always two, so neither code is a lone one bit code
+		for (const Token& token : tokens)
+		{
+			if (token.Length == 0)
+				lengthCounts[token.Literal]++;
+			else
+			{
+				lengthCounts[257 + LengthIndex(token.Length)]++;
+				distCounts[DistanceIndex(token.Distance)]++;
+			}
+		}
+		std::vector<int> lengthLengths = HuffmanLengths(lengthCounts, 15);
+		std::vector<int> distLengths = HuffmanLengths(distCounts, 15);
+
+		int lengthCount = 286;
+		while (lengthLengths[lengthCount - 1] == 0)
+			lengthCount--;
+		int distCount = 30;
+		while (distLengths[distCount - 1] == 0)
+			distCount--;
+
+		std::vector<int> all(lengthLengths.begin(), lengthLengths.begin() + lengthCount);
+		all.insert(all.end(), distLengths.begin(), distLengths.begin() + distCount);
+
+		// Run length code them: { symbol, extra bits value }
+		std::vector<std::pair<int, int>> runs;
+		for (size_t i = 0; i < all.size(); )
+		{
+			size_t run = 1;
+			while (i + run < all.size() && all[i + run] == all[i])
+				run++;
+
+			if (all[i] == 0 && run >= 11)
+			{
+				run = std::min<size_t>(run, 138);
+				runs.push_back({ 18, (int)run - 11 });
+			}
+			else if (all[i] == 0 && run >= 3)
+				runs.push_back({ 17, (int)run - 3 });
+			else if (all[i] != 0 && run >= 4)
+			{
+				run = std::min<size_t>(run, 7);
+				runs.push_back({ all[i], 0 });
+				runs.push_back({ 16, (int)run - 4 });
+			}
+			else
+			{
+				run = 1;
+				runs.push_back({ all[i], 0 });
+			}
+			i += run;
+		}
+
+		std::vector<unsigned int> codeLengthCounts(19, 0);
+		for (const std::pair<int, int>& run : runs)
+			codeLengthCounts[run.first]++;
+		std::vector<int> codeLengthLengths = HuffmanLengths(codeLengthCounts, 7);
+		std::vector<Code> codeLengthCodes = CanonicalCodes(codeLengthLengths);
+
+		static const int order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		int codeCount = 19;
+		while (codeCount > 4 && codeLengthLengths[order[codeCount - 1]] == 0)
+			codeCount--;
+
+		out.Put(last, 1);
+		out.Put(2, 2);
+		out.Put(lengthCount - 257, 5);
+		out.Put(distCount - 1, 5);
+		out.Put(codeCount - 4, 4);
+		for (int i = 0; i < codeCount; i++)
+			out.Put(codeLengthLengths[order[i]], 3);
+		for (const std::pair<int, int>& run : runs)
+		{
+			out.PutCode(codeLengthCodes[run.first].Bits, codeLengthCodes[run.first].Length);
+			if (run.first == 16) out.Put(run.second, 2);
+			if (run.first == 17) out.Put(run.second, 3);
+			if (run.first == 18) out.Put(run.second, 7);
+		}
+
+		lengthLengths.resize(286);
+		WriteTokens(out, tokens, CanonicalCodes(lengthLengths), CanonicalCodes(distLengths));
+	}
+
+	void WriteStoredBlock(BitWriter& out, const unsigned char* data, size_t size, bool last)
+	{
+		out.Put(last, 1);
+		out.Put(0, 2);
+		out.Align();
+		out.Put((unsigned int)size, 16);
+		out.Put(~(unsigned int)size & 0xFFFF, 16);
+		out.Bytes.insert(out.Bytes.end(), data, data + size);
+	}
+
+	unsigned int Adler32(const std::vector<unsigned char>& data)
+	{
+		unsigned int a = 1;
+		unsigned int b = 0;
+		for (unsigned char byte : data)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	void PutBigEndian32(std::vector<unsigned char>& out, unsigned int value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	// A zlib stream of the data in blocks of blockSize, their types (0 stored, 1 fixed, 2 dynamic) taken in turn
+	std::vector<unsigned char> Compress(const std::vector<unsigned char>& data, const std::vector<int>& types, size_t blockSize)
+	{
+		BitWriter out;
+		out.Bytes = { 0x78, 0x01 };
+		size_t blocks = std::max<size_t>(1, (data.size() + blockSize - 1) / blockSize);
+		for (size_t block = 0; block < blocks; block++)
+		{
+			size_t begin = block * blockSize;
+			size_t end = std::min(data.size(), begin + blockSize);
+			bool last = block == blocks - 1;
+			int type = types[block % types.size()];
+			if (type == 0)
+				WriteStoredBlock(out, data.data() + begin, end - begin, last);
+			else if (type == 1)
+				WriteFixedBlock(out, FindMatches(data, begin, end), last);
+			else
+				WriteDynamicBlock(out, FindMatches(data, begin, end), last);
+		}
+		out.Align();
+		PutBigEndian32(out.Bytes, Adler32(data));
+		return out.Bytes;
+	}
+
+	// Something of everything: noise, text, long runs, repeats from near the back of the window
+	std::vector<unsigned char> TestData(size_t size)
+	{
+		std::mt19937 random(1234);
+		std::vector<unsigned char> data;
+		const char* words[] = { "shadow ", "cascade ", "atlas ", "light ", "cluster ", "frame ", "graph ", "\n" };
+		while (data.size() < size)
+		{
+			switch (random() % 5)
+			{
+			case 0:
+				for (int i = 0; i < 300; i++)
+					data.push_back((unsigned char)random());
+				break;
+			case 1:
+				for (int i = 0; i < 100; i++)
+				{
+					const char* word = words[random() % 8];
+					data.insert(data.end(), word, word + strlen(word));
+				}
+				break;
+			case 2:
+				data.insert(data.end(), 1000 + random() % 2000, (unsigned char)random());
+				break;
+			case 3:
+				if (data.size() > 30000)
+				{
+					size_t from = data.size() - 30000 + random() % 2000;
+					for (int i = 0; i < 600; i++)
+						data.push_back(data[from + i]);
+				}
+				break;
+			default:
+				for (int i = 0; i < 200; i++)
+					data.push_back((unsigned char)(i * 3 + random() % 4));
+				break;
+			}
+		}
+		data.resize(size);
+		return data;
+	}
+
+	bool RoundTrip(const std::vector<unsigned char>& data, const std::vector<int>& types, size_t blockSize)
+	{
+		std::vector<unsigned char> stream = Compress(data, types, blockSize);
+		std::vector<unsigned char> decoded;
+		return InflateZlib(stream.data(), stream.size(), decoded) && decoded == data;
+	}
+
+	bool BlockTypes()
+	{
+		std::vector<unsigned char> data = TestData(300000);
+		bool ok = true;
+
+		bool stored = RoundTrip(data, { 0 }, 65535) && RoundTrip(data, { 0 }, 1000) && RoundTrip({}, { 0 }, 1);
+		ok &= Check(stored, "Stored blocks");
+
+		std::vector<unsigned char> stream = Compress(data, { 1 }, 50000);
+		bool fixed = RoundTrip(data, { 1 }, 50000) && RoundTrip(data, { 1 }, data.size()) && stream.size() < data.size();
+		printf("  %zu bytes in fixed Huffman blocks: %zu\n", data.size(), stream.size());
+		ok &= Check(fixed, "Fixed Huffman blocks");
+
+		stream = Compress(data, { 2 }, 50000);
+		bool dynamic = RoundTrip(data, { 2 }, 50000) && RoundTrip(data, { 2 }, 7000) && RoundTrip(data, { 2 }, data.size());
+		printf("  %zu bytes in dynamic Huffman blocks: %zu\n", data.size(), stream.size());
+		ok &= Check(dynamic, "Dynamic Huffman blocks");
+
+		// Matches from one block reaching back into others of other types
+		bool mixed = RoundTrip(data, { 0, 1, 2 }, 20000) && RoundTrip(data, { 2, 1, 0, 1 }, 3333);
+		ok &= Check(mixed, "Mixed blocks");
+
+		// A run of one byte repeats from a distance of 1, overlapping the bytes it copies from
+		std::vector<unsigned char> run(5000, 'x');
+		run[0] = 'y';
+		ok &= Check(RoundTrip(run, { 1 }, run.size()) && RoundTrip(run, { 2 }, run.size()), "Overlapping matches");
+
+		// Output appends, with the checksum only over this stream's part
+		std::vector<unsigned char> small(data.begin(), data.begin() + 5000);
+		stream = Compress(small, { 2 }, small.size());
+		std::vector<unsigned char> decoded = { 1, 2, 3 };
+		bool appends = InflateZlib(stream.data(), stream.size(), decoded) && decoded.size() == 5003 && std::equal(small.begin(), small.end(), decoded.begin() + 3);
+		ok &= Check(appends, "Appends to what's there");
+		return ok;
+	}
+
+	bool Rejects(const std::vector<unsigned char>& stream)
+	{
+		std::vector<unsigned char> decoded;
+		return !InflateZlib(stream.data(), stream.size(), decoded);
+	}
+
+	// A fixed Huffman block of just these symbols and extra bits, { symbol, 0 } for a literal
+	std::vector<unsigned char> FixedStream(const std::vector<std::pair<int, int>>& symbols)
+	{
+		std::vector<Code> lengthCodes = FixedLengthCodes();
+		BitWriter out;
+		out.Bytes = { 0x78, 0x01 };
+		out.Put(1, 1);
+		out.Put(1, 2);
+		for (const std::pair<int, int>& symbol : symbols)
+		{
+			if (symbol.first >= 0)
+				out.PutCode(lengthCodes[symbol.first].Bits, lengthCodes[symbol.first].Length);
+			else
+				out.PutCode(-symbol.first - 1, 5); // A distance code
+			if (symbol.second > 0)
+				out.Put(0, symbol.second);
+		}
+		out.PutCode(lengthCodes[256].Bits, lengthCodes[256].Length);
+		out.Align();
+		PutBigEndian32(out.Bytes, 0);
+		return out.Bytes;
+	}
+
+	bool BadStreams()
+	{
+		std::vector<unsigned char> data = TestData(20000);
+		bool ok = true;
+
+		// Stored blocks whose length and its complement disagree, or that run past the end
+		std::vector<unsigned char> stored = Compress(data, { 0 }, 1000);
+		std::vector<unsigned char> badComplement = stored;
+		badComplement[5] ^= 1;
+		std::vector<unsigned char> tooLong = Compress(std::vector<unsigned char>(data.begin(), data.begin() + 100), { 0 }, 100);
+		tooLong[3] = 200;
+		tooLong[5] = (unsigned char)~200;
+		ok &= Check(Rejects(badComplement) && Rejects(tooLong), "Bad stored lengths rejected");
+
+		// Length symbols 286 and 287 don't exist, nor do distance symbols 30 and 31
+		bool lengths = Rejects(FixedStream({ { 'a', 0 }, { 286, 0 } })) && Rejects(FixedStream({ { 'a', 0 }, { 287, 0 } }));
+		ok &= Check(lengths, "Bad length symbols rejected");
+		bool distances = Rejects(FixedStream({ { 'a', 0 }, { 257, 0 }, { -31, 0 } })) && Rejects(FixedStream({ { 'a', 0 }, { 257, 0 }, { -32, 0 } }));
+		// Nor can a match reach back before the start: one byte out, then 3 from 2 back
+		distances &= Rejects(FixedStream({ { 'a', 0 }, { 257, 0 }, { -2, 0 } }));
+		// The same, 1 back, is fine (apart from the checksum, so compare what came out)
+		std::vector<unsigned char> fine = FixedStream({ { 'a', 0 }, { 257, 0 }, { -1, 0 } });
+		std::vector<unsigned char> decoded;
+		InflateZlib(fine.data(), fine.size(), decoded);
+		distances &= decoded == std::vector<unsigned char>(4, 'a');
+		ok &= Check(distances, "Bad distances rejected");
+
+		// Dynamic blocks: too many length codes, a code length code set that's over-subscribed, and a repeat with
+		// nothing before it to repeat
+		BitWriter tooMany;
+		tooMany.Bytes = { 0x78, 0x01 };
+		tooMany.Put(1, 1); tooMany.Put(2, 2); tooMany.Put(30, 5); tooMany.Put(0, 5); tooMany.Put(15, 4);
+		tooMany.Put(0, 32); tooMany.Put(0, 32);
+		BitWriter overSubscribed;
+		overSubscribed.Bytes = { 0x78, 0x01 };
+		overSubscribed.Put(1, 1); overSubscribed.Put(2, 2); overSubscribed.Put(0, 5); overSubscribed.Put(0, 5); overSubscribed.Put(15, 4);
+		for (int i = 0; i < 19; i++)
+			overSubscribed.Put(1, 3);
+		overSubscribed.Put(0, 32);
+		BitWriter repeatFirst;
+		repeatFirst.Bytes = { 0x78, 0x01 };
+		repeatFirst.Put(1, 1); repeatFirst.Put(2, 2); repeatFirst.Put(0, 5); repeatFirst.Put(0, 5); repeatFirst.Put(0, 4);
+		repeatFirst.Put(1, 3); repeatFirst.Put(1, 3); repeatFirst.Put(0, 3); repeatFirst.Put(0, 3); // Codes for 16 and 17
+		repeatFirst.PutCode(0, 1); // 16 first
+		repeatFirst.Put(0, 32);
+		ok &= Check(Rejects(tooMany.Bytes) && Rejects(overSubscribed.Bytes) && Rejects(repeatFirst.Bytes), "Bad dynamic code lengths rejected");
+
+		// Block type 3, a bad header, a wrong checksum, and streams cut short
+		BitWriter reserved;
+		reserved.Bytes = { 0x78, 0x01 };
+		reserved.Put(1, 1);
+		reserved.Put(3, 2);
+		reserved.Put(0, 32);
+		std::vector<unsigned char> dynamic = Compress(data, { 2 }, 5000);
+		std::vector<unsigned char> badMethod = dynamic;
+		badMethod[0] = 0x77;
+		std::vector<unsigned char> dictionary = dynamic;
+		dictionary[1] |= 0x20;
+		std::vector<unsigned char> badChecksum = dynamic;
+		badChecksum.back() ^= 0x40;
+		std::vector<unsigned char> badData = dynamic;
+		badData[dynamic.size() / 2] ^= 0x10;
+		bool rest = Rejects(reserved.Bytes) && Rejects(badMethod) && Rejects(dictionary) && Rejects(badChecksum) && Rejects(badData);
+		for (size_t cut : { (size_t)1, (size_t)4, dynamic.size() / 3, dynamic.size() - 5, dynamic.size() - 1 })
+			rest &= Rejects(std::vector<unsigned char>(dynamic.begin(), dynamic.begin() + cut));
+		ok &= Check(rest, "Bad headers, block types, checksums and truncation rejected");
+		return ok;
+	}
+
+	void PutChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+	{
+		// A reference CRC-32, bit at a time
+		std::vector<unsigned char> crcData(type, type + 4);
+		crcData.insert(crcData.end(), data.begin(), data.end());
+		unsigned int crc = 0xFFFFFFFFu;
+		for (unsigned char byte : crcData)
+		{
+			crc ^= byte;
+			for (int bit = 0; bit < 8; bit++)
+				crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+		}
+
+		PutBigEndian32(png, (unsigned int)data.size());
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		PutBigEndian32(png, crc ^ 0xFFFFFFFFu);
+	}
+
+	// A PNG with this header around already filtered scanlines, in two IDAT chunks
+	std::vector<unsigned char> MakePNG(unsigned int width, unsigned int height, unsigned char bitDepth, unsigned char colorType, const std::vector<unsigned char>& raw)
+	{
+		std::vector<unsigned char> stream = Compress(raw, { 2 }, 4096);
+
+		std::vector<unsigned char> png = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		std::vector<unsigned char> header;
+		PutBigEndian32(header, width);
+		PutBigEndian32(header, height);
+		header.insert(header.end(), { bitDepth, colorType, 0, 0, 0 });
+		PutChunk(png, "IHDR", header);
+		PutChunk(png, "IDAT", std::vector<unsigned char>(stream.begin(), stream.begin() + stream.size() / 2));
+		PutChunk(png, "IDAT", std::vector<unsigned char>(stream.begin() + stream.size() / 2, stream.end()));
+		PutChunk(png, "IEND", {});
+		return png;
+	}
+
+	// An RGBA PNG of the pixels, unfiltered
+	std::vector<unsigned char> EncodePNG(const ImageData& image)
+	{
+		std::vector<unsigned char> raw;
+		for (unsigned int y = 0; y < image.Height; y++)
+		{
+			raw.push_back(0);
+			raw.insert(raw.end(), image.Pixels.begin() + (size_t)y * image.Width * 4, image.Pixels.begin() + (size_t)(y + 1) * image.Width * 4);
+		}
+		return MakePNG(image.Width, image.Height, 8, 6, raw);
+	}
+
+	// A small image of this depth and color type, with scanlines of the right length, so only the header can be wrong
+	bool DecodesHeader(unsigned int width, unsigned int height, unsigned char bitDepth, unsigned char colorType)
+	{
+		const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+		size_t stride = ((size_t)width * (colorType < 7 ? std::max(1, channels[colorType]) : 1) * bitDepth + 7) / 8;
+		std::vector<unsigned char> raw;
+		for (unsigned int y = 0; y < height; y++)
+		{
+			raw.push_back(0);
+			for (size_t x = 0; x < stride; x++)
+				raw.push_back((unsigned char)(x * 7 + y));
+		}
+
+		std::vector<unsigned char> png = MakePNG(width, height, bitDepth, colorType, raw);
+		ImageData image;
+		return DecodePNG(png.data(), png.size(), image) && image.Width == width && image.Height == height;
+	}
+
+	bool PNGs()
+	{
+		ImageData image;
+		image.Width = 61;
+		image.Height = 37;
+		std::mt19937 random(99);
+		for (unsigned int i = 0; i < image.Width * image.Height; i++)
+		{
+			unsigned char pixel[4] = { (unsigned char)(i % 61 * 4), (unsigned char)(i / 61 * 6), (unsigned char)(random() % 4 * 60), 255 };
+			image.Pixels.insert(image.Pixels.end(), pixel, pixel + 4);
+		}
+		std::vector<unsigned char> png = EncodePNG(image);
+
+		ImageData decoded;
+		bool ok = DecodePNG(png.data(), png.size(), decoded) && decoded.Width == image.Width && decoded.Height == image.Height && decoded.Pixels == image.Pixels;
+
+		// The header, the first IDAT's data and the last IDAT's CRC, each with a bit flipped
+		size_t idat = 8 + 25;
+		for (size_t at : { (size_t)8 + 12, idat + 20, png.size() - 12 - 2 })
+		{
+			std::vector<unsigned char> corrupt = png;
+			corrupt[at] ^= 0x04;
+			ok &= !DecodePNG(corrupt.data(), corrupt.size(), decoded);
+		}
+		return Check(ok, "PNG round trip, and bad chunk CRCs rejected");
+	}
+
+	// Only the bit depths the spec allows for each color type, and nothing past PNG_MAX_DIMENSION
+	bool PNGHeaders()
+	{
+		bool ok = true;
+		for (unsigned char depth : { 1, 2, 4, 8, 16 })
+			ok &= DecodesHeader(13, 5, depth, 0);
+		for (unsigned char depth : { 1, 2, 4, 8 })
+			ok &= DecodesHeader(13, 5, depth, 3);
+		for (unsigned char colorType : { 2, 4, 6 })
+			ok &= DecodesHeader(13, 5, 8, colorType) && DecodesHeader(13, 5, 16, colorType);
+		ok &= Check(ok, "Allowed bit depths decode");
+
+		// Depths that would shift the sub-byte unpacking out of range, and ones the color type doesn't have
+		const unsigned char badDepths[][2] = { { 3, 0 }, { 5, 0 }, { 7, 0 }, { 12, 0 }, { 0, 0 }, { 32, 0 }, { 16, 3 }, { 3, 3 },
+			{ 1, 2 }, { 4, 2 }, { 12, 2 }, { 4, 4 }, { 2, 6 }, { 8, 1 }, { 8, 5 }, { 8, 7 } };
+		bool rejected = true;
+		for (const unsigned char* bad : badDepths)
+			rejected &= !DecodesHeader(13, 5, bad[0], bad[1]);
+		ok &= Check(rejected, "Bad bit depths and color types rejected");
+
+		// As big as a texture can be decodes; past it, or big enough to wrap a row size, doesn't
+		bool sizes = DecodesHeader(PNG_MAX_DIMENSION, 1, 1, 0) && DecodesHeader(1, PNG_MAX_DIMENSION, 8, 0);
+		sizes &= !DecodesHeader(PNG_MAX_DIMENSION + 1, 1, 1, 0) && !DecodesHeader(1, PNG_MAX_DIMENSION + 1, 1, 0);
+		std::vector<unsigned char> tiny = { 0, 0 };
+		for (unsigned int huge : { 0x40000000u, 0x80000000u, 0xFFFFFFFFu })
+		{
+			ImageData image;
+			std::vector<unsigned char> wide = MakePNG(huge, 2, 16, 6, tiny);
+			std::vector<unsigned char> tall = MakePNG(2, huge, 16, 6, tiny);
+			sizes &= !DecodePNG(wide.data(), wide.size(), image) && !DecodePNG(tall.data(), tall.size(), image);
+		}
+		ok &= Check(sizes, "Dimensions past PNG_MAX_DIMENSION rejected");
+		return ok;
+	}
+
+	// DDS files are renamed into place whole, and anything cut short is caught by IsCompleteDDS
+	bool DDSFiles()
+	{
+		std::filesystem::path folder = std::filesystem::temp_directory_path() / "ImageDataCheck";
+		std::error_code error;
+		std::filesystem::remove_all(folder, error);
+		std::filesystem::create_directories(folder, error);
+
+		ImageData image;
+		image.Width = 13;
+		image.Height = 7;
+		image.Pixels.assign(13 * 7 * 4, 200);
+		std::vector<unsigned char> bc7((size_t)(4 * 2 + 2 * 1 + 1 + 1) * 16, 7); // 13x7 down to 1x1: 4 mips of blocks
+		std::vector<unsigned char> bc4((size_t)(4 * 2 + 2 * 1 + 1 + 1) * 8, 3);
+
+		// Written twice each, so the second has to replace the first
+		bool ok = true;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			ok &= SaveDDS(folder / "rgba.dds", image);
+			ok &= SaveDDS(folder / "bc7.dds", 98, 13, 7, 4, bc7);
+			ok &= SaveDDS(folder / "bc4.dds", 80, 13, 7, 4, bc4);
+		}
+		for (const char* name : { "rgba.dds", "bc7.dds", "bc4.dds" })
+		{
+			std::vector<unsigned char> bytes;
+			ok &= ReadFileBytes(folder / name, bytes) && IsCompleteDDS(bytes.data(), bytes.size());
+			for (size_t cut = 0; cut < bytes.size(); cut += 1 + cut / 8)
+				ok &= !IsCompleteDDS(bytes.data(), cut);
+		}
+
+		// A mip count the data doesn't have, and a folder that isn't there
+		ok &= SaveDDS(folder / "short.dds", 98, 13, 7, 4, std::vector<unsigned char>(bc7.begin(), bc7.end() - 16));
+		std::vector<unsigned char> bytes;
+		ok &= ReadFileBytes(folder / "short.dds", bytes) && !IsCompleteDDS(bytes.data(), bytes.size());
+		ok &= !SaveDDS(folder / "missing" / "rgba.dds", image);
+
+		// Nothing but the finished files is left behind
+		unsigned int files = 0;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder))
+			ok &= entry.path().extension() == ".dds" && ++files <= 4;
+		ok &= files == 4;
+		std::filesystem::remove_all(folder, error);
+		return Check(ok, "DDS files written whole, and cut short ones caught");
+	}
+
+	// What a reference decoder (zlib, then the PNG filters) made of each, hashed with HashBytes
+	struct ShippedPNG
+	{
+		const char* Path;
+		unsigned int Width;
+		unsigned int Height;
+		unsigned long long PixelHash;
+	};
+
+	const ShippedPNG shippedPNGs[] =
+	{
+		{ "Sky_Pink/back.png", 2048, 2048, 0x6d81bab1d6626691ull },
+		{ "Sky_Pink/down.png", 2048, 2048, 0xf753b5688a806fdbull },
+		{ "Sky_Pink/front.png", 2048, 2048, 0x4bf57a69ed300fc4ull },
+		{ "Sky_Pink/left.png", 2048, 2048, 0x65d74d072f0e8865ull },
+		{ "Sky_Pink/right.png", 2048, 2048, 0x7f72d12ba48db59aull },
+		{ "bronze_albedo.png", 1024, 1024, 0xe83141e7581990b9ull },
+		{ "bronze_metal.png", 128, 128, 0xb9f13a0aa87f2325ull },
+		{ "bronze_normals.png", 1024, 1024, 0x102ee4bcf0c4af17ull },
+		{ "bronze_roughness.png", 1024, 1024, 0x9625233094e5ceecull },
+		{ "floor_albedo.png", 1024, 1024, 0xb177a93f1ba0d359ull },
+		{ "floor_metal.png", 1024, 1024, 0x8edc16c0e55ae311ull },
+		{ "floor_normals.png", 1024, 1024, 0xe71c8a3bd5aee43bull },
+		{ "floor_roughness.png", 1024, 1024, 0xfc2c5823b2827cb6ull },
+		{ "scratched_albedo.png", 1024, 1024, 0xe585b98a59f232d0ull },
+		{ "scratched_metal.png", 1024, 1024, 0xcf8e5502b8da3f1dull },
+		{ "scratched_normals.png", 1024, 1024, 0x41198e17856a8078ull },
+		{ "scratched_roughness.png", 1024, 1024, 0xe2d4226075f2e465ull },
+		{ "wood_albedo.png", 1024, 1024, 0xf3a830b32c810b4aull },
+		{ "wood_metal.png", 128, 128, 0x60e1021eed6c2325ull },
+		{ "wood_normals.png", 1024, 1024, 0x772d0256949afe22ull },
+		{ "wood_roughness.png", 1024, 1024, 0xc58cb1376b7c9b39ull },
+	};
+
+	bool Shipped(const std::filesystem::path& folder)
+	{
+		bool ok = true;
+		for (const ShippedPNG& shipped : shippedPNGs)
+		{
+			ImageData image;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bool loaded = LoadPNG(folder / shipped.Path, image);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			bool matches = loaded && image.Width == shipped.Width && image.Height == shipped.Height &&
+				HashBytes(image.Pixels.data(), image.Pixels.size()) == shipped.PixelHash;
+			printf("  %-24s %s (%.1f ms)\n", shipped.Path, matches ? "matches" : loaded ? "DIFFERS" : "DIDN'T LOAD", seconds * 1000.0);
+			ok &= matches;
+		}
+		return Check(ok, "Shipped PNGs decode like the reference");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path folder = argc >= 2 ? argv[1] : "../Assets/Textures";
+
+	bool failed = false;
+	failed |= !BlockTypes();
+	failed |= !BadStreams();
+	failed |= !PNGs();
+	failed |= !PNGHeaders();
+	failed |= !DDSFiles();
+	failed |= !Shipped(folder);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+// Scaling benchmark for the work stealing job scheduler (JobSystem)
+// - Not part of the Visual Studio project; it builds the game's JobSystem.cpp, Transform.cpp and Bounds.cpp on their own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. -I<DirectXMath>/Inc JobSystemBench.cpp ../JobSystem.cpp ../Transform.cpp ../Bounds.cpp -o JobSystemBench
+//
+// Usage:
+//   JobSystemBench [maxThreads] [frames]
+//     Does the per-entity part of Game::Update for 1k, 10k and 100k entities: moves each one, brings its world (and
+//     inverse transpose) matrix up to date, transforms its bounds and checks them against the camera.  Times it as
+//     a plain loop, then through JobSystem::ParallelFor on 1, 2, 4... threads, and prints the speedup over the loop.
+//     Every threaded run's bounds and visibility must match the plain loop's.  Exits non-zero if any don't.
+
+#include "../JobSystem.h"
+#include "../Transform.h"
+#include "../Bounds.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Scene
+	{
+		std::vector<Transform> Transforms;
+		std::vector<AABB> Bounds;
+		std::vector<unsigned char> Visible;
+		AABB MeshBounds;
+		XMFLOAT4X4 ViewProjection;
+	};
+
+	Scene MakeScene(unsigned int count)
+	{
+		std::mt19937 random(count);
+		std::uniform_real_distribution<float> across(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+		Scene scene;
+		for (unsigned int i = 0; i < count; i++)
+			scene.Transforms.emplace_back(XMFLOAT3(across(random), 0, across(random)), XMFLOAT3(0, angle(random), 0), XMFLOAT3(size(random), size(random), size(random)));
+		scene.Bounds.resize(count);
+		scene.Visible.resize(count);
+		scene.MeshBounds = { XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1) };
+
+		// Same as the game's main camera, with a 16:9 window
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 2, -10, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.01f, 1000.0f);
+		XMStoreFloat4x4(&scene.ViewProjection, XMMatrixMultiply(view, projection));
+		return scene;
+	}
+
+	// What Game::Update and Game::UpdateShadowCascades do for each entity
+	void UpdateEntities(Scene& scene, unsigned int begin, unsigned int end, float totalTime)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			Transform& transform = scene.Transforms[i];
+			transform.SetPosition(transform.GetPosition()->x, sinf(totalTime + i), transform.GetPosition()->z);
+			scene.Bounds[i] = TransformAABB(scene.MeshBounds, transform.GetWorldMatrix());
+			scene.Visible[i] = IsAABBVisible(scene.Bounds[i], scene.ViewProjection);
+		}
+	}
+
+	bool SameResults(const Scene& a, const Scene& b)
+	{
+		return memcmp(a.Bounds.data(), b.Bounds.data(), a.Bounds.size() * sizeof(AABB)) == 0 && a.Visible == b.Visible;
+	}
+
+	// Best of a few runs, in milliseconds per frame
+	template<typename Function>
+	double TimeFrames(int frames, Function frame)
+	{
+		double best = 1e9;
+		for (int run = 0; run < 3; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int f = 0; f < frames; f++)
+				frame(f * 0.016f);
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames);
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxThreads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+	int frames = argc >= 3 ? atoi(argv[2]) : 20;
+	printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+	bool failed = false;
+	const unsigned int entityCounts[] = { 1000, 10000, 100000 };
+	for (unsigned int entityCount : entityCounts)
+	{
+		Scene serial = MakeScene(entityCount);
+		double serialTime = TimeFrames(frames, [&](float totalTime) { UpdateEntities(serial, 0, entityCount, totalTime); });
+		printf("%6u entities, plain loop:  %8.3f ms\n", entityCount, serialTime);
+
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			JobSystem jobs(threads);
+			Scene scene = MakeScene(entityCount);
+			double time = TimeFrames(frames, [&](float totalTime) {
+				jobs.ParallelFor(entityCount, 0, [&](unsigned int begin, unsigned int end) { UpdateEntities(scene, begin, end, totalTime); });
+			});
+
+			// Both did the same frames last, so they should have ended up in the same place
+			bool same = SameResults(scene, serial);
+			failed |= !same;
+			printf("%6u entities, %2u threads: %8.3f ms  (%.2fx, %llu stolen)%s\n",
+				entityCount, threads, time, serialTime / time, jobs.GetJobsStolen(), same ? "" : "  MISMATCH");
+		}
+	}
+
+	return failed ? 1 : 0;
+}
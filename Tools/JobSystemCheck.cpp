@@ -0,0 +1,229 @@
+// Stress test for the work stealing job scheduler (JobSystem)
+// - Not part of the Visual Studio project; it builds the game's JobSystem.cpp on its own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. JobSystemCheck.cpp ../JobSystem.cpp -o JobSystemCheck
+//
+// Usage:
+//   JobSystemCheck [maxThreads] [rounds]
+//     On 1, 2, 4... threads (more than the machine has is fine, and shakes out more interleavings), repeatedly:
+//     floods the system with tiny jobs, runs random graphs of dependent jobs, runs ParallelFor over awkward
+//     counts and chunk sizes (and checks short loops run inline), nests ParallelFor inside jobs, has several outside threads hand out work at once,
+//     and destroys systems with work still queued.  Every job must run exactly once, never before anything it
+//     depends on, and nothing may hang.  Exits non-zero if anything is wrong.
+
+#include "../JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Lots of jobs too small to be worth it, so the deques and the stealing are all there is to time
+	bool Flood(JobSystem& jobs, unsigned int count)
+	{
+		std::vector<std::atomic<unsigned int>> runs(count);
+		std::vector<JobHandle> handles;
+		for (unsigned int i = 0; i < count; i++)
+			handles.push_back(jobs.Run([&runs, i]() { runs[i]++; }));
+		for (const JobHandle& handle : handles)
+			jobs.Wait(handle);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (runs[i] != 1 || !jobs.IsDone(handles[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// Each job depends on a few random earlier ones (some already finished, some not yet queued).  Every job
+	// takes a ticket when it runs, and its ticket has to be later than all of its dependencies' tickets.
+	bool Graph(JobSystem& jobs, unsigned int count, std::mt19937& random)
+	{
+		std::atomic<unsigned int> nextTicket(1);
+		std::vector<std::atomic<unsigned int>> tickets(count);
+		std::vector<std::vector<unsigned int>> dependsOn(count);
+		std::vector<JobHandle> handles(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			std::vector<JobHandle> dependencies;
+			if (i > 0)
+			{
+				unsigned int dependencyCount = random() % 4;
+				for (unsigned int d = 0; d < dependencyCount; d++)
+				{
+					unsigned int other = random() % i;
+					dependsOn[i].push_back(other);
+					dependencies.push_back(handles[other]);
+				}
+				if (random() % 8 == 0)
+					dependencies.push_back(nullptr);
+			}
+
+			handles[i] = jobs.Run([&tickets, &nextTicket, i]() {
+				if (tickets[i] != 0)
+					tickets[i] = UINT32_MAX; // Ran twice
+				else
+					tickets[i] = nextTicket++;
+			}, dependencies);
+
+			// Finish some early, so later jobs depend on a mix of done and not done
+			if (random() % 16 == 0)
+				jobs.Wait(handles[random() % (i + 1)]);
+		}
+		for (const JobHandle& handle : handles)
+			jobs.Wait(handle);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (tickets[i] == 0 || tickets[i] == UINT32_MAX)
+				return false;
+			for (unsigned int other : dependsOn[i])
+			{
+				if (tickets[other] >= tickets[i])
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Every index is visited exactly once, in chunks no bigger than asked for
+	bool Coverage(JobSystem& jobs, unsigned int count, unsigned int chunkSize)
+	{
+		std::vector<std::atomic<unsigned int>> visits(count);
+		std::atomic<bool> oversized(false);
+		jobs.ParallelFor(count, chunkSize, [&](unsigned int begin, unsigned int end) {
+			if (begin >= end || (chunkSize && end - begin > chunkSize))
+				oversized = true;
+			for (unsigned int i = begin; i < end; i++)
+				visits[i]++;
+		});
+
+		if (oversized)
+			return false;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (visits[i] != 1)
+				return false;
+		}
+		return true;
+	}
+
+	// Loops too short for the default chunk size run in one go on the calling thread, without any jobs
+	bool Inline(JobSystem& jobs, unsigned int count)
+	{
+		unsigned int calls = 0;
+		bool ok = true;
+		std::thread::id caller = std::this_thread::get_id();
+		jobs.ParallelFor(count, 0, [&](unsigned int begin, unsigned int end) {
+			calls++;
+			ok &= begin == 0 && end == count && std::this_thread::get_id() == caller;
+		});
+		return ok && calls == (count > 0 ? 1u : 0u);
+	}
+
+	// ParallelFor from inside jobs, so workers have to help out while they wait too
+	bool Nested(JobSystem& jobs, unsigned int outer, unsigned int inner)
+	{
+		std::atomic<unsigned int> visits(0);
+		std::vector<JobHandle> handles;
+		for (unsigned int o = 0; o < outer; o++)
+		{
+			handles.push_back(jobs.Run([&]() {
+				jobs.ParallelFor(inner, 3, [&](unsigned int begin, unsigned int end) { visits += end - begin; });
+			}));
+		}
+		for (const JobHandle& handle : handles)
+			jobs.Wait(handle);
+		return visits == outer * inner;
+	}
+
+	// Threads that aren't workers share one deque, and all hand out (and wait on) work at the same time
+	bool OutsideThreads(JobSystem& jobs, unsigned int threadCount, unsigned int jobsEach)
+	{
+		std::atomic<unsigned int> runs(0);
+		std::atomic<bool> ok(true);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.emplace_back([&, t]() {
+				std::mt19937 random(t);
+				JobHandle previous;
+				for (unsigned int i = 0; i < jobsEach; i++)
+					previous = jobs.Run([&runs]() { runs++; }, { previous });
+				jobs.Wait(previous);
+				if (!Coverage(jobs, 100 + random() % 900, random() % 8))
+					ok = false;
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		return ok && runs == threadCount * jobsEach;
+	}
+
+	// Systems torn down straight after being handed work still run all of it
+	bool Shutdown(unsigned int threadCount, unsigned int count)
+	{
+		std::atomic<unsigned int> runs(0);
+		{
+			JobSystem jobs(threadCount);
+			for (unsigned int i = 0; i < count; i++)
+				jobs.Run([&runs]() { runs++; });
+		}
+
+		// Except with one thread: there are no workers, so nothing runs that isn't waited on
+		return threadCount == 1 || runs == count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxThreads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+	int rounds = argc >= 3 ? atoi(argv[2]) : 20;
+
+	bool failed = false;
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads);
+		std::mt19937 random(threads);
+		unsigned int flood = 0, graph = 0, coverage = 0, nested = 0, outside = 0, shutdown = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; round++)
+		{
+			flood += !Flood(jobs, 5000);
+			graph += !Graph(jobs, 2000, random);
+
+			const unsigned int counts[] = { 0, 1, 2, threads - 1, threads, threads + 1, 97, 1000, 65536 };
+			const unsigned int chunkSizes[] = { 0, 1, 7, 64, 100000 };
+			for (unsigned int count : counts)
+			{
+				for (unsigned int chunkSize : chunkSizes)
+					coverage += !Coverage(jobs, count, chunkSize);
+			}
+			for (unsigned int count : { 1u, 6u, (unsigned int)JOB_MIN_CHUNK_SIZE })
+				coverage += !Inline(jobs, count);
+
+			nested += !Nested(jobs, 32, 50);
+			outside += !OutsideThreads(jobs, 4, 500);
+			shutdown += !Shutdown(threads, 1000);
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		bool ok = flood + graph + coverage + nested + outside + shutdown == 0;
+		failed |= !ok;
+		printf("%2u threads: %d rounds in %.2f s, %llu jobs run (%llu stolen)%s\n",
+			threads, rounds, seconds, jobs.GetJobsRun(), jobs.GetJobsStolen(), ok ? "" : "  FAILED");
+		if (!ok)
+			printf("    failures: flood %u, graph %u, coverage %u, nested %u, outside threads %u, shutdown %u\n",
+				flood, graph, coverage, nested, outside, shutdown);
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+// Benchmark and correctness check for the clustered light culling (LightClusters)
+// - Not part of the Visual Studio project; it builds the game's LightClusters.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. -I<DirectXMath>/Inc LightClusterBench.cpp ../LightClusters.cpp ../Bounds.cpp ../JobSystem.cpp ../Profiler.cpp -o LightClusterBench
+//
+// Usage:
+//   LightClusterBench [maxThreads] [iterations]
+//     Scatters 1k, 2k, 5k and 10k point and spot lights in front of a camera like the game's main one, then times
+//     LightClusters::Build on 1, 2, 4... threads.  Each result is then checked: points inside every light's
+//     range (or cone) must find it in their cluster's list.  Exits non-zero if any are missing.
+
+#include "../LightClusters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	std::vector<Light> ScatterLights(unsigned int count)
+	{
+		std::mt19937 random(count);
+		std::uniform_real_distribution<float> across(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> height(-5.0f, 15.0f);
+		std::uniform_real_distribution<float> depth(-20.0f, 120.0f);
+		std::uniform_real_distribution<float> range(1.0f, 6.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> falloff(1.0f, 64.0f);
+
+		std::vector<Light> lights(count);
+		for (Light& light : lights)
+		{
+			light = {};
+			light.Type = LIGHT_TYPE_POINT;
+			light.Position = XMFLOAT3(across(random), height(random), depth(random));
+			light.Range = range(random);
+			light.Intensity = 1.0f;
+			light.ShadowIndex = -1;
+		}
+
+		// Every fourth one is a spot light pointing anywhere
+		for (unsigned int i = 1; i < count; i += 4)
+		{
+			lights[i].Type = LIGHT_TYPE_SPOT;
+			lights[i].Direction = XMFLOAT3(unit(random), unit(random), unit(random));
+			lights[i].SpotFalloff = falloff(random);
+		}
+
+		// One sun, like the game, which every cluster shares
+		lights[0].Type = LIGHT_TYPE_DIRECTIONAL;
+		return lights;
+	}
+
+	// Counts lights missing from a cluster they reach, or listed in a cluster whose box they clearly don't touch.
+	// Points inside each light's range are put in clusters the same way the pixel shader does it.
+	unsigned int CheckClusters(LightClusters& clusters, const std::vector<Light>& lights, const XMFLOAT4X4& view, const XMFLOAT4X4& projection,
+		float nearClip, float farClip)
+	{
+		const std::vector<LightCluster>& grid = clusters.GetClusters();
+		const std::vector<unsigned int>& indices = clusters.GetLightIndices();
+		float tanX = 1.0f / projection._11;
+		float tanY = 1.0f / projection._22;
+		unsigned int errors = 0;
+
+		// Spot lights as view space cones, and every light's bounding sphere in view space
+		std::vector<Cone> cones(lights.size());
+		std::vector<XMFLOAT3> centers(lights.size());
+		std::vector<float> radii(lights.size());
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			centers[i] = lights[i].Position;
+			radii[i] = lights[i].Range;
+			if (lights[i].Type == LIGHT_TYPE_SPOT)
+			{
+				cones[i] = GetSpotLightCone(lights[i]);
+				GetConeBoundingSphere(cones[i], centers[i], radii[i]);
+				XMStoreFloat3(&cones[i].Apex, XMVector3Transform(XMLoadFloat3(&cones[i].Apex), XMLoadFloat4x4(&view)));
+				XMStoreFloat3(&cones[i].Direction, XMVector3TransformNormal(XMLoadFloat3(&cones[i].Direction), XMLoadFloat4x4(&view)));
+			}
+			XMStoreFloat3(&centers[i], XMVector3Transform(XMLoadFloat3(&centers[i]), XMLoadFloat4x4(&view)));
+		}
+
+		// Everything listed really reaches the cluster's box
+		for (unsigned int c = 0; c < LIGHT_CLUSTER_COUNT; c++)
+		{
+			XMFLOAT3 boxMin, boxMax;
+			clusters.GetClusterBounds(c % LIGHT_CLUSTERS_X, c / LIGHT_CLUSTERS_X % LIGHT_CLUSTERS_Y, c / (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y), boxMin, boxMax);
+			for (unsigned int i = 0; i < grid[c].Count; i++)
+			{
+				unsigned int light = indices[grid[c].Offset + i];
+				const XMFLOAT3& center = centers[light];
+				float dx = std::max(std::max(boxMin.x - center.x, center.x - boxMax.x), 0.0f);
+				float dy = std::max(std::max(boxMin.y - center.y, center.y - boxMax.y), 0.0f);
+				float dz = std::max(std::max(boxMin.z - center.z, center.z - boxMax.z), 0.0f);
+				if (dx * dx + dy * dy + dz * dz > radii[light] * radii[light] * 1.001f)
+					errors++;
+			}
+		}
+
+		// Every point a light reaches finds it in its cluster's list
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			if (lights[i].Type == LIGHT_TYPE_DIRECTIONAL)
+				continue;
+			for (int sample = 0; sample < 64; sample++)
+			{
+				XMFLOAT3 offset(unit(random), unit(random), unit(random));
+				if (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z > 1.0f)
+					continue;
+				XMFLOAT3 point;
+				if (lights[i].Type == LIGHT_TYPE_SPOT)
+				{
+					// Inside the cone, a little way in from its edge
+					const Cone& cone = cones[i];
+					float length = sqrtf(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+					if (length < 0.001f || (offset.x * cone.Direction.x + offset.y * cone.Direction.y + offset.z * cone.Direction.z) / length < cone.CosAngle + 0.001f)
+						continue;
+					float reach = cone.Range * 0.999f;
+					point = XMFLOAT3(cone.Apex.x + offset.x * reach, cone.Apex.y + offset.y * reach, cone.Apex.z + offset.z * reach);
+				}
+				else
+				{
+					float reach = lights[i].Range * 0.999f;
+					point = XMFLOAT3(centers[i].x + offset.x * reach, centers[i].y + offset.y * reach, centers[i].z + offset.z * reach);
+				}
+				if (point.z < nearClip || point.z > farClip || fabsf(point.x) > point.z * tanX || fabsf(point.y) > point.z * tanY)
+					continue;
+
+				unsigned int x = std::min((unsigned int)((point.x / (point.z * tanX) + 1.0f) * 0.5f * LIGHT_CLUSTERS_X), LIGHT_CLUSTERS_X - 1u);
+				unsigned int y = std::min((unsigned int)((1.0f - point.y / (point.z * tanY)) * 0.5f * LIGHT_CLUSTERS_Y), LIGHT_CLUSTERS_Y - 1u);
+				unsigned int z = (unsigned int)std::clamp(floorf(logf(point.z) * clusters.GetDepthScale() + clusters.GetDepthBias()), 0.0f, LIGHT_CLUSTERS_Z - 1.0f);
+				const LightCluster& cluster = grid[(z * LIGHT_CLUSTERS_Y + y) * LIGHT_CLUSTERS_X + x];
+				const unsigned int* first = &indices[0] + cluster.Offset;
+				if (!std::binary_search(first, first + cluster.Count, i))
+					errors++;
+			}
+		}
+		return errors;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int maxThreads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+	int iterations = argc >= 3 ? atoi(argv[2]) : 50;
+
+	// Same as the game's main camera, with a 16:9 window
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 2, -10, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 0.01f, 1000.0f));
+
+	bool failed = false;
+	const unsigned int lightCounts[] = { 1000, 2000, 5000, 10000 };
+	for (unsigned int lightCount : lightCounts)
+	{
+		std::vector<Light> lights = ScatterLights(lightCount);
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			LightClusters clusters(std::make_shared<JobSystem>(threads));
+			clusters.Build(lights, view, projection, 0.01f, 1000.0f); // Warm up (and size every list)
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < iterations; i++)
+				clusters.Build(lights, view, projection, 0.01f, 1000.0f);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+			unsigned int errors = CheckClusters(clusters, lights, view, projection, 0.01f, 1000.0f);
+			failed |= errors > 0;
+			printf("%5u lights, %2u threads: %7.3f ms  (%u indices, busiest cluster %u lights)%s\n",
+				lightCount, threads, milliseconds,
+				(unsigned int)clusters.GetLightIndices().size(), clusters.GetMaxClusterLights(),
+				errors ? "  MISMATCH" : "");
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+// Correctness check for the memory tracking (MemoryTracker, and the tagged operator new in AllocationCounter.cpp)
+// - Not part of the Visual Studio project; it builds the game's MemoryTracker.cpp and AllocationCounter.cpp on their
+//   own, so every operator new in this program is counted just like the game's
+// - The D3D11 side (MemoryTrackerD3D11.cpp) only adds up resource descriptions with EstimateTextureBytes, which is
+//   checked here
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. MemoryTrackerCheck.cpp ../MemoryTracker.cpp ../AllocationCounter.cpp -o MemoryTrackerCheck
+//
+// Usage:
+//   MemoryTrackerCheck [threads]
+//     Checks that allocations land under the tag of the scope they're made in (nested scopes too), that frees are
+//     counted against the tag they were allocated under whatever scope they happen in, that live and peak sizes
+//     add up, that each thread has its own tag, that aligned allocations are tracked and stay aligned, the texture
+//     size estimates, budgets, and the report file.  Exits non-zero if anything is wrong.
+
+#include "../AllocationCounter.h"
+#include "../MemoryTracker.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Calls to operator new itself (unlike new expressions) can't be optimized away
+	void* Allocate(size_t size)
+	{
+		return ::operator new(size);
+	}
+
+	void Free(void* pointer)
+	{
+		::operator delete(pointer);
+	}
+
+	bool Tagging()
+	{
+		MemoryUsage meshBefore = GetMemoryUsage(MEMORY_MESH);
+		MemoryUsage materialBefore = GetMemoryUsage(MEMORY_MATERIAL);
+		MemoryUsage totalBefore = GetTotalMemoryUsage();
+		unsigned long long countBefore = GetHeapAllocationCount();
+
+		void* mesh;
+		void* material;
+		bool ok = GetMemoryTag() == MEMORY_OTHER;
+		{
+			MEMORY_SCOPE(MEMORY_MATERIAL);
+			{
+				MEMORY_SCOPE(MEMORY_MESH);
+				ok &= GetMemoryTag() == MEMORY_MESH;
+				mesh = Allocate(1000);
+			}
+			ok &= GetMemoryTag() == MEMORY_MATERIAL;
+			material = Allocate(300);
+		}
+		ok &= GetMemoryTag() == MEMORY_OTHER;
+
+		MemoryUsage meshDuring = GetMemoryUsage(MEMORY_MESH);
+		MemoryUsage materialDuring = GetMemoryUsage(MEMORY_MATERIAL);
+		ok &= meshDuring.HeapBytes == meshBefore.HeapBytes + 1000;
+		ok &= meshDuring.HeapAllocations == meshBefore.HeapAllocations + 1;
+		ok &= materialDuring.HeapBytes == materialBefore.HeapBytes + 300;
+		ok &= GetTotalMemoryUsage().HeapBytes == totalBefore.HeapBytes + 1300;
+		ok &= GetHeapAllocationCount() == countBefore + 2;
+
+		Free(mesh);
+		Free(material);
+		ok &= GetMemoryUsage(MEMORY_MESH).HeapBytes == meshBefore.HeapBytes;
+		ok &= GetMemoryUsage(MEMORY_MESH).HeapAllocations == meshBefore.HeapAllocations;
+		ok &= GetMemoryUsage(MEMORY_MATERIAL).HeapBytes == materialBefore.HeapBytes;
+		ok &= GetTotalMemoryUsage().HeapBytes == totalBefore.HeapBytes;
+		return Check(ok, "Allocations take the tag of the innermost scope");
+	}
+
+	// Made under one tag, freed under another (as when a loader thread's data is let go on the main thread)
+	bool ForeignFree()
+	{
+		MemoryUsage skyBefore = GetMemoryUsage(MEMORY_SKY);
+		MemoryUsage texturesBefore = GetMemoryUsage(MEMORY_TEXTURES);
+
+		void* pointer;
+		{
+			MEMORY_SCOPE(MEMORY_TEXTURES);
+			pointer = Allocate(4096);
+		}
+		bool ok = GetMemoryUsage(MEMORY_TEXTURES).HeapBytes == texturesBefore.HeapBytes + 4096;
+		{
+			MEMORY_SCOPE(MEMORY_SKY);
+			Free(pointer);
+		}
+		ok &= GetMemoryUsage(MEMORY_TEXTURES).HeapBytes == texturesBefore.HeapBytes;
+		ok &= GetMemoryUsage(MEMORY_SKY).HeapBytes == skyBefore.HeapBytes;
+		ok &= GetMemoryUsage(MEMORY_SKY).HeapAllocations == skyBefore.HeapAllocations;
+
+		// A std::vector growing under one scope and destroyed outside it
+		MemoryUsage meshBefore = GetMemoryUsage(MEMORY_MESH);
+		{
+			std::vector<int> values;
+			{
+				MEMORY_SCOPE(MEMORY_MESH);
+				values.resize(10000);
+			}
+			ok &= GetMemoryUsage(MEMORY_MESH).HeapBytes >= meshBefore.HeapBytes + 10000 * sizeof(int);
+		}
+		ok &= GetMemoryUsage(MEMORY_MESH).HeapBytes == meshBefore.HeapBytes;
+		return Check(ok, "Frees count against the tag the memory was allocated under");
+	}
+
+	bool Peaks()
+	{
+		MemoryUsage before = GetMemoryUsage(MEMORY_RENDER_TARGETS);
+		MemoryUsage totalBefore = GetTotalMemoryUsage();
+
+		std::vector<void*> pointers;
+		pointers.reserve(16);
+		{
+			MEMORY_SCOPE(MEMORY_RENDER_TARGETS);
+			for (unsigned int i = 0; i < 16; i++)
+				pointers.push_back(Allocate(64 * 1024));
+		}
+		for (void* pointer : pointers)
+			Free(pointer);
+
+		MemoryUsage after = GetMemoryUsage(MEMORY_RENDER_TARGETS);
+		bool ok = after.HeapBytes == before.HeapBytes;
+		ok &= after.HeapPeak >= before.HeapBytes + 16 * 64 * 1024;
+		ok &= GetTotalMemoryUsage().HeapPeak >= totalBefore.HeapBytes + 16 * 64 * 1024;
+
+		// The GPU side is only ever told, so it should be exact
+		MemoryUsage gpuBefore = GetMemoryUsage(MEMORY_SKY);
+		TrackGpuAllocation(MEMORY_SKY, 1000);
+		TrackGpuAllocation(MEMORY_SKY, 500);
+		TrackGpuFree(MEMORY_SKY, 1000);
+		MemoryUsage gpuAfter = GetMemoryUsage(MEMORY_SKY);
+		ok &= gpuAfter.GpuBytes == gpuBefore.GpuBytes + 500;
+		ok &= gpuAfter.GpuResources == gpuBefore.GpuResources + 1;
+		ok &= gpuAfter.GpuPeak == gpuBefore.GpuBytes + 1500;
+		TrackGpuFree(MEMORY_SKY, 500);
+		ok &= GetMemoryUsage(MEMORY_SKY).GpuBytes == gpuBefore.GpuBytes;
+		return Check(ok, "Live sizes go back down, peaks stay");
+	}
+
+	// Each thread has its own scope, and none of them sees the others'
+	bool Threads(unsigned int threadCount)
+	{
+		const MemoryTag tags[] = { MEMORY_MESH, MEMORY_MATERIAL, MEMORY_SIMPLE_SHADER, MEMORY_IMGUI };
+		MemoryUsage before[4];
+		for (unsigned int t = 0; t < 4; t++)
+			before[t] = GetMemoryUsage(tags[t]);
+
+		std::vector<std::thread> threads;
+		std::vector<unsigned char> wrongTag(threadCount, 0);
+		MEMORY_SCOPE(MEMORY_SKY);
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			threads.emplace_back([&, i]() {
+				// Not the creating thread's scope
+				wrongTag[i] = GetMemoryTag() != MEMORY_OTHER;
+
+				MEMORY_SCOPE(tags[i % 4]);
+				std::vector<void*> held;
+				held.reserve(64);
+				for (unsigned int round = 0; round < 2000; round++)
+				{
+					held.push_back(Allocate(16 + (round * 7 + i) % 500));
+					if (held.size() == 64)
+					{
+						for (void* pointer : held)
+							Free(pointer);
+						held.clear();
+					}
+					wrongTag[i] |= GetMemoryTag() != tags[i % 4];
+				}
+				for (void* pointer : held)
+					Free(pointer);
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		threads.clear();
+
+		bool ok = true;
+		for (unsigned char wrong : wrongTag)
+			ok &= wrong == 0;
+		for (unsigned int t = 0; t < 4; t++)
+		{
+			MemoryUsage after = GetMemoryUsage(tags[t]);
+			ok &= after.HeapBytes == before[t].HeapBytes;
+			ok &= after.HeapAllocations == before[t].HeapAllocations;
+		}
+		return Check(ok, "Threads keep their own tags and balance out");
+	}
+
+	bool Aligned()
+	{
+		struct alignas(64) Line { unsigned char Bytes[64]; };
+		struct alignas(256) Page { unsigned char Bytes[256]; };
+
+		MemoryUsage before = GetMemoryUsage(MEMORY_TEXTURES);
+		Line* lines;
+		Page* pages;
+		{
+			MEMORY_SCOPE(MEMORY_TEXTURES);
+			lines = new Line[10];
+			pages = new Page[2];
+		}
+
+		// Alignment is checked on copies of the addresses, taken now.  They're volatile, or the optimizer
+		// folds them back into the pointers and works them out after the delete (g++ -Wuse-after-free).
+		volatile uintptr_t linesAddress = (uintptr_t)lines;
+		volatile uintptr_t pagesAddress = (uintptr_t)pages;
+		bool ok = linesAddress % 64 == 0 && pagesAddress % 256 == 0;
+		ok &= GetMemoryUsage(MEMORY_TEXTURES).HeapBytes >= before.HeapBytes + 10 * sizeof(Line) + 2 * sizeof(Page);
+		ok &= GetMemoryUsage(MEMORY_TEXTURES).HeapAllocations == before.HeapAllocations + 2;
+
+		// Writing every byte shouldn't touch the tracking in front of them
+		for (unsigned int i = 0; i < 10; i++)
+			for (unsigned char& byte : lines[i].Bytes)
+				byte = 0xff;
+		for (unsigned int i = 0; i < 2; i++)
+			for (unsigned char& byte : pages[i].Bytes)
+				byte = 0xff;
+
+		delete[] lines;
+		delete[] pages;
+		ok &= GetMemoryUsage(MEMORY_TEXTURES).HeapBytes == before.HeapBytes;
+		ok &= GetMemoryUsage(MEMORY_TEXTURES).HeapAllocations == before.HeapAllocations;
+
+		// Sized and nothrow forms go through the same header
+		void* nothrow = ::operator new(123, std::nothrow);
+		ok &= nothrow != nullptr && (uintptr_t)nothrow % alignof(std::max_align_t) == 0;
+		::operator delete(nothrow, std::nothrow);
+		::operator delete(nullptr);
+		return Check(ok, "Aligned and nothrow allocations are tracked and stay aligned");
+	}
+
+	bool TextureSizes()
+	{
+		bool ok = true;
+		// 256x256 RGBA8, full chain: 4 bytes * (4^9 - 1) / 3 texels
+		ok &= EstimateTextureBytes(256, 256, 1, 0, 32, false) == 349524;
+		ok &= EstimateTextureBytes(256, 256, 1, 9, 32, false) == 349524;
+		ok &= EstimateTextureBytes(256, 256, 1, 1, 32, false) == 256 * 256 * 4;
+		// Non-square chains stop at 1 in the short side
+		ok &= EstimateTextureBytes(4, 1, 1, 0, 32, false) == (4 + 2 + 1) * 4;
+		// BC1 is 8 bytes a 4x4 block, BC7 16, and partial blocks round up
+		ok &= EstimateTextureBytes(1024, 1024, 1, 1, 4, true) == 256 * 256 * 8;
+		ok &= EstimateTextureBytes(1024, 1024, 1, 1, 8, true) == 256 * 256 * 16;
+		ok &= EstimateTextureBytes(5, 3, 1, 1, 4, true) == 2 * 1 * 8;
+		ok &= EstimateTextureBytes(1, 1, 1, 0, 8, true) == 16;
+		ok &= EstimateTextureBytes(8, 8, 1, 0, 8, true) == (4 + 1 + 1 + 1) * 16;
+		// A cube map is 6 slices, a cube array 6 per cube
+		ok &= EstimateTextureBytes(64, 64, 6, 1, 64, false) == 64 * 64 * 8 * 6;
+		ok &= EstimateTextureBytes(64, 64, 12, 0, 32, false) == 12 * EstimateTextureBytes(64, 64, 1, 0, 32, false);
+		// Multisampled targets store every sample
+		ok &= EstimateTextureBytes(100, 100, 1, 1, 32, false, 4) == 100 * 100 * 4 * 4;
+		return Check(ok, "Texture size estimates");
+	}
+
+	bool Budgets()
+	{
+		bool ok = true;
+		TrackGpuAllocation(MEMORY_SKY, 2048);
+		SetMemoryBudget(MEMORY_SKY, { 0, 0 });
+		ok &= !IsOverMemoryBudget(MEMORY_SKY);
+		SetMemoryBudget(MEMORY_SKY, { 0, GetMemoryUsage(MEMORY_SKY).GpuBytes });
+		ok &= !IsOverMemoryBudget(MEMORY_SKY);
+		SetMemoryBudget(MEMORY_SKY, { 0, GetMemoryUsage(MEMORY_SKY).GpuBytes - 1 });
+		ok &= IsOverMemoryBudget(MEMORY_SKY);
+		ok &= GetMemoryBudget(MEMORY_SKY).GpuBytes == GetMemoryUsage(MEMORY_SKY).GpuBytes - 1;
+
+		// Heap budgets work the same way
+		void* pointer;
+		{
+			MEMORY_SCOPE(MEMORY_IMGUI);
+			pointer = Allocate(100000);
+		}
+		SetMemoryBudget(MEMORY_IMGUI, { 50000, 0 });
+		ok &= IsOverMemoryBudget(MEMORY_IMGUI);
+		Free(pointer);
+		SetMemoryBudget(MEMORY_IMGUI, { GetMemoryUsage(MEMORY_IMGUI).HeapBytes + 1, 0 });
+		ok &= !IsOverMemoryBudget(MEMORY_IMGUI);
+		return Check(ok, "Budgets");
+	}
+
+	// Sky is still over budget from Budgets()
+	bool Report()
+	{
+		const char* path = "MemoryTrackerCheck_report.txt";
+		bool ok = WriteMemoryReport(path);
+
+		std::ifstream file(path);
+		std::vector<std::string> lines;
+		std::string line;
+		while (std::getline(file, line))
+			lines.push_back(line);
+		file.close();
+		remove(path);
+
+		// A header, a line per tag and the total
+		ok &= lines.size() == MEMORY_TAG_COUNT + 2;
+		for (unsigned int tag = 0; tag < MEMORY_TAG_COUNT && ok; tag++)
+		{
+			const std::string& tagLine = lines[tag + 1];
+			ok &= tagLine.compare(0, strlen(GetMemoryTagName((MemoryTag)tag)), GetMemoryTagName((MemoryTag)tag)) == 0;
+			ok &= (tagLine.find("OVER BUDGET") != std::string::npos) == IsOverMemoryBudget((MemoryTag)tag);
+		}
+		ok &= ok && lines.back().compare(0, 5, "Total") == 0;
+		ok &= !WriteMemoryReport("no/such/folder/report.txt");
+		TrackGpuFree(MEMORY_SKY, 2048);
+		return Check(ok, "Report file");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int threads = argc >= 2 ? (unsigned int)atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+
+	bool failed = false;
+	failed |= !Tagging();
+	failed |= !ForeignFree();
+	failed |= !Peaks();
+	failed |= !Threads(threads);
+	failed |= !Aligned();
+	failed |= !TextureSizes();
+	failed |= !Budgets();
+	failed |= !Report();
+
+	return failed ? 1 : 0;
+}
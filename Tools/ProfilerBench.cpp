@@ -0,0 +1,224 @@
+// Benchmark and correctness check for the CPU profiler (Profiler)
+// - Not part of the Visual Studio project; it builds the game's Profiler.cpp on its own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. ProfilerBench.cpp ../Profiler.cpp -o ProfilerBench
+//
+// Usage:
+//   ProfilerBench [zones]
+//     Times empty zones, flat and nested, and fails if one costs more than PROFILER_BENCH_MAX_NS.
+//     Then checks what comes back out: zones nest inside their parents on every thread, a ring that
+//     wraps before it's collected drops (and counts) its oldest zones, nothing is torn or lost uncounted
+//     while worker threads record during collection, and the Chrome trace has every zone.
+//     Exits non-zero if anything is wrong.
+
+#include "../Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PROFILER_BENCH_MAX_NS 50.0
+
+namespace
+{
+	const char* Names[] = { "Update", "Camera::Update", "Draw", "Main pass", "CopyAllBufferData" };
+
+	// Zones in and out a few deep, so each is both a parent and a child
+	void Nest(unsigned int depth)
+	{
+		PROFILE_SCOPE(Names[depth]);
+		if (depth + 1 < 4)
+		{
+			Nest(depth + 1);
+			Nest(depth + 1);
+		}
+	}
+
+	double NanosecondsPerZone(unsigned int zones, bool nested)
+	{
+		Profiler& profiler = Profiler::GetInstance();
+		double best = 1e9;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (nested)
+			{
+				// 15 zones a time
+				for (unsigned int i = 0; i < zones / 15; i++)
+					Nest(0);
+			}
+			else
+			{
+				for (unsigned int i = 0; i < zones; i++)
+				{
+					PROFILE_SCOPE("Flat");
+				}
+			}
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			best = std::min(best, ns / (nested ? zones / 15 * 15 : zones));
+			profiler.EndFrame();
+		}
+		return best;
+	}
+
+	// Each zone must sit inside the one open on its thread when it started
+	bool CheckNesting(const ProfilerFrame& frame)
+	{
+		for (const ProfilerEvent& event : frame.Events)
+		{
+			if (event.End < event.Start)
+				return false;
+			if (event.Depth == 0)
+				continue;
+			bool found = false;
+			for (const ProfilerEvent& parent : frame.Events)
+			{
+				if (parent.Thread == event.Thread && parent.Depth == event.Depth - 1 &&
+					parent.Start <= event.Start && event.End <= parent.End)
+				{
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int zones = argc >= 2 ? (unsigned int)atoi(argv[1]) : 1000000;
+	Profiler& profiler = Profiler::GetInstance();
+	bool failed = false;
+
+	// Cost per zone (begin and end) on this thread
+	{
+		double flat = NanosecondsPerZone(zones, false);
+		double nested = NanosecondsPerZone(zones, true);
+		bool ok = flat <= PROFILER_BENCH_MAX_NS && nested <= PROFILER_BENCH_MAX_NS;
+		failed |= !ok;
+		printf("Flat zones: %.1f ns each, nested: %.1f ns each (limit %.0f)%s\n", flat, nested, PROFILER_BENCH_MAX_NS, ok ? "" : "  TOO SLOW");
+	}
+
+	// A frame of nested zones comes back whole and properly nested
+	{
+		for (int i = 0; i < 10; i++)
+			Nest(0);
+		profiler.EndFrame();
+		const ProfilerFrame& frame = profiler.GetFrame(0);
+		bool ok = frame.Events.size() == 150 && frame.Dropped == 0 && CheckNesting(frame);
+		failed |= !ok;
+		printf("Nesting: %u zones, %u dropped%s\n", (unsigned int)frame.Events.size(), frame.Dropped, ok ? "" : "  WRONG");
+	}
+
+	// More zones than the ring holds: the newest survive, the rest are counted.  The oldest one left
+	// is dropped too, since the collector can't tell it isn't being overwritten.
+	{
+		unsigned int extra = 1000;
+		for (unsigned int i = 0; i < PROFILER_EVENTS_PER_THREAD + extra; i++)
+		{
+			PROFILE_SCOPE(Names[i % 5]);
+		}
+		profiler.EndFrame();
+		const ProfilerFrame& frame = profiler.GetFrame(0);
+		bool ok = frame.Events.size() == PROFILER_EVENTS_PER_THREAD - 1 && frame.Dropped == extra + 1 &&
+			frame.Events.back().Name == Names[(PROFILER_EVENTS_PER_THREAD + extra - 1) % 5];
+		failed |= !ok;
+		printf("Wrapped ring: %u kept, %u dropped%s\n", (unsigned int)frame.Events.size(), frame.Dropped, ok ? "" : "  WRONG");
+	}
+
+	// Worker threads recording flat out while this thread collects.  With fewer cores than threads
+	// they get well ahead of it and their rings wrap, but every zone must still be either collected
+	// once, untorn, or counted as dropped.
+	{
+		const unsigned int workerCount = 4;
+		const unsigned int perWorker = 200000;
+		std::atomic<unsigned int> finished(0);
+		std::vector<std::thread> workers;
+		for (unsigned int w = 0; w < workerCount; w++)
+		{
+			workers.emplace_back([&]() {
+				for (unsigned int i = 0; i < perWorker; i++)
+				{
+					PROFILE_SCOPE("Job");
+					PROFILE_SCOPE(Names[i % 5]);
+				}
+				finished++;
+			});
+		}
+
+		unsigned int collected = 0;
+		unsigned int dropped = 0;
+		unsigned int frames = 0;
+		bool ok = true;
+		while (true)
+		{
+			bool last = finished == workerCount;
+			profiler.EndFrame();
+			const ProfilerFrame& frame = profiler.GetFrame(0);
+			for (const ProfilerEvent& event : frame.Events)
+			{
+				// An inner zone is one of the names at depth 1, the outer one "Job" at depth 0
+				bool inner = std::find(std::begin(Names), std::end(Names), event.Name) != std::end(Names);
+				if (event.End < event.Start || event.Depth != (inner ? 1u : 0u) || (!inner && std::string(event.Name) != "Job"))
+					ok = false;
+			}
+			collected += (unsigned int)frame.Events.size();
+			dropped += frame.Dropped;
+			frames++;
+			if (last)
+				break;
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+
+		ok &= collected + dropped == workerCount * perWorker * 2;
+		failed |= !ok;
+		printf("%u threads recording during collection: %u zones in %u frames, %u dropped%s\n",
+			workerCount, collected, frames, dropped, ok ? "" : "  WRONG");
+	}
+
+	// The trace has a complete event for every zone the history still starts inside
+	{
+		unsigned long long newest = profiler.GetFrame(0).Start;
+		profiler.SetPaused(true);
+		Nest(0);
+		profiler.EndFrame();
+		profiler.SetPaused(false);
+		bool pausedOk = profiler.GetFrame(0).Start == newest;
+
+		unsigned long long origin = profiler.GetFrame(profiler.GetFrameCount() - 1).Start;
+		unsigned int expected = 0;
+		for (unsigned int age = 0; age < profiler.GetFrameCount(); age++)
+		{
+			for (const ProfilerEvent& event : profiler.GetFrame(age).Events)
+				expected += event.Start >= origin;
+		}
+
+		std::string path = "ProfilerBench.json";
+		bool ok = profiler.ExportChromeTrace(path);
+		std::ifstream file(path);
+		std::stringstream contents;
+		contents << file.rdbuf();
+		std::string json = contents.str();
+		unsigned int complete = 0;
+		for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1))
+			complete++;
+		ok &= complete == expected && json.rfind("{\"traceEvents\":[", 0) == 0 && json.find("]}") != std::string::npos;
+		ok &= pausedOk;
+		remove(path.c_str());
+		failed |= !ok;
+		printf("Chrome trace: %u of %u zones, pausing %s%s\n", complete, expected, pausedOk ? "kept nothing" : "kept a frame", ok ? "" : "  WRONG");
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+// Correctness check for the render target pool's lifetime analysis (RenderTargetPool)
+// - Not part of the Visual Studio project; it builds the game's RenderTargetPool.cpp on its own
+// - Needs a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. RenderTargetPoolCheck.cpp ../RenderTargetPool.cpp -o RenderTargetPoolCheck
+//
+// Usage:
+//   RenderTargetPoolCheck [randomFrames]
+//     Asks for the targets the game's frame does, at every blur and scattering setting, then for many random
+//     frames.  Every frame is checked: targets sharing a texture must match and never be alive at once, and
+//     no description may get more textures than it has targets alive at once.  Also checks that a steady
+//     frame creates nothing and lands in the same slots, and that textures nobody wants are let go.
+//     Exits non-zero if anything is wrong.
+
+#include "../RenderTargetPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Stand-ins for the DXGI formats the game uses
+	const unsigned int FormatRGBA8 = 28;
+	const unsigned int FormatRGBA16F = 10;
+
+	struct Lifetime
+	{
+		RenderTargetDesc Desc;
+		unsigned int FirstPass;
+		unsigned int LastPass;
+	};
+
+	// Asks the pool for the same targets the frame graph does for Game::Draw()
+	std::vector<Lifetime> RequestGameFrame(RenderTargetPool& pool, unsigned int width, unsigned int height, int blurRadius, unsigned int blurDownsample, unsigned int scatteringDownsample)
+	{
+		std::vector<Lifetime> lifetimes;
+		auto request = [&](const RenderTargetDesc& desc, unsigned int pass) {
+			lifetimes.push_back({ desc, pass, pass });
+			return pool.Request(desc, pass);
+		};
+		auto use = [&](unsigned int target, unsigned int pass) {
+			pool.Use(target, pass);
+			lifetimes[target].FirstPass = std::min(lifetimes[target].FirstPass, pass);
+			lifetimes[target].LastPass = std::max(lifetimes[target].LastPass, pass);
+		};
+
+		pool.BeginFrame();
+		unsigned int pass = 0;
+		unsigned int scene = request({ width, height, FormatRGBA8, 0 }, pass);
+		unsigned int sunAndOccluders = request({ width, height, FormatRGBA8, RENDER_TARGET_MIPS }, pass);
+		pass++;
+
+		unsigned int screen = scene;
+		if (blurRadius > 0)
+		{
+			auto blurPass = [&](unsigned int downsample) {
+				use(screen, pass);
+				screen = request({ std::max(width / downsample, 1u), std::max(height / downsample, 1u), FormatRGBA8, 0 }, pass);
+				pass++;
+			};
+			for (unsigned int downsample = 2; downsample <= blurDownsample; downsample *= 2)
+				blurPass(downsample);
+			blurPass(blurDownsample);
+			blurPass(blurDownsample);
+		}
+
+		unsigned int scattering = request({ std::max(width / scatteringDownsample, 1u), std::max(height / scatteringDownsample, 1u), FormatRGBA16F, 0 }, pass);
+		use(sunAndOccluders, pass);
+		pass++;
+
+		use(screen, pass);
+		use(scattering, pass);
+		pool.Allocate();
+		return lifetimes;
+	}
+
+	std::vector<Lifetime> RequestRandomFrame(RenderTargetPool& pool, std::mt19937& random)
+	{
+		std::uniform_int_distribution<unsigned int> targetCount(1, 24);
+		std::uniform_int_distribution<unsigned int> passes(0, 15);
+		std::uniform_int_distribution<unsigned int> length(0, 5);
+		std::uniform_int_distribution<unsigned int> size(0, 2);
+
+		std::vector<Lifetime> lifetimes;
+		pool.BeginFrame();
+		unsigned int count = targetCount(random);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			// Only a few descriptions, so plenty of targets could share
+			unsigned int s = size(random);
+			RenderTargetDesc desc = { 1280u >> s, 720u >> s, s == 2 ? FormatRGBA16F : FormatRGBA8, 0 };
+			unsigned int first = passes(random);
+			unsigned int last = first + length(random);
+			unsigned int target = pool.Request(desc, last);
+			pool.Use(target, first);
+			lifetimes.push_back({ desc, first, last });
+		}
+		pool.Allocate();
+		return lifetimes;
+	}
+
+	// Returns how many textures the frame could have managed with at best
+	bool CheckFrame(RenderTargetPool& pool, const std::vector<Lifetime>& lifetimes, unsigned int& bestTextures)
+	{
+		bool ok = true;
+		for (unsigned int a = 0; a < lifetimes.size(); a++)
+		{
+			for (unsigned int b = a + 1; b < lifetimes.size(); b++)
+			{
+				if (pool.GetSlot(a) != pool.GetSlot(b))
+					continue;
+				bool overlap = lifetimes[a].FirstPass <= lifetimes[b].LastPass && lifetimes[b].FirstPass <= lifetimes[a].LastPass;
+				if (!(lifetimes[a].Desc == lifetimes[b].Desc) || overlap)
+				{
+					printf("  targets %u and %u share slot %u but %s\n", a, b, pool.GetSlot(a), overlap ? "are alive at once" : "don't match");
+					ok = false;
+				}
+			}
+			if (!(pool.GetSlotDesc(pool.GetSlot(a)) == lifetimes[a].Desc))
+			{
+				printf("  target %u's slot has the wrong description\n", a);
+				ok = false;
+			}
+		}
+
+		// The most targets of each description alive during any one pass
+		std::vector<RenderTargetDesc> descs;
+		for (const Lifetime& lifetime : lifetimes)
+		{
+			if (std::find(descs.begin(), descs.end(), lifetime.Desc) == descs.end())
+				descs.push_back(lifetime.Desc);
+		}
+		bestTextures = 0;
+		for (const RenderTargetDesc& desc : descs)
+		{
+			unsigned int mostAlive = 0;
+			std::vector<unsigned int> slotsUsed;
+			for (unsigned int pass = 0; pass < 32; pass++)
+			{
+				unsigned int alive = 0;
+				for (const Lifetime& lifetime : lifetimes)
+					alive += lifetime.Desc == desc && lifetime.FirstPass <= pass && pass <= lifetime.LastPass;
+				mostAlive = std::max(mostAlive, alive);
+			}
+			for (unsigned int t = 0; t < lifetimes.size(); t++)
+			{
+				if (lifetimes[t].Desc == desc && std::find(slotsUsed.begin(), slotsUsed.end(), pool.GetSlot(t)) == slotsUsed.end())
+					slotsUsed.push_back(pool.GetSlot(t));
+			}
+			if (slotsUsed.size() > mostAlive)
+			{
+				printf("  %ux%u used %u textures, but only needed %u\n", desc.Width, desc.Height, (unsigned int)slotsUsed.size(), mostAlive);
+				ok = false;
+			}
+			bestTextures += mostAlive;
+		}
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int randomFrames = argc >= 2 ? atoi(argv[1]) : 10000;
+	bool failed = false;
+
+	// The game's frame at every setting, each on its own pool, then run twice to check nothing new is made
+	const unsigned int downsamples[] = { 1, 2, 4 };
+	for (int blurRadius = 0; blurRadius <= 1; blurRadius++)
+	{
+		for (unsigned int blurDownsample : downsamples)
+		{
+			if (blurRadius == 0 && blurDownsample > 1)
+				continue;
+			for (unsigned int scatteringDownsample : downsamples)
+			{
+				RenderTargetPool pool;
+				unsigned int bestTextures;
+				std::vector<Lifetime> lifetimes = RequestGameFrame(pool, 1280, 720, blurRadius, blurDownsample, scatteringDownsample);
+				bool ok = CheckFrame(pool, lifetimes, bestTextures);
+				std::vector<unsigned int> firstSlots;
+				for (unsigned int t = 0; t < lifetimes.size(); t++)
+					firstSlots.push_back(pool.GetSlot(t));
+
+				RequestGameFrame(pool, 1280, 720, blurRadius, blurDownsample, scatteringDownsample);
+				bool steady = pool.GetCreatedSlots().empty() && pool.GetReleasedSlots().empty();
+				for (unsigned int t = 0; t < lifetimes.size(); t++)
+					steady &= pool.GetSlot(t) == firstSlots[t];
+				if (!steady)
+					printf("  the second frame didn't reuse the first one's textures\n");
+
+				failed |= !ok || !steady;
+				printf("blur %s, scattering 1/%u: %u targets in %u textures%s\n",
+					blurRadius == 0 ? "off    " : blurDownsample == 1 ? "full   " : blurDownsample == 2 ? "half   " : "quarter",
+					scatteringDownsample, pool.GetTargetCount(), pool.GetTextureCount(), ok && steady ? "" : "  WRONG");
+			}
+		}
+	}
+
+	// Switching settings: the old blur targets hang on for a few frames, then go
+	{
+		const unsigned int framesToKeep = 3;
+		RenderTargetPool pool(framesToKeep);
+		RequestGameFrame(pool, 1280, 720, 1, 4, 2);
+		unsigned int before = pool.GetTextureCount();
+		unsigned int released = 0;
+		for (unsigned int frame = 0; frame <= framesToKeep + 1; frame++)
+		{
+			RequestGameFrame(pool, 1280, 720, 0, 1, 2);
+			released += (unsigned int)pool.GetReleasedSlots().size();
+			if (frame < framesToKeep && released > 0)
+			{
+				printf("  textures were let go after only %u frames\n", frame + 1);
+				failed = true;
+			}
+		}
+		bool ok = released > 0 && pool.GetTextureCount() == before - released;
+		failed |= !ok;
+		printf("Turning the blur off: %u textures, %u after %u frames%s\n", before, pool.GetTextureCount(), framesToKeep + 2, ok ? "" : "  WRONG");
+	}
+
+	// Random frames, all through one pool so slots are reused across frames of every shape
+	{
+		std::mt19937 random(1);
+		RenderTargetPool pool;
+		unsigned int targets = 0;
+		unsigned int textures = 0;
+		unsigned int bad = 0;
+		for (int frame = 0; frame < randomFrames; frame++)
+		{
+			unsigned int bestTextures;
+			std::vector<Lifetime> lifetimes = RequestRandomFrame(pool, random);
+			bad += !CheckFrame(pool, lifetimes, bestTextures);
+			targets += (unsigned int)lifetimes.size();
+			textures += bestTextures;
+		}
+		failed |= bad > 0;
+		printf("%d random frames: %u targets in %u textures, %u frames wrong\n", randomFrames, targets, textures, bad);
+	}
+
+	return failed ? 1 : 0;
+}
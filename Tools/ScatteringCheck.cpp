@@ -0,0 +1,222 @@
+// Golden image check for the light scattering (LightScattering.h, PixelShader_VolumetricLighting.hlsl
+// and PixelShader_VolumetricComposite.hlsl)
+// - Not part of the Visual Studio project; it builds the game's LightScattering.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc ScatteringCheck.cpp ../LightScattering.cpp ../ImageData.cpp -o ScatteringCheck
+//
+// Usage:
+//   ScatteringCheck [goldenFolder]
+//     Draws a test scene's sun and occluders, then scatters its light with ScatterLightReference at full
+//     resolution (the golden image).  The same is then done the way the game does it: at half and quarter
+//     resolution from a matching mip, then blown back up by the depth aware upsample.  Both are compared
+//     against the golden image, as is the old fixed 20 step version.  Exits non-zero if the reduced
+//     resolution versions are too far off.  With a folder, every image is also saved there as a DDS.
+
+#include "../ImageData.h"
+#include "../LightScattering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int Width = 320;
+	const unsigned int Height = 180;
+	const float FarClip = 1000.0f;
+
+	struct Scene
+	{
+		std::vector<XMFLOAT4> Occlusion;	// What the sky shader writes: the sun where it's visible, black elsewhere
+		std::vector<float> ViewDepth;
+	};
+
+	// A sun low in the sky, behind a row of posts and a floating bar
+	Scene CreateScene(XMFLOAT2& sunUV)
+	{
+		sunUV = XMFLOAT2(0.6f, 0.3f);
+		Scene scene;
+		scene.Occlusion.resize(Width * Height);
+		scene.ViewDepth.resize(Width * Height);
+		for (unsigned int y = 0; y < Height; y++)
+		{
+			for (unsigned int x = 0; x < Width; x++)
+			{
+				float u = (x + 0.5f) / Width;
+				float v = (y + 0.5f) / Height;
+				bool post = v > 0.2f && (x / 12) % 3 == 0;
+				bool bar = v > 0.35f && v < 0.4f && u > 0.3f && u < 0.9f;
+				bool ground = v > 0.7f;
+				bool occluded = post || bar || ground;
+
+				float dx = (u - sunUV.x) * Width / Height;
+				float dy = v - sunUV.y;
+				float sun = occluded ? 0.0f : powf(std::max(1.0f - sqrtf(dx * dx + dy * dy) * 4.0f, 0.0f), 2.0f);
+				scene.Occlusion[y * Width + x] = XMFLOAT4(sun, sun * 0.9f, sun * 0.7f, 1);
+				scene.ViewDepth[y * Width + x] = ground ? 3.0f + 40.0f * (1.0f - v) : post ? 8.0f : bar ? 5.0f : FarClip;
+			}
+		}
+		return scene;
+	}
+
+	// The next mip down, as GenerateMips makes it (a 2x2 average)
+	std::vector<XMFLOAT4> HalveImage(const std::vector<XMFLOAT4>& image, unsigned int width, unsigned int height)
+	{
+		std::vector<XMFLOAT4> half((width / 2) * (height / 2));
+		for (unsigned int y = 0; y < height / 2; y++)
+		{
+			for (unsigned int x = 0; x < width / 2; x++)
+			{
+				XMVECTOR total = XMVectorAdd(
+					XMVectorAdd(XMLoadFloat4(&image[(2 * y) * width + 2 * x]), XMLoadFloat4(&image[(2 * y) * width + 2 * x + 1])),
+					XMVectorAdd(XMLoadFloat4(&image[(2 * y + 1) * width + 2 * x]), XMLoadFloat4(&image[(2 * y + 1) * width + 2 * x + 1])));
+				XMStoreFloat4(&half[y * (width / 2) + x], XMVectorScale(total, 0.25f));
+			}
+		}
+		return half;
+	}
+
+	// The golden image, or the old shader: fixed steps, with decay and weight used as they are
+	std::vector<XMFLOAT3> ScatterFullSize(const Scene& scene, XMFLOAT2 sunUV, const ScatteringSettings& settings, bool fixedSteps)
+	{
+		std::vector<XMFLOAT3> result(Width * Height);
+		for (unsigned int y = 0; y < Height; y++)
+		{
+			for (unsigned int x = 0; x < Width; x++)
+			{
+				XMFLOAT2 uv((x + 0.5f) / Width, (y + 0.5f) / Height);
+				ScatteringSettings pixelSettings = settings;
+				if (fixedSteps)
+				{
+					// A step length that always gives the reference step count
+					float texelsToSun = sqrtf(powf((sunUV.x - uv.x) * Width, 2) + powf((sunUV.y - uv.y) * Height, 2));
+					pixelSettings.TexelsPerSample = std::max(texelsToSun, 0.01f) / SCATTERING_REFERENCE_SAMPLES * 1.0001f;
+					pixelSettings.MaxSamples = SCATTERING_REFERENCE_SAMPLES;
+				}
+				result[y * Width + x] = ScatterLightReference(scene.Occlusion, Width, Height, uv, sunUV, XMFLOAT2((float)Width, (float)Height), pixelSettings);
+			}
+		}
+		return result;
+	}
+
+	// The game's path: scatter into a smaller target from the matching mip, then the depth aware upsample
+	std::vector<XMFLOAT3> ScatterReduced(const Scene& scene, XMFLOAT2 sunUV, const ScatteringSettings& settings, unsigned int downsample, float depthSharpness)
+	{
+		unsigned int width = Width / downsample;
+		unsigned int height = Height / downsample;
+		std::vector<XMFLOAT4> mip = scene.Occlusion;
+		for (unsigned int size = Width; size > width; size /= 2)
+			mip = HalveImage(mip, size, Height * size / Width);
+
+		std::vector<XMFLOAT4> scattering(width * height);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			for (unsigned int x = 0; x < width; x++)
+			{
+				XMFLOAT2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+				XMFLOAT3 light = ScatterLightReference(mip, width, height, uv, sunUV, XMFLOAT2((float)width, (float)height), settings);
+				float depth = scene.ViewDepth[(unsigned int)(uv.y * Height) * Width + (unsigned int)(uv.x * Width)];
+				scattering[y * width + x] = XMFLOAT4(light.x, light.y, light.z, depth);
+			}
+		}
+
+		std::vector<XMFLOAT3> result(Width * Height);
+		for (unsigned int y = 0; y < Height; y++)
+		{
+			for (unsigned int x = 0; x < Width; x++)
+			{
+				float viewDepth = scene.ViewDepth[y * Width + x];
+				float texelX = (x + 0.5f) / Width * width - 0.5f;
+				float texelY = (y + 0.5f) / Height * height - 0.5f;
+				int cornerX = (int)floorf(texelX);
+				int cornerY = (int)floorf(texelY);
+				float blendX = texelX - cornerX;
+				float blendY = texelY - cornerY;
+
+				XMVECTOR total = XMVectorZero();
+				float totalWeight = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					int offsetX = i & 1;
+					int offsetY = i >> 1;
+					int sampleX = std::clamp(cornerX + offsetX, 0, (int)width - 1);
+					int sampleY = std::clamp(cornerY + offsetY, 0, (int)height - 1);
+					const XMFLOAT4& texel = scattering[sampleY * width + sampleX];
+					float bilinear = (offsetX ? blendX : 1 - blendX) * (offsetY ? blendY : 1 - blendY);
+					float weight = bilinear / (1 + fabsf(texel.w - viewDepth) / viewDepth * depthSharpness);
+					total = XMVectorAdd(total, XMVectorScale(XMLoadFloat4(&texel), weight));
+					totalWeight += weight;
+				}
+				XMStoreFloat3(&result[y * Width + x], XMVectorScale(total, 1.0f / std::max(totalWeight, 0.0001f)));
+			}
+		}
+		return result;
+	}
+
+	float MeanError(const std::vector<XMFLOAT3>& a, const std::vector<XMFLOAT3>& b)
+	{
+		double total = 0;
+		for (size_t i = 0; i < a.size(); i++)
+			total += fabsf(a[i].x - b[i].x) + fabsf(a[i].y - b[i].y) + fabsf(a[i].z - b[i].z);
+		return (float)(total / (a.size() * 3));
+	}
+
+	void SaveImage(const std::string& folder, const std::string& name, const std::vector<XMFLOAT3>& image)
+	{
+		ImageData data;
+		data.Width = Width;
+		data.Height = Height;
+		data.Pixels.resize(Width * Height * 4);
+		for (size_t i = 0; i < image.size(); i++)
+		{
+			data.Pixels[i * 4 + 0] = (unsigned char)(std::clamp(image[i].x, 0.0f, 1.0f) * 255.0f + 0.5f);
+			data.Pixels[i * 4 + 1] = (unsigned char)(std::clamp(image[i].y, 0.0f, 1.0f) * 255.0f + 0.5f);
+			data.Pixels[i * 4 + 2] = (unsigned char)(std::clamp(image[i].z, 0.0f, 1.0f) * 255.0f + 0.5f);
+			data.Pixels[i * 4 + 3] = 255;
+		}
+		SaveDDS(folder + "/" + name + ".dds", data);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// The game's defaults, except far brighter so that small differences show
+	ScatteringSettings settings = {};
+	settings.Exposure = 8.0f;
+	settings.Weight = 0.5f;
+	settings.Decay = 0.8f;
+	settings.TexelsPerSample = 8.0f;
+	settings.MaxSamples = 32;
+	const float depthSharpness = 20.0f;
+
+	XMFLOAT2 sunUV;
+	Scene scene = CreateScene(sunUV);
+	std::vector<XMFLOAT3> golden = ScatterFullSize(scene, sunUV, settings, false);
+	std::vector<XMFLOAT3> fixedSteps = ScatterFullSize(scene, sunUV, settings, true);
+	std::vector<XMFLOAT3> half = ScatterReduced(scene, sunUV, settings, 2, depthSharpness);
+	std::vector<XMFLOAT3> quarter = ScatterReduced(scene, sunUV, settings, 4, depthSharpness);
+
+	// Light is 0-1, so these are fractions of full brightness.  The reduced versions lose the finest
+	// detail of the posts' shadows, but should stay within a couple of 8 bit steps on average.
+	const float tolerance = 2.0f / 255.0f;
+	float fixedError = MeanError(golden, fixedSteps);
+	float halfError = MeanError(golden, half);
+	float quarterError = MeanError(golden, quarter);
+	printf("Old fixed 20 steps:      mean difference %.2f steps\n", fixedError * 255.0f);
+	printf("Half size + upsample:    mean difference %.2f steps%s\n", halfError * 255.0f, halfError > tolerance ? "  TOO FAR" : "");
+	printf("Quarter size + upsample: mean difference %.2f steps%s\n", quarterError * 255.0f, quarterError > tolerance ? "  TOO FAR" : "");
+
+	if (argc >= 2)
+	{
+		SaveImage(argv[1], "golden", golden);
+		SaveImage(argv[1], "fixed_steps", fixedSteps);
+		SaveImage(argv[1], "half", half);
+		SaveImage(argv[1], "quarter", quarter);
+	}
+
+	return halfError > tolerance || quarterError > tolerance ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+// Correctness check for the shadow atlas's quadtree allocator (ShadowAtlas)
+// - Not part of the Visual Studio project; it builds the game's ShadowAtlas.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc ShadowAtlasCheck.cpp ../ShadowAtlas.cpp -o ShadowAtlasCheck
+//
+// Usage:
+//   ShadowAtlasCheck [operations]
+//     Checks that tiles are handed out inside the atlas, aligned to their size and never overlapping, that
+//     freeing them merges neighbors back into bigger tiles, that sizes are rounded up to a power of two (and at
+//     least the smallest tile), and that running out of space fails cleanly.  Then allocates and frees tiles at
+//     random for the given number of operations, keeping its own map of which texels are used, and checks after
+//     every one that an allocation only fails when there really is no free aligned tile that big, and that the
+//     used area and fragmentation match the map.  Also times it.  Exits non-zero if anything is wrong.
+
+#include "../ShadowAtlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// Which smallest tiles of the atlas are in use, kept separately from the allocator
+	struct UsedMap
+	{
+		unsigned int Cells;		// Across the atlas
+		unsigned int CellSize;	// The smallest tile
+		std::vector<bool> Used;
+
+		UsedMap(unsigned int atlasSize, unsigned int minTileSize)
+			: Cells(atlasSize / minTileSize), CellSize(minTileSize), Used(Cells * Cells, false)
+		{
+		}
+
+		// Marks a tile, and returns false if it's outside the atlas, misaligned, or overlaps one in use
+		bool Mark(const ShadowAtlasRegion& region, bool used)
+		{
+			if (region.Size < CellSize || region.X % region.Size != 0 || region.Y % region.Size != 0 ||
+				region.X + region.Size > Cells * CellSize || region.Y + region.Size > Cells * CellSize)
+				return false;
+
+			bool ok = true;
+			for (unsigned int y = region.Y / CellSize; y < (region.Y + region.Size) / CellSize; y++)
+			{
+				for (unsigned int x = region.X / CellSize; x < (region.X + region.Size) / CellSize; x++)
+				{
+					ok &= Used[y * Cells + x] != used;
+					Used[y * Cells + x] = used;
+				}
+			}
+			return ok;
+		}
+
+		bool IsFree(unsigned int cellX, unsigned int cellY, unsigned int cells)
+		{
+			for (unsigned int y = cellY; y < cellY + cells; y++)
+			{
+				for (unsigned int x = cellX; x < cellX + cells; x++)
+				{
+					if (Used[y * Cells + x])
+						return false;
+				}
+			}
+			return true;
+		}
+
+		// The biggest aligned tile that's entirely free.  With neighbors always merged the allocator
+		// must be able to hand out a tile this big, and no bigger.
+		unsigned int LargestFreeTile()
+		{
+			for (unsigned int cells = Cells; cells >= 1; cells /= 2)
+			{
+				for (unsigned int y = 0; y < Cells; y += cells)
+				{
+					for (unsigned int x = 0; x < Cells; x += cells)
+					{
+						if (IsFree(x, y, cells))
+							return cells * CellSize;
+					}
+				}
+			}
+			return 0;
+		}
+
+		unsigned long long UsedArea()
+		{
+			return (unsigned long long)std::count(Used.begin(), Used.end(), true) * CellSize * CellSize;
+		}
+	};
+
+	// Four quarters fill the atlas; freed, they merge back into the whole atlas in any order
+	bool AllocateAndMerge()
+	{
+		bool ok = true;
+		const unsigned int orders[][4] = { { 0, 1, 2, 3 }, { 3, 2, 1, 0 }, { 2, 0, 3, 1 } };
+		for (const unsigned int* order : orders)
+		{
+			ShadowAtlas atlas(2048, 128);
+			UsedMap map(2048, 128);
+			ShadowAtlasRegion quarters[4];
+			for (ShadowAtlasRegion& quarter : quarters)
+			{
+				ok &= atlas.Allocate(1024, quarter) && quarter.Size == 1024;
+				ok &= map.Mark(quarter, true);
+			}
+			ok &= atlas.GetLargestFreeTile() == 0 && atlas.GetUsedArea() == 2048ull * 2048;
+
+			for (int i = 0; i < 4; i++)
+			{
+				atlas.Free(quarters[order[i]]);
+				ok &= map.Mark(quarters[order[i]], false);
+				ok &= atlas.GetLargestFreeTile() == map.LargestFreeTile();
+			}
+			ok &= atlas.GetLargestFreeTile() == 2048 && atlas.GetUsedArea() == 0 && atlas.GetFragmentation() == 0.0f;
+		}
+
+		// Every smallest tile, freed in a random order, still merges all the way back up
+		ShadowAtlas atlas(2048, 128);
+		UsedMap map(2048, 128);
+		std::vector<ShadowAtlasRegion> tiles(16 * 16);
+		for (ShadowAtlasRegion& tile : tiles)
+			ok &= atlas.Allocate(128, tile) && map.Mark(tile, true);
+		ShadowAtlasRegion extra;
+		ok &= !atlas.Allocate(128, extra);
+
+		std::mt19937 random(1234);
+		std::shuffle(tiles.begin(), tiles.end(), random);
+		for (const ShadowAtlasRegion& tile : tiles)
+		{
+			atlas.Free(tile);
+			ok &= map.Mark(tile, false);
+			ok &= atlas.GetLargestFreeTile() == map.LargestFreeTile();
+		}
+		ShadowAtlasRegion whole;
+		ok &= atlas.Allocate(2048, whole) && whole.X == 0 && whole.Y == 0 && whole.Size == 2048;
+		return Check(ok, "Allocate, free and merge");
+	}
+
+	// Sizes are rounded up to a power of two, at least the smallest tile, and never past the atlas
+	bool Rounding()
+	{
+		ShadowAtlas atlas(2048, 128);
+		const unsigned int sizes[][2] = { { 0, 128 }, { 1, 128 }, { 100, 128 }, { 128, 128 }, { 129, 256 },
+			{ 300, 512 }, { 512, 512 }, { 513, 1024 }, { 1500, 2048 }, { 2048, 2048 } };
+		bool ok = true;
+		for (const unsigned int* size : sizes)
+		{
+			ShadowAtlasRegion region;
+			ok &= atlas.Allocate(size[0], region) && region.Size == size[1];
+			ok &= atlas.GetUsedArea() == (unsigned long long)size[1] * size[1];
+			atlas.Free(region);
+		}
+
+		ShadowAtlasRegion region;
+		ok &= !atlas.Allocate(2049, region) && atlas.GetUsedArea() == 0;
+
+		// A smallest tile bigger than the atlas is clamped to it
+		ShadowAtlas tiny(256, 512);
+		ok &= tiny.GetMinTileSize() == 256 && tiny.Allocate(10, region) && region.Size == 256;
+		return Check(ok, "Sizes round up to a power of two");
+	}
+
+	// Filling the atlas makes further allocations fail without changing anything
+	bool OutOfSpace()
+	{
+		ShadowAtlas atlas(2048, 128);
+		UsedMap map(2048, 128);
+		bool ok = true;
+		std::vector<ShadowAtlasRegion> tiles;
+		ShadowAtlasRegion region;
+		while (atlas.Allocate(512, region))
+		{
+			ok &= map.Mark(region, true);
+			tiles.push_back(region);
+		}
+		ok &= tiles.size() == 16 && atlas.GetLargestFreeTile() == 0;
+		ok &= !atlas.Allocate(128, region) && !atlas.Allocate(2048, region);
+		ok &= atlas.GetUsedArea() == 2048ull * 2048 && atlas.GetFragmentation() == 0.0f;
+
+		// Freeing one 512 tile makes room for exactly sixteen 128 tiles
+		atlas.Free(tiles[5]);
+		map.Mark(tiles[5], false);
+		unsigned int small = 0;
+		while (atlas.Allocate(128, region))
+		{
+			ok &= map.Mark(region, true);
+			small++;
+		}
+		ok &= small == 16;
+
+		atlas.Clear();
+		ok &= atlas.GetLargestFreeTile() == 2048 && atlas.GetUsedArea() == 0;
+		return Check(ok, "Running out of space");
+	}
+
+	// Random sizes allocated and freed at random, checked against the map after every operation
+	bool Churn(unsigned int operations)
+	{
+		ShadowAtlas atlas(2048, 128);
+		UsedMap map(2048, 128);
+		std::vector<ShadowAtlasRegion> live;
+		std::mt19937 random(5678);
+		bool ok = true;
+		unsigned int failures = 0;
+		double fragmentation = 0;
+
+		for (unsigned int op = 0; op < operations; op++)
+		{
+			if (live.empty() || random() % 100 < 55)
+			{
+				unsigned int size = 128u << (random() % 3);
+				ShadowAtlasRegion region;
+				if (atlas.Allocate(size, region))
+				{
+					ok &= region.Size == size && map.Mark(region, true);
+					live.push_back(region);
+				}
+				else
+				{
+					ok &= map.LargestFreeTile() < size;
+					failures++;
+				}
+			}
+			else
+			{
+				size_t index = random() % live.size();
+				atlas.Free(live[index]);
+				ok &= map.Mark(live[index], false);
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			unsigned long long freeArea = 2048ull * 2048 - map.UsedArea();
+			unsigned int largest = map.LargestFreeTile();
+			float expected = freeArea == 0 ? 0.0f : 1.0f - (float)((double)largest * largest / freeArea);
+			ok &= atlas.GetUsedArea() == map.UsedArea();
+			ok &= atlas.GetLargestFreeTile() == largest;
+			ok &= std::abs(atlas.GetFragmentation() - expected) < 1e-6f;
+			fragmentation += atlas.GetFragmentation();
+		}
+
+		for (const ShadowAtlasRegion& region : live)
+			atlas.Free(region);
+		ok &= atlas.GetLargestFreeTile() == 2048 && atlas.GetUsedArea() == 0;
+		printf("  %u operations, %u allocations failed, mean fragmentation %.2f\n", operations, failures, fragmentation / operations);
+		return Check(ok, "Random churn matches a map of the atlas");
+	}
+
+	// The same churn without the map, timed
+	void Timing(unsigned int operations)
+	{
+		ShadowAtlas atlas(2048, 128);
+		std::vector<ShadowAtlasRegion> live;
+		live.reserve(256);
+		std::mt19937 random(5678);
+
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int op = 0; op < operations; op++)
+		{
+			if (live.empty() || random() % 100 < 55)
+			{
+				ShadowAtlasRegion region;
+				if (atlas.Allocate(128u << (random() % 3), region))
+					live.push_back(region);
+			}
+			else
+			{
+				size_t index = random() % live.size();
+				atlas.Free(live[index]);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+		double churnNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+
+		// Game::UpdateShadowAtlas's per frame rebuild: eight point lights' six faces, largest first
+		const unsigned int frames = 10000;
+		start = std::chrono::steady_clock::now();
+		unsigned int placed = 0;
+		for (unsigned int frame = 0; frame < frames; frame++)
+		{
+			atlas.Clear();
+			for (unsigned int light = 0; light < 8; light++)
+			{
+				ShadowAtlasRegion region;
+				for (unsigned int face = 0; face < 6; face++)
+					placed += atlas.Allocate(light < 1 ? 512 : light < 4 ? 256 : 128, region);
+			}
+		}
+		double rebuildUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+		printf("  %.0f ns per churn operation, %.2f us per rebuild of %u tiles\n", churnNs, rebuildUs, placed / frames);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int operations = argc >= 2 ? (unsigned int)atoi(argv[1]) : 100000;
+
+	bool failed = false;
+	failed |= !AllocateAndMerge();
+	failed |= !Rounding();
+	failed |= !OutOfSpace();
+	failed |= !Churn(operations);
+	Timing(operations * 10);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,257 @@
+// Correctness check for the cascaded shadow map fitting (ShadowCascades)
+// - Not part of the Visual Studio project; it builds the game's ShadowCascades.cpp on its own
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc ShadowCascadesCheck.cpp ../ShadowCascades.cpp -o ShadowCascadesCheck
+//
+// Usage:
+//   ShadowCascadesCheck [resolution]
+//     Fits cascades for cameras like the game's (left and right handed) along a path that moves and turns, and
+//     checks that the split depths are spaced as SplitLambda says, that every cascade's slice of the view fits
+//     inside its shadow map, that the world moves across each shadow map in whole texels as the camera moves,
+//     and that turning the camera on the spot doesn't change any cascade's size.  Exits non-zero if anything
+//     is wrong.
+
+#include "../ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace DirectX;
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// The game's camera defaults
+	const float fieldOfView = XM_PIDIV4;
+	const float aspectRatio = 16.0f / 9.0f;
+	const float nearClip = 0.01f;
+	const float farClip = 1000.0f;
+
+	struct CameraSetup
+	{
+		XMFLOAT4X4 View;
+		XMFLOAT4X4 Projection;
+	};
+
+	// Camera::UpdateViewMatrix() and UpdateProjectionMatrix(), from a position and a yaw and pitch
+	CameraSetup MakeCamera(XMFLOAT3 position, float yaw, float pitch, bool leftHanded)
+	{
+		XMVECTOR forward = XMVectorSet(sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch), 0);
+		XMVECTOR up = XMVectorSet(0, 1, 0, 0);
+
+		CameraSetup camera;
+		if (leftHanded)
+		{
+			XMStoreFloat4x4(&camera.View, XMMatrixLookToLH(XMLoadFloat3(&position), forward, up));
+			XMStoreFloat4x4(&camera.Projection, XMMatrixPerspectiveFovLH(fieldOfView, aspectRatio, nearClip, farClip));
+		}
+		else
+		{
+			XMStoreFloat4x4(&camera.View, XMMatrixLookToRH(XMLoadFloat3(&position), forward, up));
+			XMStoreFloat4x4(&camera.Projection, XMMatrixPerspectiveFovRH(fieldOfView, aspectRatio, nearClip, farClip));
+		}
+		return camera;
+	}
+
+	// A few lights, including one nearly straight down (which needs a different up vector)
+	const XMFLOAT3 lightDirections[] = { { 1, -1, 1 }, { -0.3f, -1, 0.2f }, { 0.02f, -1, 0.01f } };
+
+	bool Splits()
+	{
+		bool ok = true;
+		for (unsigned int count = 1; count <= MAX_SHADOW_CASCADES; count++)
+		{
+			float uniform[MAX_SHADOW_CASCADES + 1];
+			float logarithmic[MAX_SHADOW_CASCADES + 1];
+			float blend[MAX_SHADOW_CASCADES + 1];
+			CalculateCascadeSplits(0.1f, 60.0f, count, 0.0f, uniform);
+			CalculateCascadeSplits(0.1f, 60.0f, count, 1.0f, logarithmic);
+			CalculateCascadeSplits(0.1f, 60.0f, count, 0.8f, blend);
+
+			// Exactly the clip distances at the ends
+			ok &= uniform[0] == 0.1f && uniform[count] == 60.0f;
+			ok &= logarithmic[0] == 0.1f && logarithmic[count] == 60.0f;
+			ok &= blend[0] == 0.1f && blend[count] == 60.0f;
+
+			for (unsigned int i = 1; i <= count; i++)
+			{
+				// Even steps, the same ratio each step, and in between where lambda says
+				ok &= fabsf((uniform[i] - uniform[i - 1]) - 59.9f / count) < 1e-3f;
+				ok &= fabsf(logarithmic[i] / logarithmic[i - 1] - powf(600.0f, 1.0f / count)) < 1e-3f;
+				ok &= fabsf(blend[i] - (uniform[i] + (logarithmic[i] - uniform[i]) * 0.8f)) < 1e-3f;
+				ok &= blend[i] > blend[i - 1];
+			}
+		}
+
+		// And the cascades cover those depths, out to MaxShadowDistance
+		ShadowCascadeSettings settings;
+		CameraSetup camera = MakeCamera(XMFLOAT3(0, 2, -10), 0.3f, 0.1f, true);
+		ShadowCascade cascades[MAX_SHADOW_CASCADES];
+		unsigned int count = CalculateShadowCascades(settings, camera.View, camera.Projection, nearClip, farClip, lightDirections[0], cascades);
+		float splits[MAX_SHADOW_CASCADES + 1];
+		CalculateCascadeSplits(nearClip, settings.MaxShadowDistance, settings.CascadeCount, settings.SplitLambda, splits);
+		ok &= count == settings.CascadeCount;
+		for (unsigned int i = 0; i < count; i++)
+			ok &= cascades[i].SplitNear == splits[i] && cascades[i].SplitFar == splits[i + 1];
+		printf("  splits: %.3f %.3f %.3f %.3f %.3f\n", splits[0], splits[1], splits[2], splits[3], splits[4]);
+		return Check(ok, "Split depths");
+	}
+
+	// Each slice's corners are at its split depths, and land inside the cascade's shadow map (give or take the
+	// texel snapping, which moves it by under a texel) and between its near and far planes
+	bool SlicesFit(unsigned int resolution)
+	{
+		ShadowCascadeSettings settings;
+		settings.Resolution = resolution;
+		bool ok = true;
+		float worstSide = 0;
+		float worstDepth = 0;
+		float worstSplit = 0;
+
+		for (int handedness = 0; handedness < 2; handedness++)
+		{
+			for (const XMFLOAT3& light : lightDirections)
+			{
+				for (int step = 0; step < 200; step++)
+				{
+					XMFLOAT3 position(sinf(step * 0.05f) * 20.0f, 1.0f + step * 0.02f, step * 0.3f - 30.0f);
+					CameraSetup camera = MakeCamera(position, step * 0.11f, sinf(step * 0.07f) * 1.2f, handedness == 0);
+
+					float splits[MAX_SHADOW_CASCADES + 1];
+					CalculateCascadeSplits(nearClip, settings.MaxShadowDistance, settings.CascadeCount, settings.SplitLambda, splits);
+					for (unsigned int i = 0; i < settings.CascadeCount; i++)
+					{
+						XMFLOAT3 corners[8];
+						CalculateFrustumSliceCorners(camera.View, camera.Projection, splits[i], splits[i + 1], corners);
+						ShadowCascade cascade = FitShadowCascade(corners, light, settings.CasterDistance, resolution);
+
+						XMMATRIX view = XMLoadFloat4x4(&camera.View);
+						XMMATRIX viewProjection = XMLoadFloat4x4(&cascade.ViewProjection);
+						for (int c = 0; c < 8; c++)
+						{
+							float depth = fabsf(XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&corners[c]), view)));
+							float split = c < 4 ? splits[i] : splits[i + 1];
+							worstSplit = std::max(worstSplit, fabsf(depth - split) / std::max(split, 1.0f)); // Relative, but not to tiny depths
+
+							XMVECTOR shadow = XMVector3TransformCoord(XMLoadFloat3(&corners[c]), viewProjection);
+							worstSide = std::max(worstSide, std::max(fabsf(XMVectorGetX(shadow)), fabsf(XMVectorGetY(shadow))) - 1.0f);
+							worstDepth = std::max(worstDepth, std::max(-XMVectorGetZ(shadow), XMVectorGetZ(shadow) - 1.0f));
+						}
+					}
+				}
+			}
+		}
+
+		ok &= worstSplit < 1e-4f;
+		ok &= worstSide <= 1.0f / resolution + 1e-5f;
+		ok &= worstDepth <= 1e-5f;
+		printf("  corners at their split depth within %g, past the map's sides by at most %.3f texels, past its depth range by %g\n",
+			worstSplit, std::max(worstSide, 0.0f) * resolution * 0.5f, std::max(worstDepth, 0.0f));
+		return Check(ok, "Every slice fits inside its cascade");
+	}
+
+	// Where a world point lands in a cascade's shadow map, in texels
+	XMVECTOR TexelPosition(const ShadowCascade& cascade, XMVECTOR point, unsigned int resolution)
+	{
+		return XMVector3TransformCoord(point, XMLoadFloat4x4(&cascade.ViewProjection)) * (resolution * 0.5f);
+	}
+
+	// As the camera moves, the world slides across each shadow map by whole texels, so shadow edges don't shimmer
+	bool TexelSnapping(unsigned int resolution)
+	{
+		ShadowCascadeSettings settings;
+		settings.Resolution = resolution;
+		const XMVECTOR points[] = { XMVectorSet(0, 0, 0, 1), XMVectorSet(3.7f, 0.2f, -1.1f, 1), XMVectorSet(-12.5f, 4.0f, 20.25f, 1) };
+		bool ok = true;
+		float worst = 0;
+
+		for (int handedness = 0; handedness < 2; handedness++)
+		{
+			for (const XMFLOAT3& light : lightDirections)
+			{
+				// Turn as well as move, but only between frames with the same size cascades (a change of size
+				// changes the texel size too, and then nothing lines up)
+				ShadowCascade previous[MAX_SHADOW_CASCADES];
+				for (int step = 0; step < 300; step++)
+				{
+					XMFLOAT3 position(step * 0.0137f, 2.0f + sinf(step * 0.1f) * 0.5f, -step * 0.021f);
+					CameraSetup camera = MakeCamera(position, 0.4f + step * 0.003f, 0.2f, handedness == 0);
+					ShadowCascade cascades[MAX_SHADOW_CASCADES];
+					CalculateShadowCascades(settings, camera.View, camera.Projection, nearClip, farClip, light, cascades);
+
+					for (unsigned int i = 0; i < settings.CascadeCount; i++)
+					{
+						// The world origin is always on a texel corner
+						XMVECTOR origin = TexelPosition(cascades[i], XMVectorSet(0, 0, 0, 1), resolution);
+						worst = std::max(worst, XMVectorGetX(XMVector3Length(XMVectorSetZ(origin - XMVectorRound(origin), 0))));
+
+						if (step == 0 || cascades[i].Radius != previous[i].Radius)
+							continue;
+						for (const XMVECTOR& point : points)
+						{
+							XMVECTOR moved = TexelPosition(cascades[i], point, resolution) - TexelPosition(previous[i], point, resolution);
+							worst = std::max(worst, XMVectorGetX(XMVector3Length(XMVectorSetZ(moved - XMVectorRound(moved), 0))));
+						}
+					}
+					std::copy(cascades, cascades + MAX_SHADOW_CASCADES, previous);
+				}
+			}
+		}
+
+		ok &= worst < 0.01f;
+		printf("  world points off whole texels by at most %g of a texel\n", worst);
+		return Check(ok, "Texel snapping");
+	}
+
+	// The bounds are spheres, so turning on the spot doesn't change how big any cascade is
+	bool ConstantRadius()
+	{
+		ShadowCascadeSettings settings;
+		bool ok = true;
+		for (int handedness = 0; handedness < 2; handedness++)
+		{
+			for (const XMFLOAT3& light : lightDirections)
+			{
+				XMFLOAT3 position(4, 3, -7);
+				ShadowCascade first[MAX_SHADOW_CASCADES];
+				CameraSetup camera = MakeCamera(position, 0, 0, handedness == 0);
+				CalculateShadowCascades(settings, camera.View, camera.Projection, nearClip, farClip, light, first);
+
+				for (int step = 1; step < 360; step++)
+				{
+					float yaw = step * XM_2PI / 360.0f;
+					float pitch = sinf(step * 0.05f) * 1.4f;
+					camera = MakeCamera(position, yaw, pitch, handedness == 0);
+					ShadowCascade cascades[MAX_SHADOW_CASCADES];
+					CalculateShadowCascades(settings, camera.View, camera.Projection, nearClip, farClip, light, cascades);
+					for (unsigned int i = 0; i < settings.CascadeCount; i++)
+						ok &= cascades[i].Radius == first[i].Radius;
+				}
+
+				if (handedness == 0 && &light == &lightDirections[0])
+					printf("  radii: %.4f %.4f %.4f %.4f\n", first[0].Radius, first[1].Radius, first[2].Radius, first[3].Radius);
+			}
+		}
+		return Check(ok, "Cascade radius stays the same as the camera turns");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int resolution = argc >= 2 ? (unsigned int)atoi(argv[1]) : 1024;
+
+	bool failed = false;
+	failed |= !Splits();
+	failed |= !SlicesFit(resolution);
+	failed |= !TexelSnapping(resolution);
+	failed |= !ConstantRadius();
+
+	return failed ? 1 : 0;
+}
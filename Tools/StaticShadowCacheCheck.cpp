@@ -0,0 +1,321 @@
+// Correctness check for when cached static shadows are re-rendered (StaticShadowCache), with the
+// cascade fitting and caster culling that decide what goes into the cache (ShadowCascades, ShadowCulling)
+// - Not part of the Visual Studio project; it builds the game's StaticShadowCache.cpp, ShadowCascades.cpp,
+//   ShadowCulling.cpp and Bounds.cpp on its own and runs the same per frame steps as Game::UpdateShadowCascades
+// - Needs a C++17 compiler and the (header only) DirectXMath library, e.g. from this folder:
+//     g++ -std=c++17 -O2 -I.. -I<DirectXMath>/Inc StaticShadowCacheCheck.cpp ../StaticShadowCache.cpp
+//       ../ShadowCascades.cpp ../ShadowCulling.cpp ../Bounds.cpp -o StaticShadowCacheCheck
+//
+// Usage:
+//   StaticShadowCacheCheck [frames]
+//     Runs a made up scene (a static floor and pillars, and dynamic boxes that move every frame) for the given
+//     number of frames per test, and checks that moving dynamic objects never re-render static shadows, that a
+//     moving or turning camera only does when a cascade steps (see SHADOW_CASCADE_SNAP), and that a static
+//     object moving or becoming static, the light turning, or Invalidate() always do.  Every frame it also
+//     checks that a cache which isn't re-rendered was drawn with exactly this frame's matrices and casters.
+//     Exits non-zero if anything is wrong.
+
+#include "../ShadowCulling.h"
+#include "../StaticShadowCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	bool Check(bool ok, const char* what)
+	{
+		printf("%s: %s\n", what, ok ? "ok" : "WRONG");
+		return ok;
+	}
+
+	// The game's camera defaults
+	const float fieldOfView = XM_PIDIV4;
+	const float aspectRatio = 16.0f / 9.0f;
+	const float nearClip = 0.01f;
+	const float farClip = 1000.0f;
+
+	struct CameraSetup
+	{
+		XMFLOAT4X4 View;
+		XMFLOAT4X4 Projection;
+	};
+
+	// Camera::UpdateViewMatrix() and UpdateProjectionMatrix(), from a position and a yaw
+	CameraSetup MakeCamera(XMFLOAT3 position, float yaw)
+	{
+		XMVECTOR forward = XMVectorSet(sinf(yaw) * cosf(0.2f), -sinf(0.2f), cosf(yaw) * cosf(0.2f), 0);
+		CameraSetup camera;
+		XMStoreFloat4x4(&camera.View, XMMatrixLookToLH(XMLoadFloat3(&position), forward, XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&camera.Projection, XMMatrixPerspectiveFovLH(fieldOfView, aspectRatio, nearClip, farClip));
+		return camera;
+	}
+
+	AABB Box(float x, float y, float z, float halfWidth, float halfHeight)
+	{
+		return { { x - halfWidth, y - halfHeight, z - halfWidth }, { x + halfWidth, y + halfHeight, z + halfWidth } };
+	}
+
+	// A static floor and a grid of static pillars, with dynamic boxes in between.
+	// Versions stand in for Transform::GetVersion().
+	struct Scene
+	{
+		std::vector<AABB> Bounds;
+		std::vector<bool> Static;
+		std::vector<unsigned int> Versions;
+		std::vector<unsigned int> Dynamic;
+
+		Scene()
+		{
+			Add(AABB{ { -200, -1, -200 }, { 200, 0, 200 } }, true);
+			for (int x = -5; x <= 5; x++)
+			{
+				for (int z = -5; z <= 5; z++)
+				{
+					Add(Box(x * 8.0f, 2.0f, z * 8.0f, 0.5f, 2.0f), true);
+					Dynamic.push_back(Add(Box(x * 8.0f + 4.0f, 1.0f, z * 8.0f + 4.0f, 0.5f, 0.5f), false));
+				}
+			}
+		}
+
+		unsigned int Add(const AABB& bounds, bool isStatic)
+		{
+			Bounds.push_back(bounds);
+			Static.push_back(isStatic);
+			Versions.push_back(0);
+			return (unsigned int)Bounds.size() - 1;
+		}
+
+		// Dynamic boxes bob and drift, every frame
+		void MoveDynamic(unsigned int frame)
+		{
+			for (size_t d = 0; d < Dynamic.size(); d++)
+			{
+				AABB& bounds = Bounds[Dynamic[d]];
+				float x = (bounds.Min.x + bounds.Max.x) * 0.5f;
+				float z = (bounds.Min.z + bounds.Max.z) * 0.5f;
+				float y = 1.0f + 3.0f * sinf(frame * 0.1f + d);
+				bounds = Box(x + 0.05f * cosf(frame * 0.03f + d), y, z, 0.5f, 0.5f);
+				Versions[Dynamic[d]]++;
+			}
+		}
+	};
+
+	// What each cascade's cached static shadows were last drawn with, kept separately from the cache
+	struct Drawn
+	{
+		bool Valid = false;
+		XMFLOAT4X4 ViewProjection;
+		std::vector<StaticShadowCaster> Casters;
+	};
+
+	struct Renderer
+	{
+		ShadowCascadeSettings Settings;
+		StaticShadowCache Cache;
+		Drawn Cached[MAX_SHADOW_CASCADES];
+		ShadowCascade Cascades[MAX_SHADOW_CASCADES];
+		std::vector<unsigned int> Casters[MAX_SHADOW_CASCADES];
+		unsigned int CascadeCount = 0;
+		bool CacheGood = true;
+
+		// Game::UpdateShadowCascades().  Returns which cascades re-rendered, one bit each.
+		unsigned int Frame(const Scene& scene, const CameraSetup& camera, XMFLOAT3 light)
+		{
+			CascadeCount = CalculateShadowCascades(Settings, camera.View, camera.Projection, nearClip, farClip, light, Cascades);
+
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&camera.View), XMLoadFloat4x4(&camera.Projection)));
+			std::vector<unsigned int> visible;
+			std::vector<unsigned int> statics;
+			for (unsigned int i = 0; i < (unsigned int)scene.Bounds.size(); i++)
+			{
+				if (IsAABBVisible(scene.Bounds[i], viewProjection))
+					visible.push_back(i);
+				if (scene.Static[i])
+					statics.push_back(i);
+			}
+
+			unsigned int stale = 0;
+			for (unsigned int c = 0; c < CascadeCount; c++)
+			{
+				CullShadowCasters(Cascades[c], scene.Bounds, statics, visible, Casters[c]);
+
+				std::vector<StaticShadowCaster> staticCasters;
+				for (unsigned int i : Casters[c])
+				{
+					if (scene.Static[i])
+						staticCasters.push_back({ i, scene.Versions[i] });
+				}
+
+				Drawn& drawn = Cached[c];
+				if (Cache.NeedsUpdate(c, Cascades[c].ViewProjection, staticCasters.data(), staticCasters.size()))
+				{
+					stale |= 1u << c;
+					drawn.Valid = true;
+					drawn.ViewProjection = Cascades[c].ViewProjection;
+					drawn.Casters = staticCasters;
+					continue;
+				}
+
+				// Reusing the cache: it has to be exactly what would be drawn now
+				bool same = drawn.Valid &&
+					memcmp(&drawn.ViewProjection, &Cascades[c].ViewProjection, sizeof(XMFLOAT4X4)) == 0 &&
+					drawn.Casters.size() == staticCasters.size();
+				for (size_t i = 0; same && i < staticCasters.size(); i++)
+				{
+					same = drawn.Casters[i].Index == staticCasters[i].Index &&
+						drawn.Casters[i].TransformVersion == staticCasters[i].TransformVersion;
+				}
+				CacheGood &= same;
+			}
+			return stale;
+		}
+
+		bool HasCaster(unsigned int c, unsigned int index)
+		{
+			return std::find(Casters[c].begin(), Casters[c].end(), index) != Casters[c].end();
+		}
+
+		// How far the cascade moves at a time
+		float Step(unsigned int c)
+		{
+			unsigned int stepTexels = std::max(1u, (unsigned int)(Settings.Resolution * SHADOW_CASCADE_SNAP + 0.5f));
+			return Cascades[c].HalfSize * 2.0f * stepTexels / Settings.Resolution;
+		}
+	};
+
+	const XMFLOAT3 light = { 1, -1, 1 };
+
+	unsigned int CountBits(unsigned int bits)
+	{
+		unsigned int count = 0;
+		for (; bits; bits &= bits - 1)
+			count++;
+		return count;
+	}
+
+	// A still camera with dynamic objects moving every frame never re-renders anything
+	bool DynamicObjects(unsigned int frames)
+	{
+		Scene scene;
+		Renderer renderer;
+		CameraSetup camera = MakeCamera({ 1.3f, 2.0f, -6.7f }, 0.3f);
+
+		bool ok = renderer.Frame(scene, camera, light) == (1u << renderer.CascadeCount) - 1;
+		unsigned int updates = 0;
+		for (unsigned int frame = 1; frame <= frames; frame++)
+		{
+			scene.MoveDynamic(frame);
+			updates += CountBits(renderer.Frame(scene, camera, light));
+		}
+		ok &= updates == 0 && renderer.CacheGood;
+		printf("  %u re-renders over %u frames\n", updates, frames);
+		return Check(ok, "Moving dynamic objects don't re-render static shadows");
+	}
+
+	// Moving or turning only re-renders a cascade when it steps, and each step is a good part of its size.
+	// The sphere a cascade is fitted to moves no further than the camera does plus how far its center
+	// (at most SplitFar from the camera) swings round, and every step means crossing a whole step on
+	// one of the three light space axes.
+	bool CameraMovement(unsigned int frames)
+	{
+		Scene scene;
+		Renderer renderer;
+		bool ok = true;
+
+		float distance = 10.0f;
+		float turn = XM_PIDIV2;
+		const char* names[] = { "walking", "turning" };
+		for (int test = 0; test < 2; test++)
+		{
+			unsigned int updates[MAX_SHADOW_CASCADES] = {};
+			for (unsigned int frame = 0; frame <= frames; frame++)
+			{
+				float t = (float)frame / frames;
+				CameraSetup camera = test == 0
+					? MakeCamera({ 1.3f + distance * t * 0.6f, 2.0f, -6.7f + distance * t * 0.8f }, 0.3f)
+					: MakeCamera({ 1.3f, 2.0f, -6.7f }, 0.3f + turn * t);
+				scene.MoveDynamic(frame);
+				unsigned int stale = renderer.Frame(scene, camera, light);
+				for (unsigned int c = 0; frame > 0 && c < renderer.CascadeCount; c++)
+					updates[c] += (stale >> c) & 1;
+			}
+
+			printf("  %s, re-renders over %u frames:", names[test], frames);
+			for (unsigned int c = 0; c < renderer.CascadeCount; c++)
+			{
+				float moved = test == 0 ? distance : turn * renderer.Cascades[c].SplitFar;
+				ok &= updates[c] <= 3 * (unsigned int)(moved / renderer.Step(c) + 1);
+				ok &= updates[c] < frames / 10;
+				printf(" %u", updates[c]);
+			}
+			printf("\n");
+		}
+		ok &= renderer.CacheGood;
+		return Check(ok, "The camera moving or turning only re-renders a cascade when it steps");
+	}
+
+	// A static object changing re-renders exactly the cascades it's in, and the light turning re-renders all
+	bool StaticChanges()
+	{
+		Scene scene;
+		Renderer renderer;
+		CameraSetup camera = MakeCamera({ 1.3f, 2.0f, -6.7f }, 0.3f);
+		bool ok = renderer.Frame(scene, camera, light) == (1u << renderer.CascadeCount) - 1;
+		unsigned int all = (1u << renderer.CascadeCount) - 1;
+
+		// Move a pillar the camera can see (and, with the same version, a pillar that didn't really move)
+		unsigned int pillar = 1 + 2 * (5 * 11 + 6);
+		unsigned int before = 0;
+		for (unsigned int c = 0; c < renderer.CascadeCount; c++)
+			before |= renderer.HasCaster(c, pillar) << c;
+		scene.Bounds[pillar] = Box(8.0f, 2.5f, 0.5f, 0.5f, 2.5f);
+		scene.Versions[pillar]++;
+		unsigned int stale = renderer.Frame(scene, camera, light);
+		unsigned int after = 0;
+		for (unsigned int c = 0; c < renderer.CascadeCount; c++)
+			after |= renderer.HasCaster(c, pillar) << c;
+		ok &= before != 0 && stale == (before | after);
+		ok &= renderer.Frame(scene, camera, light) == 0;
+
+		scene.Versions[pillar]++;
+		ok &= renderer.Frame(scene, camera, light) == after;
+
+		// A dynamic box becoming static (Entity::SetStatic)
+		unsigned int box = scene.Dynamic[5 * 11 + 5];
+		scene.Static[box] = true;
+		stale = renderer.Frame(scene, camera, light);
+		unsigned int holding = 0;
+		for (unsigned int c = 0; c < renderer.CascadeCount; c++)
+			holding |= renderer.HasCaster(c, box) << c;
+		ok &= holding != 0 && stale == holding;
+
+		// The light turning a little
+		ok &= renderer.Frame(scene, camera, { 1.0f, -1.0f, 1.01f }) == all;
+		ok &= renderer.Frame(scene, camera, { 1.0f, -1.0f, 1.01f }) == 0;
+
+		renderer.Cache.Invalidate();
+		ok &= renderer.Frame(scene, camera, { 1.0f, -1.0f, 1.01f }) == all;
+		ok &= renderer.CacheGood;
+		return Check(ok, "Static objects changing, the light turning and Invalidate() re-render");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int frames = argc >= 2 ? (unsigned int)atoi(argv[1]) : 600;
+
+	bool failed = false;
+	failed |= !DynamicObjects(frames);
+	failed |= !CameraMovement(frames);
+	failed |= !StaticChanges();
+
+	return failed ? 1 : 0;
+}
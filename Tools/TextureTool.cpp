@@ -0,0 +1,355 @@
+// Command line front end for the texture asset-processing stage
+// - Not part of the Visual Studio project; it shares ImageData/TextureProcessing with the game
+// - Builds anywhere with a C++17 compiler, e.g. from this folder:
+//     g++ -std=c++17 -O2 -pthread -I.. TextureTool.cpp ../ImageData.cpp ../BlockCompression.cpp ../MipGeneration.cpp ../TextureProcessing.cpp ../WorkerPool.cpp ../ContentHash.cpp -o TextureTool
+//
+// Usage:
+//   TextureTool pack-orm <textureFolder> [materialName ...]
+//     Packs <name>_ao/_roughness/_metal.png into Cache/<name>_orm.dds.
+//     With no names, every "<name>_roughness.png" in the folder is processed.
+//
+//   TextureTool compress <file.png | textureFolder> [bc1|bc4|bc5|bc7] [threads]
+//     Block compresses into the folder's Cache/, reporting encode throughput and PSNR.
+//     Without a format, one is chosen from the file name (see ChooseBCFormat).
+//     Every mip level is encoded, just like the game's texture cache.
+//
+//   TextureTool check-mips <file.png | textureFolder> [threads]
+//     Builds each texture's mip chain and compares it against a simple double precision
+//     reference.  Exits non-zero if any level differs by more than one step.
+//
+//   TextureTool load-bench <textureFolder> [maxThreads]
+//     Times decoding and mipmapping every PNG (as the game does at startup) on worker pools
+//     of 1, 2, 4... threads, to show how startup scales with core count.
+
+#include "../TextureProcessing.h"
+#include "../WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Finds every material that has a roughness map in the folder
+	std::vector<std::string> FindMaterials(const std::filesystem::path& folder)
+	{
+		const std::string suffix = "_roughness.png";
+		std::vector<std::string> names;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(folder, error))
+		{
+			std::string file = entry.path().filename().string();
+			if (file.size() > suffix.size() && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0)
+				names.push_back(file.substr(0, file.size() - suffix.size()));
+		}
+		return names;
+	}
+
+	int PackORMCommand(int argc, char** argv)
+	{
+		std::filesystem::path folder = argv[2];
+		std::vector<std::string> names;
+		for (int i = 3; i < argc; i++)
+			names.push_back(argv[i]);
+		if (names.empty())
+			names = FindMaterials(folder);
+
+		int failures = 0;
+		for (const std::string& name : names)
+		{
+			std::filesystem::path packed = BuildPackedORM(folder, name, true);
+			if (packed.empty())
+			{
+				printf("FAILED  %s\n", name.c_str());
+				failures++;
+				continue;
+			}
+			printf("packed  %s -> %s\n", name.c_str(), packed.string().c_str());
+		}
+		return failures == 0 ? 0 : 1;
+	}
+
+	const char* FormatName(BCFormat format)
+	{
+		switch (format)
+		{
+		case BC_FORMAT_BC1: return "BC1";
+		case BC_FORMAT_BC4: return "BC4";
+		case BC_FORMAT_BC5: return "BC5";
+		default:			return "BC7";
+		}
+	}
+
+	// Compresses one PNG, timing only the encode itself
+	bool CompressFile(const std::filesystem::path& source, const char* formatArg, unsigned int threads)
+	{
+		std::string name = source.stem().string();
+		BCFormat format = ChooseBCFormat(name);
+		if (formatArg)
+		{
+			if (strcmp(formatArg, "bc1") == 0) format = BC_FORMAT_BC1;
+			else if (strcmp(formatArg, "bc4") == 0) format = BC_FORMAT_BC4;
+			else if (strcmp(formatArg, "bc5") == 0) format = BC_FORMAT_BC5;
+			else format = BC_FORMAT_BC7;
+		}
+
+		ImageData image;
+		if (!LoadPNG(source, image))
+		{
+			printf("FAILED  %s (could not decode)\n", source.string().c_str());
+			return false;
+		}
+
+		// Mips are built the same way the game's cache builds them, but only the encode is timed
+		std::vector<ImageData> mips = GenerateMipChain(image, ChooseMipContent(name), threads);
+		auto start = std::chrono::high_resolution_clock::now();
+		CompressedImage compressed = CompressMipChain(mips, format, threads);
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Compare only the channels the format actually stores
+		int channels = format == BC_FORMAT_BC4 ? 1 : (format == BC_FORMAT_BC5 ? 2 : (format == BC_FORMAT_BC1 ? 3 : 4));
+		float psnr = CalculatePSNR(image, DecompressImage(compressed), channels);
+
+		std::filesystem::path output = GetCachedTexturePath(source.parent_path(), name);
+		std::error_code error;
+		std::filesystem::create_directories(output.parent_path(), error);
+		bool saved = SaveCompressedDDS(output, compressed);
+
+		double megapixels = 0;
+		for (const ImageData& mip : mips)
+			megapixels += (double)mip.Width * mip.Height / 1.0e6;
+		printf("%-8s %-26s %4ux%-4u %7.1f ms %8.1f MPix/s  PSNR %6.2f dB%s\n",
+			FormatName(format), name.c_str(), image.Width, image.Height,
+			seconds * 1000.0, megapixels / seconds, psnr, saved ? "" : "  (SAVE FAILED)");
+		return saved;
+	}
+
+	// --------------------------------------------------------
+	// Straightforward double precision mip chain, written as
+	// plainly as possible to check GenerateMipChain against
+	// --------------------------------------------------------
+	std::vector<ImageData> ReferenceMipChain(const ImageData& image, MipContent content)
+	{
+		auto decode = [content](unsigned char value, int ch) {
+			double v = value / 255.0;
+			if (ch == 3 || content == MIP_CONTENT_LINEAR) return v;
+			return content == MIP_CONTENT_GAMMA ? pow(v, (double)MIP_GAMMA) : v * 2.0 - 1.0;
+		};
+		auto encode = [content](double v, int ch) {
+			if (ch < 3 && content == MIP_CONTENT_GAMMA) v = pow(v, 1.0 / MIP_GAMMA);
+			if (ch < 3 && content == MIP_CONTENT_NORMAL_MAP) v = v * 0.5 + 0.5;
+			return (unsigned char)(std::min(std::max(v, 0.0), 1.0) * 255.0 + 0.5);
+		};
+
+		std::vector<ImageData> chain = { image };
+		std::vector<double> level(image.Pixels.size());
+		for (size_t i = 0; i < level.size(); i++)
+			level[i] = decode(image.Pixels[i], (int)(i % 4));
+
+		unsigned int width = image.Width;
+		unsigned int height = image.Height;
+		while (width > 1 || height > 1)
+		{
+			unsigned int newWidth = std::max(1u, width / 2);
+			unsigned int newHeight = std::max(1u, height / 2);
+			std::vector<double> next((size_t)newWidth * newHeight * 4);
+			ImageData mip;
+			mip.Width = newWidth;
+			mip.Height = newHeight;
+			mip.Pixels.resize(next.size());
+
+			for (unsigned int y = 0; y < newHeight; y++)
+			{
+				for (unsigned int x = 0; x < newWidth; x++)
+				{
+					double* out = &next[((size_t)y * newWidth + x) * 4];
+					for (int ch = 0; ch < 4; ch++)
+					{
+						double sum = 0;
+						for (unsigned int sy = y * 2; sy <= y * 2 + 1; sy++)
+						{
+							for (unsigned int sx = x * 2; sx <= x * 2 + 1; sx++)
+								sum += level[((size_t)std::min(sy, height - 1) * width + std::min(sx, width - 1)) * 4 + ch];
+						}
+						out[ch] = sum / 4.0;
+					}
+
+					if (content == MIP_CONTENT_NORMAL_MAP)
+					{
+						double length = sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+						for (int ch = 0; ch < 3 && length > 0.0001; ch++)
+							out[ch] /= length;
+					}
+					for (int ch = 0; ch < 4; ch++)
+						mip.Pixels[((size_t)y * newWidth + x) * 4 + ch] = encode(out[ch], ch);
+				}
+			}
+
+			chain.push_back(std::move(mip));
+			level = std::move(next);
+			width = newWidth;
+			height = newHeight;
+		}
+		return chain;
+	}
+
+	// Generates a file's mips and compares every level against the reference (allowing one step of rounding)
+	bool CheckMipsFile(const std::filesystem::path& source, unsigned int threads)
+	{
+		std::string name = source.stem().string();
+		MipContent content = ChooseMipContent(name);
+		ImageData image;
+		if (!LoadPNG(source, image))
+		{
+			printf("FAILED  %s (could not decode)\n", source.string().c_str());
+			return false;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::vector<ImageData> mips = GenerateMipChain(image, content, threads);
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		std::vector<ImageData> reference = ReferenceMipChain(image, content);
+
+		int worstDifference = 0;
+		bool sizesMatch = mips.size() == reference.size() && mips.size() == CalculateMipCount(image.Width, image.Height);
+		for (size_t m = 0; sizesMatch && m < mips.size(); m++)
+		{
+			if (mips[m].Width != reference[m].Width || mips[m].Height != reference[m].Height)
+			{
+				sizesMatch = false;
+				break;
+			}
+			for (size_t i = 0; i < mips[m].Pixels.size(); i++)
+				worstDifference = std::max(worstDifference, abs((int)mips[m].Pixels[i] - (int)reference[m].Pixels[i]));
+		}
+
+		const char* contentName = content == MIP_CONTENT_GAMMA ? "gamma" : (content == MIP_CONTENT_NORMAL_MAP ? "normal" : "linear");
+		bool passed = sizesMatch && worstDifference <= 1;
+		printf("%-6s %-26s %-6s %2zu mips %7.1f ms  max diff %d\n", passed ? "ok" : "FAILED",
+			name.c_str(), contentName, mips.size(), seconds * 1000.0, worstDifference);
+		return passed;
+	}
+
+	int CheckMipsCommand(int argc, char** argv)
+	{
+		std::filesystem::path input = argv[2];
+		unsigned int threads = argc > 3 ? (unsigned int)atoi(argv[3]) : 0;
+
+		int failures = 0;
+		if (std::filesystem::is_directory(input))
+		{
+			std::error_code error;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error))
+			{
+				if (entry.path().extension() == ".png" && !CheckMipsFile(entry.path(), threads))
+					failures++;
+			}
+		}
+		else if (!CheckMipsFile(input, threads))
+		{
+			failures++;
+		}
+		return failures == 0 ? 0 : 1;
+	}
+
+	// --------------------------------------------------------
+	// Times decoding + mipmapping every PNG under a folder on a
+	// WorkerPool of 1, 2, 4... threads, the way the game's
+	// TextureLoader does at startup
+	// --------------------------------------------------------
+	int LoadBenchmarkCommand(int argc, char** argv)
+	{
+		std::vector<std::filesystem::path> files;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[2], error))
+		{
+			if (entry.path().extension() == ".png")
+				files.push_back(entry.path());
+		}
+		unsigned int maxThreads = argc > 3 ? (unsigned int)atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+		printf("%zu files, %u hardware threads\n", files.size(), std::thread::hardware_concurrency());
+
+		double singleThreadSeconds = 0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			size_t bytes = 0;
+			{
+				WorkerPool pool(threads);
+				std::vector<std::future<size_t>> results;
+				for (const std::filesystem::path& file : files)
+				{
+					results.push_back(pool.Submit([file]() {
+						ImageData image;
+						if (!LoadPNG(file, image))
+							return (size_t)0;
+						// One thread per texture here, the pool provides the parallelism
+						std::vector<ImageData> mips = GenerateMipChain(image, ChooseMipContent(file.stem().string()), 1);
+						size_t total = 0;
+						for (const ImageData& mip : mips)
+							total += mip.Pixels.size();
+						return total;
+					}));
+				}
+				for (std::future<size_t>& result : results)
+					bytes += result.get();
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			if (threads == 1)
+				singleThreadSeconds = seconds;
+
+			printf("%3u threads %8.1f ms  %6.1f MB/s  speedup %.2fx\n", threads, seconds * 1000.0,
+				bytes / 1.0e6 / seconds, singleThreadSeconds / seconds);
+		}
+		return 0;
+	}
+
+	int CompressCommand(int argc, char** argv)
+	{
+		std::filesystem::path input = argv[2];
+		const char* format = argc > 3 ? argv[3] : nullptr;
+		unsigned int threads = argc > 4 ? (unsigned int)atoi(argv[4]) : 0;
+		if (format && strcmp(format, "auto") == 0)
+			format = nullptr;
+
+		int failures = 0;
+		if (std::filesystem::is_directory(input))
+		{
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator(input, error))
+			{
+				if (entry.path().extension() == ".png" && !CompressFile(entry.path(), format, threads))
+					failures++;
+			}
+		}
+		else if (!CompressFile(input, format, threads))
+		{
+			failures++;
+		}
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "pack-orm") == 0)
+		return PackORMCommand(argc, argv);
+	if (argc >= 3 && strcmp(argv[1], "compress") == 0)
+		return CompressCommand(argc, argv);
+	if (argc >= 3 && strcmp(argv[1], "check-mips") == 0)
+		return CheckMipsCommand(argc, argv);
+	if (argc >= 3 && strcmp(argv[1], "load-bench") == 0)
+		return LoadBenchmarkCommand(argc, argv);
+
+	printf("Usage:\n");
+	printf("  TextureTool pack-orm <textureFolder> [materialName ...]\n");
+	printf("  TextureTool compress <file.png | textureFolder> [auto|bc1|bc4|bc5|bc7] [threads]\n");
+	printf("  TextureTool check-mips <file.png | textureFolder> [threads]\n");
+	printf("  TextureTool load-bench <textureFolder> [maxThreads]\n");
+	return 1;
+}
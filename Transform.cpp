@@ -15,6 +15,7 @@ Transform::Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT4 rotation, Dir
     XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
     XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
     transformAltered = true;
+    version = 0;
     UpdateRotation();
 }
 
@@ -47,6 +48,11 @@ DirectX::XMFLOAT3* Transform::GetScale()
     return &scale;
 }
 
+unsigned int Transform::GetVersion()
+{
+    return version;
+}
+
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
     if (transformAltered)
@@ -100,18 +106,21 @@ void Transform::SetPosition(DirectX::XMFLOAT3 newPos)
 {
     position = newPos;
     transformAltered = true;
+    version++;
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
     position = XMFLOAT3(x, y, z);
     transformAltered = true;
+    version++;
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 newPitchYawRoll)
 {
     XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&newPitchYawRoll)));
     transformAltered = true;
+    version++;
     rotationAltered = true;
 }
 
@@ -119,6 +128,7 @@ void Transform::SetRotation(float pitch, float yaw, float roll)
 {
     XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
     transformAltered = true;
+    version++;
     rotationAltered = true;
 }
 
@@ -126,6 +136,7 @@ void Transform::SetRotation(DirectX::XMFLOAT4 newQuaternion)
 {
     rotation = newQuaternion;
     transformAltered = true;
+    version++;
     rotationAltered = true;
 }
 
@@ -133,12 +144,14 @@ void Transform::SetScale(DirectX::XMFLOAT3 newScale)
 {
     scale = newScale;
     transformAltered = true;
+    version++;
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
     scale = XMFLOAT3(x, y, z);
     transformAltered = true;
+    version++;
 }
 #pragma endregion
 
@@ -149,30 +162,35 @@ void Transform::MoveBy(DirectX::XMFLOAT3 offset)
 {
     XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMLoadFloat3(&offset)));
     transformAltered = true;
+    version++;
 }
 
 void Transform::MoveBy(float x, float y, float z)
 {
     XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMVectorSet(x, y, z, 0)));
     transformAltered = true;
+    version++;
 }
 
 void Transform::LocalMoveBy(DirectX::XMFLOAT3 offset)
 {
     XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMVector3Rotate(XMLoadFloat3(&offset), XMLoadFloat4(&rotation))));
     transformAltered = true;
+    version++;
 }
 
 void Transform::LocalMoveBy(float x, float y, float z)
 {
     XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMVector3Rotate(XMVectorSet(x, y, z, 0), XMLoadFloat4(&rotation))));
     transformAltered = true;
+    version++;
 }
 
 void Transform::RotateBy(DirectX::XMFLOAT4 quaternion)
 {
     XMStoreFloat4(&rotation, XMQuaternionMultiply(XMLoadFloat4(&rotation), XMLoadFloat4(&quaternion)));
     transformAltered = true;
+    version++;
     rotationAltered = true;
 }
 
@@ -180,6 +198,7 @@ void Transform::RotateBy(DirectX::XMFLOAT3 pitchYawRoll)
 {
     XMStoreFloat4(&rotation, XMQuaternionMultiply(XMLoadFloat4(&rotation), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))));
     transformAltered = true;
+    version++;
     rotationAltered = true;
 }
 
@@ -187,6 +206,7 @@ void Transform::RotateBy(float pitch, float yaw, float roll)
 {
     XMStoreFloat4(&rotation, XMQuaternionMultiply(XMLoadFloat4(&rotation), XMQuaternionRotationRollPitchYaw(pitch, yaw, roll)));
     transformAltered = true;
+    version++;
     rotationAltered = true;
 
 }
@@ -195,12 +215,14 @@ void Transform::ScaleBy(DirectX::XMFLOAT3 scaleFactor)
 {
     XMStoreFloat3(&scale, XMVectorMultiply(XMLoadFloat3(&scale), XMLoadFloat3(&scaleFactor)));
     transformAltered = true;
+    version++;
 }
 
 void Transform::ScaleBy(float x, float y, float z)
 {
     XMStoreFloat3(&scale, XMVectorMultiply(XMLoadFloat3(&scale), XMVectorSet(x, y, z, 0)));
     transformAltered = true;
+    version++;
 }
 #pragma endregion
 
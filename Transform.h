@@ -25,6 +25,7 @@ public:
 	DirectX::XMFLOAT3* GetForward();
 	float GetPitch();
 	float GetYaw();
+	unsigned int GetVersion(); // Goes up every time the transform changes
 
 	// Setters
 	void SetPosition(DirectX::XMFLOAT3 newPos);
@@ -65,6 +66,8 @@ private:
 	bool transformAltered;
 	// Has the rotation changed since the matrix was last calculated?
 	bool rotationAltered;
+	// How many times the transform has changed, so others can tell if it moved since they last looked
+	unsigned int version;
 
 	void UpdateMatrices();
 	void UpdateRotation();
@@ -5,8 +5,6 @@ cbuffer ExternalData : register(b0) {
 	matrix worldInvTranspose;
 	matrix view;
 	matrix projection;
-	matrix lightView;
-	matrix lightProjection;
 }
 
 // --------------------------------------------------------
@@ -23,9 +21,9 @@ VertexToPixel_NormalMap main(VertexShaderInput input)
 	matrix wvp = mul(projection, mul(view, world));
 	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 
-	// Calculating which pixel of the shadow map corresponds to this vertex. Z value will be the distance from the light
-	matrix shadowWVP = mul(lightProjection, mul(lightView, world));
-	output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+	// Depth in front of the camera decides which shadow cascade the pixel shader reads
+	// (abs() since right handed cameras look down -Z)
+	output.viewDepth = abs(mul(view, mul(world, float4(input.localPosition, 1.0f))).z);
 
 	// Transform the normal in the same way this vertex was transformed
 	output.normal = mul((float3x3)worldInvTranspose, input.normal); // Why does this work again???
@@ -0,0 +1,60 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+	: stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+unsigned int WorkerPool::GetThreadCount()
+{
+	return (unsigned int)threads.size();
+}
+
+void WorkerPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+// --------------------------------------------------------
+// Each worker sleeps until there's something in the queue,
+// and only exits once stopping AND the queue is drained
+// --------------------------------------------------------
+void WorkerPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// A fixed set of background threads that run queued tasks in order
+// - Used to get slow CPU work (like decoding textures) off the main thread
+// - No Windows/D3D dependencies, so it can be used (and measured) by the offline tools too
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	// Zero threads means "one per hardware thread, minus one for the main thread"
+	WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool(); // Finishes everything already queued, then joins
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Queues a task and returns a future for its result
+	template<typename Function>
+	std::future<std::invoke_result_t<Function>> Submit(Function task)
+	{
+		using Result = std::invoke_result_t<Function>;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> future = packaged->get_future();
+		Enqueue([packaged]() { (*packaged)(); });
+		return future;
+	}
+
+	unsigned int GetThreadCount();
+
+private:
+	void Enqueue(std::function<void()> task);
+	void WorkerLoop();
+
+	std::vector<std::thread> threads;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	bool stopping;
+};